@@ -39,6 +39,7 @@
 #include "assoc_mgr.h"
 
 #include <sys/types.h>
+#include <ctype.h>
 #include <pwd.h>
 #include <fcntl.h>
 
@@ -70,6 +71,190 @@ void (*update_resvs) () = NULL;
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
 
+/* Hash tables over assoc_mgr_association_list and assoc_mgr_user_list
+ * so the lookups done on every job submission don't have to walk the
+ * entire list.  Associations are chained through their usage record,
+ * by id and by user/account, in the same order they sit in the list.
+ * Users are kept in open addressed tables by uid and by name.  The
+ * tables are rebuilt whenever a list is replaced or changes shape,
+ * under the same write lock that protects the list itself. */
+static slurmdb_association_rec_t **assoc_hash_id = NULL;
+static slurmdb_association_rec_t **assoc_hash = NULL;
+static int assoc_hash_size = 0;
+static slurmdb_user_rec_t **user_hash_uid = NULL;
+static slurmdb_user_rec_t **user_hash_name = NULL;
+static int user_hash_size = 0;
+
+static int _assoc_hash_inx(uint32_t uid, char *acct)
+{
+	uint32_t hash = uid;
+
+	if (acct) {
+		for ( ; *acct; acct++)
+			hash = (hash * 31) + tolower((int)*acct);
+	}
+	return (int)(hash % assoc_hash_size);
+}
+
+static int _user_name_hash_inx(char *name)
+{
+	uint32_t hash = 0;
+
+	for ( ; *name; name++)
+		hash = (hash * 31) + tolower((int)*name);
+	return (int)(hash % user_hash_size);
+}
+
+/* Locks should be in place before calling this. */
+static void _rebuild_assoc_hash(void)
+{
+	slurmdb_association_rec_t **tail_id = NULL, **tail = NULL;
+	slurmdb_association_rec_t *assoc = NULL;
+	ListIterator itr = NULL;
+	int inx;
+
+	xfree(assoc_hash_id);
+	xfree(assoc_hash);
+	assoc_hash_size = 0;
+	if (!assoc_mgr_association_list
+	    || !list_count(assoc_mgr_association_list))
+		return;
+
+	assoc_hash_size = list_count(assoc_mgr_association_list);
+	assoc_hash_id = xmalloc(sizeof(slurmdb_association_rec_t *) *
+				assoc_hash_size);
+	assoc_hash = xmalloc(sizeof(slurmdb_association_rec_t *) *
+			     assoc_hash_size);
+	tail_id = xmalloc(sizeof(slurmdb_association_rec_t *) *
+			  assoc_hash_size);
+	tail = xmalloc(sizeof(slurmdb_association_rec_t *) * assoc_hash_size);
+
+	/* Append to the end of each chain so a walk down a chain sees
+	 * the associations in list order, same as a list scan would. */
+	itr = list_iterator_create(assoc_mgr_association_list);
+	while ((assoc = list_next(itr))) {
+		if (!assoc->usage)
+			assoc->usage = create_assoc_mgr_association_usage();
+		assoc->usage->assoc_next_id = NULL;
+		assoc->usage->assoc_next = NULL;
+
+		inx = assoc->id % assoc_hash_size;
+		if (tail_id[inx])
+			tail_id[inx]->usage->assoc_next_id = assoc;
+		else
+			assoc_hash_id[inx] = assoc;
+		tail_id[inx] = assoc;
+
+		inx = _assoc_hash_inx(assoc->uid, assoc->acct);
+		if (tail[inx])
+			tail[inx]->usage->assoc_next = assoc;
+		else
+			assoc_hash[inx] = assoc;
+		tail[inx] = assoc;
+	}
+	list_iterator_destroy(itr);
+	xfree(tail_id);
+	xfree(tail);
+}
+
+/* Locks should be in place before calling this. */
+static slurmdb_association_rec_t *_find_assoc_rec_id(uint32_t assoc_id)
+{
+	slurmdb_association_rec_t *assoc = NULL;
+
+	if (!assoc_hash_id)
+		return NULL;
+
+	assoc = assoc_hash_id[assoc_id % assoc_hash_size];
+	while (assoc) {
+		if (assoc->id == assoc_id)
+			break;
+		assoc = assoc->usage->assoc_next_id;
+	}
+	return assoc;
+}
+
+/* Locks should be in place before calling this. */
+static void _rebuild_user_hash(void)
+{
+	slurmdb_user_rec_t *user = NULL;
+	ListIterator itr = NULL;
+	int inx;
+
+	xfree(user_hash_uid);
+	xfree(user_hash_name);
+	user_hash_size = 0;
+	if (!assoc_mgr_user_list || !list_count(assoc_mgr_user_list))
+		return;
+
+	/* Keep the tables at most half full so probes stay short */
+	user_hash_size = (list_count(assoc_mgr_user_list) * 2) + 1;
+	user_hash_uid = xmalloc(sizeof(slurmdb_user_rec_t *) *
+				user_hash_size);
+	user_hash_name = xmalloc(sizeof(slurmdb_user_rec_t *) *
+				 user_hash_size);
+
+	/* Only the first of any duplicates goes in, which is what a
+	 * scan of the list would have found. */
+	itr = list_iterator_create(assoc_mgr_user_list);
+	while ((user = list_next(itr))) {
+		if (user->uid != NO_VAL) {
+			inx = user->uid % user_hash_size;
+			while (user_hash_uid[inx]
+			       && (user_hash_uid[inx]->uid != user->uid))
+				inx = (inx + 1) % user_hash_size;
+			if (!user_hash_uid[inx])
+				user_hash_uid[inx] = user;
+		}
+		if (user->name) {
+			inx = _user_name_hash_inx(user->name);
+			while (user_hash_name[inx]
+			       && strcasecmp(user_hash_name[inx]->name,
+					     user->name))
+				inx = (inx + 1) % user_hash_size;
+			if (!user_hash_name[inx])
+				user_hash_name[inx] = user;
+		}
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Locks should be in place before calling this. */
+static slurmdb_user_rec_t *_find_user_rec_uid(uint32_t uid)
+{
+	slurmdb_user_rec_t *user = NULL;
+	int inx;
+
+	if (!user_hash_uid || (uid == NO_VAL))
+		return NULL;
+
+	inx = uid % user_hash_size;
+	while ((user = user_hash_uid[inx])) {
+		if (user->uid == uid)
+			break;
+		inx = (inx + 1) % user_hash_size;
+	}
+	return user;
+}
+
+/* Locks should be in place before calling this. */
+static slurmdb_user_rec_t *_find_user_rec_name(char *name)
+{
+	slurmdb_user_rec_t *user = NULL;
+	int inx;
+
+	if (!user_hash_name || !name)
+		return NULL;
+
+	inx = _user_name_hash_inx(name);
+	while ((user = user_hash_name[inx])) {
+		if (!strcasecmp(user->name, name))
+			break;
+		inx = (inx + 1) % user_hash_size;
+	}
+	return user;
+}
+
 /* you should check for assoc == NULL before this function */
 static void _normalize_assoc_shares(slurmdb_association_rec_t *assoc)
 {
@@ -534,6 +719,8 @@ static int _post_association_list(List assoc_list)
 	list_iterator_destroy(itr);
 
 	slurmdb_sort_hierarchical_assoc_list(assoc_list);
+	if (assoc_list == assoc_mgr_association_list)
+		_rebuild_assoc_hash();
 
 	//END_TIMER2("load_associations");
 	return SLURM_SUCCESS;
@@ -662,6 +849,7 @@ static int _get_assoc_mgr_association_list(void *db_conn, int enforce)
 		   isn't anything there */
 		assoc_mgr_association_list =
 			list_create(slurmdb_destroy_association_rec);
+		_rebuild_assoc_hash();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_association_list: "
@@ -724,6 +912,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	assoc_mgr_user_list = acct_storage_g_get_users(db_conn, uid, &user_q);
 
 	if (!assoc_mgr_user_list) {
+		_rebuild_user_hash();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_user_list: "
@@ -735,6 +924,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	}
 
 	_post_user_list(assoc_mgr_user_list);
+	_rebuild_user_hash();
 
 	assoc_mgr_unlock(&locks);
 	return SLURM_SUCCESS;
@@ -800,7 +990,6 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 	List current_assocs = NULL;
 	uid_t uid = getuid();
 	ListIterator curr_itr = NULL;
-	ListIterator assoc_mgr_itr = NULL;
 	slurmdb_association_rec_t *curr_assoc = NULL, *assoc = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
@@ -845,17 +1034,13 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 	}
 
 	curr_itr = list_iterator_create(current_assocs);
-	assoc_mgr_itr = list_iterator_create(assoc_mgr_association_list);
 
 	/* add used limits We only look for the user associations to
 	 * do the parents since a parent may have moved */
 	while ((curr_assoc = list_next(curr_itr))) {
 		if (!curr_assoc->user)
 			continue;
-		while ((assoc = list_next(assoc_mgr_itr))) {
-			if (assoc->id == curr_assoc->id)
-				break;
-		}
+		assoc = _find_assoc_rec_id(curr_assoc->id);
 
 		while (assoc) {
 			_addto_used_info(assoc, curr_assoc);
@@ -863,11 +1048,9 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 			   different than the one we are updating from */
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-		list_iterator_reset(assoc_mgr_itr);
 	}
 
 	list_iterator_destroy(curr_itr);
-	list_iterator_destroy(assoc_mgr_itr);
 
 	assoc_mgr_unlock(&locks);
 
@@ -937,6 +1120,7 @@ static int _refresh_assoc_mgr_user_list(void *db_conn, int enforce)
 		list_destroy(assoc_mgr_user_list);
 
 	assoc_mgr_user_list = current_users;
+	_rebuild_user_hash();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1150,6 +1334,8 @@ extern int assoc_mgr_fini(char *state_save_location)
 	assoc_mgr_qos_list = NULL;
 	assoc_mgr_user_list = NULL;
 	assoc_mgr_wckey_list = NULL;
+	_rebuild_assoc_hash();
+	_rebuild_user_hash();
 
 	return SLURM_SUCCESS;
 }
@@ -1305,7 +1491,6 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 				   int enforce,
 				   slurmdb_association_rec_t **assoc_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_association_rec_t * found_assoc = NULL;
 	slurmdb_association_rec_t * ret_assoc = NULL;
 	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
@@ -1376,62 +1561,61 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 /* 	     assoc->user, assoc->uid, assoc->acct, */
 /* 	     assoc->cluster, assoc->partition); */
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_association_list);
-	while ((found_assoc = list_next(itr))) {
-		if (assoc->id) {
-			if (assoc->id == found_assoc->id) {
-				ret_assoc = found_assoc;
-				break;
-			}
+	if (assoc->id)
+		ret_assoc = _find_assoc_rec_id(assoc->id);
+	else if (assoc_hash)
+		found_assoc = assoc_hash[_assoc_hash_inx(assoc->uid,
+							 assoc->acct)];
+	/* Any association that can match is on this chain, in the
+	 * order it is in the list, so the partition fallback below
+	 * picks the same one a scan of the whole list would. */
+	for ( ; found_assoc;
+	      found_assoc = found_assoc->usage->assoc_next) {
+		if (assoc->uid == NO_VAL
+		    && found_assoc->uid != NO_VAL) {
+			debug3("we are looking for a "
+			       "nonuser association");
 			continue;
-		} else {
-			if (assoc->uid == NO_VAL
-			    && found_assoc->uid != NO_VAL) {
-				debug3("we are looking for a "
-				       "nonuser association");
-				continue;
-			} else if (assoc->uid != found_assoc->uid) {
-				debug4("not the right user %u != %u",
-				       assoc->uid, found_assoc->uid);
-				continue;
-			}
+		} else if (assoc->uid != found_assoc->uid) {
+			debug4("not the right user %u != %u",
+			       assoc->uid, found_assoc->uid);
+			continue;
+		}
 
-			if (found_assoc->acct
-			    && strcasecmp(assoc->acct, found_assoc->acct)) {
-				debug4("not the right account %s != %s",
-				       assoc->acct, found_assoc->acct);
-				continue;
-			}
+		if (found_assoc->acct
+		    && strcasecmp(assoc->acct, found_assoc->acct)) {
+			debug4("not the right account %s != %s",
+			       assoc->acct, found_assoc->acct);
+			continue;
+		}
 
-			/* only check for on the slurmdbd */
-			if (!assoc_mgr_cluster_name && found_assoc->cluster
-			    && strcasecmp(assoc->cluster,
-					  found_assoc->cluster)) {
-				debug4("not the right cluster");
-				continue;
-			}
+		/* only check for on the slurmdbd */
+		if (!assoc_mgr_cluster_name && found_assoc->cluster
+		    && strcasecmp(assoc->cluster,
+				  found_assoc->cluster)) {
+			debug4("not the right cluster");
+			continue;
+		}
 
-			if (assoc->partition) {
-				if (!found_assoc->partition) {
-					ret_assoc = found_assoc;
-					debug3("found association "
-					       "for no partition");
-					continue;
-				} else if (strcasecmp(assoc->partition,
-						      found_assoc->partition)) {
-					debug4("not the right partition");
-					continue;
-				}
-			} else if (found_assoc->partition) {
-				debug4("partition specific association "
-				       "looking for one without.");
+		if (assoc->partition) {
+			if (!found_assoc->partition) {
+				ret_assoc = found_assoc;
+				debug3("found association "
+				       "for no partition");
+				continue;
+			} else if (strcasecmp(assoc->partition,
+					      found_assoc->partition)) {
+				debug4("not the right partition");
 				continue;
 			}
+		} else if (found_assoc->partition) {
+			debug4("partition specific association "
+			       "looking for one without.");
+			continue;
 		}
 		ret_assoc = found_assoc;
 		break;
 	}
-	list_iterator_destroy(itr);
 
 	if (!ret_assoc) {
 		assoc_mgr_unlock(&locks);
@@ -1530,7 +1714,6 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 				  int enforce,
 				  slurmdb_user_rec_t **user_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -1546,16 +1729,10 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
-				break;
-		} else if (user->name
-			   && !strcasecmp(user->name, found_user->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	if (user->uid != NO_VAL)
+		found_user = _find_user_rec_uid(user->uid);
+	else
+		found_user = _find_user_rec_name(user->name);
 
 	if (!found_user) {
 		assoc_mgr_unlock(&locks);
@@ -1863,7 +2040,6 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 						       uint32_t uid)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -1876,12 +2052,7 @@ extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 		return SLURMDB_ADMIN_NOTSET;
 
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (uid == found_user->uid)
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_user = _find_user_rec_uid(uid);
 	assoc_mgr_unlock(&locks);
 
 	if (found_user)
@@ -1908,12 +2079,7 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn,
 		return false;
 
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (uid == found_user->uid)
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_user = _find_user_rec_uid(uid);
 
 	if (!found_user || !found_user->coord_accts) {
 		assoc_mgr_unlock(&locks);
@@ -2063,12 +2229,6 @@ extern List assoc_mgr_get_shares(void *db_conn,
 		share->usage_raw = (uint64_t)assoc->usage->usage_raw;
 
 		if (assoc->user) {
-			/* We only calculate user effective usage when
-			 * we need it
-			 */
-			if (assoc->usage->usage_efctv == (long double)NO_VAL)
-				priority_g_set_assoc_usage(assoc);
-
 			share->name = xstrdup(assoc->user);
 			share->parent = xstrdup(assoc->acct);
 			share->user = 1;
@@ -2167,6 +2327,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 	int parents_changed = 0;
 	int run_update_resvs = 0;
 	int resort = 0;
+	int rehash = 0;
 	List remove_list = NULL;
 	List update_list = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
@@ -2408,6 +2569,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 				object->is_def = 0;
 			list_append(assoc_mgr_association_list, object);
 			object = NULL;
+			rehash = 1;
 			parents_changed = 1; /* set since we need to
 						set the parent
 					     */
@@ -2422,6 +2584,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 
 			run_update_resvs = 1; /* needed for updating
 						 reservations */
+			rehash = 1;
 
 			if (setup_children)
 				parents_changed = 1; /* set since we need to
@@ -2535,6 +2698,10 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 		slurmdb_sort_hierarchical_assoc_list(
 			assoc_mgr_association_list);
 
+	/* The list order or the uids may have changed as well */
+	if (rehash || parents_changed || resort)
+		_rebuild_assoc_hash();
+
 	list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 
@@ -2687,6 +2854,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 
 	ListIterator itr = NULL;
 	int rc = SLURM_SUCCESS;
+	int rehash = 0;
 	uid_t pw_uid;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
 				   NO_LOCK, WRITE_LOCK, WRITE_LOCK };
@@ -2728,6 +2896,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 				rec->name = object->name;
 				object->name = NULL;
 				rc = _change_user_name(rec);
+				rehash = 1;
 			}
 
 			if (object->default_acct) {
@@ -2759,6 +2928,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 				object->uid = pw_uid;
 			list_append(assoc_mgr_user_list, object);
 			object = NULL;
+			rehash = 1;
 			break;
 		case SLURMDB_REMOVE_USER:
 			if (!rec) {
@@ -2766,6 +2936,7 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 				break;
 			}
 			list_delete_item(itr);
+			rehash = 1;
 			break;
 		case SLURMDB_ADD_COORD:
 			/* same as SLURMDB_REMOVE_COORD */
@@ -2792,6 +2963,10 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 		slurmdb_destroy_user_rec(object);
 	}
 	list_iterator_destroy(itr);
+	if (rehash) {
+		_rebuild_user_hash();
+		_rebuild_assoc_hash();
+	}
 	assoc_mgr_unlock(&locks);
 
 	return rc;
@@ -3088,7 +3263,6 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 				       uint32_t assoc_id,
 				       int enforce)
 {
-	ListIterator itr = NULL;
 	slurmdb_association_rec_t * found_assoc = NULL;
 	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
@@ -3104,12 +3278,7 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 		return SLURM_SUCCESS;
 
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_association_list);
-	while ((found_assoc = list_next(itr))) {
-		if (assoc_id == found_assoc->id)
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_assoc = _find_assoc_rec_id(assoc_id);
 	assoc_mgr_unlock(&locks);
 
 	if (found_assoc || !(enforce & ACCOUNTING_ENFORCE_ASSOCS))
@@ -3460,7 +3629,6 @@ extern int load_assoc_usage(char *state_save_location)
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
-	ListIterator itr = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, READ_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
 
@@ -3516,7 +3684,6 @@ extern int load_assoc_usage(char *state_save_location)
 
 	safe_unpack_time(&buf_time, buffer);
 
-	itr = list_iterator_create(assoc_mgr_association_list);
 	while (remaining_buf(buffer) > 0) {
 		uint32_t assoc_id = 0;
 		uint32_t grp_used_wall = 0;
@@ -3526,9 +3693,7 @@ extern int load_assoc_usage(char *state_save_location)
 		safe_unpack32(&assoc_id, buffer);
 		safe_unpack64(&usage_raw, buffer);
 		safe_unpack32(&grp_used_wall, buffer);
-		while ((assoc = list_next(itr)))
-			if (assoc->id == assoc_id)
-				break;
+		assoc = _find_assoc_rec_id(assoc_id);
 
 		/* We want to do this all the way up to and including
 		   root.  This way we can keep track of how much usage
@@ -3541,9 +3706,7 @@ extern int load_assoc_usage(char *state_save_location)
 
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-		list_iterator_reset(itr);
 	}
-	list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 
 	free_buf(buffer);
@@ -3552,8 +3715,6 @@ extern int load_assoc_usage(char *state_save_location)
 unpack_error:
 	if (buffer)
 		free_buf(buffer);
-	if (itr)
-		list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 	return SLURM_ERROR;
 }
@@ -3756,6 +3917,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				list_destroy(assoc_mgr_user_list);
 			assoc_mgr_user_list = msg->my_list;
 			_post_user_list(assoc_mgr_user_list);
+			_rebuild_user_hash();
 			debug("Recovered %u users",
 			      list_count(assoc_mgr_user_list));
 			msg->my_list = NULL;
@@ -3908,6 +4070,8 @@ extern int assoc_mgr_set_missing_uids()
 		}
 		list_iterator_destroy(itr);
 	}
+	_rebuild_assoc_hash();
+	_rebuild_user_hash();
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -97,6 +97,13 @@ typedef struct {
 } assoc_init_args_t;
 
 struct assoc_mgr_association_usage {
+	slurmdb_association_rec_t *assoc_next; /* next assoc with the
+						* same user/account hash
+						* (DON'T PACK) */
+	slurmdb_association_rec_t *assoc_next_id; /* next assoc with the
+						   * same id hash
+						   * (DON'T PACK) */
+
 	List childern_list;     /* list of childern associations
 				 * (DON'T PACK) */
 
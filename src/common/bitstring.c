@@ -66,6 +66,7 @@ strong_alias(bit_free,		slurm_bit_free);
 strong_alias(bit_realloc,	slurm_bit_realloc);
 strong_alias(bit_size,		slurm_bit_size);
 strong_alias(bit_and,		slurm_bit_and);
+strong_alias(bit_and_not,	slurm_bit_and_not);
 strong_alias(bit_not,		slurm_bit_not);
 strong_alias(bit_or,		slurm_bit_or);
 strong_alias(bit_set_count,	slurm_bit_set_count);
@@ -95,6 +96,176 @@ strong_alias(bit_copybits,	slurm_bit_copybits);
 strong_alias(bit_get_bit_num,	slurm_bit_get_bit_num);
 strong_alias(bit_get_pos_num,	slurm_bit_get_pos_num);
 
+/* bitstr_t words are operated on as unsigned values */
+#ifdef USE_64BIT_BITSTR
+typedef uint64_t bitword_t;
+#else
+typedef uint32_t bitword_t;
+#endif
+
+/* number of bits in a bitstr_t word */
+#define BITSTR_WORD_BITS	(sizeof(bitstr_t) * 8)
+
+/* index one past the last data word of a bitstring */
+#define _bitstr_end_word(name)	(_bitstr_words(_bitstr_bits(name)))
+
+/*
+ * Returns the hamming weight (i.e. the number of bits set) in a word.
+ * Use the compiler's builtin where it maps to a single instruction,
+ * otherwise the usual parallel bit count.
+ */
+static inline int
+hweight(bitword_t w)
+{
+#if defined(__GNUC__) && defined(__POPCNT__)
+#  ifdef USE_64BIT_BITSTR
+	return __builtin_popcountll(w);
+#  else
+	return __builtin_popcount(w);
+#  endif
+#else
+#  ifdef USE_64BIT_BITSTR
+	w = w - ((w >> 1) & 0x5555555555555555ULL);
+	w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+	w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (int) ((w * 0x0101010101010101ULL) >> 56);
+#  else
+	w = w - ((w >> 1) & 0x55555555);
+	w = (w & 0x33333333) + ((w >> 2) & 0x33333333);
+	w = (w + (w >> 4)) & 0x0F0F0F0F;
+	return (int) ((w * 0x01010101) >> 24);
+#  endif
+#endif
+}
+
+/*
+ * Mask of the valid bits in the last word of a bitstring. Bits past the end
+ * of the bitstring may be set (e.g. by bit_not() or bit_realloc()), so they
+ * must be masked off by any operation examining whole words.
+ */
+static inline bitword_t
+_bit_tail_mask(bitstr_t *b)
+{
+	int tail = _bitstr_bits(b) & BITSTR_MAXPOS;
+
+	if (tail == 0)
+		return ~((bitword_t) 0);
+#ifdef SLURM_BIGENDIAN
+	return ~(~((bitword_t) 0) >> tail);
+#else
+	return (((bitword_t) 1) << tail) - 1;
+#endif
+}
+
+/* Return data word i of b, masking bits past the end of the bitstring */
+static inline bitword_t
+_bit_word_val(bitstr_t *b, bitoff_t i)
+{
+	if (i == (_bitstr_end_word(b) - 1))
+		return ((bitword_t) b[i]) & _bit_tail_mask(b);
+	return (bitword_t) b[i];
+}
+
+/* Bit offset of word i's first bit */
+#define _word_first_bit(i)	(((bitoff_t) ((i) - BITSTR_OVERHEAD)) << \
+				 BITSTR_SHIFT)
+
+/* Position within a non-zero word of its lowest numbered set bit */
+static inline int
+_word_ffs(bitword_t w)
+{
+#if defined(__GNUC__)
+#  ifdef SLURM_BIGENDIAN
+#    ifdef USE_64BIT_BITSTR
+	return __builtin_clzll(w);
+#    else
+	return __builtin_clz(w);
+#    endif
+#  else
+#    ifdef USE_64BIT_BITSTR
+	return __builtin_ctzll(w);
+#    else
+	return __builtin_ctz(w);
+#    endif
+#  endif
+#else
+	int pos = 0;
+
+	while (!(w & _bit_mask(pos)))
+		pos++;
+	return pos;
+#endif
+}
+
+/* Position within a non-zero word of its highest numbered set bit */
+static inline int
+_word_fls(bitword_t w)
+{
+#if defined(__GNUC__)
+#  ifdef SLURM_BIGENDIAN
+#    ifdef USE_64BIT_BITSTR
+	return BITSTR_MAXPOS - __builtin_ctzll(w);
+#    else
+	return BITSTR_MAXPOS - __builtin_ctz(w);
+#    endif
+#  else
+#    ifdef USE_64BIT_BITSTR
+	return BITSTR_MAXPOS - __builtin_clzll(w);
+#    else
+	return BITSTR_MAXPOS - __builtin_clz(w);
+#    endif
+#  endif
+#else
+	int pos = BITSTR_MAXPOS;
+
+	while (!(w & _bit_mask(pos)))
+		pos--;
+	return pos;
+#endif
+}
+
+/*
+ * Find the first run of n contiguous bits which are all set (or all clear)
+ * starting within [start, end), testing whole words at once where possible.
+ *   RETURN	position of first bit in run (-1 if none found)
+ */
+static bitoff_t
+_bit_find_run(bitstr_t *b, int n, bitoff_t start, bitoff_t end, int set)
+{
+	bitoff_t bit = start;
+	bitword_t word;
+	int cnt = 0;
+
+	while (bit < end) {
+		if (((bit & BITSTR_MAXPOS) == 0) &&
+		    ((bit + BITSTR_WORD_BITS) <= end)) {
+			word = (bitword_t) b[_bit_word(bit)];
+			if (!set)
+				word = ~word;
+			if (word == 0) {
+				cnt = 0;
+				bit += BITSTR_WORD_BITS;
+				continue;
+			}
+			if (word == ~((bitword_t) 0)) {
+				if ((cnt + BITSTR_WORD_BITS) >= n)
+					return bit - cnt;
+				cnt += BITSTR_WORD_BITS;
+				bit += BITSTR_WORD_BITS;
+				continue;
+			}
+		}
+		if (bit_test(b, bit) == set) {
+			cnt++;
+			if (cnt >= n)
+				return bit - (cnt - 1);
+		} else
+			cnt = 0;
+		bit++;
+	}
+	return -1;
+}
+
 /*
  * Allocate a bitstring.
  *   nbits (IN)		valid bits in new bitstring, initialized to all clear
@@ -257,26 +428,20 @@ bit_nclear(bitstr_t *b, bitoff_t start, bitoff_t stop)
 bitoff_t
 bit_ffc(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t i, end;
+	bitword_t word;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int word = _bit_word(bit);
-
-		if (b[word] == BITSTR_MAXPOS) {
-			bit += sizeof(bitstr_t)*8;
-			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (!bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+	end = _bitstr_end_word(b);
+	for (i = BITSTR_OVERHEAD; i < end; i++) {
+		word = ~((bitword_t) b[i]);
+		if (i == (end - 1))
+			word &= _bit_tail_mask(b);
+		if (word)
+			return _word_first_bit(i) + _word_ffs(word);
 	}
-	return value;
+	return -1;
 }
 
 /* Find the first n contiguous bits clear in b.
@@ -287,26 +452,10 @@ bit_ffc(bitstr_t *b)
 bitoff_t
 bit_nffc(bitstr_t *b, int n)
 {
-	bitoff_t value = -1;
-	bitoff_t bit;
-	int cnt = 0;
-
 	_assert_bitstr_valid(b);
 	assert(n > 0 && n < _bitstr_bits(b));
 
-	for (bit = 0; bit < _bitstr_bits(b); bit++) {
-		if (bit_test(b, bit)) {		/* fail */
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				break;
-			}
-		}
-	}
-
-	return value;
+	return _bit_find_run(b, n, 0, _bitstr_bits(b), 0);
 }
 
 /* Find n contiguous bits clear in b starting at some offset.
@@ -318,9 +467,7 @@ bit_nffc(bitstr_t *b, int n)
 bitoff_t
 bit_noc(bitstr_t *b, int n, int seed)
 {
-	bitoff_t value = -1;
-	bitoff_t bit;
-	int cnt = 0;
+	bitoff_t value;
 
 	_assert_bitstr_valid(b);
 	assert(n > 0 && n <= _bitstr_bits(b));
@@ -328,34 +475,13 @@ bit_noc(bitstr_t *b, int n, int seed)
 	if ((seed + n) >= _bitstr_bits(b))
 		seed = _bitstr_bits(b);	/* skip offset test, too small */
 
-	for (bit = seed; bit < _bitstr_bits(b); bit++) {	/* start at offset */
-		if (bit_test(b, bit)) {		/* fail */
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				return value;
-			}
-		}
-	}
+	/* start at offset */
+	value = _bit_find_run(b, n, seed, _bitstr_bits(b), 0);
+	if (value != -1)
+		return value;
 
-	cnt = 0;	/* start at beginning */
-	for (bit = 0; bit < _bitstr_bits(b); bit++) {
-		if (bit_test(b, bit)) {		/* fail */
-			if (bit >= seed)
-				break;
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				return value;
-			}
-		}
-	}
-
-	return -1;
+	/* start at beginning, for runs starting before the offset */
+	return _bit_find_run(b, n, 0, MIN(_bitstr_bits(b), seed + n - 1), 0);
 }
 
 /* Find the first n contiguous bits set in b.
@@ -366,26 +492,10 @@ bit_noc(bitstr_t *b, int n, int seed)
 bitoff_t
 bit_nffs(bitstr_t *b, int n)
 {
-	bitoff_t value = -1;
-	bitoff_t bit;
-	int cnt = 0;
-
 	_assert_bitstr_valid(b);
 	assert(n > 0 && n <= _bitstr_bits(b));
 
-	for (bit = 0; bit <= _bitstr_bits(b) - n; bit++) {
-		if (!bit_test(b, bit)) {	/* fail */
-			cnt = 0;
-		} else {
-			cnt++;
-			if (cnt >= n) {
-				value = bit - (cnt - 1);
-				break;
-			}
-		}
-	}
-
-	return value;
+	return _bit_find_run(b, n, 0, _bitstr_bits(b), 1);
 }
 
 /*
@@ -396,26 +506,20 @@ bit_nffs(bitstr_t *b, int n)
 bitoff_t
 bit_ffs(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t i, end;
+	bitword_t word;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int word = _bit_word(bit);
-
-		if (b[word] == 0) {
-			bit += sizeof(bitstr_t)*8;
+	end = _bitstr_end_word(b);
+	for (i = BITSTR_OVERHEAD; i < end; i++) {
+		if (b[i] == 0)
 			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+		word = _bit_word_val(b, i);
+		if (word)
+			return _word_first_bit(i) + _word_ffs(word);
 	}
-	return value;
+	return -1;
 }
 
 /*
@@ -426,39 +530,19 @@ bit_ffs(bitstr_t *b)
 bitoff_t
 bit_fls(bitstr_t *b)
 {
-	bitoff_t bit, value = -1;
-	int word;
+	bitoff_t i;
+	bitword_t word;
 
 	_assert_bitstr_valid(b);
 
-	if (_bitstr_bits(b) == 0)	/* empty bitstring */
-		return -1;
-
-	bit = _bitstr_bits(b) - 1;	/* zero origin */
-
-	while (bit >= 0 && 		/* test partitial words */
-		(_bit_word(bit) == _bit_word(bit + 1))) {
-		if (bit_test(b, bit)) {
-			value = bit;
-			break;
-		}
-		bit--;
-	}
-	while (bit >= 0 && value == -1) {	/* test whole words */
-		word = _bit_word(bit);
-		if (b[word] == 0) {
-			bit -= sizeof(bitstr_t) * 8;
+	for (i = _bitstr_end_word(b) - 1; i >= BITSTR_OVERHEAD; i--) {
+		if (b[i] == 0)
 			continue;
-		}
-		while (bit >= 0) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit--;
-		}
+		word = _bit_word_val(b, i);
+		if (word)
+			return _word_first_bit(i) + _word_fls(word);
 	}
-	return value;
+	return -1;
 }
 
 /*
@@ -486,17 +570,21 @@ bit_fill_gaps(bitstr_t *b) {
  */
 int
 bit_super_set(bitstr_t *b1, bitstr_t *b2)  {
-	bitoff_t bit;
+	bitoff_t i, end;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != (b1[_bit_word(bit)] &
-		                           b2[_bit_word(bit)]))
+	end = _bitstr_end_word(b1);
+	if (end == BITSTR_OVERHEAD)
+		return 1;
+	for (i = BITSTR_OVERHEAD; i < (end - 1); i++) {
+		if (b1[i] & ~b2[i])
 			return 0;
 	}
+	if (_bit_word_val(b1, end - 1) & ~((bitword_t) b2[end - 1]))
+		return 0;
 
 	return 1;
 }
@@ -507,7 +595,7 @@ bit_super_set(bitstr_t *b1, bitstr_t *b2)  {
 extern int
 bit_equal(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	bitoff_t i, end;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
@@ -515,10 +603,15 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 	if (_bitstr_bits(b1) != _bitstr_bits(b2))
 		return 0;
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != b2[_bit_word(bit)])
+	end = _bitstr_end_word(b1);
+	if (end == BITSTR_OVERHEAD)
+		return 1;
+	for (i = BITSTR_OVERHEAD; i < (end - 1); i++) {
+		if (b1[i] != b2[i])
 			return 0;
 	}
+	if (_bit_word_val(b1, end - 1) != _bit_word_val(b2, end - 1))
+		return 0;
 
 	return 1;
 }
@@ -532,14 +625,33 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
  */
 void
 bit_and(bitstr_t *b1, bitstr_t *b2) {
-	bitoff_t bit;
+	bitoff_t i, end;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	end = _bitstr_end_word(b1);
+	for (i = BITSTR_OVERHEAD; i < end; i++)
+		b1[i] &= b2[i];
+}
+
+/*
+ * b1 &= ~b2, without modifying b2 or allocating a temporary bitmap
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ */
+void
+bit_and_not(bitstr_t *b1, bitstr_t *b2) {
+	bitoff_t i, end;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= b2[_bit_word(bit)];
+	end = _bitstr_end_word(b1);
+	for (i = BITSTR_OVERHEAD; i < end; i++)
+		b1[i] &= ~b2[i];
 }
 
 /*
@@ -548,12 +660,13 @@ bit_and(bitstr_t *b1, bitstr_t *b2) {
  */
 void
 bit_not(bitstr_t *b) {
-	bitoff_t bit;
+	bitoff_t i, end;
 
 	_assert_bitstr_valid(b);
 
-	for (bit = 0; bit < _bitstr_bits(b); bit += sizeof(bitstr_t)*8)
-		b[_bit_word(bit)] = ~b[_bit_word(bit)];
+	end = _bitstr_end_word(b);
+	for (i = BITSTR_OVERHEAD; i < end; i++)
+		b[i] = ~b[i];
 }
 
 /*
@@ -563,14 +676,15 @@ bit_not(bitstr_t *b) {
  */
 void
 bit_or(bitstr_t *b1, bitstr_t *b2) {
-	bitoff_t bit;
+	bitoff_t i, end;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] |= b2[_bit_word(bit)];
+	end = _bitstr_end_word(b1);
+	for (i = BITSTR_OVERHEAD; i < end; i++)
+		b1[i] |= b2[i];
 }
 
 
@@ -609,44 +723,6 @@ bit_copybits(bitstr_t *dest, bitstr_t *src)
 	memcpy(&dest[BITSTR_OVERHEAD], &src[BITSTR_OVERHEAD], len);
 }
 
-#if !defined(USE_64BIT_BITSTR)
-/*
- * Returns the hamming weight (i.e. the number of bits set) in a word.
- * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
- */
-static uint32_t
-hweight(uint32_t w)
-{
-	uint32_t res;
-
-	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
-	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
-	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
-	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
-	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
-
-	return res;
-}
-#else
-/*
- * A 64 bit version crafted from 32-bit one borrowed above.
- */
-static uint64_t
-hweight(uint64_t w)
-{
-	uint64_t res;
-
-	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
-	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
-	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
-	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
-	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
-	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
-
-	return res;
-}
-#endif /* !USE_64BIT_BITSTR */
-
 /*
  * Count the number of bits set in bitstring.
  *   b (IN)		bitstring to check
@@ -656,21 +732,16 @@ int
 bit_set_count(bitstr_t *b)
 {
 	int count = 0;
-	bitoff_t bit, bit_cnt;
-	int word_size = sizeof(bitstr_t) * 8;
+	bitoff_t i, end;
 
 	_assert_bitstr_valid(b);
 
-	bit_cnt = _bitstr_bits(b);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b, bit))
-			count++;
-	}
+	end = _bitstr_end_word(b);
+	if (end == BITSTR_OVERHEAD)
+		return 0;
+	for (i = BITSTR_OVERHEAD; i < (end - 1); i++)
+		count += hweight((bitword_t) b[i]);
+	count += hweight(_bit_word_val(b, end - 1));
 
 	return count;
 }
@@ -682,23 +753,18 @@ extern int
 bit_overlap(bitstr_t *b1, bitstr_t *b2)
 {
 	int count = 0;
-	bitoff_t bit, bit_cnt;
-	int word_size = sizeof(bitstr_t) * 8;
+	bitoff_t i, end;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	bit_cnt = _bitstr_bits(b1);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b1[_bit_word(bit)] & b2[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b1, bit) && bit_test(b2, bit))
-			count++;
-	}
+	end = _bitstr_end_word(b1);
+	if (end == BITSTR_OVERHEAD)
+		return 0;
+	for (i = BITSTR_OVERHEAD; i < (end - 1); i++)
+		count += hweight((bitword_t) (b1[i] & b2[i]));
+	count += hweight(_bit_word_val(b1, end - 1) & (bitword_t) b2[end - 1]);
 
 	return count;
 }
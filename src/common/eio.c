@@ -41,8 +41,13 @@
 
 #include <sys/poll.h>
 #include <unistd.h>
+#include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
 #include "src/common/xmalloc.h"
 #include "src/common/xassert.h"
 #include "src/common/log.h"
@@ -67,9 +72,24 @@ struct eio_handle_components {
 };
 
 
+#ifdef HAVE_SYS_EPOLL_H
+/* Maximum events processed per epoll_wait() call */
+#define EIO_EPOLL_EVENTS 256
+#endif
+
 /* Function prototypes
  */
 
+#ifdef HAVE_SYS_EPOLL_H
+static int          _epoll_create(eio_handle_t *eio);
+static int          _epoll_mainloop(eio_handle_t *eio, bool *use_poll);
+static short        _epoll_revents(uint32_t events);
+static int          _epoll_setup(int epfd, List l, eio_obj_t ***ready,
+				 int *ready_size, int *nready);
+#endif
+static bool         _is_readable(eio_obj_t *obj);
+static bool         _is_writable(eio_obj_t *obj);
+static int          _poll_mainloop(eio_handle_t *eio);
 static int          _poll_internal(struct pollfd *pfds, unsigned int nfds);
 static unsigned int _poll_setup_pollfds(struct pollfd *, eio_obj_t **, List);
 static void         _poll_dispatch(struct pollfd *, unsigned int, eio_obj_t **,
@@ -241,6 +261,264 @@ static int _eio_wakeup_handler(eio_handle_t *eio)
 }
 
 int eio_handle_mainloop(eio_handle_t *eio)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	bool use_poll = false;
+	int  retval;
+
+	xassert (eio != NULL);
+	xassert (eio->magic == EIO_MAGIC);
+
+	retval = _epoll_mainloop(eio, &use_poll);
+	if (!use_poll)
+		return retval;
+	/* Every object is polled afresh, so nothing is lost by
+	 * switching over in the middle of the loop */
+	debug2("eio: falling back to poll");
+#endif
+	return _poll_mainloop(eio);
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Create an epoll set watching the eio handle's signalling fd, which is
+ * the only fd registered with a NULL data pointer.
+ */
+static int _epoll_create(eio_handle_t *eio)
+{
+	struct epoll_event ev;
+	int epfd;
+
+	if ((epfd = epoll_create(EIO_EPOLL_EVENTS)) < 0) {
+		error("eio: epoll_create: %m");
+		return -1;
+	}
+	fd_set_close_on_exec(epfd);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, eio->fds[0], &ev) < 0) {
+		error("eio: epoll_ctl(%d): %m", eio->fds[0]);
+		close(epfd);
+		return -1;
+	}
+	return epfd;
+}
+
+/*
+ * Same as _poll_mainloop(), but an object's fd stays registered with the
+ * epoll set from one pass to the next and is only touched when the
+ * object's readable/writable state changes.  Waiting and dispatching
+ * are then proportional to the number of objects with events rather
+ * than to the number of objects.
+ *
+ * Sets use_poll if some fd can not be handled with epoll, in which case
+ * the caller should carry on with _poll_mainloop().
+ */
+static int _epoll_mainloop(eio_handle_t *eio, bool *use_poll)
+{
+	struct epoll_event *events = NULL;
+	ListIterator itr;
+	eio_obj_t **ready = NULL;
+	eio_obj_t  *obj;
+	int epfd, i, n, nobjs;
+	int nready = 0, ready_size = 0;
+	int retval = 0;
+
+	if ((epfd = _epoll_create(eio)) < 0) {
+		*use_poll = true;
+		return 0;
+	}
+	events = xmalloc(sizeof(struct epoll_event) * EIO_EPOLL_EVENTS);
+
+	/* Nothing is registered with this epoll set yet */
+	itr = list_iterator_create(eio->obj_list);
+	while ((obj = list_next(itr))) {
+		obj->epoll_events = 0;
+		obj->epoll_ready = false;
+	}
+	list_iterator_destroy(itr);
+
+	for (;;) {
+		debug4("eio: handling events for %d objects",
+		       list_count(eio->obj_list));
+		nobjs = _epoll_setup(epfd, eio->obj_list, &ready,
+				     &ready_size, &nready);
+		if (nobjs < 0) {
+			*use_poll = true;
+			goto done;
+		}
+		if (nobjs == 0)
+			goto done;
+
+		/* Objects which are always ready must not wait */
+		while ((n = epoll_wait(epfd, events, EIO_EPOLL_EVENTS,
+				       nready ? 0 : -1)) < 0) {
+			if (errno == EINTR) {
+				n = 0;
+				break;
+			}
+			error("eio: epoll_wait: %m");
+			retval = -1;
+			goto done;
+		}
+
+		/* Handle the signalling fd first, as with poll */
+		for (i = 0; i < n; i++) {
+			if (events[i].data.ptr == NULL) {
+				_eio_wakeup_handler(eio);
+				break;
+			}
+		}
+
+		for (i = 0; i < nready; i++) {
+			_poll_handle_event(_epoll_revents(
+						   ready[i]->epoll_events),
+					   ready[i], eio->obj_list);
+		}
+
+		for (i = 0; i < n; i++) {
+			obj = (eio_obj_t *) events[i].data.ptr;
+			if (obj == NULL)
+				continue;
+			if ((obj->epoll_events == 0) || obj->epoll_ready) {
+				/* The fd was closed behind our back while
+				 * its file is still open somewhere else, so
+				 * the registration outlived it.  Start over
+				 * with a new epoll set to get rid of it. */
+				debug2("eio: stale epoll event, rebuilding");
+				close(epfd);
+				if ((epfd = _epoll_create(eio)) < 0) {
+					*use_poll = true;
+					goto done;
+				}
+				itr = list_iterator_create(eio->obj_list);
+				while ((obj = list_next(itr))) {
+					obj->epoll_events = 0;
+					obj->epoll_ready = false;
+				}
+				list_iterator_destroy(itr);
+				break;
+			}
+			_poll_handle_event(_epoll_revents(events[i].events),
+					   obj, eio->obj_list);
+		}
+	}
+
+done:
+	if (epfd >= 0)
+		close(epfd);
+	xfree(events);
+	xfree(ready);
+	return retval;
+}
+
+/*
+ * Bring the epoll set up to date with the readable/writable state of
+ * every object in list l.  Objects whose fd epoll can not handle, which
+ * poll() would always report ready, are returned in the ready array.
+ *
+ * Returns the number of objects with events of interest, or -1 if an
+ * fd could not be registered and poll() should be used instead.
+ */
+static int _epoll_setup(int epfd, List l, eio_obj_t ***ready,
+			int *ready_size, int *nready)
+{
+	struct epoll_event ev;
+	ListIterator itr = list_iterator_create(l);
+	eio_obj_t *obj;
+	uint32_t   want;
+	int nobjs = 0, op;
+
+	*nready = 0;
+	while ((obj = list_next(itr))) {
+		want = 0;
+		if (_is_writable(obj))
+			want |= EPOLLOUT;
+		if (_is_readable(obj))
+			want |= EPOLLIN;
+
+		/* An fd which was closed (and possibly reused) since it
+		 * was registered lost its registration with the close */
+		if (obj->epoll_events && (obj->fd != obj->epoll_fd)) {
+			obj->epoll_events = 0;
+			obj->epoll_ready = false;
+		}
+
+		if (want == 0) {
+			if (obj->epoll_events && !obj->epoll_ready) {
+				memset(&ev, 0, sizeof(ev));
+				(void) epoll_ctl(epfd, EPOLL_CTL_DEL,
+						 obj->fd, &ev);
+			}
+			obj->epoll_events = 0;
+			obj->epoll_ready = false;
+			continue;
+		}
+
+		nobjs++;
+		if (obj->fd < 0)	/* poll() ignores it too */
+			continue;
+
+		if (!obj->epoll_ready && (want != obj->epoll_events)) {
+			op = obj->epoll_events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+			memset(&ev, 0, sizeof(ev));
+			ev.events = want;
+			ev.data.ptr = obj;
+			if (epoll_ctl(epfd, op, obj->fd, &ev) == 0) {
+				obj->epoll_fd = obj->fd;
+				obj->epoll_events = want;
+				continue;
+			} else if ((op == EPOLL_CTL_ADD) && (errno == EEXIST) &&
+				   (epoll_ctl(epfd, EPOLL_CTL_MOD, obj->fd,
+					      &ev) == 0)) {
+				/* Left over from an earlier object using
+				 * the same fd, take it over */
+				obj->epoll_fd = obj->fd;
+				obj->epoll_events = want;
+				continue;
+			} else if ((op == EPOLL_CTL_ADD) && (errno == EPERM)) {
+				/* A regular file, always readable and
+				 * writable */
+				obj->epoll_ready = true;
+			} else {
+				debug2("eio: epoll_ctl(%d): %m", obj->fd);
+				nobjs = -1;
+				break;
+			}
+		} else if (!obj->epoll_ready)
+			continue;
+
+		obj->epoll_fd = obj->fd;
+		obj->epoll_events = want;
+		if (*nready >= *ready_size) {
+			*ready_size += 16;
+			xrealloc(*ready, *ready_size * sizeof(eio_obj_t *));
+		}
+		(*ready)[(*nready)++] = obj;
+	}
+	list_iterator_destroy(itr);
+	return nobjs;
+}
+
+static short _epoll_revents(uint32_t events)
+{
+	short revents = 0;
+
+	if (events & EPOLLIN)
+		revents |= POLLIN;
+	if (events & EPOLLOUT)
+		revents |= POLLOUT;
+	if (events & EPOLLERR)
+		revents |= POLLERR;
+	if (events & EPOLLHUP)
+		revents |= POLLHUP;
+	return revents;
+}
+#endif
+
+static int _poll_mainloop(eio_handle_t *eio)
 {
 	int            retval  = 0;
 	struct pollfd *pollfds = NULL;
@@ -67,6 +67,12 @@ struct eio_obj {
 	void *arg;                        /* application-specific data       */
 	struct io_operations *ops;        /* pointer to ops struct for obj   */
 	bool shutdown;
+
+	/* eio mainloop private, state of the obj's epoll registration */
+	int epoll_fd;                     /* fd registered with epoll        */
+	uint32_t epoll_events;            /* events registered, 0 if none    */
+	bool epoll_ready;                 /* fd can't be used with epoll
+					   * (a regular file), always ready  */
 };
 
 eio_handle_t *eio_handle_create(void);
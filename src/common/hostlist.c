@@ -248,6 +248,11 @@ struct hostlist {
 /* a hostset is a wrapper around a hostlist */
 struct hostset {
 	hostlist_t hl;
+
+	/* set once the ranges of a prefix may be out of suffix order or
+	 * overlap (e.g. zero padded and unpadded ranges), the set is then
+	 * searched linearly */
+	int unsorted;
 };
 
 struct hostlist_iterator {
@@ -337,7 +342,9 @@ static int    _zero_padded(unsigned long, int);
 static int    _width_equiv(unsigned long, int *, unsigned long, int *);
 
 static int           host_prefix_end(const char *);
+static int           hostname_split(const char *, unsigned long *);
 static hostname_t    hostname_create(const char *);
+static int           hostname_init(hostname_t, const char *, char *, int);
 static void          hostname_destroy(hostname_t);
 static int           hostname_suffix_is_valid(hostname_t);
 static int           hostname_suffix_width(hostname_t);
@@ -348,6 +355,7 @@ static hostrange_t   hostrange_create(char *, unsigned long, unsigned long,
 				      int);
 static unsigned long hostrange_count(hostrange_t);
 static hostrange_t   hostrange_copy(hostrange_t);
+static void          hostrange_init_hn(hostrange_t, hostname_t);
 static void          hostrange_destroy(hostrange_t);
 static hostrange_t   hostrange_delete_host(hostrange_t, unsigned long);
 static int           hostrange_cmp(hostrange_t, hostrange_t);
@@ -384,7 +392,9 @@ static hostlist_iterator_t hostlist_iterator_new(void);
 static void               _iterator_advance(hostlist_iterator_t);
 static void               _iterator_advance_range(hostlist_iterator_t);
 
+static int hostset_find_range(hostset_t, hostrange_t);
 static int hostset_find_host(hostset_t, const char *);
+static int hostset_in_order(hostlist_t, int);
 
 /* ------[ macros ]------ */
 
@@ -625,23 +635,45 @@ static int host_prefix_end(const char *hostname)
 	return idx;
 }
 
+/*
+ * split hostname into its prefix and numeric suffix, storing the suffix
+ * value in num.  Returns the length of the prefix, which is the length
+ * of the whole hostname if it has no valid numeric suffix.
+ */
+static int hostname_split(const char *hostname, unsigned long *num)
+{
+	char *p = NULL;
+	int idx, len;
+	int hostlist_base = hostlist_get_base();
+	int dims = slurmdb_setup_cluster_dims();
+
+	len = strlen(hostname);
+	idx = host_prefix_end(hostname);
+	if (idx == (len - 1))
+		return len;
+
+	if((dims > 1) && ((len - idx - 1) != dims))
+		hostlist_base = 10;
+
+	*num = strtoul(hostname + idx + 1, &p, hostlist_base);
+	if (*p != '\0')
+		return len;
+
+	return idx + 1;
+}
+
 /*
  * create a hostname_t object from a string hostname
  */
 static hostname_t hostname_create(const char *hostname)
 {
 	hostname_t hn = NULL;
-	char *p = '\0';
-	int idx = 0;
-	int hostlist_base = hostlist_get_base();
-	int dims = slurmdb_setup_cluster_dims();
+	int len, prefix_len;
 	assert(hostname != NULL);
 
 	if (!(hn = (hostname_t) malloc(sizeof(*hn))))
   		out_of_memory("hostname create");
 
-	idx = host_prefix_end(hostname);
-
 	if (!(hn->hostname = strdup(hostname))) {
 		free(hn);
 		out_of_memory("hostname create");
@@ -650,7 +682,10 @@ static hostname_t hostname_create(const char *hostname)
 	hn->num = 0;
 	hn->prefix = NULL;
 	hn->suffix = NULL;
-	if (idx == (strlen(hostname) - 1)) {
+
+	len = strlen(hostname);
+	prefix_len = hostname_split(hostname, &hn->num);
+	if (prefix_len == len) {
 		if ((hn->prefix = strdup(hostname)) == NULL) {
 			hostname_destroy(hn);
 			out_of_memory("hostname prefix create");
@@ -658,29 +693,46 @@ static hostname_t hostname_create(const char *hostname)
 		return hn;
 	}
 
-	hn->suffix = hn->hostname + idx + 1;
+	if (!(hn->prefix = malloc((prefix_len + 1) * sizeof(char)))) {
+		hostname_destroy(hn);
+		out_of_memory("hostname prefix create");
+	}
+	memcpy(hn->prefix, hostname, prefix_len);
+	hn->prefix[prefix_len] = '\0';
+	hn->suffix = hn->hostname + prefix_len;
 
-	if((dims > 1) && (strlen(hn->suffix) != dims))
-		hostlist_base = 10;
+	return hn;
+}
 
-	hn->num = strtoul(hn->suffix, &p, hostlist_base);
+/*
+ * fill in a caller supplied hostname_t from a string hostname without
+ * allocating anything: hn->hostname points at hostname and the prefix
+ * is copied into buf.  Returns -1 if the prefix does not fit in buf,
+ * in which case the caller should fall back to hostname_create().
+ * The result must not be passed to hostname_destroy().
+ */
+static int hostname_init(hostname_t hn, const char *hostname,
+			 char *buf, int buf_len)
+{
+	int prefix_len;
 
-	if (*p == '\0') {
-		if (!(hn->prefix = malloc((idx + 2) * sizeof(char)))) {
-			hostname_destroy(hn);
-			out_of_memory("hostname prefix create");
-		}
-		memcpy(hn->prefix, hostname, idx + 1);
-		hn->prefix[idx + 1] = '\0';
-	} else {
-		if (!(hn->prefix = strdup(hostname))) {
-			hostname_destroy(hn);
-			out_of_memory("hostname prefix create");
-		}
+	assert(hostname != NULL);
+
+	hn->num = 0;
+	prefix_len = hostname_split(hostname, &hn->num);
+	if (prefix_len >= buf_len)
+		return -1;
+
+	memcpy(buf, hostname, prefix_len);
+	buf[prefix_len] = '\0';
+	hn->hostname = (char *) hostname;
+	hn->prefix = buf;
+	if (hostname[prefix_len] != '\0')
+		hn->suffix = hn->hostname + prefix_len;
+	else
 		hn->suffix = NULL;
-	}
 
-	return hn;
+	return 0;
 }
 
 /* free a hostname object
@@ -788,6 +840,26 @@ error1:
 }
 
 
+/* Fill in a caller supplied hostrange_t holding the single host hn.
+ * The prefix is shared with hn, so hr must not be passed to
+ * hostrange_destroy().
+ */
+static void hostrange_init_hn(hostrange_t hr, hostname_t hn)
+{
+	hr->prefix = hn->prefix;
+	if (hostname_suffix_is_valid(hn)) {
+		hr->lo = hn->num;
+		hr->hi = hn->num;
+		hr->width = hostname_suffix_width(hn);
+		hr->singlehost = 0;
+	} else {
+		hr->lo = 0L;
+		hr->hi = 0L;
+		hr->width = 0;
+		hr->singlehost = 1;
+	}
+}
+
 /* Return the number of hosts stored in the hostrange object
  */
 static unsigned long hostrange_count(hostrange_t hr)
@@ -1374,10 +1446,16 @@ static int
 hostlist_push_hr(hostlist_t hl, char *prefix, unsigned long lo,
 		 unsigned long hi, int width)
 {
-	hostrange_t hr = hostrange_create(prefix, lo, hi, width);
-	int retval = hostlist_push_range(hl, hr);
-	hostrange_destroy(hr);
-	return retval;
+	struct hostrange_components hr;
+
+	/* hostlist_push_range() copies the range only if it can not
+	 * be joined to the tail, so there is no need to allocate one */
+	hr.prefix = prefix;
+	hr.lo = lo;
+	hr.hi = hi;
+	hr.width = width;
+	hr.singlehost = 0;
+	return hostlist_push_range(hl, &hr);
 }
 
 /* Insert a range object hr into position n of the hostlist hl
@@ -1654,18 +1732,17 @@ static int _parse_box_range(char *str, struct _range *ranges,
  */
 static int _parse_single_range(const char *str, struct _range *range)
 {
-	char *p, *q;
-	char *orig = strdup(str);
+	char *p, *q, *dash = NULL;
 	int hostlist_base = hostlist_get_base();
 	int dims = slurmdb_setup_cluster_dims();
 
-	if (!orig)
-		seterrno_ret(ENOMEM, 0);
-
 	if ((p = strchr(str, 'x')))
 		goto error; /* do NOT allow boxes here */
 
+	/* str is split in place at the '-', which is put back before
+	 * str is used in an error message */
 	if ((p = strchr(str, '-'))) {
+		dash = p;
 		*p++ = '\0';
 		if (*p == '-')     /* do NOT allow negative numbers */
 			goto error;
@@ -1695,19 +1772,20 @@ static int _parse_single_range(const char *str, struct _range *range)
 		goto error;
 
 	if (range->hi - range->lo + 1 > MAX_RANGE ) {
+		if (dash)
+			*dash = '-';
 		_error(__FILE__, __LINE__, "Too many hosts in range `%s'\n",
-		       orig);
-		free(orig);
+		       str);
 		seterrno_ret(ERANGE, 0);
 	}
 
-	free(orig);
 	return 1;
 
 error:
+	if (dash)
+		*dash = '-';
 	errno = EINVAL;
-	_error(__FILE__, __LINE__, "Invalid range: `%s'", orig);
-	free(orig);
+	_error(__FILE__, __LINE__, "Invalid range: `%s'", str);
 	return 0;
 }
 
@@ -1942,24 +2020,22 @@ int hostlist_push(hostlist_t hl, const char *hosts)
 
 int hostlist_push_host(hostlist_t hl, const char *str)
 {
-	hostrange_t hr;
-	hostname_t hn;
+	struct hostrange_components hr;
+	struct hostname_components hn_buf;
+	hostname_t hn = &hn_buf;
+	char prefix[MAXHOSTNAMELEN + 16];
 
 	if (!str || !hl)
 		return 0;
 
-	hn = hostname_create(str);
+	if (hostname_init(hn, str, prefix, sizeof(prefix)) < 0)
+		hn = hostname_create(str);
 
-	if (hostname_suffix_is_valid(hn))
-		hr = hostrange_create(hn->prefix, hn->num, hn->num,
-				      hostname_suffix_width(hn));
-	else
-		hr = hostrange_create_single(str);
+	hostrange_init_hn(&hr, hn);
+	hostlist_push_range(hl, &hr);
 
-	hostlist_push_range(hl, hr);
-
-	hostrange_destroy(hr);
-	hostname_destroy(hn);
+	if (hn != &hn_buf)
+		hostname_destroy(hn);
 
 	return 1;
 }
@@ -2277,12 +2353,15 @@ int hostlist_count(hostlist_t hl)
 int hostlist_find(hostlist_t hl, const char *hostname)
 {
 	int i, count, ret = -1;
-	hostname_t hn;
+	struct hostname_components hn_buf;
+	hostname_t hn = &hn_buf;
+	char prefix[MAXHOSTNAMELEN + 16];
 
 	if (!hostname || !hl)
 		return -1;
 
-	hn = hostname_create(hostname);
+	if (hostname_init(hn, hostname, prefix, sizeof(prefix)) < 0)
+		hn = hostname_create(hostname);
 
 	LOCK_HOSTLIST(hl);
 
@@ -2299,7 +2378,8 @@ int hostlist_find(hostlist_t hl, const char *hostname)
 
 done:
 	UNLOCK_HOSTLIST(hl);
-	hostname_destroy(hn);
+	if (hn != &hn_buf)
+		hostname_destroy(hn);
 	return ret;
 }
 
@@ -2433,7 +2513,7 @@ static int _attempt_range_join(hostlist_t hl, int loc)
 
 void hostlist_uniq(hostlist_t hl)
 {
-	int i = 1;
+	int i, n = 0, ndup;
 	hostlist_iterator_t hli;
 	LOCK_HOSTLIST(hl);
 	if (hl->nranges <= 1) {
@@ -2442,10 +2522,18 @@ void hostlist_uniq(hostlist_t hl)
 	}
 	qsort(hl->hr, hl->nranges, sizeof(hostrange_t), &_cmp);
 
-	while (i < hl->nranges) {
-		if (_attempt_range_join(hl, i) < 0) /* No range join occurred */
-			i++;
+	/* Join each range into the last one kept, compacting the array
+	 * as we go rather than shifting it down after every join */
+	for (i = 1; i < hl->nranges; i++) {
+		if ((ndup = hostrange_join(hl->hr[n], hl->hr[i])) >= 0) {
+			hostrange_destroy(hl->hr[i]);
+			hl->nhosts -= ndup;
+		} else
+			hl->hr[++n] = hl->hr[i];
 	}
+	for (i = n + 1; i < hl->nranges; i++)
+		hl->hr[i] = NULL;
+	hl->nranges = n + 1;
 
 	/* reset all iterators */
 	for (hli = hl->ilist; hli; hli = hli->next)
@@ -3355,6 +3443,7 @@ int hostlist_remove(hostlist_iterator_t i)
 hostset_t hostset_create(const char *hostlist)
 {
 	hostset_t new;
+	int i;
 
 	if (!(new = (hostset_t) malloc(sizeof(*new))))
 		goto error1;
@@ -3363,6 +3452,13 @@ hostset_t hostset_create(const char *hostlist)
 		goto error2;
 
 	hostlist_uniq(new->hl);
+	new->unsorted = 0;
+	for (i = 1; i < new->hl->nranges; i++) {
+		if (!hostset_in_order(new->hl, i)) {
+			new->unsorted = 1;
+			break;
+		}
+	}
 	return new;
 
 error2:
@@ -3380,6 +3476,7 @@ hostset_t hostset_copy(const hostset_t set)
 	if (!(new->hl = hostlist_copy(set->hl)))
 		goto error2;
 
+	new->unsorted = set->unsorted;
 	return new;
 error2:
 	free(new);
@@ -3401,8 +3498,7 @@ void hostset_destroy(hostset_t set)
  */
 static int hostset_insert_range(hostset_t set, hostrange_t hr)
 {
-	int i = 0;
-	int inserted = 0;
+	int i = 0, j;
 	int nhosts = 0;
 	int ndups = 0;
 	hostlist_t hl;
@@ -3414,29 +3510,23 @@ static int hostset_insert_range(hostset_t set, hostrange_t hr)
 
 	nhosts = hostrange_count(hr);
 
-	for (i = 0; i < hl->nranges; i++) {
-		if (hostrange_cmp(hr, hl->hr[i]) <= 0) {
-
-			if ((ndups = hostrange_join(hr, hl->hr[i])) >= 0)
-				hostlist_delete_range(hl, i);
-			else if (ndups < 0)
-				ndups = 0;
+	i = hostset_find_range(set, hr);
+	if (i < hl->nranges) {
+		if ((ndups = hostrange_join(hr, hl->hr[i])) >= 0)
+			hostlist_delete_range(hl, i);
+		else if (ndups < 0)
+			ndups = 0;
 
-			hostlist_insert_range(hl, hr, i);
+		hostlist_insert_range(hl, hr, i);
 
-			/* now attempt to join hr[i] and hr[i-1] */
-			if (i > 0) {
-				int m;
-				if ((m = _attempt_range_join(hl, i)) > 0)
-					ndups += m;
-			}
-			hl->nhosts += nhosts - ndups;
-			inserted = 1;
-			break;
+		/* now attempt to join hr[i] and hr[i-1] */
+		if (i > 0) {
+			int m;
+			if ((m = _attempt_range_join(hl, i)) > 0)
+				ndups += m;
 		}
-	}
-
-	if (inserted == 0) {
+		hl->nhosts += nhosts - ndups;
+	} else {
 		hl->hr[hl->nranges++] = hostrange_copy(hr);
 		hl->nhosts += nhosts;
 		if (hl->nranges > 1) {
@@ -3445,6 +3535,13 @@ static int hostset_insert_range(hostset_t set, hostrange_t hr)
 		}
 	}
 
+	/* the new range is now at i or was joined to i-1, only the order
+	 * of its neighbours can have changed */
+	for (j = i - 1; (j <= i + 1) && !set->unsorted; j++) {
+		if (!hostset_in_order(hl, j))
+			set->unsorted = 1;
+	}
+
 	/*
 	 *  Return the number of unique hosts inserted
 	 */
@@ -3468,24 +3565,99 @@ int hostset_insert(hostset_t set, const char *hosts)
 }
 
 
-/* linear search through N ranges for hostname "host"
+/* return 1 if the ranges at i-1 and i of a hostset are in order: sorted by
+ * prefix and, within a prefix, by suffix without overlapping.
+ * hostrange_cmp() can not be trusted for this, it orders ranges with
+ * incompatible widths by width, not by suffix.
+ */
+static int hostset_in_order(hostlist_t hl, int i)
+{
+	hostrange_t h1, h2;
+	int cmp;
+
+	if ((i <= 0) || (i >= hl->nranges))
+		return 1;
+	h1 = hl->hr[i - 1];
+	h2 = hl->hr[i];
+	if ((cmp = hostrange_prefix_cmp(h1, h2)) != 0)
+		return (cmp < 0);
+	if (h1->singlehost)
+		return 1;
+	return (h1->hi < h2->lo);
+}
+
+/* search through the ranges of a hostset for the first one which does
+ * not compare less than hr. While the set is in order this is a binary
+ * search, otherwise the linear scan which placed the ranges there.
+ * Assumes that the set->hl lock is already held
+ */
+static int hostset_find_range(hostset_t set, hostrange_t hr)
+{
+	int lo = 0, hi = set->hl->nranges, mid;
+
+	if (set->unsorted) {
+		for (lo = 0; lo < hi; lo++) {
+			if (hostrange_cmp(hr, set->hl->hr[lo]) <= 0)
+				break;
+		}
+		return lo;
+	}
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (hostrange_cmp(hr, set->hl->hr[mid]) <= 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/* search through N ranges for hostname "host", a binary search on prefix
+ * and suffix while the set is in order
  * */
 static int hostset_find_host(hostset_t set, const char *host)
 {
-	int i;
+	int i, lo, hi, cmp;
 	int retval = 0;
-	hostname_t hn;
+	struct hostrange_components hr;
+	struct hostname_components hn_buf;
+	hostname_t hn = &hn_buf;
+	char prefix[MAXHOSTNAMELEN + 16];
+
+	if (hostname_init(hn, host, prefix, sizeof(prefix)) < 0)
+		hn = hostname_create(host);
+	hostrange_init_hn(&hr, hn);
+
 	LOCK_HOSTLIST(set->hl);
-	hn = hostname_create(host);
-	for (i = 0; i < set->hl->nranges; i++) {
-		if (hostrange_hn_within(set->hl->hr[i], hn)) {
-			retval = 1;
-			goto done;
+	if (set->unsorted) {
+		for (i = 0; i < set->hl->nranges; i++) {
+			if (hostrange_hn_within(set->hl->hr[i], hn)) {
+				retval = 1;
+				break;
+			}
+		}
+	} else {
+		/* the ranges of a prefix do not overlap, so host can only
+		 * be in the last one starting at or below its suffix */
+		lo = 0;
+		hi = set->hl->nranges;
+		while (lo < hi) {
+			i = (lo + hi) / 2;
+			cmp = hostrange_prefix_cmp(set->hl->hr[i], &hr);
+			if ((cmp < 0) ||
+			    ((cmp == 0) && (set->hl->hr[i]->lo <= hr.lo)))
+				lo = i + 1;
+			else
+				hi = i;
 		}
+		if ((lo > 0) && hostrange_hn_within(set->hl->hr[lo - 1], hn))
+			retval = 1;
 	}
-done:
 	UNLOCK_HOSTLIST(set->hl);
-	hostname_destroy(hn);
+
+	if (hn != &hn_buf)
+		hostname_destroy(hn);
 	return retval;
 }
 
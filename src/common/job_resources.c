@@ -1043,17 +1043,28 @@ extern int job_fits_into_cores(job_resources_t *job_resrcs_ptr,
 			       const uint16_t *bits_per_node)
 {
 	int full_node_inx = 0, full_bit_inx  = 0, job_bit_inx  = 0, i;
+	int first_node, last_node;
 
-	if (!full_bitmap)
+	if (!full_bitmap || !job_resrcs_ptr->core_bitmap)
 		return 1;
 
-	for (full_node_inx = 0; full_node_inx < node_record_count;
+	/* Only visit the nodes allocated to the job, not every node in
+	 * the system. The offsets of nodes before the first one are still
+	 * needed to locate its cores in the full_bitmap. */
+	first_node = bit_ffs(job_resrcs_ptr->node_bitmap);
+	if (first_node < 0)
+		return 1;
+	last_node = bit_fls(job_resrcs_ptr->node_bitmap);
+	for (full_node_inx = 0; full_node_inx < first_node; full_node_inx++)
+		full_bit_inx += bits_per_node[full_node_inx];
+
+	for (full_node_inx = first_node; full_node_inx <= last_node;
 	     full_node_inx++) {
 		if (bit_test(job_resrcs_ptr->node_bitmap, full_node_inx)) {
 			for (i = 0; i < bits_per_node[full_node_inx]; i++) {
-				if (bit_test(full_bitmap, full_bit_inx + i) &&
-				    bit_test(job_resrcs_ptr->core_bitmap,
-					     job_bit_inx + i)) {
+				if (bit_test(job_resrcs_ptr->core_bitmap,
+					     job_bit_inx + i) &&
+				    bit_test(full_bitmap, full_bit_inx + i)) {
 					return 0;
 				}
 			}
@@ -1077,6 +1088,7 @@ extern void add_job_to_cores(job_resources_t *job_resrcs_ptr,
 {
 	int full_node_inx = 0;
 	int job_bit_inx  = 0, full_bit_inx  = 0, i;
+	int first_node, last_node;
 
 	if (!job_resrcs_ptr->core_bitmap)
 		return;
@@ -1091,7 +1103,14 @@ extern void add_job_to_cores(job_resources_t *job_resrcs_ptr,
 			fatal("add_job_to_cores: bitmap memory error");
 	}
 
-	for (full_node_inx = 0; full_node_inx < node_record_count;
+	first_node = bit_ffs(job_resrcs_ptr->node_bitmap);
+	if (first_node < 0)
+		return;
+	last_node = bit_fls(job_resrcs_ptr->node_bitmap);
+	for (full_node_inx = 0; full_node_inx < first_node; full_node_inx++)
+		full_bit_inx += bits_per_node[full_node_inx];
+
+	for (full_node_inx = first_node; full_node_inx <= last_node;
 	     full_node_inx++) {
 		if (bit_test(job_resrcs_ptr->node_bitmap, full_node_inx)) {
 			for (i = 0; i < bits_per_node[full_node_inx]; i++) {
@@ -1106,6 +1125,45 @@ extern void add_job_to_cores(job_resources_t *job_resrcs_ptr,
 	}
 }
 
+/*
+ * Remove job from full-length core_bitmap
+ * IN job_resrcs_ptr - resources allocated to a job
+ * IN/OUT full_bitmap - bitmap of available CPUs
+ * IN bits_per_node - bits per node in the full_bitmap
+ */
+extern void remove_job_from_cores(job_resources_t *job_resrcs_ptr,
+				  bitstr_t **full_core_bitmap,
+				  const uint16_t *bits_per_node)
+{
+	int full_node_inx = 0;
+	int job_bit_inx  = 0, full_bit_inx  = 0, i;
+	int first_node, last_node;
+
+	if (!job_resrcs_ptr->core_bitmap || (*full_core_bitmap == NULL))
+		return;
+
+	first_node = bit_ffs(job_resrcs_ptr->node_bitmap);
+	if (first_node < 0)
+		return;
+	last_node = bit_fls(job_resrcs_ptr->node_bitmap);
+	for (full_node_inx = 0; full_node_inx < first_node; full_node_inx++)
+		full_bit_inx += bits_per_node[full_node_inx];
+
+	for (full_node_inx = first_node; full_node_inx <= last_node;
+	     full_node_inx++) {
+		if (bit_test(job_resrcs_ptr->node_bitmap, full_node_inx)) {
+			for (i = 0; i < bits_per_node[full_node_inx]; i++) {
+				if (!bit_test(job_resrcs_ptr->core_bitmap,
+					      job_bit_inx + i))
+					continue;
+				bit_clear(*full_core_bitmap, full_bit_inx + i);
+			}
+			job_bit_inx += bits_per_node[full_node_inx];
+		}
+		full_bit_inx += bits_per_node[full_node_inx];
+	}
+}
+
 /* Given a job pointer and a global node index, return the index of that
  * node in the job_resrcs_ptr->cpus. Return -1 if invalid */
 extern int job_resources_node_inx_to_cpu_inx(job_resources_t *job_resrcs_ptr,
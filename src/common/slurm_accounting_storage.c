@@ -167,16 +167,25 @@ typedef struct slurm_acct_storage_ops {
 				   uint32_t cpus, time_t event_time);
 	int  (*register_ctld)      (void *db_conn, uint16_t port);
 	int  (*job_start)          (void *db_conn, struct job_record *job_ptr);
+	int  (*job_start_mult)     (void *db_conn, List job_list);
 	int  (*job_complete)       (void *db_conn,
 				    struct job_record *job_ptr);
 	int  (*step_start)         (void *db_conn,
 				    struct step_record *step_ptr);
 	int  (*step_complete)      (void *db_conn,
 				    struct step_record *step_ptr);
+	int  (*step_start_mult)    (void *db_conn, List step_list);
+	int  (*step_complete_mult) (void *db_conn, List step_list);
 	int  (*job_suspend)        (void *db_conn,
 				    struct job_record *job_ptr);
 	List (*get_jobs_cond)      (void *db_conn, uint32_t uid,
 				    slurmdb_job_cond_t *job_cond);
+	int (*get_jobs_cond_chunks)(void *db_conn, uint32_t uid,
+				    slurmdb_job_cond_t *job_cond,
+				    int chunk_size,
+				    int (*chunk_func) (List job_list,
+						       void *arg),
+				    void *arg);
 	int (*archive_dump)        (void *db_conn,
 				    slurmdb_archive_cond_t *arch_cond);
 	int (*archive_load)        (void *db_conn,
@@ -264,11 +273,15 @@ static slurm_acct_storage_ops_t * _acct_storage_get_ops(
 		"clusteracct_storage_p_cluster_cpus",
 		"clusteracct_storage_p_register_ctld",
 		"jobacct_storage_p_job_start",
+		"jobacct_storage_p_job_start_mult",
 		"jobacct_storage_p_job_complete",
 		"jobacct_storage_p_step_start",
 		"jobacct_storage_p_step_complete",
+		"jobacct_storage_p_step_start_mult",
+		"jobacct_storage_p_step_complete_mult",
 		"jobacct_storage_p_suspend",
 		"jobacct_storage_p_get_jobs_cond",
+		"jobacct_storage_p_get_jobs_cond_chunks",
 		"jobacct_storage_p_archive",
 		"jobacct_storage_p_archive_load",
 		"acct_storage_p_update_shares_used",
@@ -898,6 +911,42 @@ extern int jobacct_storage_g_job_start (void *db_conn,
 	return (*(g_acct_storage_context->ops.job_start))(db_conn, job_ptr);
 }
 
+/*
+ * load into the storage the start of several jobs at once
+ */
+extern int jobacct_storage_g_job_start_mult (void *db_conn, List job_list)
+{
+	struct job_record *job_ptr;
+	ListIterator itr;
+	time_t *orig_start_time;
+	int i = 0, rc;
+
+	if (slurm_acct_storage_init(NULL) < 0)
+		return SLURM_ERROR;
+
+	/* clear the start_time of pending jobs as in
+	 * jobacct_storage_g_job_start() */
+	orig_start_time = xmalloc(sizeof(time_t) * list_count(job_list));
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		orig_start_time[i++] = job_ptr->start_time;
+		if (IS_JOB_PENDING(job_ptr))
+			job_ptr->start_time = (time_t) 0;
+	}
+
+	rc = (*(g_acct_storage_context->ops.job_start_mult))(db_conn,
+							     job_list);
+
+	i = 0;
+	list_iterator_reset(itr);
+	while ((job_ptr = list_next(itr)))
+		job_ptr->start_time = orig_start_time[i++];
+	list_iterator_destroy(itr);
+	xfree(orig_start_time);
+
+	return rc;
+}
+
 /*
  * load into the storage the end of a job
  */
@@ -932,6 +981,29 @@ extern int jobacct_storage_g_step_complete (void *db_conn,
 							      step_ptr);
 }
 
+/*
+ * load into the storage the start of several job steps at once
+ */
+extern int jobacct_storage_g_step_start_mult (void *db_conn, List step_list)
+{
+	if (slurm_acct_storage_init(NULL) < 0)
+		return SLURM_ERROR;
+	return (*(g_acct_storage_context->ops.step_start_mult))(db_conn,
+								step_list);
+}
+
+/*
+ * load into the storage the end of several job steps at once
+ */
+extern int jobacct_storage_g_step_complete_mult (void *db_conn,
+						 List step_list)
+{
+	if (slurm_acct_storage_init(NULL) < 0)
+		return SLURM_ERROR;
+	return (*(g_acct_storage_context->ops.step_complete_mult))(db_conn,
+								   step_list);
+}
+
 /*
  * load into the storage a suspention of a job
  */
@@ -957,6 +1029,21 @@ extern List jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 		(db_conn, uid, job_cond);
 }
 
+/*
+ * get info from the storage a chunk of jobs at a time
+ * chunk_func is called with a List of job_rec_t * for each chunk
+ */
+extern int jobacct_storage_g_get_jobs_cond_chunks(
+	void *db_conn, uint32_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg)
+{
+	if (slurm_acct_storage_init(NULL) < 0)
+		return SLURM_ERROR;
+ 	return (*(g_acct_storage_context->ops.get_jobs_cond_chunks))
+		(db_conn, uid, job_cond, chunk_size, chunk_func, arg);
+}
+
 /*
  * expire old info from the storage
  */
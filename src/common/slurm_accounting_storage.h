@@ -458,6 +458,14 @@ extern int clusteracct_storage_g_register_ctld(void *db_conn, uint16_t port);
 extern int jobacct_storage_g_job_start (void *db_conn,
 					struct job_record *job_ptr);
 
+/*
+ * load into the storage the start of several jobs at once, each job
+ * gets its db_index set as with jobacct_storage_g_job_start
+ * IN:  job_list List of struct job_record *
+ * RET: SLURM_SUCCESS if all jobs were stored, an error code else
+ */
+extern int jobacct_storage_g_job_start_mult (void *db_conn, List job_list);
+
 /*
  * load into the storage the end of a job
  */
@@ -476,6 +484,21 @@ extern int jobacct_storage_g_step_start (void *db_conn,
 extern int jobacct_storage_g_step_complete (void *db_conn,
 					    struct step_record *step_ptr);
 
+/*
+ * load into the storage the start of several job steps at once
+ * IN:  step_list List of struct step_record *
+ * RET: SLURM_SUCCESS if all steps were stored, an error code else
+ */
+extern int jobacct_storage_g_step_start_mult (void *db_conn, List step_list);
+
+/*
+ * load into the storage the end of several job steps at once
+ * IN:  step_list List of struct step_record *
+ * RET: SLURM_SUCCESS if all steps were stored, an error code else
+ */
+extern int jobacct_storage_g_step_complete_mult (void *db_conn,
+						 List step_list);
+
 /*
  * load into the storage a suspention of a job
  */
@@ -490,6 +513,20 @@ extern int jobacct_storage_g_job_suspend (void *db_conn,
 extern List jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 					    slurmdb_job_cond_t *job_cond);
 
+/*
+ * get info from the storage a chunk of jobs at a time, so the whole
+ * result never has to be in memory at once
+ * IN:  chunk_size - about how many jobs to hand chunk_func at a time
+ * IN:  chunk_func - called with a List of slurmdb_job_rec_t * for each
+ *      chunk found, returns SLURM_SUCCESS to get the next one.  The List
+ *      is freed after the call, so list_transfer() any jobs to be kept.
+ * RET: SLURM_SUCCESS or an error code
+ */
+extern int jobacct_storage_g_get_jobs_cond_chunks(
+	void *db_conn, uint32_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg);
+
 /*
  * expire old info from the storage
  */
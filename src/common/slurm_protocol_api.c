@@ -2077,9 +2077,7 @@ int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
-	header_t header;
 	int rc;
-	void *auth_cred = NULL;
 	Buf buffer;
 
 	xassert(fd >= 0);
@@ -2106,9 +2104,11 @@ int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout)
 	 *  the message.
 	 */
 	if (_slurm_msg_recvfrom_timeout(fd, &buf, &buflen, 0, timeout) < 0) {
-		forward_init(&header.forward, NULL);
 		rc = errno;
-		goto total_return;
+		slurm_seterrno(rc);
+		msg->auth_cred = (void *) NULL;
+		error("slurm_receive_msg: %s", slurm_strerror(rc));
+		return -1;
 	}
 
 #if	_DEBUG
@@ -2116,6 +2116,26 @@ int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout)
 #endif
 	buffer = create_buf(buf, buflen);
 
+	return slurm_unpack_received_msg(msg, fd, buffer);
+}
+
+/*
+ * NOTE: memory is allocated for the returned msg must be freed at
+ *       some point using the slurm_free_functions.
+ * OUT msg	- a slurm_msg struct to be filled in by the function
+ * IN fd	- file descriptor the message was read from
+ * IN buffer	- complete message as read from fd (header, credential
+ *		  and body), always consumed by this function
+ * RET int	- returns 0 on success, -1 on failure and sets errno
+ */
+int slurm_unpack_received_msg(slurm_msg_t *msg, slurm_fd_t fd, Buf buffer)
+{
+	header_t header;
+	int rc;
+	void *auth_cred = NULL;
+
+	msg->conn_fd = fd;
+
 	if (unpack_header(&header, buffer) == SLURM_ERROR) {
 		free_buf(buffer);
 		rc = SLURM_COMMUNICATIONS_RECEIVE_ERROR;
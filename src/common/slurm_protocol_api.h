@@ -669,6 +669,21 @@ inline int slurm_shutdown_msg_engine(slurm_fd_t open_fd);
  */
 int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout);
 
+/*
+ *  Unpack a slurm message which has already been read in its entirety
+ *    from the open slurm descriptor "fd" (header, credential and body).
+ *    This is the second half of slurm_receive_msg() and is used by
+ *    daemons that gather message data with non-blocking I/O before
+ *    handing it off for processing. Memory for the message data is
+ *    allocated as described for slurm_receive_msg().
+ *
+ * OUT msg	- a slurm_msg struct to be filled in by the function
+ * IN fd	- file descriptor the message was read from
+ * IN buffer	- the message data, always freed by this function
+ * RET int	- returns 0 on success, -1 on failure and sets errno
+ */
+int slurm_unpack_received_msg(slurm_msg_t *msg, slurm_fd_t fd, Buf buffer);
+
 /*
  *  Receive a slurm message on the open slurm descriptor "fd" waiting
  *    at most "timeout" seconds for the message data. If timeout is
@@ -70,6 +70,12 @@ typedef int32_t slurm_fd_t ;
    typedef struct sockaddr_in slurm_addr_t ;
 #endif
 
+/*
+ *  Maximum message size. Messages larger than this value (in bytes)
+ *  will not be received.
+ */
+#define MAX_MSG_SIZE     (16*1024*1024)
+
 /* this is the slurm equivalent of the BSD sockets fd_set */
 typedef fd_set slurm_fd_set ;
 typedef fd_set _slurm_fd_set ;
@@ -51,9 +51,11 @@
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <syslog.h>
+#include <sys/mman.h>
 #include <sys/poll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -84,7 +86,11 @@ strong_alias(slurmdbd_free_id_rc_msg,	slurmdb_slurmdbd_free_id_rc_msg);
 
 
 #define DBD_MAGIC		0xDEAD3219
-#define MAX_AGENT_QUEUE		10000
+#define MAX_AGENT_QUEUE		10000	/* Records queued in memory, any
+					 * more are spilled to disk */
+#define DBD_AGENT_BATCH		500	/* Records per DBD_SEND_MULT_MSG */
+#define DBD_AGENT_WINDOW	4	/* Batches awaiting a reply */
+#define DBD_AGENT_MAX_BATCHES	16	/* Batches sent per slurmdbd_lock */
 #define MAX_DBD_MSG_LEN		16384
 #define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
 
@@ -98,11 +104,20 @@ static List      agent_list     = (List) NULL;
 static pthread_t agent_tid      = 0;
 static time_t    agent_shutdown = 0;
 
+/* Records which did not fit in agent_list are appended to the state save
+ * file (dbd.messages) and read back in order as agent_list drains.
+ * Protected by agent_lock */
+static int       spill_fd       = -1;
+static off_t     spill_read     = 0;	/* offset of first unread record */
+static uint32_t  spill_cnt      = 0;	/* unread records in spill_fd */
+
 static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
 static slurm_fd_t  slurmdbd_fd         = -1;
 static char *    slurmdbd_auth_info  = NULL;
 static char *    slurmdbd_cluster    = NULL;
+static uint16_t  slurmdbd_rpc_version = SLURMDBD_VERSION; /* accepted by
+							    * the slurmdbd */
 static bool      rollback_started    = 0;
 static bool      halt_agent          = 0;
 static slurm_trigger_callbacks_t callback;
@@ -114,21 +129,32 @@ static void   _create_agent(void);
 static bool   _fd_readable(slurm_fd_t fd, int read_timeout);
 static int    _fd_writeable(slurm_fd_t fd);
 static int    _get_return_code(uint16_t rpc_version, int read_timeout);
+static int    _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout,
+				  int skip, int *acked);
 static Buf    _load_dbd_rec(int fd);
 static void   _load_dbd_state(void);
 static void   _open_slurmdbd_fd(bool db_needed);
+static Buf    _pack_agent_batch(int skip, int *cnt);
 static int    _purge_job_start_req(void);
 static Buf    _recv_msg(int read_timeout);
 static void   _reopen_slurmdbd_fd(void);
 static int    _save_dbd_rec(int fd, Buf buffer);
 static void   _save_dbd_state(void);
-static int    _send_init_msg(void);
+static int    _send_init_msg(uint16_t rpc_version);
 static int    _send_fini_msg(void);
 static int    _send_msg(Buf buffer);
+static int    _send_msg_reopen(Buf buffer, bool reopen);
 static void   _sig_handler(int signal);
 static void   _shutdown_agent(void);
 static void   _slurmdbd_packstr(void *str, uint16_t rpc_version, Buf buffer);
 static int    _slurmdbd_unpackstr(void **str, uint16_t rpc_version, Buf buffer);
+static void   _spill_close(bool remove);
+static int    _spill_copy(int fd);
+static char * _spill_fname(void);
+static int    _spill_open(void);
+static int    _spill_rec(Buf buffer);
+static void   _spill_refill(void);
+static int    _spill_walk(int fd, off_t *offset, int max, List l);
 static int    _tot_wait (struct timeval *start_time);
 
 /****************************************************************************
@@ -337,6 +363,83 @@ end_it:
 	return rc;
 }
 
+/* Send an RPC to the SlurmDBD and hand each of the reply messages to
+ * resp_func as it arrives, for as long as they are of type more_type.
+ * The first reply of any other type is the last one.  If resp_func
+ * returns an error the rest of the replies are dropped by closing the
+ * connection. */
+extern int slurm_send_recv_slurmdbd_msgs(uint16_t rpc_version,
+					 slurmdbd_msg_t *req,
+					 uint16_t more_type,
+					 int (*resp_func) (slurmdbd_msg_t *resp,
+							   void *arg),
+					 void *arg)
+{
+	int rc = SLURM_SUCCESS, read_timeout;
+	bool last = false;
+	slurmdbd_msg_t resp;
+	Buf buffer;
+
+	xassert(req);
+	xassert(resp_func);
+
+	halt_agent = 1;
+	read_timeout = SLURMDBD_TIMEOUT * 1000;
+	slurm_mutex_lock(&slurmdbd_lock);
+	halt_agent = 0;
+	if (slurmdbd_fd < 0) {
+		_open_slurmdbd_fd(1);
+		if (slurmdbd_fd < 0) {
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+	}
+
+	if (!(buffer = pack_slurmdbd_msg(req, rpc_version))) {
+		rc = SLURM_ERROR;
+		goto end_it;
+	}
+
+	rc = _send_msg(buffer);
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS) {
+		error("slurmdbd: Sending message type %u: %d: %m",
+		      req->msg_type, rc);
+		goto end_it;
+	}
+
+	while (1) {
+		buffer = _recv_msg(read_timeout);
+		if (buffer == NULL) {
+			error("slurmdbd: Getting response to message type %u",
+			      req->msg_type);
+			rc = SLURM_ERROR;
+			break;
+		}
+
+		memset(&resp, 0, sizeof(slurmdbd_msg_t));
+		rc = unpack_slurmdbd_msg(&resp, rpc_version, buffer);
+		free_buf(buffer);
+		if (rc != SLURM_SUCCESS)
+			break;
+
+		last = (resp.msg_type != more_type);
+		rc = (*resp_func)(&resp, arg);
+		if ((rc != SLURM_SUCCESS) || last)
+			break;
+	}
+
+	/* Any replies left unread would be taken as the response to
+	 * the next RPC on this connection */
+	if (!last)
+		_close_slurmdbd_fd();
+end_it:
+	pthread_cond_signal(&slurmdbd_cond);
+	slurm_mutex_unlock(&slurmdbd_lock);
+
+	return rc;
+}
+
 /* Send an RPC to the SlurmDBD. Do not wait for the reply. The RPC
  * will be queued and processed later if the SlurmDBD is not responding.
  * NOTE: slurm_open_slurmdbd_conn() must have been called with callbacks set
@@ -360,7 +463,7 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 		}
 	}
 	cnt = list_count(agent_list);
-	if ((cnt >= (MAX_AGENT_QUEUE / 2)) &&
+	if (((cnt + spill_cnt) >= (MAX_AGENT_QUEUE / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
 		syslog_time = time(NULL);
@@ -369,16 +472,32 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 		if (callbacks_requested)
 			(callback.dbd_fail)();
 	}
-	if (cnt == (MAX_AGENT_QUEUE - 1))
-		cnt -= _purge_job_start_req();
-	if (cnt < MAX_AGENT_QUEUE) {
+	/* Once records are spilled to disk, later ones must follow them
+	 * there to stay in order.  Registration messages are not saved
+	 * to disk (see _save_dbd_state()), so always keep them here. */
+	if (((cnt < MAX_AGENT_QUEUE) && (spill_cnt == 0)) ||
+	    (req->msg_type == DBD_REGISTER_CTLD)) {
 		if (list_enqueue(agent_list, buffer) == NULL)
 			fatal("list_enqueue: memory allocation failure");
+	} else if (_spill_rec(buffer) == SLURM_SUCCESS) {
+		free_buf(buffer);
 	} else {
-		error("slurmdbd: agent queue is full, discarding request");
-		if (callbacks_requested)
-			(callback.acct_full)();
-		rc = SLURM_ERROR;
+		/* No disk space left, fall back to keeping what we can
+		 * in memory */
+		if (cnt >= (MAX_AGENT_QUEUE - 1))
+			cnt -= _purge_job_start_req();
+		if (cnt < MAX_AGENT_QUEUE) {
+			if (list_enqueue(agent_list, buffer) == NULL)
+				fatal("list_enqueue: memory allocation "
+				      "failure");
+		} else {
+			error("slurmdbd: agent queue is full, "
+			      "discarding request");
+			if (callbacks_requested)
+				(callback.acct_full)();
+			free_buf(buffer);
+			rc = SLURM_ERROR;
+		}
 	}
 
 	pthread_cond_broadcast(&agent_cond);
@@ -433,7 +552,23 @@ again:
 		} else {
 			int rc;
 			fd_set_nonblocking(slurmdbd_fd);
-			rc = _send_init_msg();
+			rc = _send_init_msg(SLURMDBD_VERSION);
+			if (rc == SLURM_PROTOCOL_VERSION_ERROR) {
+				/* An older slurmdbd closes the connection
+				 * after refusing our version, so connect
+				 * again with the one before pipelining */
+				debug("slurmdbd: Older slurmdbd, trying "
+				      "version %d",
+				      SLURMDBD_PIPELINE_VERSION - 1);
+				close(slurmdbd_fd);
+				slurmdbd_fd = slurm_open_msg_conn(&dbd_addr);
+				if (slurmdbd_fd >= 0) {
+					fd_set_nonblocking(slurmdbd_fd);
+					rc = _send_init_msg(
+						SLURMDBD_PIPELINE_VERSION - 1);
+				} else
+					rc = SLURM_ERROR;
+			}
 			if ((rc == SLURM_SUCCESS) && callbacks_requested) {
 				(callback.dbd_resumed)();
 				(callback.db_resumed)();
@@ -474,6 +609,7 @@ extern Buf pack_slurmdbd_msg(slurmdbd_msg_t *req, uint16_t rpc_version)
 	case DBD_GOT_CLUSTERS:
 	case DBD_GOT_EVENTS:
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_CHUNK:
 	case DBD_GOT_LIST:
 	case DBD_GOT_PROBS:
 	case DBD_ADD_QOS:
@@ -512,6 +648,7 @@ extern Buf pack_slurmdbd_msg(slurmdbd_msg_t *req, uint16_t rpc_version)
 	case DBD_GET_CLUSTERS:
 	case DBD_GET_EVENTS:
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_CHUNKS:
 	case DBD_GET_PROBS:
 	case DBD_GET_QOS:
 	case DBD_GET_RESVS:
@@ -645,6 +782,7 @@ extern int unpack_slurmdbd_msg(slurmdbd_msg_t *resp,
 	case DBD_GOT_CLUSTERS:
 	case DBD_GOT_EVENTS:
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_CHUNK:
 	case DBD_GOT_LIST:
 	case DBD_GOT_PROBS:
 	case DBD_ADD_QOS:
@@ -684,6 +822,7 @@ extern int unpack_slurmdbd_msg(slurmdbd_msg_t *resp,
 	case DBD_GET_CLUSTERS:
 	case DBD_GET_EVENTS:
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_CHUNKS:
 	case DBD_GET_PROBS:
 	case DBD_GET_QOS:
 	case DBD_GET_RESVS:
@@ -962,6 +1101,10 @@ extern slurmdbd_msg_type_t str_2_slurmdbd_msg_type(char *msg_type)
 		return DBD_SEND_MULT_MSG;
 	} else if(!strcasecmp(msg_type, "Got Multiple Message Returns")) {
 		return DBD_GOT_MULT_MSG;
+	} else if(!strcasecmp(msg_type, "Get Jobs in Chunks")) {
+		return DBD_GET_JOBS_CHUNKS;
+	} else if(!strcasecmp(msg_type, "Got Jobs Chunk")) {
+		return DBD_GOT_JOBS_CHUNK;
 	} else {
 		return NO_VAL;
 	}
@@ -1422,6 +1565,18 @@ extern char *slurmdbd_msg_type_2_str(slurmdbd_msg_type_t msg_type, int get_enum)
 		} else
 			return "Got Multiple Message Returns";
 		break;
+	case DBD_GET_JOBS_CHUNKS:
+		if(get_enum) {
+			return "DBD_GET_JOBS_CHUNKS";
+		} else
+			return "Get Jobs in Chunks";
+		break;
+	case DBD_GOT_JOBS_CHUNK:
+		if(get_enum) {
+			return "DBD_GOT_JOBS_CHUNK";
+		} else
+			return "Got Jobs Chunk";
+		break;
 	default:
 		return "Unknown";
 		break;
@@ -1437,7 +1592,7 @@ extern void slurmdbd_free_buffer(void *x)
 		free_buf(buffer);
 }
 
-static int _send_init_msg()
+static int _send_init_msg(uint16_t rpc_version)
 {
 	int rc, read_timeout;
 	Buf buffer;
@@ -1450,7 +1605,7 @@ static int _send_init_msg()
 	pack16((uint16_t) DBD_INIT, buffer);
 	req.cluster_name = slurmdbd_cluster;
 	req.rollback = rollback_started;
-	req.version  = SLURMDBD_VERSION;
+	req.version  = rpc_version;
 	slurmdbd_pack_init_msg(&req, SLURMDBD_VERSION, buffer,
 			       slurmdbd_auth_info);
 	/* if we have an issue with the pack we want to log the errno,
@@ -1466,6 +1621,8 @@ static int _send_init_msg()
 
 	read_timeout = slurm_get_msg_timeout() * 1000;
 	rc = _get_return_code(SLURMDBD_VERSION, read_timeout);
+	if ((rc == SLURM_SUCCESS) || (rc == ESLURM_DB_CONNECTION))
+		slurmdbd_rpc_version = rpc_version;
 	if(tmp_errno)
 		errno = tmp_errno;
 	else if(rc != SLURM_SUCCESS)
@@ -1513,6 +1670,14 @@ static void _reopen_slurmdbd_fd(void)
 }
 
 static int _send_msg(Buf buffer)
+{
+	return _send_msg_reopen(buffer, true);
+}
+
+/* Send a message to the slurmdbd. If the connection was closed and reopen
+ * is false return ESLURM_DB_CONNECTION rather than sending the message on a
+ * new connection, for when replies to earlier messages are still due. */
+static int _send_msg_reopen(Buf buffer, bool reopen)
 {
 	uint32_t msg_size, nw_size;
 	char *msg;
@@ -1525,6 +1690,8 @@ static int _send_msg(Buf buffer)
 	rc =_fd_writeable(slurmdbd_fd);
 	if (rc == -1) {
 	re_open:	/* SlurmDBD shutdown, try to reopen a connection now */
+		if (!reopen)
+			return ESLURM_DB_CONNECTION;
 		if (retry_cnt++ > 3)
 			return EAGAIN;
 		/* if errno is ACCESS_DENIED do not try to reopen to
@@ -1634,7 +1801,13 @@ static int _get_return_code(uint16_t rpc_version, int read_timeout)
 	return rc;
 }
 
-static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
+/* Read the reply to a DBD_SEND_MULT_MSG and remove the records which it
+ * acknowledges from agent_list.  The batch started after the first skip
+ * records of agent_list.
+ * acked OUT - number of records acknowledged, -1 if there was no reply
+ * RET return code of the first record which failed or SLURM_SUCCESS */
+static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout,
+			       int skip, int *acked)
 {
 	Buf buffer;
 	uint16_t msg_type;
@@ -1643,9 +1816,11 @@ static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 	int rc = SLURM_ERROR;
 	Buf out_buf = NULL;
 
+	*acked = -1;
 	buffer = _recv_msg(read_timeout);
 	if (buffer == NULL)
 		return rc;
+	*acked = 0;
 
 	safe_unpack16(&msg_type, buffer);
 	switch(msg_type) {
@@ -1661,14 +1836,23 @@ static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
 		if (agent_list) {
 			ListIterator itr =
 				list_iterator_create(list_msg->my_list);
+			ListIterator agent_itr =
+				list_iterator_create(agent_list);
+			int i;
+
+			for (i = 0; i < skip; i++)
+				(void) list_next(agent_itr);
 			while((out_buf = list_next(itr))) {
 				if((rc = _unpack_return_code(
 					    rpc_version, out_buf))
 				    != SLURM_SUCCESS)
 					break;
 
-				free_buf(list_dequeue(agent_list));
+				if (list_next(agent_itr))
+					list_delete_item(agent_itr);
+				(*acked)++;
 			}
+			list_iterator_destroy(agent_itr);
 			list_iterator_destroy(itr);
 		}
 		slurm_mutex_unlock(&agent_lock);
@@ -1949,6 +2133,43 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Pack up to DBD_AGENT_BATCH records of agent_list into one
+ * DBD_SEND_MULT_MSG, starting after its first skip records.
+ * NOTE: agent_lock must be locked
+ * cnt OUT - number of records packed
+ * RET buffer to send or NULL if there are no more records, must be freed */
+static Buf _pack_agent_batch(int skip, int *cnt)
+{
+	slurmdbd_msg_t list_req;
+	dbd_list_msg_t list_msg;
+	ListIterator itr;
+	Buf buffer;
+	int i = 0;
+
+	*cnt = 0;
+	if (!agent_list || (list_count(agent_list) <= skip))
+		return NULL;
+
+	list_req.msg_type = DBD_SEND_MULT_MSG;
+	list_req.data = &list_msg;
+	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+	list_msg.my_list = list_create(NULL);
+
+	itr = list_iterator_create(agent_list);
+	while ((buffer = list_next(itr))) {
+		if (i++ < skip)
+			continue;
+		list_append(list_msg.my_list, buffer);
+		if (++(*cnt) >= DBD_AGENT_BATCH)
+			break;
+	}
+	list_iterator_destroy(itr);
+
+	buffer = pack_slurmdbd_msg(&list_req, SLURMDBD_VERSION);
+	list_destroy(list_msg.my_list);
+	return buffer;
+}
+
 static void *_agent(void *x)
 {
 	int cnt, rc;
@@ -1957,12 +2178,8 @@ static void *_agent(void *x)
 	static time_t fail_time = 0;
 	int sigarray[] = {SIGUSR1, 0};
 	int read_timeout = SLURMDBD_TIMEOUT * 1000;
-	slurmdbd_msg_t list_req;
-	dbd_list_msg_t list_msg;
-
-	list_req.msg_type = DBD_SEND_MULT_MSG;
-	list_req.data = &list_msg;
-	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+	int batch_cnt[DBD_AGENT_WINDOW];
+	int acked, batches, first, inflight, inflight_recs, kept, window;
 	/* DEF_TIMERS; */
 
 	/* Prepare to catch SIGUSR1 to interrupt pending
@@ -1985,6 +2202,9 @@ static void *_agent(void *x)
 		}
 
 		slurm_mutex_lock(&agent_lock);
+		if (agent_list && spill_cnt &&
+		    (list_count(agent_list) < (MAX_AGENT_QUEUE / 2)))
+			_spill_refill();
 		if (agent_list && slurmdbd_fd)
 			cnt = list_count(agent_list);
 		else
@@ -1998,53 +2218,102 @@ static void *_agent(void *x)
 						    &abs_time);
 			slurm_mutex_unlock(&agent_lock);
 			continue;
-		} else if ((cnt > 0) && ((cnt % 50) == 0))
-			info("slurmdbd: agent queue size %u", cnt);
-		/* Leave item on the queue until processing complete */
-		if (agent_list) {
-			if(list_count(agent_list) > 1) {
-				list_msg.my_list = agent_list;
-				buffer = pack_slurmdbd_msg(&list_req,
-							   SLURMDBD_VERSION);
-			} else
-				buffer = (Buf) list_peek(agent_list);
-		} else
-			buffer = NULL;
-		slurm_mutex_unlock(&agent_lock);
-		if (buffer == NULL) {
-			slurm_mutex_unlock(&slurmdbd_lock);
-
-			slurm_mutex_lock(&assoc_cache_mutex);
-			if(slurmdbd_fd >= 0 && running_cache)
-				pthread_cond_signal(&assoc_cache_cond);
-			slurm_mutex_unlock(&assoc_cache_mutex);
-
-			continue;
+		} else if ((cnt > 0) && ((cnt % 50) == 0)) {
+			if (spill_cnt)
+				info("slurmdbd: agent queue size %u, "
+				     "%u more on disk", cnt, spill_cnt);
+			else
+				info("slurmdbd: agent queue size %u", cnt);
 		}
+		slurm_mutex_unlock(&agent_lock);
 
-		/* NOTE: agent_lock is clear here, so we can add more
-		 * requests to the queue while waiting for this RPC to
-		 * complete. */
-		rc = _send_msg(buffer);
-		if (rc != SLURM_SUCCESS) {
-			if (agent_shutdown) {
-				slurm_mutex_unlock(&slurmdbd_lock);
-				break;
-			}
-			error("slurmdbd: Failure sending message: %d: %m", rc);
-		} else if(list_msg.my_list) {
-			rc = _handle_mult_rc_ret(SLURMDBD_VERSION,
-						 read_timeout);
-		} else {
-			rc = _get_return_code(SLURMDBD_VERSION, read_timeout);
-			if (rc == EAGAIN) {
-				if (agent_shutdown) {
-					slurm_mutex_unlock(&slurmdbd_lock);
+		/* Keep up to DBD_AGENT_WINDOW batches in flight.  Records
+		 * stay on the queue until acknowledged.  The slurmdbd
+		 * replies in order, so the queue starts with the kept
+		 * records of batches which failed, then inflight_recs
+		 * records awaiting a reply, then those not yet sent.
+		 * Once a batch fails the slurmdbd closes the connection
+		 * without reading the batches sent after it, so no record
+		 * is stored ahead of one that failed.  An older slurmdbd
+		 * doesn't, so only one batch is sent to it at a time.
+		 * NOTE: agent_lock is clear while sending and waiting, so
+		 * we can add more requests to the queue meanwhile. */
+		rc = SLURM_SUCCESS;
+		acked = batches = first = inflight = inflight_recs = kept = 0;
+		if (slurmdbd_rpc_version >= SLURMDBD_PIPELINE_VERSION)
+			window = DBD_AGENT_WINDOW;
+		else
+			window = 1;
+		while (1) {
+			while ((rc == SLURM_SUCCESS) &&
+			       (inflight < window) &&
+			       (batches < DBD_AGENT_MAX_BATCHES)) {
+				slurm_mutex_lock(&agent_lock);
+				buffer = _pack_agent_batch(
+					kept + inflight_recs, &cnt);
+				slurm_mutex_unlock(&agent_lock);
+				if (buffer == NULL)
+					break;
+				/* Only reconnect with nothing in flight,
+				 * the records must reach the slurmdbd in
+				 * queue order */
+				rc = _send_msg_reopen(buffer, (inflight == 0));
+				free_buf(buffer);
+				if ((rc == ESLURM_DB_CONNECTION) && inflight) {
+					/* The connection closed, so the
+					 * replies to the batches in flight are
+					 * lost.  Reconnect and send again from
+					 * the head of the queue, the batch
+					 * just packed was not sent. */
+					_reopen_slurmdbd_fd();
+					first = inflight = inflight_recs = 0;
+					kept = 0;
+					rc = SLURM_SUCCESS;
+					if (slurmdbd_fd < 0) {
+						rc = EAGAIN;
+						break;
+					}
+					continue;
+				}
+				if (rc != SLURM_SUCCESS) {
+					if (agent_shutdown)
+						break;
+					error("slurmdbd: Failure sending "
+					      "message: %d: %m", rc);
 					break;
 				}
-				error("slurmdbd: Failure with "
-				      "message need to resend: %d: %m", rc);
+				batch_cnt[(first + inflight) %
+					  DBD_AGENT_WINDOW] = cnt;
+				inflight++;
+				inflight_recs += cnt;
+				batches++;
+				if (kept)
+					rc = EAGAIN;
+			}
+			if (inflight == 0)
+				break;
+
+			/* The reply to the oldest batch comes first */
+			if (_handle_mult_rc_ret(SLURMDBD_VERSION, read_timeout,
+						kept, &acked) != SLURM_SUCCESS)
+				rc = SLURM_ERROR;
+			if (acked < 0) {
+				/* No reply, the others can't be matched
+				 * to their batches any more */
+				if (!agent_shutdown)
+					_close_slurmdbd_fd();
+				break;
 			}
+			if (acked < batch_cnt[first])
+				rc = SLURM_ERROR;
+			kept += batch_cnt[first] - acked;
+			inflight_recs -= batch_cnt[first];
+			first = (first + 1) % DBD_AGENT_WINDOW;
+			inflight--;
+		}
+		if ((rc != SLURM_SUCCESS) && agent_shutdown) {
+			slurm_mutex_unlock(&slurmdbd_lock);
+			break;
 		}
 		slurm_mutex_unlock(&slurmdbd_lock);
 		slurm_mutex_lock(&assoc_cache_mutex);
@@ -2053,30 +2322,10 @@ static void *_agent(void *x)
 		slurm_mutex_unlock(&assoc_cache_mutex);
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list && (rc == SLURM_SUCCESS)) {
-			/* If we sent a mult_msg we just need to free
-			   buffer, we don't need to requeue, just mark
-			   list_msg.my_list as NULL as that is the
-			   sign we sent a mult_msg.
-			*/
-			if(list_msg.my_list)
-				list_msg.my_list = NULL;
-			else
-				buffer = (Buf) list_dequeue(agent_list);
-
-			free_buf(buffer);
+		if (rc == SLURM_SUCCESS)
 			fail_time = 0;
-		} else {
-			/* We still need to free a mult_msg even if we
-			   got a failure.
-			*/
-			if(list_msg.my_list) {
-				list_msg.my_list = NULL;
-				free_buf(buffer);
-			}
-
+		else
 			fail_time = time(NULL);
-		}
 		slurm_mutex_unlock(&agent_lock);
 		/* END_TIMER; */
 		/* info("at the end with %s", TIME_STR); */
@@ -2092,21 +2341,24 @@ static void *_agent(void *x)
 	return NULL;
 }
 
+/* Save agent_list followed by the unread records of the spill file to
+ * the state save file, which replaces the spill file.
+ * NOTE: agent_lock must be locked */
 static void _save_dbd_state(void)
 {
-	char *dbd_fname;
+	char *dbd_fname, *new_fname;
 	Buf buffer;
-	int fd, rc, wrote = 0;
+	int fd, rc = SLURM_SUCCESS, wrote = 0;
 	uint16_t msg_type;
 	uint32_t offset;
 
-	dbd_fname = slurm_get_state_save_location();
-	xstrcat(dbd_fname, "/dbd.messages");
-	(void) unlink(dbd_fname);	/* clear save state */
-	fd = open(dbd_fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	dbd_fname = _spill_fname();
+	new_fname = xstrdup_printf("%s.new", dbd_fname);
+	fd = open(new_fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
 	if (fd < 0) {
-		error("slurmdbd: Creating state save file %s", dbd_fname);
-	} else if (agent_list && list_count(agent_list)) {
+		error("slurmdbd: Creating state save file %s", new_fname);
+		rc = SLURM_ERROR;
+	} else if ((agent_list && list_count(agent_list)) || spill_cnt) {
 		char curr_ver_str[10];
 		snprintf(curr_ver_str, sizeof(curr_ver_str),
 			 "VER%d", SLURMDBD_VERSION);
@@ -2117,7 +2369,7 @@ static void _save_dbd_state(void)
 		if (rc != SLURM_SUCCESS)
 			goto end_it;
 
-		while ((buffer = list_dequeue(agent_list))) {
+		while (agent_list && (buffer = list_dequeue(agent_list))) {
 			/* We do not want to store registration
 			   messages.  If an admin puts in an incorrect
 			   cluster name we can get a deadlock unless
@@ -2142,13 +2394,31 @@ static void _save_dbd_state(void)
 				break;
 			wrote++;
 		}
+
+		/* Records still in the spill file are newer */
+		if ((rc == SLURM_SUCCESS) && spill_cnt) {
+			rc = _spill_copy(fd);
+			wrote += spill_cnt;
+		}
 	}
 
 end_it:
 	if (fd >= 0) {
-		verbose("slurmdbd: saved %d pending RPCs", wrote);
+		if (fsync(fd) < 0)
+			rc = SLURM_ERROR;
 		(void) close(fd);
 	}
+	_spill_close(false);
+	if (rc == SLURM_SUCCESS) {
+		verbose("slurmdbd: saved %d pending RPCs", wrote);
+		if (rename(new_fname, dbd_fname) < 0)
+			error("slurmdbd: rename(%s, %s): %m",
+			      new_fname, dbd_fname);
+	} else {
+		error("slurmdbd: unable to save pending requests");
+		(void) unlink(new_fname);
+	}
+	xfree(new_fname);
 	xfree(dbd_fname);
 }
 
@@ -2158,10 +2428,14 @@ static void _load_dbd_state(void)
 	Buf buffer;
 	int fd, recovered = 0;
 	uint16_t rpc_version = 0;
+	off_t offset;
 
-	dbd_fname = slurm_get_state_save_location();
-	xstrcat(dbd_fname, "/dbd.messages");
-	fd = open(dbd_fname, O_RDONLY);
+	/* A spill file in use already holds anything we could load */
+	if (spill_fd >= 0)
+		return;
+
+	dbd_fname = _spill_fname();
+	fd = open(dbd_fname, O_RDWR | O_APPEND);
 	if (fd < 0) {
 		/* don't print an error message if there is no file */
 		if(errno == ENOENT)
@@ -2196,6 +2470,19 @@ static void _load_dbd_state(void)
 		}
 
 		xfree(ver_str);
+		if (!buffer && (rpc_version == SLURMDBD_VERSION)) {
+			/* Use the file as our spill file and only read
+			 * in as many records as agent_list takes */
+			fd_set_close_on_exec(fd);
+			spill_fd = fd;
+			spill_read = lseek(fd, 0, SEEK_CUR);
+			offset = spill_read;
+			spill_cnt = _spill_walk(fd, &offset, INT_MAX, NULL);
+			recovered = spill_cnt;
+			_spill_refill();
+			fd = -1;
+			goto end_it;
+		}
 		while (1) {
 			/* If the buffer was not the VER%d string it
 			   was an actual message so we don't want to
@@ -2249,12 +2536,233 @@ static void _load_dbd_state(void)
 			recovered++;
 			buffer = NULL;
 		}
+		/* Records of an older version can't be spilled to, they
+		 * are all in agent_list now */
+		(void) unlink(dbd_fname);
 
 	end_it:
 		verbose("slurmdbd: recovered %d pending RPCs", recovered);
-		(void) close(fd);
+		if (fd >= 0)
+			(void) close(fd);
+	}
+	xfree(dbd_fname);
+}
+
+static char *_spill_fname(void)
+{
+	char *dbd_fname = slurm_get_state_save_location();
+
+	xstrcat(dbd_fname, "/dbd.messages");
+	return dbd_fname;
+}
+
+/* Open the spill file, creating it with a version header if needed.
+ * NOTE: agent_lock must be locked */
+static int _spill_open(void)
+{
+	char *dbd_fname, curr_ver_str[10];
+	struct stat stat_buf;
+	Buf buffer;
+	int rc;
+
+	if (spill_fd >= 0)
+		return SLURM_SUCCESS;
+
+	dbd_fname = _spill_fname();
+	spill_fd = open(dbd_fname, O_RDWR | O_CREAT | O_APPEND, 0600);
+	if (spill_fd < 0) {
+		error("slurmdbd: Creating spill file %s: %m", dbd_fname);
+		xfree(dbd_fname);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(spill_fd);
+	spill_cnt = 0;
+
+	/* Anything in an existing file was loaded by _load_dbd_state()
+	 * when the agent started, so start over */
+	if ((fstat(spill_fd, &stat_buf) < 0) || stat_buf.st_size)
+		(void) ftruncate(spill_fd, 0);
+	snprintf(curr_ver_str, sizeof(curr_ver_str), "VER%d",
+		 SLURMDBD_VERSION);
+	buffer = init_buf(strlen(curr_ver_str));
+	packstr(curr_ver_str, buffer);
+	rc = _save_dbd_rec(spill_fd, buffer);
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS) {
+		_spill_close(true);
+		xfree(dbd_fname);
+		return SLURM_ERROR;
 	}
+	spill_read = lseek(spill_fd, 0, SEEK_END);
+	info("slurmdbd: agent queue is full, spilling requests to %s",
+	     dbd_fname);
 	xfree(dbd_fname);
+	return SLURM_SUCCESS;
+}
+
+/* Close the spill file, removing it if remove is set.
+ * NOTE: agent_lock must be locked */
+static void _spill_close(bool remove)
+{
+	char *dbd_fname;
+
+	if (spill_fd < 0)
+		return;
+	if (remove) {
+		dbd_fname = _spill_fname();
+		(void) unlink(dbd_fname);
+		xfree(dbd_fname);
+	}
+	(void) close(spill_fd);
+	spill_fd = -1;
+	spill_read = 0;
+	spill_cnt = 0;
+}
+
+/* Append a record to the spill file.
+ * NOTE: agent_lock must be locked */
+static int _spill_rec(Buf buffer)
+{
+	off_t end;
+
+	if (_spill_open() != SLURM_SUCCESS)
+		return SLURM_ERROR;
+
+	end = lseek(spill_fd, 0, SEEK_END);
+	if (_save_dbd_rec(spill_fd, buffer) != SLURM_SUCCESS) {
+		/* Don't leave a partial record behind */
+		(void) ftruncate(spill_fd, end);
+		if (spill_cnt == 0)
+			_spill_close(true);
+		return SLURM_ERROR;
+	}
+	spill_cnt++;
+	return SLURM_SUCCESS;
+}
+
+/* Move records from the spill file to agent_list until it holds
+ * MAX_AGENT_QUEUE records.  The spill file is removed once empty.
+ * NOTE: agent_lock must be locked */
+static void _spill_refill(void)
+{
+	int cnt, want;
+
+	if (spill_fd < 0)
+		return;
+
+	want = MAX_AGENT_QUEUE - list_count(agent_list);
+	want = MIN(want, (int) spill_cnt);
+	if (want > 0) {
+		cnt = _spill_walk(spill_fd, &spill_read, want, agent_list);
+		if (cnt < want)		/* file was truncated */
+			spill_cnt = 0;
+		else
+			spill_cnt -= cnt;
+		debug("slurmdbd: read %d spilled requests, %u left",
+		      cnt, spill_cnt);
+	}
+	if (spill_cnt == 0)
+		_spill_close(true);
+}
+
+/* Walk up to max records of spill file fd starting at offset, queueing
+ * a copy of each on list l unless l is NULL.  A damaged record, as left
+ * by a crash while appending, is truncated along with anything after it.
+ * offset IN/OUT - advanced past the records walked
+ * RET number of records walked */
+static int _spill_walk(int fd, off_t *offset, int max, List l)
+{
+	struct stat stat_buf;
+	off_t base;
+	size_t len, pos, rec_size;
+	uint32_t msg_size, magic;
+	char *map;
+	Buf buffer;
+	int cnt = 0;
+
+	if (fstat(fd, &stat_buf) < 0) {
+		error("slurmdbd: fstat spill file: %m");
+		return 0;
+	}
+	if (*offset >= stat_buf.st_size)
+		return 0;
+
+	/* Pages are only read in as records are copied out */
+	base = *offset - (*offset % getpagesize());
+	len = stat_buf.st_size - base;
+	map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, base);
+	if (map == MAP_FAILED) {
+		error("slurmdbd: mmap spill file: %m");
+		return 0;
+	}
+
+	pos = *offset - base;
+	while ((cnt < max) && (pos < len)) {
+		if ((len - pos) < sizeof(msg_size))
+			break;
+		memcpy(&msg_size, map + pos, sizeof(msg_size));
+		rec_size = sizeof(msg_size) + msg_size + sizeof(magic);
+		if ((msg_size > MAX_DBD_MSG_LEN) || ((len - pos) < rec_size))
+			break;
+		memcpy(&magic, map + pos + sizeof(msg_size) + msg_size,
+		       sizeof(magic));
+		if (magic != DBD_MAGIC)
+			break;
+		if (l) {
+			buffer = init_buf(msg_size);
+			memcpy(get_buf_data(buffer), map + pos + sizeof(msg_size),
+			       msg_size);
+			set_buf_offset(buffer, msg_size);
+			if (!list_enqueue(l, buffer))
+				fatal("slurmdbd: list_enqueue, no memory");
+		}
+		pos += rec_size;
+		cnt++;
+	}
+	(void) munmap(map, len);
+	*offset = base + pos;
+
+	if ((cnt < max) && (pos < len)) {
+		error("slurmdbd: spill file damaged at offset %ld, "
+		      "discarding %ld bytes",
+		      (long) *offset, (long) (len - pos));
+		(void) ftruncate(fd, *offset);
+	}
+	return cnt;
+}
+
+/* Append the unread records of the spill file to fd.
+ * NOTE: agent_lock must be locked */
+static int _spill_copy(int fd)
+{
+	char buf[16384];
+	off_t offset = spill_read;
+	ssize_t rd_size, wrote;
+	char *ptr;
+
+	while ((rd_size = pread(spill_fd, buf, sizeof(buf), offset))) {
+		if (rd_size < 0) {
+			if (errno == EINTR)
+				continue;
+			error("slurmdbd: state save error: %m");
+			return SLURM_ERROR;
+		}
+		offset += rd_size;
+		ptr = buf;
+		while (rd_size > 0) {
+			wrote = write(fd, ptr, rd_size);
+			if (wrote > 0) {
+				ptr += wrote;
+				rd_size -= wrote;
+			} else if ((wrote == -1) && (errno == EINTR))
+				continue;
+			else {
+				error("slurmdbd: state save error: %m");
+				return SLURM_ERROR;
+			}
+		}
+	}
+	return SLURM_SUCCESS;
 }
 
 static int _save_dbd_rec(int fd, Buf buffer)
@@ -2445,6 +2953,7 @@ inline void slurmdbd_free_cond_msg(dbd_cond_msg_t *msg,
 			my_destroy = slurmdb_destroy_cluster_cond;
 			break;
 		case DBD_GET_JOBS_COND:
+		case DBD_GET_JOBS_CHUNKS:
 			my_destroy = slurmdb_destroy_job_cond;
 			break;
 		case DBD_GET_QOS:
@@ -2848,6 +3357,7 @@ inline void slurmdbd_pack_cond_msg(dbd_cond_msg_t *msg,
 		my_function = slurmdb_pack_cluster_cond;
 		break;
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_CHUNKS:
 		my_function = slurmdb_pack_job_cond;
 		break;
 	case DBD_GET_QOS:
@@ -2904,6 +3414,7 @@ inline int slurmdbd_unpack_cond_msg(dbd_cond_msg_t **msg,
 		my_function = slurmdb_unpack_cluster_cond;
 		break;
 	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_CHUNKS:
 		my_function = slurmdb_unpack_job_cond;
 		break;
 	case DBD_GET_QOS:
@@ -3438,6 +3949,7 @@ inline void slurmdbd_pack_list_msg(dbd_list_msg_t *msg,
 		my_function = pack_config_key_pair;
 		break;
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_CHUNK:
 		my_function = slurmdb_pack_job_rec;
 		break;
 	case DBD_GOT_LIST:
@@ -3530,6 +4042,7 @@ inline int slurmdbd_unpack_list_msg(dbd_list_msg_t **msg, uint16_t rpc_version,
 		my_destroy = destroy_config_key_pair;
 		break;
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_CHUNK:
 		my_function = slurmdb_unpack_job_rec;
 		my_destroy = slurmdb_destroy_job_rec;
 		break;
@@ -76,9 +76,13 @@
  *	communicating with it (e.g. it will not accept messages with a
  *	version higher than SLURMDBD_VERSION).
  */
-#define SLURMDBD_VERSION	8 /* already changed for 2.2 */
+#define SLURMDBD_VERSION	9 /* changed for 2.2.6 */
 #define SLURMDBD_VERSION_MIN	7
 
+/* First version whose slurmdbd accepts DBD_SEND_MULT_MSG batches sent
+ * before the reply to the previous one was read */
+#define SLURMDBD_PIPELINE_VERSION	9
+
 /* SLURM DBD message types */
 /* ANY TIME YOU ADD TO THIS LIST UPDATE THE CONVERSION FUNCTIONS! */
 typedef enum {
@@ -165,7 +169,11 @@ typedef enum {
 	DBD_GOT_MULT_JOB_START,	/* Get response to DBD_SEND_MULT_JOB_START */
 	DBD_SEND_MULT_MSG,      /* Send multiple message		*/
 	DBD_GOT_MULT_MSG,	/* Get response to DBD_SEND_MULT_MSG    */
-	DBD_MODIFY_JOB		/* Modify existing Job(s)               */
+	DBD_MODIFY_JOB,		/* Modify existing Job(s)               */
+	DBD_GET_JOBS_CHUNKS,	/* Get job information with a condition,
+				 * replied to with DBD_GOT_JOBS_CHUNK
+				 * messages ended by a DBD_RC		*/
+	DBD_GOT_JOBS_CHUNK	/* Part of response to DBD_GET_JOBS_CHUNKS */
 } slurmdbd_msg_type_t;
 
 /*****************************************************************************\
@@ -406,6 +414,20 @@ extern int slurm_close_slurmdbd_conn();
 extern int slurm_send_slurmdbd_msg(uint16_t rpc_version,
 				   slurmdbd_msg_t *req);
 
+/* Send an RPC to the SlurmDBD and pass each of its reply messages to
+ * resp_func as they arrive.  Replies of type more_type are followed by
+ * more, a reply of any other type is the last one.  resp_func must free
+ * the data of the message it is given and returns SLURM_SUCCESS to get
+ * the next reply.
+ * The RPC will not be queued if an error occurs.
+ * Returns the return code of the last call to resp_func or an error code */
+extern int slurm_send_recv_slurmdbd_msgs(uint16_t rpc_version,
+					 slurmdbd_msg_t *req,
+					 uint16_t more_type,
+					 int (*resp_func) (slurmdbd_msg_t *resp,
+							   void *arg),
+					 void *arg);
+
 /* Send an RPC to the SlurmDBD and wait for an arbitrary reply message.
  * The RPC will not be queued if an error occurs.
  * The "resp" message must be freed by the caller.
@@ -602,6 +602,26 @@ extern int jobacct_storage_p_job_start(void *db_conn,
 	return rc;
 }
 
+/*
+ * load into the storage the start of several jobs at once
+ */
+extern int jobacct_storage_p_job_start_mult(void *db_conn, List job_list)
+{
+	struct job_record *job_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		if (jobacct_storage_p_job_start(db_conn, job_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
 /*
  * load into the storage the end of a job
  */
@@ -905,6 +925,47 @@ extern int jobacct_storage_p_step_complete(void *db_conn,
 	return rc;
 }
 
+/*
+ * load into the storage the start of several job steps at once
+ */
+extern int jobacct_storage_p_step_start_mult(void *db_conn, List step_list)
+{
+	struct step_record *step_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(step_list);
+	while ((step_ptr = list_next(itr))) {
+		if (jobacct_storage_p_step_start(db_conn, step_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
+/*
+ * load into the storage the end of several job steps at once
+ */
+extern int jobacct_storage_p_step_complete_mult(void *db_conn,
+						List step_list)
+{
+	struct step_record *step_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(step_list);
+	while ((step_ptr = list_next(itr))) {
+		if (jobacct_storage_p_step_complete(db_conn, step_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
 /*
  * load into the storage a suspention of a job
  */
@@ -952,6 +1013,26 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return filetxt_jobacct_process_get_jobs(job_cond);
 }
 
+/*
+ * get info from the storage a chunk of jobs at a time
+ * The file is read all at once, so this is just one chunk.
+ */
+extern int jobacct_storage_p_get_jobs_cond_chunks(
+	void *db_conn, uid_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg)
+{
+	int rc;
+	List job_list = filetxt_jobacct_process_get_jobs(job_cond);
+
+	if (!job_list)
+		return SLURM_ERROR;
+	rc = (*chunk_func)(job_list, arg);
+	list_destroy(job_list);
+
+	return rc;
+}
+
 /*
  * expire old info from the storage
  */
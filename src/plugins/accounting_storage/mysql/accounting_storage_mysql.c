@@ -2604,6 +2604,15 @@ extern int jobacct_storage_p_job_start(mysql_conn_t *mysql_conn,
 	return as_mysql_job_start(mysql_conn, job_ptr);
 }
 
+/*
+ * load into the storage the start of several jobs at once
+ */
+extern int jobacct_storage_p_job_start_mult(mysql_conn_t *mysql_conn,
+					    List job_list)
+{
+	return as_mysql_job_start_mult(mysql_conn, job_list);
+}
+
 /*
  * load into the storage the end of a job
  */
@@ -2631,6 +2640,24 @@ extern int jobacct_storage_p_step_complete(mysql_conn_t *mysql_conn,
 	return as_mysql_step_complete(mysql_conn, step_ptr);
 }
 
+/*
+ * load into the storage the start of several job steps at once
+ */
+extern int jobacct_storage_p_step_start_mult(mysql_conn_t *mysql_conn,
+					     List step_list)
+{
+	return as_mysql_step_start_mult(mysql_conn, step_list);
+}
+
+/*
+ * load into the storage the end of several job steps at once
+ */
+extern int jobacct_storage_p_step_complete_mult(mysql_conn_t *mysql_conn,
+						List step_list)
+{
+	return as_mysql_step_complete_mult(mysql_conn, step_list);
+}
+
 /*
  * load into the storage a suspention of a job
  */
@@ -2659,6 +2686,21 @@ extern List jobacct_storage_p_get_jobs_cond(mysql_conn_t *mysql_conn,
 	return job_list;
 }
 
+/*
+ * get info from the storage a chunk of jobs at a time
+ */
+extern int jobacct_storage_p_get_jobs_cond_chunks(
+	mysql_conn_t *mysql_conn, uid_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg)
+{
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	return as_mysql_jobacct_process_get_jobs_chunks(
+		mysql_conn, uid, job_cond, chunk_size, chunk_func, arg);
+}
+
 /*
  * expire old info from the storage
  */
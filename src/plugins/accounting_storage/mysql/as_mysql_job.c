@@ -43,6 +43,64 @@
 
 #include "src/common/parse_time.h"
 #include "src/common/jobacct_common.h"
+#include "src/common/timers.h"
+
+/* Values of a job record which are not taken as is from the job */
+typedef struct {
+	time_t begin_time;
+	char *block_id;
+	char *jname;
+	int job_state;
+	int node_cnt;
+	char *node_inx;
+	char *nodes;
+	time_t start_time;
+	time_t submit_time;
+	int track_steps;
+	uint32_t wckeyid;
+} job_start_vals_t;
+
+/* Columns of a job record which are only set if the job has them */
+#define JOB_START_ACCOUNT	0x0001
+#define JOB_START_PARTITION	0x0002
+#define JOB_START_BLOCK_ID	0x0004
+#define JOB_START_WCKEY		0x0008
+#define JOB_START_NODE_INX	0x0010
+
+/* Most job records inserted by one statement */
+#define JOB_START_BULK_MAX	500
+
+/* New job records inserted together by as_mysql_job_start_mult() */
+typedef struct {
+	char *id_str;			/* job ids, to get the db_index */
+	struct job_record **job;
+	int job_cnt;
+	int opts;			/* JOB_START_* columns of query */
+	char *query;
+	int query_cnt;			/* statements run */
+	int query_rows;			/* job records in query */
+	struct timeval start;		/* when the first job was added */
+} job_bulk_t;
+
+/* Most step records stored by one query */
+#define STEP_BULK_MAX		500
+
+/* Step records stored together by as_mysql_step_*_mult() */
+typedef struct {
+	bool insert;			/* new step records, else step ends */
+	char *query;
+	int query_cnt;			/* queries run */
+	int query_rows;			/* step records in query */
+	int rc;
+	int rows;			/* step records in the commit */
+	struct timeval start;		/* when the first step was added */
+} step_bulk_t;
+
+/* Totals reported by as_mysql_job_start_mult() and the step ones */
+static pthread_mutex_t bulk_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t bulk_commits = 0;
+static uint64_t bulk_rows = 0;
+static uint64_t bulk_usec = 0;
 
 /* Used in job functions for getting the database index based off the
  * submit time, job and assoc id.  0 is returned if none is found
@@ -206,184 +264,60 @@ no_wckeyid:
 	return wckeyid;
 }
 
-/* extern functions */
-
-extern int as_mysql_job_start(mysql_conn_t *mysql_conn,
-			      struct job_record *job_ptr)
+static void _job_start_times(struct job_record *job_ptr,
+			     job_start_vals_t *vals)
 {
-	int rc=SLURM_SUCCESS;
-	char *nodes = NULL, *jname = NULL, *node_inx = NULL;
-	int track_steps = 0;
-	char *block_id = NULL;
-	char *query = NULL;
-	int reinit = 0;
-	time_t begin_time, check_time, start_time, submit_time;
-	uint32_t wckeyid = 0;
-	int job_state, node_cnt = 0;
-	uint32_t job_db_inx = job_ptr->db_index;
-
-	if ((!job_ptr->details || !job_ptr->details->submit_time)
-	    && !job_ptr->resize_time) {
-		error("as_mysql_job_start: "
-		      "Not inputing this job, it has no submit time.");
-		return SLURM_ERROR;
-	}
-
-	if (check_connection(mysql_conn) != SLURM_SUCCESS)
-		return ESLURM_DB_CONNECTION;
-
-	debug2("as_mysql_slurmdb_job_start() called");
-
-	job_state = job_ptr->job_state;
-
-	/* Since we need a new db_inx make sure the old db_inx
-	 * removed. This is most likely the only time we are going to
-	 * be notified of the change also so make the state without
-	 * the resize. */
-	if (IS_JOB_RESIZING(job_ptr)) {
-		/* If we have a db_index lets end the previous record. */
-		if (job_ptr->db_index)
-			as_mysql_job_complete(mysql_conn, job_ptr);
-		else
-			error("We don't have a db_index for job %u, "
-			      "this should never happen.", job_ptr->job_id);
-		job_state &= (~JOB_RESIZING);
-		job_ptr->db_index = 0;
-	}
-
-	job_state &= JOB_STATE_BASE;
-
 	if (job_ptr->resize_time) {
-		begin_time  = job_ptr->resize_time;
-		submit_time = job_ptr->resize_time;
-		start_time  = job_ptr->resize_time;
+		vals->begin_time  = job_ptr->resize_time;
+		vals->submit_time = job_ptr->resize_time;
+		vals->start_time  = job_ptr->resize_time;
 	} else {
-		begin_time  = job_ptr->details->begin_time;
-		submit_time = job_ptr->details->submit_time;
-		start_time  = job_ptr->start_time;
+		vals->begin_time  = job_ptr->details->begin_time;
+		vals->submit_time = job_ptr->details->submit_time;
+		vals->start_time  = job_ptr->start_time;
 	}
+}
 
-	/* See what we are hearing about here if no start time. If
-	 * this job latest time is before the last roll up we will
-	 * need to reset it to look at this job. */
-	if (start_time)
-		check_time = start_time;
-	else if (begin_time)
-		check_time = begin_time;
-	else
-		check_time = submit_time;
-
-	slurm_mutex_lock(&rollup_lock);
-	if (check_time < global_last_rollup) {
-		MYSQL_RES *result = NULL;
-		MYSQL_ROW row;
-
-		/* check to see if we are hearing about this time for the
-		 * first time.
-		 */
-		query = xstrdup_printf("select job_db_inx "
-				       "from \"%s_%s\" where id_job=%u and "
-				       "time_submit=%ld and time_eligible=%ld "
-				       "and time_start=%ld;",
-				       mysql_conn->cluster_name,
-				       job_table, job_ptr->job_id,
-				       submit_time, begin_time, start_time);
-		debug3("%d(%s:%d) query\n%s",
-		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-		if (!(result =
-		      mysql_db_query_ret(mysql_conn, query, 0))) {
-			xfree(query);
-			slurm_mutex_unlock(&rollup_lock);
-			return SLURM_ERROR;
-		}
-		xfree(query);
-		if ((row = mysql_fetch_row(result))) {
-			mysql_free_result(result);
-			debug4("revieved an update for a "
-			       "job (%u) already known about",
-			       job_ptr->job_id);
-			slurm_mutex_unlock(&rollup_lock);
-			goto no_rollup_change;
-		}
-		mysql_free_result(result);
-
-		if (job_ptr->start_time)
-			debug("Need to reroll usage from %sJob %u "
-			      "from %s started then and we are just "
-			      "now hearing about it.",
-			      ctime(&check_time),
-			      job_ptr->job_id, mysql_conn->cluster_name);
-		else if (begin_time)
-			debug("Need to reroll usage from %sJob %u "
-			      "from %s became eligible then and we are just "
-			      "now hearing about it.",
-			      ctime(&check_time),
-			      job_ptr->job_id, mysql_conn->cluster_name);
-		else
-			debug("Need to reroll usage from %sJob %u "
-			      "from %s was submitted then and we are just "
-			      "now hearing about it.",
-			      ctime(&check_time),
-			      job_ptr->job_id, mysql_conn->cluster_name);
-
-		global_last_rollup = check_time;
-		slurm_mutex_unlock(&rollup_lock);
-
-		/* If the times here are later than the daily_rollup
-		   or monthly rollup it isn't a big deal since they
-		   are always shrunk down to the beginning of each
-		   time period.
-		*/
-		query = xstrdup_printf("update \"%s_%s\" set "
-				       "hourly_rollup=%ld, "
-				       "daily_rollup=%ld, monthly_rollup=%ld",
-				       mysql_conn->cluster_name,
-				       last_ran_table, check_time,
-				       check_time, check_time);
-		debug3("%d(%s:%d) query\n%s",
-		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-		rc = mysql_db_query(mysql_conn, query);
-		xfree(query);
-	} else
-		slurm_mutex_unlock(&rollup_lock);
-
-no_rollup_change:
-
+/* Fill in the rest of vals, _job_start_times() must be called first */
+static void _job_start_vals(mysql_conn_t *mysql_conn,
+			    struct job_record *job_ptr, job_start_vals_t *vals)
+{
 	if (job_ptr->name && job_ptr->name[0])
-		jname = slurm_add_slash_to_quotes(job_ptr->name);
+		vals->jname = slurm_add_slash_to_quotes(job_ptr->name);
 	else {
-		jname = xstrdup("allocation");
-		track_steps = 1;
+		vals->jname = xstrdup("allocation");
+		vals->track_steps = 1;
 	}
 
 	if (job_ptr->nodes && job_ptr->nodes[0])
-		nodes = job_ptr->nodes;
+		vals->nodes = job_ptr->nodes;
 	else
-		nodes = "None assigned";
+		vals->nodes = "None assigned";
 
 	if (job_ptr->batch_flag)
-		track_steps = 1;
+		vals->track_steps = 1;
 
 	if (slurmdbd_conf) {
-		block_id = xstrdup(job_ptr->comment);
-		node_cnt = job_ptr->total_nodes;
-		node_inx = job_ptr->network;
+		vals->block_id = xstrdup(job_ptr->comment);
+		vals->node_cnt = job_ptr->total_nodes;
+		vals->node_inx = xstrdup(job_ptr->network);
 	} else {
 		char temp_bit[BUF_SIZE];
 
 		if (job_ptr->node_bitmap) {
-			node_inx = bit_fmt(temp_bit, sizeof(temp_bit),
-					   job_ptr->node_bitmap);
+			vals->node_inx = xstrdup(bit_fmt(temp_bit,
+							 sizeof(temp_bit),
+							 job_ptr->node_bitmap));
 		}
 #ifdef HAVE_BG
 		select_g_select_jobinfo_get(job_ptr->select_jobinfo,
 					    SELECT_JOBDATA_BLOCK_ID,
-					    &block_id);
+					    &vals->block_id);
 		select_g_select_jobinfo_get(job_ptr->select_jobinfo,
 					    SELECT_JOBDATA_NODE_CNT,
-					    &node_cnt);
+					    &vals->node_cnt);
 #else
-		node_cnt = job_ptr->total_nodes;
+		vals->node_cnt = job_ptr->total_nodes;
 #endif
 	}
 
@@ -391,355 +325,341 @@ no_rollup_change:
 	 * cancelled before the job starts we also want to grab it. */
 	if (job_ptr->assoc_id
 	    && (job_ptr->start_time || IS_JOB_CANCELLED(job_ptr)))
-		wckeyid = _get_wckeyid(mysql_conn, &job_ptr->wckey,
-				       job_ptr->user_id,
-				       mysql_conn->cluster_name,
-				       job_ptr->assoc_id);
+		vals->wckeyid = _get_wckeyid(mysql_conn, &job_ptr->wckey,
+					     job_ptr->user_id,
+					     mysql_conn->cluster_name,
+					     job_ptr->assoc_id);
+}
 
-	if (!job_ptr->db_index) {
-		if (!begin_time)
-			begin_time = submit_time;
-		query = xstrdup_printf(
-			"insert into \"%s_%s\" "
-			"(id_job, id_assoc, id_qos, id_wckey, id_user, "
-			"id_group, nodelist, id_resv, timelimit, "
-			"time_eligible, time_submit, time_start, "
-			"job_name, track_steps, state, priority, cpus_req, "
-			"cpus_alloc, nodes_alloc",
-			mysql_conn->cluster_name, job_table);
+static void _free_job_start_vals(job_start_vals_t *vals)
+{
+	xfree(vals->block_id);
+	xfree(vals->jname);
+	xfree(vals->node_inx);
+}
 
-		if (job_ptr->account)
-			xstrcat(query, ", account");
-		if (job_ptr->partition)
-			xstrcat(query, ", partition");
-		if (block_id)
-			xstrcat(query, ", id_block");
-		if (job_ptr->wckey)
-			xstrcat(query, ", wckey");
-		if (node_inx)
-			xstrcat(query, ", node_inx");
+static int _job_start_opts(struct job_record *job_ptr,
+			   job_start_vals_t *vals)
+{
+	int opts = 0;
+
+	if (job_ptr->account)
+		opts |= JOB_START_ACCOUNT;
+	if (job_ptr->partition)
+		opts |= JOB_START_PARTITION;
+	if (vals->block_id)
+		opts |= JOB_START_BLOCK_ID;
+	if (job_ptr->wckey)
+		opts |= JOB_START_WCKEY;
+	if (vals->node_inx)
+		opts |= JOB_START_NODE_INX;
+
+	return opts;
+}
 
-		xstrfmtcat(query,
-			   ") values (%u, %u, %u, %u, %u, %u, '%s', %u, %u, "
-			   "%ld, %ld, %ld, '%s', %u, %u, %u, %u, %u, %u",
-			   job_ptr->job_id, job_ptr->assoc_id,
-			   job_ptr->qos_id, wckeyid,
-			   job_ptr->user_id, job_ptr->group_id, nodes,
-			   job_ptr->resv_id, job_ptr->time_limit,
-			   begin_time, submit_time, start_time,
-			   jname, track_steps, job_state,
-			   job_ptr->priority, job_ptr->details->min_cpus,
-			   job_ptr->total_cpus, node_cnt);
+/* Start an insert of job records with the columns in opts, the values of
+ * each record are added with _job_insert_values() and the statement
+ * finished with _job_insert_dup() */
+static char *_job_insert_query(mysql_conn_t *mysql_conn, int opts)
+{
+	char *query = xstrdup_printf(
+		"insert into \"%s_%s\" "
+		"(id_job, id_assoc, id_qos, id_wckey, id_user, "
+		"id_group, nodelist, id_resv, timelimit, "
+		"time_eligible, time_submit, time_start, "
+		"job_name, track_steps, state, priority, cpus_req, "
+		"cpus_alloc, nodes_alloc",
+		mysql_conn->cluster_name, job_table);
 
-		if (job_ptr->account)
-			xstrfmtcat(query, ", '%s'", job_ptr->account);
-		if (job_ptr->partition)
-			xstrfmtcat(query, ", '%s'", job_ptr->partition);
-		if (block_id)
-			xstrfmtcat(query, ", '%s'", block_id);
-		if (job_ptr->wckey)
-			xstrfmtcat(query, ", '%s'", job_ptr->wckey);
-		if (node_inx)
-			xstrfmtcat(query, ", '%s'", node_inx);
+	if (opts & JOB_START_ACCOUNT)
+		xstrcat(query, ", account");
+	if (opts & JOB_START_PARTITION)
+		xstrcat(query, ", partition");
+	if (opts & JOB_START_BLOCK_ID)
+		xstrcat(query, ", id_block");
+	if (opts & JOB_START_WCKEY)
+		xstrcat(query, ", wckey");
+	if (opts & JOB_START_NODE_INX)
+		xstrcat(query, ", node_inx");
+	xstrcat(query, ") values ");
+
+	return query;
+}
 
-		xstrfmtcat(query,
-			   ") on duplicate key update "
-			   "job_db_inx=LAST_INSERT_ID(job_db_inx), "
-			   "id_wckey=%u, id_user=%u, id_group=%u, "
-			   "nodelist='%s', id_resv=%u, timelimit=%u, "
-			   "time_submit=%ld, time_start=%ld, "
-			   "job_name='%s', track_steps=%u, id_qos=%u, "
-			   "state=greatest(state, %u), priority=%u, "
-			   "cpus_req=%u, cpus_alloc=%u, nodes_alloc=%u",
-			   wckeyid, job_ptr->user_id, job_ptr->group_id, nodes,
-			   job_ptr->resv_id, job_ptr->time_limit,
-			   submit_time, start_time,
-			   jname, track_steps, job_ptr->qos_id, job_state,
-			   job_ptr->priority, job_ptr->details->min_cpus,
-			   job_ptr->total_cpus, node_cnt);
+static void _job_insert_values(char **query, struct job_record *job_ptr,
+			       job_start_vals_t *vals, int opts)
+{
+	xstrfmtcat(*query,
+		   "(%u, %u, %u, %u, %u, %u, '%s', %u, %u, "
+		   "%ld, %ld, %ld, '%s', %u, %u, %u, %u, %u, %u",
+		   job_ptr->job_id, job_ptr->assoc_id,
+		   job_ptr->qos_id, vals->wckeyid,
+		   job_ptr->user_id, job_ptr->group_id, vals->nodes,
+		   job_ptr->resv_id, job_ptr->time_limit,
+		   vals->begin_time, vals->submit_time, vals->start_time,
+		   vals->jname, vals->track_steps, vals->job_state,
+		   job_ptr->priority, job_ptr->details->min_cpus,
+		   job_ptr->total_cpus, vals->node_cnt);
+
+	if (opts & JOB_START_ACCOUNT)
+		xstrfmtcat(*query, ", '%s'", job_ptr->account);
+	if (opts & JOB_START_PARTITION)
+		xstrfmtcat(*query, ", '%s'", job_ptr->partition);
+	if (opts & JOB_START_BLOCK_ID)
+		xstrfmtcat(*query, ", '%s'", vals->block_id);
+	if (opts & JOB_START_WCKEY)
+		xstrfmtcat(*query, ", '%s'", job_ptr->wckey);
+	if (opts & JOB_START_NODE_INX)
+		xstrfmtcat(*query, ", '%s'", vals->node_inx);
+	xstrcat(*query, ")");
+}
 
-		if (job_ptr->account)
-			xstrfmtcat(query, ", account='%s'", job_ptr->account);
-		if (job_ptr->partition)
-			xstrfmtcat(query, ", partition='%s'",
-				   job_ptr->partition);
-		if (block_id)
-			xstrfmtcat(query, ", id_block='%s'", block_id);
-		if (job_ptr->wckey)
-			xstrfmtcat(query, ", wckey='%s'", job_ptr->wckey);
-		if (node_inx)
-			xstrfmtcat(query, ", node_inx='%s'", node_inx);
+static void _job_insert_dup(char **query, int opts)
+{
+	xstrcat(*query,
+		" on duplicate key update "
+		"job_db_inx=LAST_INSERT_ID(job_db_inx), "
+		"id_wckey=VALUES(id_wckey), id_user=VALUES(id_user), "
+		"id_group=VALUES(id_group), nodelist=VALUES(nodelist), "
+		"id_resv=VALUES(id_resv), timelimit=VALUES(timelimit), "
+		"time_submit=VALUES(time_submit), "
+		"time_start=VALUES(time_start), "
+		"job_name=VALUES(job_name), track_steps=VALUES(track_steps), "
+		"id_qos=VALUES(id_qos), state=greatest(state, VALUES(state)), "
+		"priority=VALUES(priority), cpus_req=VALUES(cpus_req), "
+		"cpus_alloc=VALUES(cpus_alloc), "
+		"nodes_alloc=VALUES(nodes_alloc)");
+
+	if (opts & JOB_START_ACCOUNT)
+		xstrcat(*query, ", account=VALUES(account)");
+	if (opts & JOB_START_PARTITION)
+		xstrcat(*query, ", partition=VALUES(partition)");
+	if (opts & JOB_START_BLOCK_ID)
+		xstrcat(*query, ", id_block=VALUES(id_block)");
+	if (opts & JOB_START_WCKEY)
+		xstrcat(*query, ", wckey=VALUES(wckey)");
+	if (opts & JOB_START_NODE_INX)
+		xstrcat(*query, ", node_inx=VALUES(node_inx)");
+}
 
-		debug3("%d(%s:%d) query\n%s",
-		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	try_again:
-		if (!(job_ptr->db_index = mysql_db_insert_ret_id(
-			      mysql_conn, query))) {
-			if (!reinit) {
-				error("It looks like the storage has gone "
-				      "away trying to reconnect");
-				mysql_db_close_db_connection(
-					mysql_conn);
-				/* reconnect */
-				check_connection(mysql_conn);
-				reinit = 1;
-				goto try_again;
-			} else
-				rc = SLURM_ERROR;
-		}
-	} else {
-		query = xstrdup_printf("update \"%s_%s\" set nodelist='%s', ",
-				       mysql_conn->cluster_name,
-				       job_table, nodes);
+/* Log the rate of records stored in one commit since start and of all
+ * records stored in bulk so far */
+static void _bulk_stats(char *type, int rows, int query_cnt,
+			struct timeval *start)
+{
+	uint32_t commits;
+	uint64_t total_rows, total_usec;
+	struct timeval now;
+	long usec;
+
+	gettimeofday(&now, NULL);
+	usec = MAX(diff_tv(start, &now), 1);
+	slurm_mutex_lock(&bulk_stats_lock);
+	bulk_commits++;
+	bulk_rows += rows;
+	bulk_usec += usec;
+	commits = bulk_commits;
+	total_rows = bulk_rows;
+	total_usec = bulk_usec;
+	slurm_mutex_unlock(&bulk_stats_lock);
+
+	debug("%d %s records stored by %d queries in one commit "
+	      "in %ld usec, %"PRIu64" rows/sec",
+	      rows, type, query_cnt, usec,
+	      ((uint64_t) rows * 1000000) / usec);
+	debug2("%u bulk record commits, %"PRIu64" rows/sec, "
+	       "%"PRIu64" usec per commit",
+	       commits, (total_rows * 1000000) / MAX(total_usec, 1),
+	       total_usec / commits);
+}
 
-		if (job_ptr->account)
-			xstrfmtcat(query, "account='%s', ", job_ptr->account);
-		if (job_ptr->partition)
-			xstrfmtcat(query, "partition='%s', ",
-				   job_ptr->partition);
-		if (block_id)
-			xstrfmtcat(query, "id_block='%s', ", block_id);
-		if (job_ptr->wckey)
-			xstrfmtcat(query, "wckey='%s', ", job_ptr->wckey);
-		if (node_inx)
-			xstrfmtcat(query, "node_inx='%s', ", node_inx);
+/* Only a new record is needed for most jobs, those can be inserted
+ * together with others.  Anything else goes through as_mysql_job_start().
+ * RET true if the job can be inserted with others, vals then has the
+ *	times of the job record */
+static bool _job_start_bulk(struct job_record *job_ptr,
+			    job_start_vals_t *vals)
+{
+	time_t check_time;
+	bool bulk;
+
+	if (IS_JOB_RESIZING(job_ptr) || job_ptr->resize_time
+	    || job_ptr->db_index
+	    || !job_ptr->details || !job_ptr->details->submit_time)
+		return false;
+
+	_job_start_times(job_ptr, vals);
+	if (vals->start_time)
+		check_time = vals->start_time;
+	else if (vals->begin_time)
+		check_time = vals->begin_time;
+	else
+		check_time = vals->submit_time;
 
-		xstrfmtcat(query, "time_start=%ld, job_name='%s', state=%u, "
-			   "cpus_alloc=%u, nodes_alloc=%u, id_qos=%u, "
-			   "id_assoc=%u, id_wckey=%u, id_resv=%u, timelimit=%u "
-			   "where job_db_inx=%d",
-			   start_time, jname, job_state,
-			   job_ptr->total_cpus, node_cnt, job_ptr->qos_id,
-			   job_ptr->assoc_id, wckeyid,
-			   job_ptr->resv_id, job_ptr->time_limit,
-			   job_ptr->db_index);
-		debug3("%d(%s:%d) query\n%s",
-		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-		rc = mysql_db_query(mysql_conn, query);
-	}
+	/* usage rolled up past this time has to be reset */
+	slurm_mutex_lock(&rollup_lock);
+	bulk = (check_time >= global_last_rollup);
+	slurm_mutex_unlock(&rollup_lock);
 
-	xfree(block_id);
-	xfree(jname);
-	xfree(query);
+	return bulk;
+}
 
-	/* now we will reset all the steps */
-	if (IS_JOB_RESIZING(job_ptr)) {
-		if (IS_JOB_SUSPENDED(job_ptr))
-			as_mysql_suspend(mysql_conn, job_db_inx, job_ptr);
-		/* Here we aren't sure how many cpus are being changed here in
-		   the step since we don't have that information from the
-		   job.  The resize of steps shouldn't happen very often in
-		   the first place (srun --no-kill option), and this don't
-		   effect accounting in the first place so it isn't a
-		   big deal. */
+static void _job_bulk_run(mysql_conn_t *mysql_conn, job_bulk_t *bulk)
+{
+	if (!bulk->query)
+		return;
 
-		query = xstrdup_printf("update \"%s_%s\" set job_db_inx=%u "
-				       "where job_db_inx=%u;",
-				       mysql_conn->cluster_name, step_table,
-				       job_ptr->db_index, job_db_inx);
+	_job_insert_dup(&bulk->query, bulk->opts);
+	debug3("%d(%s:%d) query\n%s",
+	       mysql_conn->conn, THIS_FILE, __LINE__, bulk->query);
+	/* Records not inserted are found missing when getting their
+	 * db_index and inserted one at a time */
+	if (mysql_db_query(mysql_conn, bulk->query) != SLURM_SUCCESS)
+		error("Couldn't insert %d job records together",
+		      bulk->query_rows);
+	xfree(bulk->query);
+	bulk->query_cnt++;
+	bulk->query_rows = 0;
+}
 
-		debug3("%d(%s:%d) query\n%s",
-		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-		rc = mysql_db_query(mysql_conn, query);
-		xfree(query);
+static void _job_bulk_add(mysql_conn_t *mysql_conn, job_bulk_t *bulk,
+			  struct job_record *job_ptr, job_start_vals_t *vals)
+{
+	int opts = _job_start_opts(job_ptr, vals);
+
+	/* Statements are run in the order the records came in, so a
+	 * later record of a job always updates an earlier one */
+	if (bulk->query && ((opts != bulk->opts) ||
+			    (bulk->query_rows >= JOB_START_BULK_MAX)))
+		_job_bulk_run(mysql_conn, bulk);
+
+	if (!bulk->job_cnt) {
+		gettimeofday(&bulk->start, NULL);
+		/* commit all the records at once */
+		if (!mysql_conn->rollback)
+			mysql_autocommit(mysql_conn->db_conn, 0);
 	}
 
-	return rc;
+	if (!bulk->query) {
+		bulk->query = _job_insert_query(mysql_conn, opts);
+		bulk->opts = opts;
+	} else
+		xstrcat(bulk->query, ", ");
+	_job_insert_values(&bulk->query, job_ptr, vals, opts);
+	bulk->query_rows++;
+
+	xstrfmtcat(bulk->id_str, "%s%u",
+		   bulk->id_str ? ", " : "", job_ptr->job_id);
+	bulk->job[bulk->job_cnt++] = job_ptr;
 }
 
-extern List as_mysql_modify_job(mysql_conn_t *mysql_conn, uint32_t uid,
-				slurmdb_job_modify_cond_t *job_cond,
-				slurmdb_job_rec_t *job)
+static int _cmp_job_key(struct job_record *job_ptr, uint32_t job_id,
+			uint32_t assoc_id, time_t submit_time)
 {
-	List ret_list = NULL;
-	int rc = SLURM_SUCCESS;
-	char *object = NULL;
-	char *vals = NULL, *query = NULL, *cond_char = NULL;
-	time_t now = time(NULL);
-	char *user_name = NULL;
-	MYSQL_RES *result = NULL;
-	MYSQL_ROW row;
+	if (job_ptr->job_id != job_id)
+		return (job_ptr->job_id < job_id) ? -1 : 1;
+	if (job_ptr->assoc_id != assoc_id)
+		return (job_ptr->assoc_id < assoc_id) ? -1 : 1;
+	if (job_ptr->details->submit_time != submit_time)
+		return (job_ptr->details->submit_time < submit_time) ? -1 : 1;
+	return 0;
+}
 
-	if (!job_cond || !job) {
-		error("we need something to change");
-		return NULL;
-	} else if (job_cond->job_id == NO_VAL) {
-		errno = SLURM_NO_CHANGE_IN_DATA;
-		error("Job ID was not specified for job modification\n");
-		return NULL;
-	} else if (!job_cond->cluster) {
-		errno = SLURM_NO_CHANGE_IN_DATA;
-		error("Cluster was not specified for job modification\n");
-		return NULL;
-	} else if (check_connection(mysql_conn) != SLURM_SUCCESS)
-		return NULL;
+static int _sort_job_key(const void *x, const void *y)
+{
+	struct job_record *job_a = *(struct job_record **) x;
+	struct job_record *job_b = *(struct job_record **) y;
 
-	if (job->derived_ec != NO_VAL)
-		xstrfmtcat(vals, ", derived_ec=%u", job->derived_ec);
+	return _cmp_job_key(job_a, job_b->job_id, job_b->assoc_id,
+			    job_b->details->submit_time);
+}
 
-	if (job->derived_es)
-		xstrfmtcat(vals, ", derived_es='%s'", job->derived_es);
-
-	if (!vals) {
-		errno = SLURM_NO_CHANGE_IN_DATA;
-		error("No change specified for job modification");
-		return NULL;
-	}
-
-	/* Here we want to get the last job submitted here */
-	query = xstrdup_printf("select job_db_inx, id_job, time_submit "
-			       "from \"%s_%s\" where deleted=0 "
-			       "&& id_job=%u && id_user=%u "
-			       "order by time_submit desc limit 1;",
-			       job_cond->cluster, job_table,
-			       job_cond->job_id, uid);
+/* Fill in the db_index of the jobs inserted together with one query for
+ * all of them, matching the sorted jobs against the sorted rows */
+static void _job_bulk_db_index(mysql_conn_t *mysql_conn, job_bulk_t *bulk)
+{
+	MYSQL_RES *result = NULL;
+	MYSQL_ROW row;
+	char *query;
+	int i = 0, diff;
 
+	query = xstrdup_printf("select job_db_inx, id_job, id_assoc, "
+			       "time_submit from \"%s_%s\" "
+			       "where id_job in (%s) "
+			       "order by id_job, id_assoc, time_submit",
+			       mysql_conn->cluster_name, job_table,
+			       bulk->id_str);
 	debug3("%d(%s:%d) query\n%s",
 	       mysql_conn->conn, THIS_FILE, __LINE__, query);
 	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
-		xfree(vals);
-		xfree(query);
-		return NULL;
-	}
-
-	if ((row = mysql_fetch_row(result))) {
-		char tmp_char[25];
-		time_t time_submit = atol(row[2]);
-		slurm_make_time_str(&time_submit, tmp_char, sizeof(tmp_char));
-
-		xstrfmtcat(cond_char, "job_db_inx=%s", row[0]);
-		object = xstrdup_printf("%s submitted at %s", row[1], tmp_char);
-
-		ret_list = list_create(slurm_destroy_char);
-		list_append(ret_list, object);
-		mysql_free_result(result);
-	} else {
-		errno = SLURM_NO_CHANGE_IN_DATA;
-		debug3("didn't effect anything\n%s", query);
-		xfree(vals);
 		xfree(query);
-		mysql_free_result(result);
-		return NULL;
+		return;
 	}
 	xfree(query);
 
-	user_name = uid_to_string((uid_t) uid);
-	rc = modify_common(mysql_conn, DBD_MODIFY_JOB, now, user_name,
-			   job_table, cond_char, vals, job_cond->cluster);
-	xfree(user_name);
-	xfree(cond_char);
-	xfree(vals);
-	if (rc == SLURM_ERROR) {
-		error("Couldn't modify job");
-		list_destroy(ret_list);
-		ret_list = NULL;
+	qsort(bulk->job, bulk->job_cnt, sizeof(struct job_record *),
+	      _sort_job_key);
+	while ((i < bulk->job_cnt) && (row = mysql_fetch_row(result))) {
+		uint32_t job_id = slurm_atoul(row[1]);
+		uint32_t assoc_id = slurm_atoul(row[2]);
+		time_t submit_time = slurm_atoul(row[3]);
+
+		while ((i < bulk->job_cnt) &&
+		       ((diff = _cmp_job_key(bulk->job[i], job_id, assoc_id,
+					     submit_time)) <= 0)) {
+			/* a job sent more than once has one record */
+			if (diff == 0)
+				bulk->job[i]->db_index = slurm_atoul(row[0]);
+			i++;
+		}
 	}
-
-	return ret_list;
+	mysql_free_result(result);
 }
 
-extern int as_mysql_job_complete(mysql_conn_t *mysql_conn,
-				 struct job_record *job_ptr)
+/* Finish inserting the jobs in bulk, commit them and get their db_index.
+ * RET SLURM_SUCCESS if all jobs were inserted */
+static int _job_bulk_fini(mysql_conn_t *mysql_conn, job_bulk_t *bulk)
 {
-	char *query = NULL, *nodes = NULL;
-	int rc = SLURM_SUCCESS, job_state;
-	time_t submit_time, end_time;
-
-	if (!job_ptr->db_index
-	    && ((!job_ptr->details || !job_ptr->details->submit_time)
-		&& !job_ptr->resize_time)) {
-		error("as_mysql_job_complete: "
-		      "Not inputing this job, it has no submit time.");
-		return SLURM_ERROR;
-	}
+	int i, rows, rc = SLURM_SUCCESS;
 
-	if (check_connection(mysql_conn) != SLURM_SUCCESS)
-		return ESLURM_DB_CONNECTION;
-	debug2("as_mysql_slurmdb_job_complete() called");
-
-	if (job_ptr->resize_time)
-		submit_time = job_ptr->resize_time;
-	else
-		submit_time = job_ptr->details->submit_time;
+	if (!bulk->job_cnt)
+		return rc;
 
-	if (IS_JOB_RESIZING(job_ptr)) {
-		end_time = job_ptr->resize_time;
-		job_state = JOB_RESIZING;
-	} else {
-		/* If we get an error with this just fall through to avoid an
-		 * infinite loop */
-		if (job_ptr->end_time == 0) {
-			debug("as_mysql_jobacct: job %u never started",
-			      job_ptr->job_id);
-			return SLURM_SUCCESS;
-		}
-		end_time = job_ptr->end_time;
-		job_state = job_ptr->job_state & JOB_STATE_BASE;
+	_job_bulk_run(mysql_conn, bulk);
+	if (!mysql_conn->rollback) {
+		if (mysql_db_commit(mysql_conn))
+			error("commit of %d job records failed",
+			      bulk->job_cnt);
+		mysql_autocommit(mysql_conn->db_conn, 1);
 	}
 
-	slurm_mutex_lock(&rollup_lock);
-	if (end_time < global_last_rollup) {
-		global_last_rollup = job_ptr->end_time;
-		slurm_mutex_unlock(&rollup_lock);
-
-		query = xstrdup_printf("update \"%s_%s\" set "
-				       "hourly_rollup=%ld, "
-				       "daily_rollup=%ld, monthly_rollup=%ld",
-				       mysql_conn->cluster_name,
-				       last_ran_table, end_time,
-				       end_time, end_time);
-		debug3("%d(%s:%d) query\n%s",
-		       mysql_conn->conn, THIS_FILE, __LINE__, query);
-		rc = mysql_db_query(mysql_conn, query);
-		xfree(query);
-	} else
-		slurm_mutex_unlock(&rollup_lock);
-
-	if (job_ptr->nodes && job_ptr->nodes[0])
-		nodes = job_ptr->nodes;
-	else
-		nodes = "None assigned";
-
-	if (!job_ptr->db_index) {
-		if (!(job_ptr->db_index =
-		      _get_db_index(mysql_conn,
-				    submit_time,
-				    job_ptr->job_id,
-				    job_ptr->assoc_id))) {
-			/* If we get an error with this just fall
-			 * through to avoid an infinite loop
-			 */
-			if (as_mysql_job_start(
-				    mysql_conn, job_ptr) == SLURM_ERROR) {
-				error("couldn't add job %u at job completion",
-				      job_ptr->job_id);
-				return SLURM_SUCCESS;
-			}
-		}
+	_job_bulk_db_index(mysql_conn, bulk);
+	rows = bulk->job_cnt;
+	for (i = 0; i < bulk->job_cnt; i++) {
+		if (bulk->job[i]->db_index)
+			continue;
+		debug("Inserting job %u by itself", bulk->job[i]->job_id);
+		rows--;
+		if (as_mysql_job_start(mysql_conn, bulk->job[i])
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
 	}
 
-	query = xstrdup_printf("update \"%s_%s\" set "
-			       "time_end=%ld, state=%d, nodelist='%s', "
-			       "derived_ec=%d, exit_code=%d, "
-			       "kill_requid=%d where job_db_inx=%d;",
-			       mysql_conn->cluster_name, job_table,
-			       end_time, job_state, nodes,
-			       job_ptr->derived_ec, job_ptr->exit_code,
-			       job_ptr->requid, job_ptr->db_index);
+	_bulk_stats("job", rows, bulk->query_cnt, &bulk->start);
 
-	debug3("%d(%s:%d) query\n%s",
-	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	rc = mysql_db_query(mysql_conn, query);
-	xfree(query);
+	xfree(bulk->id_str);
+	bulk->job_cnt = 0;
+	bulk->query_cnt = 0;
 
 	return rc;
 }
 
-extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
-			       struct step_record *step_ptr)
+/* Get the values of a step record for _step_insert_query().
+ * RET SLURM_SUCCESS, values is NULL if the step is not to be stored */
+static int _step_start_values(mysql_conn_t *mysql_conn,
+			      struct step_record *step_ptr, char **values)
 {
 	int cpus = 0, tasks = 0, nodes = 0, task_dist = 0;
-	int rc=SLURM_SUCCESS;
 	char node_list[BUFFER_SIZE];
 	char *node_inx = NULL, *step_name = NULL;
 	time_t start_time, submit_time;
@@ -747,7 +667,6 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 #ifdef HAVE_BG
 	char *ionodes = NULL;
 #endif
-	char *query = NULL;
 
 	if (!step_ptr->job_ptr->db_index
 	    && ((!step_ptr->job_ptr->details
@@ -767,8 +686,6 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 		submit_time = step_ptr->job_ptr->details->submit_time;
 	}
 
-	if (check_connection(mysql_conn) != SLURM_SUCCESS)
-		return ESLURM_DB_CONNECTION;
 	if (slurmdbd_conf) {
 		tasks = step_ptr->job_ptr->details->num_tasks;
 		cpus = step_ptr->cpu_count;
@@ -849,37 +766,23 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 
 	step_name = slurm_add_slash_to_quotes(step_ptr->name);
 
-	/* we want to print a -1 for the requid so leave it a
-	   %d */
 	/* The stepid could be -2 so use %d not %u */
-	query = xstrdup_printf(
-		"insert into \"%s_%s\" (job_db_inx, id_step, time_start, "
-		"step_name, state, "
-		"cpus_alloc, nodes_alloc, task_cnt, nodelist, "
-		"node_inx, task_dist) "
-		"values (%d, %d, %d, '%s', %d, %d, %d, %d, "
-		"'%s', '%s', %d) "
-		"on duplicate key update cpus_alloc=%d, nodes_alloc=%d, "
-		"task_cnt=%d, time_end=0, state=%d, "
-		"nodelist='%s', node_inx='%s', task_dist=%d",
-		mysql_conn->cluster_name, step_table,
-		step_ptr->job_ptr->db_index,
-		step_ptr->step_id,
-		(int)start_time, step_name,
-		JOB_RUNNING, cpus, nodes, tasks, node_list, node_inx, task_dist,
-		cpus, nodes, tasks, JOB_RUNNING,
-		node_list, node_inx, task_dist);
-	debug3("%d(%s:%d) query\n%s",
-	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	rc = mysql_db_query(mysql_conn, query);
-	xfree(query);
+	*values = xstrdup_printf("(%d, %d, %d, '%s', %d, %d, %d, %d, "
+				 "'%s', '%s', %d)",
+				 step_ptr->job_ptr->db_index,
+				 step_ptr->step_id,
+				 (int)start_time, step_name,
+				 JOB_RUNNING, cpus, nodes, tasks,
+				 node_list, node_inx, task_dist);
 	xfree(step_name);
 
-	return rc;
+	return SLURM_SUCCESS;
 }
 
-extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
-				  struct step_record *step_ptr)
+/* Get the statement storing the end of a step.
+ * RET SLURM_SUCCESS, query is NULL if the step is not to be stored */
+static int _step_complete_query(mysql_conn_t *mysql_conn,
+				struct step_record *step_ptr, char **query)
 {
 	time_t now;
 	int elapsed;
@@ -889,8 +792,6 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 	struct jobacctinfo dummy_jobacct;
 	double ave_vsize = 0, ave_rss = 0, ave_pages = 0;
 	double ave_cpu = 0, ave_cpu2 = 0;
-	char *query = NULL;
-	int rc =SLURM_SUCCESS;
 	uint32_t exit_code = 0;
 	time_t start_time, submit_time;
 
@@ -918,9 +819,6 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 		jobacct = &dummy_jobacct;
 	}
 
-	if (check_connection(mysql_conn) != SLURM_SUCCESS)
-		return ESLURM_DB_CONNECTION;
-
 	if (slurmdbd_conf) {
 		now = step_ptr->job_ptr->end_time;
 		tasks = step_ptr->job_ptr->details->num_tasks;
@@ -992,7 +890,7 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 	}
 
 	/* The stepid could be -2 so use %d not %u */
-	query = xstrdup_printf(
+	*query = xstrdup_printf(
 		"update \"%s_%s\" set time_end=%d, state=%d, "
 		"kill_requid=%d, exit_code=%d, "
 		"user_sec=%u, user_usec=%u, "
@@ -1035,12 +933,665 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 		jobacct->min_cpu_id.nodeid,	/* min cpu node */
 		ave_cpu,	/* ave cpu */
 		step_ptr->job_ptr->db_index, step_ptr->step_id);
+
+	return SLURM_SUCCESS;
+}
+
+static char *_step_insert_query(mysql_conn_t *mysql_conn)
+{
+	return xstrdup_printf(
+		"insert into \"%s_%s\" (job_db_inx, id_step, time_start, "
+		"step_name, state, "
+		"cpus_alloc, nodes_alloc, task_cnt, nodelist, "
+		"node_inx, task_dist) values ",
+		mysql_conn->cluster_name, step_table);
+}
+
+static void _step_insert_dup(char **query)
+{
+	xstrcat(*query, " on duplicate key update "
+		"cpus_alloc=VALUES(cpus_alloc), "
+		"nodes_alloc=VALUES(nodes_alloc), "
+		"task_cnt=VALUES(task_cnt), time_end=0, "
+		"state=VALUES(state), nodelist=VALUES(nodelist), "
+		"node_inx=VALUES(node_inx), task_dist=VALUES(task_dist)");
+}
+
+static void _step_bulk_run(mysql_conn_t *mysql_conn, step_bulk_t *bulk)
+{
+	if (!bulk->query)
+		return;
+
+	if (bulk->insert)
+		_step_insert_dup(&bulk->query);
 	debug3("%d(%s:%d) query\n%s",
-	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	rc = mysql_db_query(mysql_conn, query);
-	xfree(query);
+	       mysql_conn->conn, THIS_FILE, __LINE__, bulk->query);
+	if (mysql_db_query(mysql_conn, bulk->query) != SLURM_SUCCESS)
+		bulk->rc = SLURM_ERROR;
+	xfree(bulk->query);
+	bulk->query_cnt++;
+	bulk->query_rows = 0;
+}
 
-	return rc;
+/* Add the values of a new step record or the statement storing the end
+ * of one to the query run next */
+static void _step_bulk_add(mysql_conn_t *mysql_conn, step_bulk_t *bulk,
+			   char *values)
+{
+	if (bulk->query_rows >= STEP_BULK_MAX)
+		_step_bulk_run(mysql_conn, bulk);
+
+	if (!bulk->rows) {
+		gettimeofday(&bulk->start, NULL);
+		/* commit all the records at once */
+		if (!mysql_conn->rollback)
+			mysql_autocommit(mysql_conn->db_conn, 0);
+	}
+
+	if (!bulk->query) {
+		if (bulk->insert)
+			bulk->query = _step_insert_query(mysql_conn);
+	} else
+		xstrcat(bulk->query, bulk->insert ? ", " : "; ");
+	xstrcat(bulk->query, values);
+	bulk->query_rows++;
+	bulk->rows++;
+}
+
+/* Run what is left of the query and commit all the step records, nothing
+ * is kept if any of them failed.
+ * RET SLURM_SUCCESS if all steps were stored */
+static int _step_bulk_fini(mysql_conn_t *mysql_conn, step_bulk_t *bulk)
+{
+	if (!bulk->rows)
+		return bulk->rc;
+
+	if (bulk->rc == SLURM_SUCCESS)
+		_step_bulk_run(mysql_conn, bulk);
+	else
+		xfree(bulk->query);
+	if (!mysql_conn->rollback) {
+		if (bulk->rc != SLURM_SUCCESS)
+			mysql_db_rollback(mysql_conn);
+		else if (mysql_db_commit(mysql_conn)) {
+			error("commit of %d step records failed", bulk->rows);
+			bulk->rc = SLURM_ERROR;
+		}
+		mysql_autocommit(mysql_conn->db_conn, 1);
+	}
+
+	if (bulk->rc == SLURM_SUCCESS)
+		_bulk_stats("step", bulk->rows, bulk->query_cnt,
+			    &bulk->start);
+
+	return bulk->rc;
+}
+
+/* extern functions */
+
+extern int as_mysql_job_start(mysql_conn_t *mysql_conn,
+			      struct job_record *job_ptr)
+{
+	int rc=SLURM_SUCCESS;
+	char *query = NULL;
+	int reinit = 0;
+	time_t check_time;
+	job_start_vals_t vals;
+	uint32_t job_db_inx = job_ptr->db_index;
+
+	if ((!job_ptr->details || !job_ptr->details->submit_time)
+	    && !job_ptr->resize_time) {
+		error("as_mysql_job_start: "
+		      "Not inputing this job, it has no submit time.");
+		return SLURM_ERROR;
+	}
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	debug2("as_mysql_slurmdb_job_start() called");
+
+	memset(&vals, 0, sizeof(job_start_vals_t));
+	vals.job_state = job_ptr->job_state;
+
+	/* Since we need a new db_inx make sure the old db_inx
+	 * removed. This is most likely the only time we are going to
+	 * be notified of the change also so make the state without
+	 * the resize. */
+	if (IS_JOB_RESIZING(job_ptr)) {
+		/* If we have a db_index lets end the previous record. */
+		if (job_ptr->db_index)
+			as_mysql_job_complete(mysql_conn, job_ptr);
+		else
+			error("We don't have a db_index for job %u, "
+			      "this should never happen.", job_ptr->job_id);
+		vals.job_state &= (~JOB_RESIZING);
+		job_ptr->db_index = 0;
+	}
+
+	vals.job_state &= JOB_STATE_BASE;
+
+	_job_start_times(job_ptr, &vals);
+
+	/* See what we are hearing about here if no start time. If
+	 * this job latest time is before the last roll up we will
+	 * need to reset it to look at this job. */
+	if (vals.start_time)
+		check_time = vals.start_time;
+	else if (vals.begin_time)
+		check_time = vals.begin_time;
+	else
+		check_time = vals.submit_time;
+
+	slurm_mutex_lock(&rollup_lock);
+	if (check_time < global_last_rollup) {
+		MYSQL_RES *result = NULL;
+		MYSQL_ROW row;
+
+		/* check to see if we are hearing about this time for the
+		 * first time.
+		 */
+		query = xstrdup_printf("select job_db_inx "
+				       "from \"%s_%s\" where id_job=%u and "
+				       "time_submit=%ld and time_eligible=%ld "
+				       "and time_start=%ld;",
+				       mysql_conn->cluster_name,
+				       job_table, job_ptr->job_id,
+				       vals.submit_time, vals.begin_time,
+				       vals.start_time);
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		if (!(result =
+		      mysql_db_query_ret(mysql_conn, query, 0))) {
+			xfree(query);
+			slurm_mutex_unlock(&rollup_lock);
+			return SLURM_ERROR;
+		}
+		xfree(query);
+		if ((row = mysql_fetch_row(result))) {
+			mysql_free_result(result);
+			debug4("revieved an update for a "
+			       "job (%u) already known about",
+			       job_ptr->job_id);
+			slurm_mutex_unlock(&rollup_lock);
+			goto no_rollup_change;
+		}
+		mysql_free_result(result);
+
+		if (job_ptr->start_time)
+			debug("Need to reroll usage from %sJob %u "
+			      "from %s started then and we are just "
+			      "now hearing about it.",
+			      ctime(&check_time),
+			      job_ptr->job_id, mysql_conn->cluster_name);
+		else if (vals.begin_time)
+			debug("Need to reroll usage from %sJob %u "
+			      "from %s became eligible then and we are just "
+			      "now hearing about it.",
+			      ctime(&check_time),
+			      job_ptr->job_id, mysql_conn->cluster_name);
+		else
+			debug("Need to reroll usage from %sJob %u "
+			      "from %s was submitted then and we are just "
+			      "now hearing about it.",
+			      ctime(&check_time),
+			      job_ptr->job_id, mysql_conn->cluster_name);
+
+		global_last_rollup = check_time;
+		slurm_mutex_unlock(&rollup_lock);
+
+		/* If the times here are later than the daily_rollup
+		   or monthly rollup it isn't a big deal since they
+		   are always shrunk down to the beginning of each
+		   time period.
+		*/
+		query = xstrdup_printf("update \"%s_%s\" set "
+				       "hourly_rollup=%ld, "
+				       "daily_rollup=%ld, monthly_rollup=%ld",
+				       mysql_conn->cluster_name,
+				       last_ran_table, check_time,
+				       check_time, check_time);
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+	} else
+		slurm_mutex_unlock(&rollup_lock);
+
+no_rollup_change:
+
+	_job_start_vals(mysql_conn, job_ptr, &vals);
+
+	if (!job_ptr->db_index) {
+		int opts = _job_start_opts(job_ptr, &vals);
+
+		if (!vals.begin_time)
+			vals.begin_time = vals.submit_time;
+		query = _job_insert_query(mysql_conn, opts);
+		_job_insert_values(&query, job_ptr, &vals, opts);
+		_job_insert_dup(&query, opts);
+
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+	try_again:
+		if (!(job_ptr->db_index = mysql_db_insert_ret_id(
+			      mysql_conn, query))) {
+			if (!reinit) {
+				error("It looks like the storage has gone "
+				      "away trying to reconnect");
+				mysql_db_close_db_connection(
+					mysql_conn);
+				/* reconnect */
+				check_connection(mysql_conn);
+				reinit = 1;
+				goto try_again;
+			} else
+				rc = SLURM_ERROR;
+		}
+	} else {
+		query = xstrdup_printf("update \"%s_%s\" set nodelist='%s', ",
+				       mysql_conn->cluster_name,
+				       job_table, vals.nodes);
+
+		if (job_ptr->account)
+			xstrfmtcat(query, "account='%s', ", job_ptr->account);
+		if (job_ptr->partition)
+			xstrfmtcat(query, "partition='%s', ",
+				   job_ptr->partition);
+		if (vals.block_id)
+			xstrfmtcat(query, "id_block='%s', ", vals.block_id);
+		if (job_ptr->wckey)
+			xstrfmtcat(query, "wckey='%s', ", job_ptr->wckey);
+		if (vals.node_inx)
+			xstrfmtcat(query, "node_inx='%s', ", vals.node_inx);
+
+		xstrfmtcat(query, "time_start=%ld, job_name='%s', state=%u, "
+			   "cpus_alloc=%u, nodes_alloc=%u, id_qos=%u, "
+			   "id_assoc=%u, id_wckey=%u, id_resv=%u, timelimit=%u "
+			   "where job_db_inx=%d",
+			   vals.start_time, vals.jname, vals.job_state,
+			   job_ptr->total_cpus, vals.node_cnt,
+			   job_ptr->qos_id, job_ptr->assoc_id, vals.wckeyid,
+			   job_ptr->resv_id, job_ptr->time_limit,
+			   job_ptr->db_index);
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		rc = mysql_db_query(mysql_conn, query);
+	}
+
+	_free_job_start_vals(&vals);
+	xfree(query);
+
+	/* now we will reset all the steps */
+	if (IS_JOB_RESIZING(job_ptr)) {
+		if (IS_JOB_SUSPENDED(job_ptr))
+			as_mysql_suspend(mysql_conn, job_db_inx, job_ptr);
+		/* Here we aren't sure how many cpus are being changed here in
+		   the step since we don't have that information from the
+		   job.  The resize of steps shouldn't happen very often in
+		   the first place (srun --no-kill option), and this don't
+		   effect accounting in the first place so it isn't a
+		   big deal. */
+
+		query = xstrdup_printf("update \"%s_%s\" set job_db_inx=%u "
+				       "where job_db_inx=%u;",
+				       mysql_conn->cluster_name, step_table,
+				       job_ptr->db_index, job_db_inx);
+
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+	}
+
+	return rc;
+}
+
+extern int as_mysql_job_start_mult(mysql_conn_t *mysql_conn, List job_list)
+{
+	int rc = SLURM_SUCCESS;
+	struct job_record *job_ptr;
+	job_start_vals_t vals;
+	job_bulk_t bulk;
+	ListIterator itr;
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	debug2("as_mysql_job_start_mult() called for %d jobs",
+	       list_count(job_list));
+
+	memset(&bulk, 0, sizeof(job_bulk_t));
+	bulk.job = xmalloc(sizeof(struct job_record *) *
+			   list_count(job_list));
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		memset(&vals, 0, sizeof(job_start_vals_t));
+		if (!_job_start_bulk(job_ptr, &vals)) {
+			/* keep the order the records came in */
+			if (_job_bulk_fini(mysql_conn, &bulk)
+			    != SLURM_SUCCESS)
+				rc = SLURM_ERROR;
+			if (as_mysql_job_start(mysql_conn, job_ptr)
+			    != SLURM_SUCCESS)
+				rc = SLURM_ERROR;
+			continue;
+		}
+
+		vals.job_state = job_ptr->job_state & JOB_STATE_BASE;
+		_job_start_vals(mysql_conn, job_ptr, &vals);
+		if (!vals.begin_time)
+			vals.begin_time = vals.submit_time;
+		_job_bulk_add(mysql_conn, &bulk, job_ptr, &vals);
+		_free_job_start_vals(&vals);
+	}
+	list_iterator_destroy(itr);
+
+	if (_job_bulk_fini(mysql_conn, &bulk) != SLURM_SUCCESS)
+		rc = SLURM_ERROR;
+	xfree(bulk.job);
+
+	return rc;
+}
+
+extern List as_mysql_modify_job(mysql_conn_t *mysql_conn, uint32_t uid,
+				slurmdb_job_modify_cond_t *job_cond,
+				slurmdb_job_rec_t *job)
+{
+	List ret_list = NULL;
+	int rc = SLURM_SUCCESS;
+	char *object = NULL;
+	char *vals = NULL, *query = NULL, *cond_char = NULL;
+	time_t now = time(NULL);
+	char *user_name = NULL;
+	MYSQL_RES *result = NULL;
+	MYSQL_ROW row;
+
+	if (!job_cond || !job) {
+		error("we need something to change");
+		return NULL;
+	} else if (job_cond->job_id == NO_VAL) {
+		errno = SLURM_NO_CHANGE_IN_DATA;
+		error("Job ID was not specified for job modification\n");
+		return NULL;
+	} else if (!job_cond->cluster) {
+		errno = SLURM_NO_CHANGE_IN_DATA;
+		error("Cluster was not specified for job modification\n");
+		return NULL;
+	} else if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return NULL;
+
+	if (job->derived_ec != NO_VAL)
+		xstrfmtcat(vals, ", derived_ec=%u", job->derived_ec);
+
+	if (job->derived_es)
+		xstrfmtcat(vals, ", derived_es='%s'", job->derived_es);
+
+	if (!vals) {
+		errno = SLURM_NO_CHANGE_IN_DATA;
+		error("No change specified for job modification");
+		return NULL;
+	}
+
+	/* Here we want to get the last job submitted here */
+	query = xstrdup_printf("select job_db_inx, id_job, time_submit "
+			       "from \"%s_%s\" where deleted=0 "
+			       "&& id_job=%u && id_user=%u "
+			       "order by time_submit desc limit 1;",
+			       job_cond->cluster, job_table,
+			       job_cond->job_id, uid);
+
+	debug3("%d(%s:%d) query\n%s",
+	       mysql_conn->conn, THIS_FILE, __LINE__, query);
+	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
+		xfree(vals);
+		xfree(query);
+		return NULL;
+	}
+
+	if ((row = mysql_fetch_row(result))) {
+		char tmp_char[25];
+		time_t time_submit = atol(row[2]);
+		slurm_make_time_str(&time_submit, tmp_char, sizeof(tmp_char));
+
+		xstrfmtcat(cond_char, "job_db_inx=%s", row[0]);
+		object = xstrdup_printf("%s submitted at %s", row[1], tmp_char);
+
+		ret_list = list_create(slurm_destroy_char);
+		list_append(ret_list, object);
+		mysql_free_result(result);
+	} else {
+		errno = SLURM_NO_CHANGE_IN_DATA;
+		debug3("didn't effect anything\n%s", query);
+		xfree(vals);
+		xfree(query);
+		mysql_free_result(result);
+		return NULL;
+	}
+	xfree(query);
+
+	user_name = uid_to_string((uid_t) uid);
+	rc = modify_common(mysql_conn, DBD_MODIFY_JOB, now, user_name,
+			   job_table, cond_char, vals, job_cond->cluster);
+	xfree(user_name);
+	xfree(cond_char);
+	xfree(vals);
+	if (rc == SLURM_ERROR) {
+		error("Couldn't modify job");
+		list_destroy(ret_list);
+		ret_list = NULL;
+	}
+
+	return ret_list;
+}
+
+extern int as_mysql_job_complete(mysql_conn_t *mysql_conn,
+				 struct job_record *job_ptr)
+{
+	char *query = NULL, *nodes = NULL;
+	int rc = SLURM_SUCCESS, job_state;
+	time_t submit_time, end_time;
+
+	if (!job_ptr->db_index
+	    && ((!job_ptr->details || !job_ptr->details->submit_time)
+		&& !job_ptr->resize_time)) {
+		error("as_mysql_job_complete: "
+		      "Not inputing this job, it has no submit time.");
+		return SLURM_ERROR;
+	}
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+	debug2("as_mysql_slurmdb_job_complete() called");
+
+	if (job_ptr->resize_time)
+		submit_time = job_ptr->resize_time;
+	else
+		submit_time = job_ptr->details->submit_time;
+
+	if (IS_JOB_RESIZING(job_ptr)) {
+		end_time = job_ptr->resize_time;
+		job_state = JOB_RESIZING;
+	} else {
+		/* If we get an error with this just fall through to avoid an
+		 * infinite loop */
+		if (job_ptr->end_time == 0) {
+			debug("as_mysql_jobacct: job %u never started",
+			      job_ptr->job_id);
+			return SLURM_SUCCESS;
+		}
+		end_time = job_ptr->end_time;
+		job_state = job_ptr->job_state & JOB_STATE_BASE;
+	}
+
+	slurm_mutex_lock(&rollup_lock);
+	if (end_time < global_last_rollup) {
+		global_last_rollup = job_ptr->end_time;
+		slurm_mutex_unlock(&rollup_lock);
+
+		query = xstrdup_printf("update \"%s_%s\" set "
+				       "hourly_rollup=%ld, "
+				       "daily_rollup=%ld, monthly_rollup=%ld",
+				       mysql_conn->cluster_name,
+				       last_ran_table, end_time,
+				       end_time, end_time);
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+	} else
+		slurm_mutex_unlock(&rollup_lock);
+
+	if (job_ptr->nodes && job_ptr->nodes[0])
+		nodes = job_ptr->nodes;
+	else
+		nodes = "None assigned";
+
+	if (!job_ptr->db_index) {
+		if (!(job_ptr->db_index =
+		      _get_db_index(mysql_conn,
+				    submit_time,
+				    job_ptr->job_id,
+				    job_ptr->assoc_id))) {
+			/* If we get an error with this just fall
+			 * through to avoid an infinite loop
+			 */
+			if (as_mysql_job_start(
+				    mysql_conn, job_ptr) == SLURM_ERROR) {
+				error("couldn't add job %u at job completion",
+				      job_ptr->job_id);
+				return SLURM_SUCCESS;
+			}
+		}
+	}
+
+	query = xstrdup_printf("update \"%s_%s\" set "
+			       "time_end=%ld, state=%d, nodelist='%s', "
+			       "derived_ec=%d, exit_code=%d, "
+			       "kill_requid=%d where job_db_inx=%d;",
+			       mysql_conn->cluster_name, job_table,
+			       end_time, job_state, nodes,
+			       job_ptr->derived_ec, job_ptr->exit_code,
+			       job_ptr->requid, job_ptr->db_index);
+
+	debug3("%d(%s:%d) query\n%s",
+	       mysql_conn->conn, THIS_FILE, __LINE__, query);
+	rc = mysql_db_query(mysql_conn, query);
+	xfree(query);
+
+	return rc;
+}
+
+extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
+			       struct step_record *step_ptr)
+{
+	int rc;
+	char *query = NULL, *values = NULL;
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	if ((rc = _step_start_values(mysql_conn, step_ptr, &values))
+	    != SLURM_SUCCESS || !values)
+		return rc;
+
+	query = _step_insert_query(mysql_conn);
+	xstrcat(query, values);
+	_step_insert_dup(&query);
+	xfree(values);
+	debug3("%d(%s:%d) query\n%s",
+	       mysql_conn->conn, THIS_FILE, __LINE__, query);
+	rc = mysql_db_query(mysql_conn, query);
+	xfree(query);
+
+	return rc;
+}
+
+/* The steps are inserted up to STEP_BULK_MAX at a time and committed
+ * together.  If any of them fails none are kept, so the caller can store
+ * them one at a time to find out which. */
+extern int as_mysql_step_start_mult(mysql_conn_t *mysql_conn, List step_list)
+{
+	struct step_record *step_ptr;
+	step_bulk_t bulk;
+	ListIterator itr;
+	char *values;
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	debug2("as_mysql_step_start_mult() called for %d steps",
+	       list_count(step_list));
+
+	memset(&bulk, 0, sizeof(step_bulk_t));
+	bulk.insert = true;
+	itr = list_iterator_create(step_list);
+	while ((bulk.rc == SLURM_SUCCESS) && (step_ptr = list_next(itr))) {
+		values = NULL;
+		if (_step_start_values(mysql_conn, step_ptr, &values)
+		    != SLURM_SUCCESS)
+			bulk.rc = SLURM_ERROR;
+		else if (values)
+			_step_bulk_add(mysql_conn, &bulk, values);
+		xfree(values);
+	}
+	list_iterator_destroy(itr);
+
+	return _step_bulk_fini(mysql_conn, &bulk);
+}
+
+extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
+				  struct step_record *step_ptr)
+{
+	int rc;
+	char *query = NULL;
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	if ((rc = _step_complete_query(mysql_conn, step_ptr, &query))
+	    != SLURM_SUCCESS || !query)
+		return rc;
+
+	debug3("%d(%s:%d) query\n%s",
+	       mysql_conn->conn, THIS_FILE, __LINE__, query);
+	rc = mysql_db_query(mysql_conn, query);
+	xfree(query);
+
+	return rc;
+}
+
+/* The updates of up to STEP_BULK_MAX steps go to the server as one
+ * query and are committed together, as in as_mysql_step_start_mult() */
+extern int as_mysql_step_complete_mult(mysql_conn_t *mysql_conn,
+				       List step_list)
+{
+	struct step_record *step_ptr;
+	step_bulk_t bulk;
+	ListIterator itr;
+	char *query;
+
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	debug2("as_mysql_step_complete_mult() called for %d steps",
+	       list_count(step_list));
+
+	memset(&bulk, 0, sizeof(step_bulk_t));
+	itr = list_iterator_create(step_list);
+	while ((bulk.rc == SLURM_SUCCESS) && (step_ptr = list_next(itr))) {
+		query = NULL;
+		if (_step_complete_query(mysql_conn, step_ptr, &query)
+		    != SLURM_SUCCESS)
+			bulk.rc = SLURM_ERROR;
+		else if (query)
+			_step_bulk_add(mysql_conn, &bulk, query);
+		xfree(query);
+	}
+	list_iterator_destroy(itr);
+
+	return _step_bulk_fini(mysql_conn, &bulk);
 }
 
 extern int as_mysql_suspend(mysql_conn_t *mysql_conn,
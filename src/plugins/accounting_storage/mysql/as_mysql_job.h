@@ -45,6 +45,8 @@
 extern int as_mysql_job_start(mysql_conn_t *mysql_conn,
 			   struct job_record *job_ptr);
 
+extern int as_mysql_job_start_mult(mysql_conn_t *mysql_conn, List job_list);
+
 extern List as_mysql_modify_job(mysql_conn_t *mysql_conn, uint32_t uid,
 				 slurmdb_job_modify_cond_t *job_cond,
 				 slurmdb_job_rec_t *job);
@@ -58,6 +60,11 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 			       struct step_record *step_ptr);
 
+extern int as_mysql_step_start_mult(mysql_conn_t *mysql_conn, List step_list);
+
+extern int as_mysql_step_complete_mult(mysql_conn_t *mysql_conn,
+				       List step_list);
+
 extern int as_mysql_suspend(mysql_conn_t *mysql_conn, uint32_t old_db_inx,
 			    struct job_record *job_ptr);
 
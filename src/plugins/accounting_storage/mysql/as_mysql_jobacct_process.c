@@ -310,9 +310,12 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			     char *cluster_name,
 			     char *job_fields, char *step_fields,
 			     char *sent_extra,
-			     bool is_admin, int only_pending, List sent_list)
+			     bool is_admin, int only_pending, List sent_list,
+			     int chunk_size,
+			     int (*chunk_func) (List job_list, void *arg),
+			     void *arg)
 {
-	char *query = NULL;
+	char *query = NULL, *job_query = NULL;
 	char *extra = xstrdup(sent_extra);
 	uint16_t private_data = slurm_get_private_data();
 	slurmdb_selected_step_t *selected_step = NULL;
@@ -329,6 +332,7 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	int rc = SLURM_SUCCESS;
 	int last_id = -1, curr_id = -1, last_state = -1;
 	local_cluster_t *curr_cluster = NULL;
+	mysql_conn_t *job_conn = mysql_conn;
 
 	/* This is here to make sure we are looking at only this user
 	 * if this flag is set.  We also include any accounts they may be
@@ -382,37 +386,22 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		if (set)
 			xstrcat(extra,")");
 		mysql_free_result(result);
+		result = NULL;
 	}
 
 	setup_job_cluster_cond_limits(mysql_conn, job_cond,
 				      cluster_name, &extra);
 
-	query = xstrdup_printf("select %s from \"%s_%s\" as t1 "
-			       "left join \"%s_%s\" as t2 "
-			       "on t1.id_assoc=t2.id_assoc",
-			       job_fields, cluster_name, job_table,
-			       cluster_name, assoc_table);
+	job_query = xstrdup_printf("select %s from \"%s_%s\" as t1 "
+				   "left join \"%s_%s\" as t2 "
+				   "on t1.id_assoc=t2.id_assoc",
+				   job_fields, cluster_name, job_table,
+				   cluster_name, assoc_table);
 	if (extra) {
-		xstrcat(query, extra);
+		xstrcat(job_query, extra);
 		xfree(extra);
 	}
 
-	/* Here we want to order them this way in such a way so it is
-	   easy to look for duplicates, it is also easy to sort the
-	   resized jobs.
-	*/
-	xstrcat(query, " group by id_job, time_submit desc");
-
-	debug3("%d(%s:%d) query\n%s",
-	       mysql_conn->conn, THIS_FILE, __LINE__, query);
-	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
-		xfree(query);
-		rc = SLURM_ERROR;
-		goto end_it;
-	}
-	xfree(query);
-
-
 	/* Here we set up environment to check used nodes of jobs.
 	   Since we store the bitmap of the entire cluster we can use
 	   that to set up a hostlist and set up the bitmap to make
@@ -428,6 +417,33 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		}
 	}
 
+	/* Here we want to order them this way in such a way so it is
+	   easy to look for duplicates, it is also easy to sort the
+	   resized jobs.
+	*/
+	xstrcat(job_query, " group by id_job, time_submit desc");
+
+	debug3("%d(%s:%d) query\n%s",
+	       mysql_conn->conn, THIS_FILE, __LINE__, job_query);
+	if (chunk_func) {
+		/* When handing the jobs out in chunks read the rows
+		   unbuffered on a connection of their own, so we only
+		   ever hold about chunk_size jobs no matter how many
+		   match, while the steps of each job are still looked
+		   up on the normal connection.
+		*/
+		job_conn = create_mysql_conn(mysql_conn->conn, 0,
+					     cluster_name);
+		if ((rc = check_connection(job_conn)) != SLURM_SUCCESS)
+			goto end_it;
+		result = mysql_db_query_use(job_conn, job_query);
+	} else
+		result = mysql_db_query_ret(mysql_conn, job_query, 0);
+	if (!result) {
+		rc = SLURM_ERROR;
+		goto end_it;
+	}
+
 	while ((row = mysql_fetch_row(result))) {
 		char *id = row[JOB_REQ_ID];
 		bool job_ended = 0;
@@ -435,6 +451,16 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 
 		curr_id = slurm_atoul(row[JOB_REQ_JOBID]);
 
+		/* Only hand out a chunk between jobs so all the
+		   records of a job go out together. */
+		if (chunk_func && (curr_id != last_id)
+		    && (list_count(job_list) >= chunk_size)) {
+			if ((rc = (*chunk_func)(job_list, arg))
+			    != SLURM_SUCCESS)
+				goto end_it;
+			list_flush(job_list);
+		}
+
 		if (job_cond && !job_cond->duplicates
 		    && (curr_id == last_id)
 		    && (slurm_atoul(row[JOB_REQ_STATE]) != JOB_RESIZING))
@@ -538,9 +564,9 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 				if (!(result2 = mysql_db_query_ret(
 					      mysql_conn,
 					      query, 0))) {
-					list_destroy(job_list);
-					job_list = NULL;
-					break;
+					xfree(query);
+					rc = SLURM_ERROR;
+					goto end_it;
 				}
 				xfree(query);
 				while ((row2 = mysql_fetch_row(result2))) {
@@ -806,13 +832,30 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 		/* need to reset here to make the above test valid */
 		step = NULL;
 	}
-	mysql_free_result(result);
+	if (chunk_func && list_count(job_list)) {
+		rc = (*chunk_func)(job_list, arg);
+		list_flush(job_list);
+	}
 
 end_it:
+	/* Freeing an unbuffered result reads off the rows left, so if
+	   we stopped early (e.g. the client went away) have the server
+	   drop the connection instead of sending us the rest. */
+	if (result && (job_conn != mysql_conn) && !mysql_eof(result)) {
+		query = xstrdup_printf("kill %lu",
+				       mysql_thread_id(job_conn->db_conn));
+		mysql_db_query(mysql_conn, query);
+		xfree(query);
+	}
+	if (result)
+		mysql_free_result(result);
+	if (job_conn != mysql_conn)
+		destroy_mysql_conn(job_conn);
+	xfree(job_query);
 	if (local_cluster_list)
 		list_destroy(local_cluster_list);
 
-	if (rc == SLURM_SUCCESS)
+	if ((rc == SLURM_SUCCESS) && sent_list)
 		list_transfer(sent_list, job_list);
 
 	list_destroy(job_list);
@@ -1277,16 +1320,20 @@ extern int setup_job_cond_limits(mysql_conn_t *mysql_conn,
 	return set;
 }
 
-extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
-					      uid_t uid,
-					      slurmdb_job_cond_t *job_cond)
+/* Fill in job_list, or if chunk_func is set hand the jobs to it
+ * chunk_size at a time instead. */
+static int _get_jobs(mysql_conn_t *mysql_conn, uid_t uid,
+		     slurmdb_job_cond_t *job_cond, List job_list,
+		     int chunk_size,
+		     int (*chunk_func) (List job_list, void *arg),
+		     void *arg)
 {
 	char *extra = NULL;
 	char *tmp = NULL, *tmp2 = NULL;
 	ListIterator itr = NULL;
 	int is_admin=1;
 	int i;
-	List job_list = NULL;
+	int rc = SLURM_SUCCESS;
 	uint16_t private_data = 0;
 	slurmdb_user_rec_t user;
 	int only_pending = 0;
@@ -1330,28 +1377,67 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	if (job_cond
 	    && job_cond->cluster_list && list_count(job_cond->cluster_list))
 		use_cluster_list = job_cond->cluster_list;
-	else
+	else if (chunk_func) {
+		/* The chunks are sent out as we go, which could take
+		   a while, so don't hold the lock that long. */
+		use_cluster_list = list_create(slurm_destroy_char);
+		slurm_mutex_lock(&as_mysql_cluster_list_lock);
+		itr = list_iterator_create(as_mysql_cluster_list);
+		while ((cluster_name = list_next(itr)))
+			list_append(use_cluster_list, xstrdup(cluster_name));
+		list_iterator_destroy(itr);
+		slurm_mutex_unlock(&as_mysql_cluster_list_lock);
+	} else
 		slurm_mutex_lock(&as_mysql_cluster_list_lock);
 
-	job_list = list_create(slurmdb_destroy_job_rec);
 	itr = list_iterator_create(use_cluster_list);
 	while ((cluster_name = list_next(itr))) {
-		int rc;
 		if ((rc = _cluster_get_jobs(mysql_conn, &user, job_cond,
 					    cluster_name, tmp, tmp2, extra,
-					    is_admin, only_pending, job_list))
-		    != SLURM_SUCCESS)
+					    is_admin, only_pending, job_list,
+					    chunk_size, chunk_func, arg))
+		    != SLURM_SUCCESS) {
 			error("Problem getting jobs for cluster %s",
 			      cluster_name);
+			/* Jobs already handed out can't be taken
+			   back so don't go on as if nothing happened. */
+			if (chunk_func)
+				break;
+		}
 	}
 	list_iterator_destroy(itr);
 
 	if (use_cluster_list == as_mysql_cluster_list)
 		slurm_mutex_unlock(&as_mysql_cluster_list_lock);
+	else if (!job_cond || (use_cluster_list != job_cond->cluster_list))
+		list_destroy(use_cluster_list);
 
 	xfree(tmp);
 	xfree(tmp2);
 	xfree(extra);
 
+	return rc;
+}
+
+extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
+					      uid_t uid,
+					      slurmdb_job_cond_t *job_cond)
+{
+	List job_list = list_create(slurmdb_destroy_job_rec);
+
+	_get_jobs(mysql_conn, uid, job_cond, job_list, 0, NULL, NULL);
+
 	return job_list;
 }
+
+extern int as_mysql_jobacct_process_get_jobs_chunks(
+	mysql_conn_t *mysql_conn, uid_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg)
+{
+	if (chunk_size <= 0)
+		chunk_size = 1;
+
+	return _get_jobs(mysql_conn, uid, job_cond, NULL,
+			 chunk_size, chunk_func, arg);
+}
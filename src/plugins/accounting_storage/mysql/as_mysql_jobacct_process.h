@@ -61,5 +61,9 @@ extern int setup_job_cond_limits(mysql_conn_t *mysql_conn,
 
 extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn, uid_t uid,
 					   slurmdb_job_cond_t *job_cond);
+extern int as_mysql_jobacct_process_get_jobs_chunks(
+	mysql_conn_t *mysql_conn, uid_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg);
 
 #endif
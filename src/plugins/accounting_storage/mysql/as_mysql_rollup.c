@@ -70,6 +70,32 @@ typedef struct {
 	time_t end;
 } local_resv_usage_t;
 
+typedef struct {
+	int db_inx;
+	time_t start;
+	time_t end;
+} local_suspend_t;
+
+/* Hours of one cluster rolled up by a thread of their own */
+typedef struct {
+	char *cluster_name;
+	int conn;
+	time_t end;
+	int rc;
+	time_t start;
+	pthread_t thread_id;
+} local_hour_rollup_t;
+
+/* Most threads rolling up hours at once, for all clusters together */
+#define ROLLUP_THREAD_COUNT	8
+/* Fewest hours given to a rollup thread.  Anything shorter, like the
+ * usual single hour, is rolled up by the caller itself. */
+#define ROLLUP_THREAD_HOURS	24
+
+static pthread_mutex_t rollup_thread_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  rollup_thread_cond = PTHREAD_COND_INITIALIZER;
+static int rollup_thread_cnt = 0;
+
 static void _destroy_local_id_usage(void *object)
 {
 	local_id_usage_t *a_usage = (local_id_usage_t *)object;
@@ -146,10 +172,31 @@ static int _process_purge(mysql_conn_t *mysql_conn,
 	return rc;
 }
 
-extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
-				  char *cluster_name,
-				  time_t start, time_t end,
-				  uint16_t archive_data)
+/* Return the index of the first suspend record of job db_inx in a list
+ * sorted by job_db_inx, or -1 if the job has none */
+static int _find_suspend(local_suspend_t *suspend, int suspend_cnt,
+			 int db_inx)
+{
+	int lo = 0, hi = suspend_cnt;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (suspend[mid].db_inx < db_inx)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if ((lo < suspend_cnt) && (suspend[lo].db_inx == db_inx))
+		return lo;
+	return -1;
+}
+
+/* Roll up the hours from start to end of a cluster.  Each hour only
+ * depends on the event, reservation, job and suspend records of that
+ * hour, so the range can be split up between threads. */
+static int _hourly_rollup(mysql_conn_t *mysql_conn,
+			  char *cluster_name,
+			  time_t start, time_t end)
 {
 	int rc = SLURM_SUCCESS;
 	int add_sec = 3600;
@@ -216,11 +263,15 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	};
 
 	char *suspend_req_inx[] = {
+		"job_db_inx",
 		"time_start",
 		"time_end"
 	};
 	char *suspend_str = NULL;
+	local_suspend_t *suspend = NULL;
+	int suspend_cnt = 0;
 	enum {
+		SUSPEND_REQ_DB_INX,
 		SUSPEND_REQ_START,
 		SUSPEND_REQ_END,
 		SUSPEND_REQ_COUNT
@@ -483,6 +534,41 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		}
 		mysql_free_result(result);
 
+		/* get the suspended time of all the jobs in this hour
+		 * at once instead of asking for each job */
+		query = xstrdup_printf("select %s from \"%s_%s\" where "
+				       "(time_start < %ld && (time_end >= %ld "
+				       "|| time_end = 0)) "
+				       "order by job_db_inx, time_start",
+				       suspend_str, cluster_name, suspend_table,
+				       curr_end, curr_start);
+
+		debug3("%d(%s:%d) query\n%s",
+		       mysql_conn->conn, THIS_FILE, __LINE__, query);
+		if (!(result = mysql_db_query_ret(
+			     mysql_conn, query, 0))) {
+			xfree(query);
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+		xfree(query);
+
+		suspend_cnt = 0;
+		if (mysql_num_rows(result)) {
+			xrealloc(suspend, sizeof(local_suspend_t) *
+				 mysql_num_rows(result));
+		}
+		while ((row = mysql_fetch_row(result))) {
+			suspend[suspend_cnt].db_inx =
+				slurm_atoul(row[SUSPEND_REQ_DB_INX]);
+			suspend[suspend_cnt].start =
+				slurm_atoul(row[SUSPEND_REQ_START]);
+			suspend[suspend_cnt].end =
+				slurm_atoul(row[SUSPEND_REQ_END]);
+			suspend_cnt++;
+		}
+		mysql_free_result(result);
+
 		/* now get the jobs during this time only  */
 		query = xstrdup_printf("select %s from \"%s_%s\" where "
 				       "(time_eligible < %ld && "
@@ -526,35 +612,16 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 			seconds = (row_end - row_start);
 
-			if (row[JOB_REQ_SUSPENDED]) {
-				MYSQL_RES *result2 = NULL;
-				MYSQL_ROW row2;
-				/* get the suspended time for this job */
-				query = xstrdup_printf(
-					"select %s from \"%s_%s\" where "
-					"(time_start < %ld && (time_end >= %ld "
-					"|| time_end = 0)) && job_db_inx=%s "
-					"order by time_start",
-					suspend_str, cluster_name,
-					suspend_table,
-					curr_end, curr_start,
-					row[JOB_REQ_DB_INX]);
-
-				debug4("%d(%s:%d) query\n%s",
-				       mysql_conn->conn, THIS_FILE,
-				       __LINE__, query);
-				if (!(result2 = mysql_db_query_ret(
-					     mysql_conn,
-					     query, 0))) {
-					xfree(query);
-					return SLURM_ERROR;
-				}
-				xfree(query);
-				while ((row2 = mysql_fetch_row(result2))) {
-					time_t local_start = slurm_atoul(
-						row2[SUSPEND_REQ_START]);
-					time_t local_end = slurm_atoul(
-						row2[SUSPEND_REQ_END]);
+			if (row[JOB_REQ_SUSPENDED] && suspend_cnt) {
+				int db_inx = slurm_atoul(row[JOB_REQ_DB_INX]);
+				int s = _find_suspend(suspend, suspend_cnt,
+						      db_inx);
+				/* take off the suspended time for this job */
+				for ( ; (s >= 0) && (s < suspend_cnt) &&
+					      (suspend[s].db_inx == db_inx);
+				      s++) {
+					time_t local_start = suspend[s].start;
+					time_t local_end = suspend[s].end;
 
 					if (!local_start)
 						continue;
@@ -569,7 +636,6 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 					seconds -= (local_end - local_start);
 				}
-				mysql_free_result(result2);
 			}
 			if (seconds < 1) {
 				debug4("This job (%u) was suspended "
@@ -1014,6 +1080,7 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		curr_end = curr_start + add_sec;
 	}
 end_it:
+	xfree(suspend);
 	xfree(suspend_str);
 	xfree(event_str);
 	xfree(job_str);
@@ -1031,6 +1098,118 @@ end_it:
 /* 	info("stop start %s", ctime(&curr_start)); */
 /* 	info("stop end %s", ctime(&curr_end)); */
 
+	return rc;
+}
+
+/* Roll up a range of hours on a connection of its own and commit it.
+ * Since the hour tables are written with "on duplicate key update" an
+ * hour committed here is just rolled up again if the cluster's rollup
+ * fails afterwards. */
+static void *_hourly_rollup_thread(void *arg)
+{
+	local_hour_rollup_t *hour_rollup = (local_hour_rollup_t *)arg;
+	mysql_conn_t *mysql_conn = create_mysql_conn(
+		hour_rollup->conn, 1, hour_rollup->cluster_name);
+
+	hour_rollup->rc = check_connection(mysql_conn);
+	if (hour_rollup->rc == SLURM_SUCCESS)
+		hour_rollup->rc = _hourly_rollup(mysql_conn,
+						 hour_rollup->cluster_name,
+						 hour_rollup->start,
+						 hour_rollup->end);
+
+	if (hour_rollup->rc == SLURM_SUCCESS) {
+		if (mysql_db_commit(mysql_conn)) {
+			error("Couldn't commit hourly rollup of cluster %s",
+			      hour_rollup->cluster_name);
+			hour_rollup->rc = SLURM_ERROR;
+		}
+	} else if (mysql_conn->db_conn && mysql_db_rollback(mysql_conn))
+		error("rollback failed");
+	destroy_mysql_conn(mysql_conn);
+
+	slurm_mutex_lock(&rollup_thread_lock);
+	rollup_thread_cnt--;
+	pthread_cond_broadcast(&rollup_thread_cond);
+	slurm_mutex_unlock(&rollup_thread_lock);
+
+	return NULL;
+}
+
+/* Split the hours from start to end between threads.  The threads of
+ * all clusters together are limited to ROLLUP_THREAD_COUNT so catching
+ * up after an outage doesn't take every connection to the database. */
+static int _hourly_rollup_threads(mysql_conn_t *mysql_conn,
+				  char *cluster_name,
+				  time_t start, time_t end, int hours)
+{
+	int rc = SLURM_SUCCESS;
+	int i, thread_cnt, thread_hours;
+	local_hour_rollup_t *hour_rollup;
+	pthread_attr_t thread_attr;
+
+	thread_hours = hours / ROLLUP_THREAD_COUNT;
+	if (thread_hours < ROLLUP_THREAD_HOURS)
+		thread_hours = ROLLUP_THREAD_HOURS;
+	thread_cnt = (hours + thread_hours - 1) / thread_hours;
+
+	debug("Rolling up %d hours of cluster %s with %d threads",
+	      hours, cluster_name, thread_cnt);
+
+	hour_rollup = xmalloc(sizeof(local_hour_rollup_t) * thread_cnt);
+	slurm_attr_init(&thread_attr);
+	for (i=0; i<thread_cnt; i++) {
+		hour_rollup[i].cluster_name = cluster_name;
+		hour_rollup[i].conn = mysql_conn->conn;
+		hour_rollup[i].start = start + (i * thread_hours * 3600);
+		hour_rollup[i].end = hour_rollup[i].start +
+			(thread_hours * 3600);
+		if (hour_rollup[i].end > end)
+			hour_rollup[i].end = end;
+
+		slurm_mutex_lock(&rollup_thread_lock);
+		while (rollup_thread_cnt >= ROLLUP_THREAD_COUNT)
+			pthread_cond_wait(&rollup_thread_cond,
+					  &rollup_thread_lock);
+		rollup_thread_cnt++;
+		slurm_mutex_unlock(&rollup_thread_lock);
+
+		if (pthread_create(&hour_rollup[i].thread_id, &thread_attr,
+				   _hourly_rollup_thread,
+				   (void *) &hour_rollup[i])) {
+			error("pthread_create error %m");
+			/* just do it ourselves then */
+			hour_rollup[i].thread_id = (pthread_t) 0;
+			_hourly_rollup_thread((void *) &hour_rollup[i]);
+		}
+	}
+	slurm_attr_destroy(&thread_attr);
+
+	for (i=0; i<thread_cnt; i++) {
+		if (hour_rollup[i].thread_id)
+			pthread_join(hour_rollup[i].thread_id, NULL);
+		if (hour_rollup[i].rc != SLURM_SUCCESS)
+			rc = hour_rollup[i].rc;
+	}
+	xfree(hour_rollup);
+
+	return rc;
+}
+
+extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
+				  char *cluster_name,
+				  time_t start, time_t end,
+				  uint16_t archive_data)
+{
+	int rc;
+	int hours = (end - start + 3599) / 3600;
+
+	if (hours > ROLLUP_THREAD_HOURS)
+		rc = _hourly_rollup_threads(mysql_conn, cluster_name,
+					    start, end, hours);
+	else
+		rc = _hourly_rollup(mysql_conn, cluster_name, start, end);
+
 	/* go check to see if we archive and purge */
 
 	if (rc == SLURM_SUCCESS)
@@ -1039,6 +1218,7 @@ end_it:
 
 	return rc;
 }
+
 extern int as_mysql_daily_rollup(mysql_conn_t *mysql_conn,
 				 char *cluster_name,
 				 time_t start, time_t end,
@@ -399,6 +399,7 @@ end_it:
 		(*local_rollup->rc) = rc;
 	pthread_cond_signal(local_rollup->rolledup_cond);
 	slurm_mutex_unlock(local_rollup->rolledup_lock);
+	xfree(local_rollup->cluster_name);
 	xfree(local_rollup);
 
 	return NULL;
@@ -915,6 +916,8 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 {
 	int rc = SLURM_SUCCESS;
 	int rolledup = 0;
+	int cluster_cnt = 0;
+	int cancel_state;
 	char *cluster_name = NULL;
 	ListIterator itr;
 	pthread_mutex_t rolledup_lock = PTHREAD_MUTEX_INITIALIZER;
@@ -926,6 +929,10 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 
 	slurm_mutex_lock(&usage_rollup_lock);
 
+	/* The cluster threads use the rolledup variables on our
+	 * stack, so we can't be cancelled until they are all done. */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel_state);
+
 	slurm_mutex_init(&rolledup_lock);
 	pthread_cond_init(&rolledup_cond, NULL);
 
@@ -933,12 +940,12 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 	slurm_mutex_lock(&as_mysql_cluster_list_lock);
 	itr = list_iterator_create(as_mysql_cluster_list);
 	while ((cluster_name = list_next(itr))) {
-		/* pthread_t rollup_tid; */
-		/* pthread_attr_t rollup_attr; */
+		pthread_t rollup_tid;
+		pthread_attr_t rollup_attr;
 		local_rollup_t *local_rollup = xmalloc(sizeof(local_rollup_t));
 
 		local_rollup->archive_data = archive_data;
-		local_rollup->cluster_name = cluster_name;
+		local_rollup->cluster_name = xstrdup(cluster_name);
 
 		local_rollup->mysql_conn = mysql_conn;
 		local_rollup->rc = &rc;
@@ -949,27 +956,29 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 		local_rollup->sent_end = sent_end;
 		local_rollup->sent_start = sent_start;
 
-		/* _cluster_rollup_usage is responsible for freeing
+		/* Each cluster is rolled up in a thread of its own so
+		   one cluster catching up on a long time period
+		   doesn't hold up the others.
+		   _cluster_rollup_usage is responsible for freeing
 		   this local_rollup */
-		_cluster_rollup_usage(local_rollup);
-		/* It turns out doing this with threads only buys a
-		   very small victory, and can skew the timings.  So
-		   just doing them one after the other isn't too bad.
-		   If you really want to do this in threads you can
-		   just uncomment this, and comment the call above.
-		*/
-		/* slurm_attr_init(&rollup_attr); */
-		/* if (pthread_create(&rollup_tid, &rollup_attr, */
-		/* 		   _cluster_rollup_usage, */
-		/* 		   (void *)local_rollup)) */
-		/* 	fatal("pthread_create: %m"); */
-		/* slurm_attr_destroy(&rollup_attr); */
+		slurm_attr_init(&rollup_attr);
+		if (pthread_attr_setdetachstate(&rollup_attr,
+						PTHREAD_CREATE_DETACHED))
+			error("pthread_attr_setdetachstate error %m");
+		if (pthread_create(&rollup_tid, &rollup_attr,
+				   _cluster_rollup_usage,
+				   (void *)local_rollup)) {
+			error("pthread_create error %m");
+			_cluster_rollup_usage(local_rollup);
+		}
+		slurm_attr_destroy(&rollup_attr);
+		cluster_cnt++;
 	}
 	slurm_mutex_lock(&rolledup_lock);
 	list_iterator_destroy(itr);
 	slurm_mutex_unlock(&as_mysql_cluster_list_lock);
 
-	while (rolledup < list_count(as_mysql_cluster_list)) {
+	while (rolledup < cluster_cnt) {
 		pthread_cond_wait(&rolledup_cond, &rolledup_lock);
 		debug2("Got %d rolled up", rolledup);
 	}
@@ -981,6 +990,7 @@ extern int as_mysql_roll_usage(mysql_conn_t *mysql_conn,
 	/* info("total time was %s", TIME_STR); */
 
 	slurm_mutex_unlock(&usage_rollup_lock);
+	pthread_setcancelstate(cancel_state, NULL);
 
 	return rc;
 }
@@ -376,6 +376,14 @@ extern int jobacct_storage_p_job_start(void *db_conn,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * load into the storage the start of several jobs at once
+ */
+extern int jobacct_storage_p_job_start_mult(void *db_conn, List job_list)
+{
+	return SLURM_SUCCESS;
+}
+
 /*
  * load into the storage the end of a job
  */
@@ -403,6 +411,23 @@ extern int jobacct_storage_p_step_complete(void *db_conn,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * load into the storage the start of several job steps at once
+ */
+extern int jobacct_storage_p_step_start_mult(void *db_conn, List step_list)
+{
+	return SLURM_SUCCESS;
+}
+
+/*
+ * load into the storage the end of several job steps at once
+ */
+extern int jobacct_storage_p_step_complete_mult(void *db_conn,
+						List step_list)
+{
+	return SLURM_SUCCESS;
+}
+
 /*
  * load into the storage a suspention of a job
  */
@@ -423,6 +448,16 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return NULL;
 }
 
+/*
+ * get info from the storage a chunk of jobs at a time
+ */
+extern int jobacct_storage_p_get_jobs_cond_chunks(
+	void *db_conn, uid_t uid, void *job_cond, int chunk_size,
+	int (*chunk_func) (List job_list, void *arg), void *arg)
+{
+	return SLURM_SUCCESS;
+}
+
 /*
  * expire old info from the storage
  */
@@ -623,6 +623,26 @@ extern int jobacct_storage_p_job_start(pgsql_conn_t *pg_conn,
 	return js_pg_job_start(pg_conn, job_ptr);
 }
 
+/*
+ * load into the storage the start of several jobs at once
+ */
+extern int jobacct_storage_p_job_start_mult(pgsql_conn_t *pg_conn, List job_list)
+{
+	struct job_record *job_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		if (jobacct_storage_p_job_start(pg_conn, job_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
 /*
  * load into the storage the end of a job
  */
@@ -665,6 +685,48 @@ extern int jobacct_storage_p_step_complete(pgsql_conn_t *pg_conn,
 	return js_pg_step_complete(pg_conn, step_ptr);
 }
 
+/*
+ * load into the storage the start of several job steps at once
+ */
+extern int jobacct_storage_p_step_start_mult(pgsql_conn_t *pg_conn,
+					     List step_list)
+{
+	struct step_record *step_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(step_list);
+	while ((step_ptr = list_next(itr))) {
+		if (jobacct_storage_p_step_start(pg_conn, step_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
+/*
+ * load into the storage the end of several job steps at once
+ */
+extern int jobacct_storage_p_step_complete_mult(pgsql_conn_t *pg_conn,
+						List step_list)
+{
+	struct step_record *step_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(step_list);
+	while ((step_ptr = list_next(itr))) {
+		if (jobacct_storage_p_step_complete(pg_conn, step_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
 /*
  * load into the storage a suspention of a job
  */
@@ -690,6 +752,26 @@ extern List jobacct_storage_p_get_jobs_cond(pgsql_conn_t *pg_conn, uid_t uid,
 	return js_pg_get_jobs_cond(pg_conn, uid, job_cond);
 }
 
+/*
+ * get info from the storage a chunk of jobs at a time
+ * The jobs are all gotten at once here, so this is just one chunk.
+ */
+extern int jobacct_storage_p_get_jobs_cond_chunks(
+	pgsql_conn_t *pg_conn, uid_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg)
+{
+	int rc;
+	List job_list = js_pg_get_jobs_cond(pg_conn, uid, job_cond);
+
+	if (!job_list)
+		return SLURM_ERROR;
+	rc = (*chunk_func)(job_list, arg);
+	list_destroy(job_list);
+
+	return rc;
+}
+
 /*
  * expire old info from the storage
  */
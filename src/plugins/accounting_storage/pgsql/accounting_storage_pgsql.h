@@ -161,16 +161,26 @@ extern int clusteracct_storage_p_get_usage(
 
 extern int jobacct_storage_p_job_start(pgsql_conn_t *pg_conn,
 				       struct job_record *job_ptr);
+extern int jobacct_storage_p_job_start_mult(pgsql_conn_t *pg_conn,
+					    List job_list);
 extern int jobacct_storage_p_job_complete(pgsql_conn_t *pg_conn,
 					  struct job_record *job_ptr);
 extern int jobacct_storage_p_step_start(pgsql_conn_t *pg_conn,
 					struct step_record *step_ptr);
 extern int jobacct_storage_p_step_complete(pgsql_conn_t *pg_conn,
 					   struct step_record *step_ptr);
+extern int jobacct_storage_p_step_start_mult(pgsql_conn_t *pg_conn,
+					     List step_list);
+extern int jobacct_storage_p_step_complete_mult(pgsql_conn_t *pg_conn,
+						List step_list);
 extern int jobacct_storage_p_suspend(pgsql_conn_t *pg_conn,
 				     struct job_record *job_ptr);
 extern List jobacct_storage_p_get_jobs_cond(pgsql_conn_t *pg_conn, uid_t uid,
 					    slurmdb_job_cond_t *job_cond);
+extern int jobacct_storage_p_get_jobs_cond_chunks(
+	pgsql_conn_t *pg_conn, uid_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg);
 
 extern int jobacct_storage_p_archive(pgsql_conn_t *pg_conn,
 				     slurmdb_archive_cond_t *arch_cond);
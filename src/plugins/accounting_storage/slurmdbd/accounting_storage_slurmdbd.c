@@ -110,6 +110,13 @@ static pthread_t cleanup_handler_thread;
 static pthread_mutex_t db_inx_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool running_db_inx = 0;
 
+/* State for jobacct_storage_p_get_jobs_cond_chunks() */
+typedef struct {
+	int (*chunk_func) (List job_list, void *arg);
+	void *arg;
+	bool old_dbd;		/* slurmdbd doesn't know DBD_GET_JOBS_CHUNKS */
+} jobs_chunks_t;
+
 extern int jobacct_storage_p_job_start(void *db_conn,
 				       struct job_record *job_ptr);
 
@@ -2010,6 +2017,26 @@ extern int jobacct_storage_p_job_start(void *db_conn,
 	return rc;
 }
 
+/*
+ * load into the storage the start of several jobs at once
+ */
+extern int jobacct_storage_p_job_start_mult(void *db_conn, List job_list)
+{
+	struct job_record *job_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		if (jobacct_storage_p_job_start(db_conn, job_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
 /*
  * load into the storage the end of a job
  */
@@ -2229,6 +2256,47 @@ extern int jobacct_storage_p_step_complete(void *db_conn,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * load into the storage the start of several job steps at once
+ */
+extern int jobacct_storage_p_step_start_mult(void *db_conn, List step_list)
+{
+	struct step_record *step_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(step_list);
+	while ((step_ptr = list_next(itr))) {
+		if (jobacct_storage_p_step_start(db_conn, step_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
+/*
+ * load into the storage the end of several job steps at once
+ */
+extern int jobacct_storage_p_step_complete_mult(void *db_conn,
+						List step_list)
+{
+	struct step_record *step_ptr;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(step_list);
+	while ((step_ptr = list_next(itr))) {
+		if (jobacct_storage_p_step_complete(db_conn, step_ptr)
+		    != SLURM_SUCCESS)
+			rc = SLURM_ERROR;
+	}
+	list_iterator_destroy(itr);
+
+	return rc;
+}
+
 /*
  * load into the storage a suspention of a job
  */
@@ -2307,6 +2375,82 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return my_job_list;
 }
 
+static int _got_jobs_chunk(slurmdbd_msg_t *resp, void *arg)
+{
+	jobs_chunks_t *chunks = (jobs_chunks_t *) arg;
+	dbd_list_msg_t *got_msg;
+	int rc = SLURM_SUCCESS;
+
+	if (resp->msg_type == DBD_RC) {
+		dbd_rc_msg_t *msg = resp->data;
+		rc = msg->return_code;
+		/* A slurmdbd that doesn't know the RPC doesn't say
+		 * which one it got */
+		if ((rc == EINVAL) && (msg->sent_type != DBD_GET_JOBS_CHUNKS))
+			chunks->old_dbd = 1;
+		else if (rc != SLURM_SUCCESS) {
+			slurm_seterrno(rc);
+			error("%s", msg->comment);
+		}
+		slurmdbd_free_rc_msg(msg);
+	} else if (resp->msg_type != DBD_GOT_JOBS_CHUNK) {
+		error("slurmdbd: response type not DBD_GOT_JOBS_CHUNK: %u",
+		      resp->msg_type);
+		rc = SLURM_ERROR;
+	} else {
+		got_msg = (dbd_list_msg_t *) resp->data;
+		rc = (*(chunks->chunk_func))(got_msg->my_list, chunks->arg);
+		slurmdbd_free_list_msg(got_msg);
+	}
+
+	return rc;
+}
+
+/*
+ * get info from the storage a chunk of jobs at a time
+ * The chunk size is up to the slurmdbd.
+ */
+extern int jobacct_storage_p_get_jobs_cond_chunks(
+	void *db_conn, uid_t uid, slurmdb_job_cond_t *job_cond,
+	int chunk_size, int (*chunk_func) (List job_list, void *arg),
+	void *arg)
+{
+	slurmdbd_msg_t req;
+	dbd_cond_msg_t get_msg;
+	jobs_chunks_t chunks;
+	List job_list;
+	int rc;
+
+	memset(&get_msg, 0, sizeof(dbd_cond_msg_t));
+	memset(&chunks, 0, sizeof(jobs_chunks_t));
+
+	get_msg.cond = job_cond;
+	chunks.chunk_func = chunk_func;
+	chunks.arg = arg;
+
+	req.msg_type = DBD_GET_JOBS_CHUNKS;
+	req.data = &get_msg;
+	rc = slurm_send_recv_slurmdbd_msgs(SLURMDBD_VERSION, &req,
+					   DBD_GOT_JOBS_CHUNK,
+					   _got_jobs_chunk, &chunks);
+	if (!chunks.old_dbd) {
+		if (rc != SLURM_SUCCESS)
+			error("slurmdbd: DBD_GET_JOBS_CHUNKS failure: %m");
+		return rc;
+	}
+
+	/* Nothing was sent yet so get them all in one chunk */
+	debug("slurmdbd: DBD_GET_JOBS_CHUNKS not supported, "
+	      "using DBD_GET_JOBS_COND");
+	if (!(job_list = jobacct_storage_p_get_jobs_cond(
+		      db_conn, uid, job_cond)))
+		return SLURM_ERROR;
+	rc = (*chunk_func)(job_list, arg);
+	list_destroy(job_list);
+
+	return rc;
+}
+
 /*
  * Expire old info from the storage
  * Not applicable for any database
@@ -65,6 +65,9 @@
 
 #define SECS_PER_DAY	(24 * 60 * 60)
 #define SECS_PER_WEEK	(7 * SECS_PER_DAY)
+/* Running jobs to add usage for each time the association and QOS
+ * write locks are taken */
+#define USAGE_LOCK_BATCH	64
 /* These are defined here so when we link with something other than
  * the slurmctld we will have these symbols defined.  They will get
  * overwritten when linking with the slurmctld.
@@ -359,12 +362,12 @@ static int _write_last_decay_ran(time_t last_ran, time_t last_reset)
 
 /* This should initially get the childern list from
  * assoc_mgr_root_assoc.  Since our algorythm goes from top down we
- * calculate all the non-user associations now.  When a user submits a
- * job, that norm_fairshare is calculated.  Here we will set the
- * usage_efctv to NO_VAL for users to not have to calculate a bunch
- * of things that will never be used.
+ * calculate all the associations now, users included, so the fairshare
+ * factor of each pending job only needs its association's usage_efctv
+ * and no association is modified while jobs are prioritized.
  *
- * NOTE: acct_mgr_association_lock must be locked before this is called.
+ * NOTE: acct_mgr_association_lock must be write locked before this is
+ * called.
  */
 static int _set_children_usage_efctv(List childern_list)
 {
@@ -376,11 +379,9 @@ static int _set_children_usage_efctv(List childern_list)
 
 	itr = list_iterator_create(childern_list);
 	while ((assoc = list_next(itr))) {
-		if (assoc->user) {
-			assoc->usage->usage_efctv = (long double)NO_VAL;
-			continue;
-		}
 		priority_p_set_assoc_usage(assoc);
+		if (assoc->user)
+			continue;
 		_set_children_usage_efctv(assoc->usage->childern_list);
 	}
 	list_iterator_destroy(itr);
@@ -389,6 +390,8 @@ static int _set_children_usage_efctv(List childern_list)
 
 /* job_ptr should already have the partition priority and such added
  * here before had we will be adding to it
+ *
+ * NOTE: acct_mgr_association_lock must be locked before this is called.
  */
 static double _get_fairshare_priority( struct job_record *job_ptr)
 {
@@ -396,8 +399,6 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 		(slurmdb_association_rec_t *)job_ptr->assoc_ptr;
 	slurmdb_association_rec_t *fs_assoc = NULL;
 	double priority_fs = 0.0;
-	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
-				   NO_LOCK, NO_LOCK, NO_LOCK };
 
 	if (!calc_fairshare)
 		return 0;
@@ -410,8 +411,6 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 
 	fs_assoc = job_assoc;
 
-	assoc_mgr_lock(&locks);
-
 	/* Use values from parent when FairShare=SLURMDB_FS_USE_PARENT */
 	while ((fs_assoc->shares_raw == SLURMDB_FS_USE_PARENT)
 	       && fs_assoc->usage->parent_assoc_ptr
@@ -419,9 +418,6 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 		fs_assoc = fs_assoc->usage->parent_assoc_ptr;
 	}
 
-	if (fs_assoc->usage->usage_efctv == (long double) NO_VAL)
-		priority_p_set_assoc_usage(fs_assoc);
-
 	/* Priority is 0 -> 1 */
 	priority_fs = priority_p_calc_fs_factor(
 		fs_assoc->usage->usage_efctv,
@@ -434,8 +430,6 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 		     fs_assoc->usage->shares_norm, priority_fs);
 	}
 
-	assoc_mgr_unlock(&locks);
-
 	return priority_fs;
 }
 
@@ -735,6 +729,138 @@ uint32_t _init_grp_used_cpu_run_secs(time_t last_ran)
 	unlock_slurmctld(job_read_lock);
 }
   
+/*
+ * Add the usage of a running job since the last decay to its QOS and to
+ * its association and every parent association up to and including root.
+ * IN job_ptr - running job
+ * IN decay_factor - decay per second
+ * IN start_period, end_period - time period being accounted for
+ * NOTE: association and QOS write locks must be set before calling this
+ */
+static void _apply_new_usage(struct job_record *job_ptr, double decay_factor,
+			     time_t start_period, time_t end_period)
+{
+	static int last_delta = -1;
+	static double last_decay_factor = 0.0, last_pow = 0.0;
+	slurmdb_qos_rec_t *qos;
+	slurmdb_association_rec_t *assoc;
+	double run_decay = 0, real_decay;
+	int run_delta;
+
+	/* If usage_factor is 0 just skip this
+	   since we don't add the usage.
+	*/
+	qos = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
+	if (qos && !qos->usage_factor)
+		return;
+
+	if (job_ptr->start_time > start_period)
+		start_period = job_ptr->start_time;
+
+	if (job_ptr->end_time
+	    && (end_period > job_ptr->end_time))
+		end_period = job_ptr->end_time;
+
+	run_delta = (int)end_period - (int)start_period;
+
+	/* job already has been accounted for
+	   go to next */
+	if (run_delta < 1)
+		return;
+
+	if (priority_debug)
+		info("job %u ran for %d seconds",
+		     job_ptr->job_id, run_delta);
+
+	/* get the time in decayed fashion. Most running jobs ran for
+	 * the whole period, so reuse the last power computed. */
+	if ((run_delta != last_delta) ||
+	    (decay_factor != last_decay_factor)) {
+		last_pow = pow(decay_factor, (double)run_delta);
+		last_delta = run_delta;
+		last_decay_factor = decay_factor;
+	}
+	run_decay = run_delta * last_pow;
+
+	real_decay = run_decay * (double)job_ptr->total_cpus;
+
+	assoc = (slurmdb_association_rec_t *)job_ptr->assoc_ptr;
+	/* now apply the usage factor for this
+	   qos */
+	if (qos) {
+		if (qos->usage_factor >= 0) {
+			real_decay *= qos->usage_factor;
+			run_decay *= qos->usage_factor;
+		}
+		qos->usage->grp_used_wall += run_decay;
+		qos->usage->usage_raw += (long double)real_decay;
+		if (qos->usage->grp_used_cpu_run_secs >=
+		    job_ptr->total_cpus * run_delta) {
+			if(priority_debug)
+				debug4("grp_used_cpu_run_secs is %lu, "
+				       "will subtract %u",
+				       qos->usage->grp_used_cpu_run_secs,
+				       job_ptr->total_cpus * run_delta);
+			qos->usage->grp_used_cpu_run_secs -=
+				job_ptr->total_cpus * run_delta;
+		} else {
+			if (priority_debug)
+				debug4("jobid %u, qos %s: setting "
+				       "grp_used_cpu_run_secs "
+				       "to 0 because %lu < %i",
+				       job_ptr->job_id, qos->name,
+				       qos->usage->grp_used_cpu_run_secs,
+				       job_ptr->total_cpus * run_delta);
+			qos->usage->grp_used_cpu_run_secs = 0;
+		}
+	}
+
+	/* We want to do this all the way up
+	   to and including root.  This way we
+	   can keep track of how much usage
+	   has occured on the entire system
+	   and use that to normalize against.
+	*/
+	while (assoc) {
+		if (assoc->usage->grp_used_cpu_run_secs >=
+		    job_ptr->total_cpus * run_delta) {
+			if(priority_debug)
+				debug4("grp_used_cpu_run_secs is %lu, "
+				       "will subtract %u",
+				       assoc->usage->grp_used_cpu_run_secs,
+				       job_ptr->total_cpus * run_delta);
+			assoc->usage->grp_used_cpu_run_secs -=
+				job_ptr->total_cpus * run_delta;
+		} else {
+			if (priority_debug)
+				debug4("jobid %u, assoc %u: setting "
+				       "grp_used_cpu_run_secs "
+				       "to 0 because %lu < %i",
+				       job_ptr->job_id, assoc->id,
+				       assoc->usage->grp_used_cpu_run_secs,
+				       job_ptr->total_cpus * run_delta);
+			assoc->usage->grp_used_cpu_run_secs = 0;
+		}
+
+		assoc->usage->grp_used_wall += run_decay;
+		assoc->usage->usage_raw += (long double)real_decay;
+		if (priority_debug)
+			info("adding %f new usage to "
+			     "assoc %u (user='%s' "
+			     "acct='%s') raw usage "
+			     "is now %Lf.  Group wall "
+			     "added %f making it %f. "
+			     "GrpCPURunMins is %lu",
+			     real_decay, assoc->id,
+			     assoc->user, assoc->acct,
+			     assoc->usage->usage_raw,
+			     run_decay,
+			     assoc->usage->grp_used_wall,
+			     assoc->usage->grp_used_cpu_run_secs);
+		assoc = assoc->usage->parent_assoc_ptr;
+	}
+}
+
 static void *_decay_thread(void *no_data)
 {
 	struct job_record *job_ptr = NULL;
@@ -750,11 +876,19 @@ static void *_decay_thread(void *no_data)
 	double decay_factor = 1;
 	uint16_t reset_period = slurm_get_priority_reset_period();
 
+	bool calc_prio = false;
+	int batch_cnt = 0;
+
 	/* Write lock on jobs, read lock on nodes and partitions */
 	slurmctld_lock_t job_write_lock =
 		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	/* Read lock on jobs, nodes and partitions */
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
 				   WRITE_LOCK, NO_LOCK, NO_LOCK };
+	assoc_mgr_lock_t assoc_read_lock = { READ_LOCK, NO_LOCK,
+					     NO_LOCK, NO_LOCK, NO_LOCK };
 
 	if (decay_hl > 0)
 		decay_factor = 1 - (0.693 / decay_hl);
@@ -853,162 +987,35 @@ static void *_decay_thread(void *no_data)
 			slurm_mutex_unlock(&decay_lock);
 			break;
 		}
-		lock_slurmctld(job_write_lock);
+		/* Apply new usage from running jobs. This only reads job
+		 * records, so hold a job read lock. The association and
+		 * QOS write locks are only taken around running jobs and
+		 * let go every USAGE_LOCK_BATCH of them so sshare and
+		 * association updates are not held off for the whole job
+		 * list. The job read lock keeps the jobs' associations
+		 * from being freed in between. */
+		lock_slurmctld(job_read_lock);
 		itr = list_iterator_create(job_list);
 		while ((job_ptr = list_next(itr))) {
-			/* apply new usage */
-			if (!IS_JOB_PENDING(job_ptr) &&
-			    job_ptr->start_time && job_ptr->assoc_ptr) {
-				slurmdb_qos_rec_t *qos;
-				slurmdb_association_rec_t *assoc;
-				time_t start_period = last_ran;
-				time_t end_period = start_time;
-				double run_decay = 0;
-				assoc_mgr_lock_t qos_read_lock =
-					{ NO_LOCK, NO_LOCK,
-					  READ_LOCK, NO_LOCK, NO_LOCK };
-
-				/* If usage_factor is 0 just skip this
-				   since we don't add the usage.
-				*/
-				assoc_mgr_lock(&qos_read_lock);
-				qos = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
-				if (qos && !qos->usage_factor) {
-					assoc_mgr_unlock(&qos_read_lock);
-					continue;
-				}
-				assoc_mgr_unlock(&qos_read_lock);
-
-				if (job_ptr->start_time > start_period)
-					start_period = job_ptr->start_time;
-
-				if (job_ptr->end_time
-				    && (end_period > job_ptr->end_time))
-					end_period = job_ptr->end_time;
-
-				run_delta = (int)end_period - (int)start_period;
-
-				/* job already has been accounted for
-				   go to next */
-				if (run_delta < 1)
-					continue;
-
-				if (priority_debug)
-					info("job %u ran for %d seconds",
-					     job_ptr->job_id, run_delta);
-
-				/* get the time in decayed fashion */
-				run_decay = run_delta
-					* pow(decay_factor, (double)run_delta);
-
-				real_decay = run_decay
-					* (double)job_ptr->total_cpus;
-
+			if (IS_JOB_PENDING(job_ptr) ||
+			    !job_ptr->start_time || !job_ptr->assoc_ptr)
+				continue;
+			if (batch_cnt == 0)
 				assoc_mgr_lock(&locks);
-				/* Just to make sure we don't make a
-				   window where the qos_ptr could of
-				   changed make sure we get it again
-				   here.
-				*/
-				qos = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
-				assoc = (slurmdb_association_rec_t *)
-					job_ptr->assoc_ptr;
-				/* now apply the usage factor for this
-				   qos */
-				if (qos) {
-					if (qos->usage_factor >= 0) {
-						real_decay *= qos->usage_factor;
-						run_decay *= qos->usage_factor;
-					}
-					qos->usage->grp_used_wall += run_decay;
-					qos->usage->usage_raw +=
-						(long double)real_decay;
-					if (qos->usage->grp_used_cpu_run_secs >=
-					    job_ptr->total_cpus * run_delta) {
-						if(priority_debug)
-							debug4("grp_used_cpu_run_secs is %lu, will subtract %u",
-							       qos->usage->grp_used_cpu_run_secs,
-							       job_ptr->total_cpus * run_delta);
-						qos->usage->grp_used_cpu_run_secs -=
-						  job_ptr->total_cpus * run_delta;
-					} else {
-						if (priority_debug)
-							debug4("jobid %u, qos %s: setting grp_used_cpu_run_secs "
-							       "to 0 because %lu < %i",
-							       job_ptr->job_id, qos->name,
-							       qos->usage->grp_used_cpu_run_secs,
-							       job_ptr->total_cpus * run_delta);
-						qos->usage->grp_used_cpu_run_secs = 0;
-					}
-				}
-
-				/* We want to do this all the way up
-				   to and including root.  This way we
-				   can keep track of how much usage
-				   has occured on the entire system
-				   and use that to normalize against.
-				*/
-				while (assoc) {
-					if (assoc->usage->grp_used_cpu_run_secs >=
-					    job_ptr->total_cpus * run_delta) {
-						if(priority_debug)
-							debug4("grp_used_cpu_run_secs is %lu, will subtract %u",
-							        assoc->usage->grp_used_cpu_run_secs,
-							        job_ptr->total_cpus*run_delta);
-						assoc->usage->grp_used_cpu_run_secs -=
-						  job_ptr->total_cpus * run_delta;
-					} else {
-						if (priority_debug)
-							debug4("jobid %u, assoc %u: setting grp_used_cpu_run_secs "
-							       "to 0 because %lu < %i",
-							       job_ptr->job_id, assoc->id,
-							       assoc->usage->grp_used_cpu_run_secs,
-							       job_ptr->total_cpus * run_delta);
-						assoc->usage->grp_used_cpu_run_secs = 0;
-					}
-
-					assoc->usage->grp_used_wall +=
-						run_decay;
-					assoc->usage->usage_raw +=
-						(long double)real_decay;
-					if (priority_debug)
-						info("adding %f new usage to "
-						     "assoc %u (user='%s' "
-						     "acct='%s') raw usage "
-						     "is now %Lf.  Group wall "
-						     "added %f making it %f. "
-						     "GrpCPURunMins is %lu",
-						     real_decay, assoc->id,
-						     assoc->user, assoc->acct,
-						     assoc->usage->usage_raw,
-						     run_decay,
-						     assoc->usage->
-						     grp_used_wall,
-						     assoc->usage->
-						     grp_used_cpu_run_secs);
-					assoc = assoc->usage->parent_assoc_ptr;
-				}
+			_apply_new_usage(job_ptr, decay_factor,
+					 last_ran, start_time);
+			if (++batch_cnt >= USAGE_LOCK_BATCH) {
 				assoc_mgr_unlock(&locks);
+				batch_cnt = 0;
 			}
-
-			/*
-			 * This means the job is held, 0, or a system
-			 * hold, 1. Continue also if the job is not
-			 * pending.  There is no reason to set the
-			 * priority if the job isn't pending.
-			 */
-			if ((job_ptr->priority <= 1)
-			    || !IS_JOB_PENDING(job_ptr))
-				continue;
-
-			job_ptr->priority =
-				_get_priority_internal(start_time, job_ptr);
-			last_job_update = time(NULL);
-			debug2("priority for job %u is now %u",
-			       job_ptr->job_id, job_ptr->priority);
 		}
 		list_iterator_destroy(itr);
-		unlock_slurmctld(job_write_lock);
+		if (batch_cnt) {
+			assoc_mgr_unlock(&locks);
+			batch_cnt = 0;
+		}
+		unlock_slurmctld(job_read_lock);
+		calc_prio = true;
 
 	get_usage:
 		/* now calculate all the normalized usage here */
@@ -1019,6 +1026,36 @@ static void *_decay_thread(void *no_data)
 		assoc_mgr_unlock(&locks);
 		locks.qos = WRITE_LOCK;
 
+		/* Recompute the priority of pending jobs from the new
+		 * usage. The fair-share factor of each job is now just a
+		 * lookup of its association's effective usage. */
+		if (calc_prio) {
+			lock_slurmctld(job_write_lock);
+			assoc_mgr_lock(&assoc_read_lock);
+			itr = list_iterator_create(job_list);
+			while ((job_ptr = list_next(itr))) {
+				/*
+				 * This means the job is held, 0, or a system
+				 * hold, 1. Continue also if the job is not
+				 * pending.  There is no reason to set the
+				 * priority if the job isn't pending.
+				 */
+				if ((job_ptr->priority <= 1)
+				    || !IS_JOB_PENDING(job_ptr))
+					continue;
+
+				job_ptr->priority = _get_priority_internal(
+					start_time, job_ptr);
+				last_job_update = time(NULL);
+				debug2("priority for job %u is now %u",
+				       job_ptr->job_id, job_ptr->priority);
+			}
+			list_iterator_destroy(itr);
+			assoc_mgr_unlock(&assoc_read_lock);
+			unlock_slurmctld(job_write_lock);
+			calc_prio = false;
+		}
+
 		last_ran = start_time;
 
 		_write_last_decay_ran(last_ran, last_reset);
@@ -1202,7 +1239,13 @@ int fini ( void )
 
 extern uint32_t priority_p_set(uint32_t last_prio, struct job_record *job_ptr)
 {
-	uint32_t priority = _get_priority_internal(time(NULL), job_ptr);
+	uint32_t priority;
+	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
+				   NO_LOCK, NO_LOCK, NO_LOCK };
+
+	assoc_mgr_lock(&locks);
+	priority = _get_priority_internal(time(NULL), job_ptr);
+	assoc_mgr_unlock(&locks);
 
 	debug2("initial priority for job %u is %u", job_ptr->job_id, priority);
 
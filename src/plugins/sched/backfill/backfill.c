@@ -91,12 +91,26 @@
 
 #define SLURMCTLD_THREAD_LIMIT	5
 
+/* _yield_locks() return values */
+#define YIELD_NO_CHANGE		0	/* no relevant state change */
+#define YIELD_JOB_CHANGE	1	/* job or node state changed, the job
+					 * queue must be rebuilt */
+#define YIELD_RESTART		2	/* partition or configuration changed
+					 * or backfill stopped */
+
 typedef struct node_space_map {
 	time_t begin_time;
 	time_t end_time;
 	bitstr_t *avail_bitmap;
 	int next;	/* next record, by time, zero termination */
 } node_space_map_t;
+
+/* A job queue record tested in this pass. A job may be queued once per
+ * partition, so the partition is part of the key */
+typedef struct tested_rec {
+	uint32_t job_id;
+	struct part_record *part_ptr;
+} tested_rec_t;
 int backfilled_jobs = 0;
 
 /*********************** local variables *********************/
@@ -109,6 +123,7 @@ static uint32_t debug_flags = 0;
 static int backfill_interval = BACKFILL_INTERVAL;
 static int backfill_window = BACKFILL_WINDOW;
 static int max_backfill_job_cnt = 50;
+static int max_backfill_job_per_user = 0;
 
 /*********************** local functions *********************/
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
@@ -116,6 +131,9 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     node_space_map_t *node_space,
 			     int *node_space_recs);
 static int  _attempt_backfill(void);
+static bool _bf_user_limit(uint32_t user_id, uint32_t **user_ids,
+			   uint32_t **user_jobs, int *user_cnt);
+static int  _cmp_tested(const void *x, const void *y);
 static void _diff_tv_str(struct timeval *tv1,struct timeval *tv2,
 		char *tv_str, int len_tv_str);
 static bool _job_is_completing(void);
@@ -133,6 +151,7 @@ static bool _test_resv_overlap(node_space_map_t *node_space,
 static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		       uint32_t min_nodes, uint32_t max_nodes,
 		       uint32_t req_nodes);
+static int  _yield_locks(void);
 
 /* Log resource allocate table */
 static void _dump_node_space_table(node_space_map_t *node_space_ptr)
@@ -381,6 +400,13 @@ static void _load_config(void)
 		fatal("Invalid backfill scheduler max_job_bf: %d",
 		      max_backfill_job_cnt);
 	}
+	if (sched_params &&
+	    (tmp_ptr=strstr(sched_params, "bf_max_job_user=")))
+		max_backfill_job_per_user = atoi(tmp_ptr + 16);
+	if (max_backfill_job_per_user < 0) {
+		fatal("Invalid backfill scheduler bf_max_job_user: %d",
+		      max_backfill_job_per_user);
+	}
 	xfree(sched_params);
 }
 
@@ -432,8 +458,12 @@ extern void *backfill_agent(void *args)
 	return NULL;
 }
 
-/* Return non-zero to break the backfill loop if change in job, node or
- * partition state or the backfill scheduler needs to be stopped. */
+/* Release locks for a while so other work can proceed.
+ * RET YIELD_NO_CHANGE if nothing of interest changed meanwhile,
+ *     YIELD_JOB_CHANGE if job or node state changed (job records may have
+ *	been purged, so the job queue must be rebuilt), or
+ *     YIELD_RESTART if partitions or configuration changed or the backfill
+ *	scheduler needs to be stopped */
 static int _yield_locks(void)
 {
 	slurmctld_lock_t all_locks = {
@@ -448,13 +478,58 @@ static int _yield_locks(void)
 	_my_sleep(backfill_interval);
 	lock_slurmctld(all_locks);
 
-	if ((last_job_update  == job_update)  &&
-	    (last_node_update == node_update) &&
-	    (last_part_update == part_update) &&
-	    (! stop_backfill) && (! config_flag))
-		return 0;
-	else
+	if ((last_part_update != part_update) || stop_backfill || config_flag)
+		return YIELD_RESTART;
+	if ((last_job_update  != job_update)  ||
+	    (last_node_update != node_update))
+		return YIELD_JOB_CHANGE;
+	return YIELD_NO_CHANGE;
+}
+
+/* Return true if a user has already had bf_max_job_user jobs tested in this
+ * backfill pass, otherwise count another job tested for the user.
+ * IN user_id - owner of the job to be tested
+ * IN/OUT user_ids, user_jobs, user_cnt - users seen so far this pass and
+ *	the count of jobs tested for each, xfree user_ids and user_jobs
+ *	when the pass completes */
+static bool _bf_user_limit(uint32_t user_id, uint32_t **user_ids,
+			   uint32_t **user_jobs, int *user_cnt)
+{
+	int i;
+
+	for (i = 0; i < *user_cnt; i++) {
+		if ((*user_ids)[i] == user_id)
+			break;
+	}
+	if (i == *user_cnt) {
+		if ((*user_cnt % 64) == 0) {
+			xrealloc(*user_ids,  sizeof(uint32_t) * (*user_cnt + 64));
+			xrealloc(*user_jobs, sizeof(uint32_t) * (*user_cnt + 64));
+		}
+		(*user_ids)[i]  = user_id;
+		(*user_jobs)[i] = 0;
+		(*user_cnt)++;
+	}
+	if ((*user_jobs)[i] >= max_backfill_job_per_user)
+		return true;
+	(*user_jobs)[i]++;
+	return false;
+}
+
+/* Order tested_rec_t records by job id, then partition */
+static int _cmp_tested(const void *x, const void *y)
+{
+	const tested_rec_t *rec1 = x, *rec2 = y;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
 		return 1;
+	if (rec1->part_ptr < rec2->part_ptr)
+		return -1;
+	if (rec1->part_ptr > rec2->part_ptr)
+		return 1;
+	return 0;
 }
 
 static int _attempt_backfill(void)
@@ -474,6 +549,11 @@ static int _attempt_backfill(void)
 	node_space_map_t *node_space;
 	static int sched_timeout = 0;
 	int this_sched_timeout = 0, rc = 0;
+	tested_rec_t *tested = NULL;	/* jobs tested before last resume */
+	tested_rec_t tested_key;
+	int tested_cnt = 0, tested_alloc = 0, tested_sorted = 0;
+	uint32_t *user_ids = NULL, *user_jobs = NULL;
+	int user_cnt = 0;
 
 	sched_start = now;
 	if (sched_timeout == 0) {
@@ -510,6 +590,17 @@ static int _attempt_backfill(void)
 		xfree(job_queue_rec);
 		if (!IS_JOB_PENDING(job_ptr))
 			continue;	/* started in other partition */
+		tested_key.job_id = job_ptr->job_id;
+		tested_key.part_ptr = part_ptr;
+		if (tested_sorted &&
+		    bsearch(&tested_key, tested, tested_sorted,
+			    sizeof(tested_rec_t), _cmp_tested))
+			continue;	/* tested before queue was rebuilt */
+		if (tested_cnt >= tested_alloc) {
+			tested_alloc += 256;
+			xrealloc(tested, sizeof(tested_rec_t) * tested_alloc);
+		}
+		tested[tested_cnt++] = tested_key;
 		job_ptr->part_ptr = part_ptr;
 
 		if (debug_flags & DEBUG_FLAG_BACKFILL)
@@ -609,10 +700,8 @@ static int _attempt_backfill(void)
 		}
 
 		if (job_ptr->details->exc_node_bitmap) {
-			bit_not(job_ptr->details->exc_node_bitmap);
-			bit_and(avail_bitmap,
-				job_ptr->details->exc_node_bitmap);
-			bit_not(job_ptr->details->exc_node_bitmap);
+			bit_and_not(avail_bitmap,
+				    job_ptr->details->exc_node_bitmap);
 		}
 
 		/* Test if insufficient nodes remain OR
@@ -637,16 +726,55 @@ static int _attempt_backfill(void)
 		bit_not(resv_bitmap);
 
 		if ((time(NULL) - sched_start) >= this_sched_timeout) {
+			uint32_t test_time_limit = job_ptr->time_limit;
 			debug("backfill: loop taking too long, yielding locks");
-			if (_yield_locks()) {
+			/* job_ptr may be purged while unlocked */
+			job_ptr->time_limit = orig_time_limit;
+			j = _yield_locks();
+			this_sched_timeout += sched_timeout;
+			if (j == YIELD_NO_CHANGE)
+				job_ptr->time_limit = test_time_limit;
+			if (j == YIELD_RESTART) {
 				debug("backfill: system state changed, "
 				      "breaking out");
 				rc = 1;
 				break;
-			} else {
-				this_sched_timeout += sched_timeout;
+			} else if (j == YIELD_JOB_CHANGE) {
+				/* Keep reservations made so far and resume
+				 * with jobs not yet tested, including this
+				 * one, rather than restarting from the top
+				 * of the queue. Job records in the old queue
+				 * (including job_ptr) may have been purged. */
+				debug("backfill: job or node state changed, "
+				      "resuming with %d jobs tested",
+				      tested_cnt - 1);
+				tested_cnt--;
+				qsort(tested, tested_cnt, sizeof(tested_rec_t),
+				      _cmp_tested);
+				tested_sorted = tested_cnt;
+				for (i = 0; ; ) {
+					bit_and(node_space[i].avail_bitmap,
+						avail_node_bitmap);
+					if ((i = node_space[i].next) == 0)
+						break;
+				}
+				list_destroy(job_queue);
+				job_queue = build_job_queue(false);
+				continue;
 			}
 		}
+
+		/* Only jobs which get this far count against the user */
+		if (max_backfill_job_per_user &&
+		    _bf_user_limit(job_ptr->user_id, &user_ids, &user_jobs,
+				   &user_cnt)) {
+			debug2("backfill: job %u skipped, user %u has "
+			       "bf_max_job_user jobs tested",
+			       job_ptr->job_id, job_ptr->user_id);
+			job_ptr->time_limit = orig_time_limit;
+			continue;
+		}
+
 		/* this is the time consuming operation */
 		debug2("backfill: entering _try_sched for job %u.",
 		       job_ptr->job_id);
@@ -745,6 +873,9 @@ static int _attempt_backfill(void)
 			break;
 	}
 	xfree(node_space);
+	xfree(tested);
+	xfree(user_ids);
+	xfree(user_jobs);
 	list_destroy(job_queue);
 	return rc;
 }
@@ -61,6 +61,7 @@
 #include "src/common/node_select.h"
 #include "src/common/uid.h"
 #include "src/common/xstring.h"
+#include "src/slurmctld/job_scheduler.h"
 #include "src/slurmctld/proc_req.h"
 #include "bluegene.h"
 
@@ -1291,6 +1292,7 @@ extern int sync_jobs(List job_list)
 					| JOB_COMPLETING;
 				job_ptr->end_time = time(NULL);
 				last_job_update = time(NULL);
+				notify_job_dependents(job_ptr);
 				_destroy_bg_action(bg_action_ptr);
 				continue;
 			}
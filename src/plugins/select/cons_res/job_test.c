@@ -113,6 +113,10 @@ static int _eval_nodes_topo(struct job_record *job_ptr, bitstr_t *node_map,
 			uint32_t min_nodes, uint32_t max_nodes,
 			uint32_t req_nodes, uint32_t cr_node_cnt,
 			uint16_t *cpu_cnt);
+static void _topo_switch_cpus(struct job_record *job_ptr, uint16_t *cpu_cnt,
+			      bitstr_t *avail_nodes_bitmap,
+			      bitstr_t **switches_bitmap,
+			      int *switches_cpu_cnt, int *switches_node_cnt);
 
 /* _allocate_sockets - Given the job requirements, determine which sockets
  *                     from the given node can be allocated (if any) to this
@@ -830,8 +834,8 @@ clear_bit:	/* This node is not usable by this job */
 /* given an "avail" node_bitmap, return a corresponding "avail" core_bitmap */
 bitstr_t *_make_core_bitmap(bitstr_t *node_map)
 {
-	uint32_t n, c, nodes, size;
-	uint32_t coff;
+	int n, first, last, start = -1;
+	uint32_t nodes, size;
 
 	nodes = bit_size(node_map);
 	size = cr_get_coremap_offset(nodes);
@@ -839,13 +843,19 @@ bitstr_t *_make_core_bitmap(bitstr_t *node_map)
 	if (!core_map)
 		return NULL;
 
-	nodes = bit_size(node_map);
-	for (n = 0, c = 0; n < nodes; n++) {
-		if (bit_test(node_map, n)) {
-			coff = cr_get_coremap_offset(n+1);
-			while (c < coff) {
-				bit_set(core_map, c++);
-			}
+	/* Set the cores of each run of consecutive nodes in one call */
+	first = bit_ffs(node_map);
+	if (first < 0)
+		return core_map;
+	last = bit_fls(node_map);
+	for (n = first; n <= last + 1; n++) {
+		if ((n <= last) && bit_test(node_map, n)) {
+			if (start < 0)
+				start = n;
+		} else if (start >= 0) {
+			bit_nset(core_map, cr_get_coremap_offset(start),
+				 cr_get_coremap_offset(n) - 1);
+			start = -1;
 		}
 	}
 	return core_map;
@@ -1302,6 +1312,65 @@ fini:	xfree(consec_cpus);
 	return error_code;
 }
 
+/*
+ * Compute the CPUs available to the job on each switch.
+ * IN avail_nodes_bitmap - if set, first remove nodes not in this bitmap
+ *	from each switch's bitmap and node count
+ * IN/OUT switches_bitmap, switches_cpu_cnt, switches_node_cnt - per switch
+ *	data, indexed as switch_record_table
+ * With the leaf switch cache, only leaf switches are scanned node by node
+ * and each higher level switch sums the counts of its leafs.
+ */
+static void _topo_switch_cpus(struct job_record *job_ptr, uint16_t *cpu_cnt,
+			      bitstr_t *avail_nodes_bitmap,
+			      bitstr_t **switches_bitmap,
+			      int *switches_cpu_cnt, int *switches_node_cnt)
+{
+	int i, j, first, last;
+	uint32_t k;
+
+	for (j=0; j<switch_record_cnt; j++) {
+		if (cr_switch_leaf_offset &&
+		    (switch_record_table[j].level != 0))
+			continue;
+		if (switches_node_cnt[j] == 0)
+			continue;
+		first = bit_ffs(switches_bitmap[j]);
+		if (first < 0)
+			continue;
+		last  = bit_fls(switches_bitmap[j]);
+		for (i=first; i<=last; i++) {
+			if (!bit_test(switches_bitmap[j], i))
+				continue;
+			if (avail_nodes_bitmap &&
+			    !bit_test(avail_nodes_bitmap, i)) {
+				/* cleared from lower level */
+				bit_clear(switches_bitmap[j], i);
+				switches_node_cnt[j]--;
+			} else {
+				switches_cpu_cnt[j] +=
+					_get_cpu_cnt(job_ptr, i, cpu_cnt);
+			}
+		}
+	}
+	if (!cr_switch_leaf_offset)
+		return;
+
+	for (j=0; j<switch_record_cnt; j++) {
+		if (switch_record_table[j].level == 0)
+			continue;
+		if (avail_nodes_bitmap && switches_node_cnt[j]) {
+			bit_and(switches_bitmap[j], avail_nodes_bitmap);
+			switches_node_cnt[j] = bit_set_count(switches_bitmap[j]);
+		}
+		for (k = cr_switch_leaf_offset[j];
+		     k < cr_switch_leaf_offset[j+1]; k++) {
+			switches_cpu_cnt[j] +=
+				switches_cpu_cnt[cr_switch_leaf_inx[k]];
+		}
+	}
+}
+
 /*
  * A network topology aware version of _eval_nodes().
  * NOTE: The logic here is almost identical to that of _job_test_topo()
@@ -1454,41 +1523,14 @@ static int _eval_nodes_topo(struct job_record *job_ptr, bitstr_t *bitmap,
 			goto fini;
 
 		/* Update bitmaps and node counts for higher-level switches */
-		for (j=0; j<switch_record_cnt; j++) {
-			if (switches_node_cnt[j] == 0)
-				continue;
-			first = bit_ffs(switches_bitmap[j]);
-			if (first < 0)
-				continue;
-			last  = bit_fls(switches_bitmap[j]);
-			for (i=first; i<=last; i++) {
-				if (!bit_test(switches_bitmap[j], i))
-					continue;
-				if (!bit_test(avail_nodes_bitmap, i)) {
-					/* cleared from lower level */
-					bit_clear(switches_bitmap[j], i);
-					switches_node_cnt[j]--;
-				} else {
-					switches_cpu_cnt[j] +=
-						_get_cpu_cnt(job_ptr, i,
-							     cpu_cnt);
-				}
-			}
-		}
+		_topo_switch_cpus(job_ptr, cpu_cnt, avail_nodes_bitmap,
+				  switches_bitmap, switches_cpu_cnt,
+				  switches_node_cnt);
 	} else {
 		/* No specific required nodes, calculate CPU counts */
-		for (j=0; j<switch_record_cnt; j++) {
-			first = bit_ffs(switches_bitmap[j]);
-			if (first < 0)
-				continue;
-			last  = bit_fls(switches_bitmap[j]);
-			for (i=first; i<=last; i++) {
-				if (!bit_test(switches_bitmap[j], i))
-					continue;
-				switches_cpu_cnt[j] +=
-					_get_cpu_cnt(job_ptr, i, cpu_cnt);
-			}
-		}
+		_topo_switch_cpus(job_ptr, cpu_cnt, NULL,
+				  switches_bitmap, switches_cpu_cnt,
+				  switches_node_cnt);
 	}
 
 	/* Determine lowest level switch satisfying request with best fit 
@@ -1548,11 +1590,22 @@ static int _eval_nodes_topo(struct job_record *job_ptr, bitstr_t *bitmap,
 	bit_and(avail_nodes_bitmap, switches_bitmap[best_fit_inx]);
 
 	/* Identify usable leafs (within higher switch having best fit) */
-	for (j=0; j<switch_record_cnt; j++) {
-		if ((switch_record_table[j].level != 0) ||
-		    (!bit_super_set(switches_bitmap[j],
-				    switches_bitmap[best_fit_inx]))) {
-			switches_node_cnt[j] = 0;
+	if (cr_switch_leaf_offset) {
+		int *leaf_node_cnt = xmalloc(sizeof(int) * switch_record_cnt);
+		for (i = cr_switch_leaf_offset[best_fit_inx];
+		     i < cr_switch_leaf_offset[best_fit_inx + 1]; i++) {
+			j = cr_switch_leaf_inx[i];
+			leaf_node_cnt[j] = switches_node_cnt[j];
+		}
+		xfree(switches_node_cnt);
+		switches_node_cnt = leaf_node_cnt;
+	} else {
+		for (j=0; j<switch_record_cnt; j++) {
+			if ((switch_record_table[j].level != 0) ||
+			    (!bit_super_set(switches_bitmap[j],
+					    switches_bitmap[best_fit_inx]))) {
+				switches_node_cnt[j] = 0;
+			}
 		}
 	}
 
@@ -178,6 +178,8 @@ uint16_t select_fast_schedule;
 
 uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
+uint32_t *cr_switch_leaf_offset = NULL;
+int *cr_switch_leaf_inx = NULL;
 struct part_res_record *select_part_record = NULL;
 struct node_res_record *select_node_record = NULL;
 struct node_use_record *select_node_usage  = NULL;
@@ -196,6 +198,8 @@ extern select_nodeinfo_t *select_p_select_nodeinfo_alloc(uint32_t size);
 extern int select_p_select_nodeinfo_free(select_nodeinfo_t *nodeinfo);
 
 /* Procedure Declarations */
+static void _compact_part_rows(struct part_res_record *part_ptr);
+static void _rebuild_row_bitmap(struct part_row_data *r_ptr);
 static int _rm_job_from_one_node(struct job_record *job_ptr,
 				 struct node_record *node_ptr);
 static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
@@ -315,6 +319,62 @@ static void _init_global_core_data(struct node_record *node_ptr, int node_cnt)
 }
 
 
+/* (re)set cr_switch_leaf arrays: for each switch, the indexes of the leaf
+ * switches whose nodes it contains. The arrays are only built if every
+ * switch's nodes are exactly those of its leaf switches, with no node on
+ * more than one leaf, so per-switch counts can be summed from the leafs. */
+static void _init_switch_leaf_data(void)
+{
+	int i, j, leaf_cnt = 0, node_cnt;
+	int *leaf_node_cnt;
+
+	xfree(cr_switch_leaf_offset);
+	xfree(cr_switch_leaf_inx);
+	if ((switch_record_cnt == 0) || (switch_record_table == NULL))
+		return;
+
+	leaf_node_cnt = xmalloc(sizeof(int) * switch_record_cnt);
+	for (i = 0; i < switch_record_cnt; i++) {
+		if (switch_record_table[i].node_bitmap == NULL)
+			goto fini;
+		leaf_node_cnt[i] = bit_set_count(switch_record_table[i].
+						 node_bitmap);
+		if (switch_record_table[i].level == 0)
+			leaf_cnt++;
+	}
+
+	cr_switch_leaf_offset = xmalloc(sizeof(uint32_t) *
+					(switch_record_cnt + 1));
+	cr_switch_leaf_inx = xmalloc(sizeof(int) * switch_record_cnt *
+				     leaf_cnt);
+	for (j = 0; j < switch_record_cnt; j++) {
+		cr_switch_leaf_offset[j+1] = cr_switch_leaf_offset[j];
+		node_cnt = 0;
+		for (i = 0; i < switch_record_cnt; i++) {
+			if ((switch_record_table[i].level != 0) ||
+			    (leaf_node_cnt[i] == 0) ||
+			    !bit_super_set(switch_record_table[i].node_bitmap,
+					   switch_record_table[j].node_bitmap))
+				continue;
+			cr_switch_leaf_inx[cr_switch_leaf_offset[j+1]++] = i;
+			node_cnt += leaf_node_cnt[i];
+		}
+		if (node_cnt != leaf_node_cnt[j]) {
+			debug("cons_res: switch %s nodes differ from its leaf "
+			      "switches, not caching topology",
+			      switch_record_table[j].name);
+			xfree(cr_switch_leaf_offset);
+			xfree(cr_switch_leaf_inx);
+			goto fini;
+		}
+	}
+	xrealloc(cr_switch_leaf_inx, sizeof(int) *
+		 MAX(cr_switch_leaf_offset[switch_record_cnt], 1));
+
+fini:	xfree(leaf_node_cnt);
+}
+
+
 /* return the coremap index to the first core of the given node */
 extern uint32_t cr_get_coremap_offset(uint32_t node_index)
 {
@@ -368,6 +428,8 @@ static struct part_res_record *_dup_part_data(struct part_res_record *orig_ptr)
 		new_ptr->num_rows = orig_ptr->num_rows;
 		new_ptr->row = _dup_row_data(orig_ptr->row,
 					     orig_ptr->num_rows);
+		new_ptr->rebuild_rows = orig_ptr->rebuild_rows;
+		new_ptr->rows_overlap = orig_ptr->rows_overlap;
 		if (orig_ptr->next) {
 			new_ptr->next = xmalloc(sizeof(struct part_res_record));
 			new_ptr = new_ptr->next;
@@ -590,7 +652,7 @@ extern void cr_sort_part_rows(struct part_res_record *p_ptr)
 
 
 /*
- * _build_row_bitmaps: A job has been removed from the given partition,
+ * _build_row_bitmaps: Jobs have been removed from the given partition,
  *                     so the row_bitmap(s) need to be reconstructed.
  *                     Optimize the jobs into the least number of rows,
  *                     and make the lower rows as dense as possible.
@@ -604,6 +666,7 @@ static void _build_row_bitmaps(struct part_res_record *p_ptr)
 	struct part_row_data *this_row, *orig_row;
 	struct job_resources **tmpjobs, *job;
 
+	p_ptr->rebuild_rows = false;
 	if (!p_ptr->row)
 		return;
 
@@ -614,6 +677,7 @@ static void _build_row_bitmaps(struct part_res_record *p_ptr)
 				size = bit_size(this_row->row_bitmap);
 				bit_nclear(this_row->row_bitmap, 0, size-1);
 			}
+			p_ptr->rows_overlap = false;
 			return;
 		}
 
@@ -647,6 +711,7 @@ static void _build_row_bitmaps(struct part_res_record *p_ptr)
 					   size-1);
 			}
 		}
+		p_ptr->rows_overlap = false;
 		return;
 	}
 
@@ -773,6 +838,9 @@ static void _build_row_bitmaps(struct part_res_record *p_ptr)
 						 cr_node_num_cores);
 			}
 		}
+	} else {
+		/* every job was placed in a row that it fits */
+		p_ptr->rows_overlap = false;
 	}
 
 	if (select_debug_flags & DEBUG_FLAG_CPU_BIND) {
@@ -817,6 +885,35 @@ static void _build_row_bitmaps(struct part_res_record *p_ptr)
 }
 
 
+
+/* Repack the rows of every partition from which jobs have been removed
+ * since its rows were last built. Removing a job only clears its own
+ * cores, so this is deferred until the rows are next used to place a
+ * job rather than done for every job that ends. */
+static void _compact_part_rows(struct part_res_record *part_ptr)
+{
+	struct part_res_record *p_ptr;
+
+	for (p_ptr = part_ptr; p_ptr; p_ptr = p_ptr->next) {
+		if (p_ptr->rebuild_rows)
+			_build_row_bitmaps(p_ptr);
+	}
+}
+
+
+/* Rebuild one row's bitmap from the current core_bitmap of its jobs */
+static void _rebuild_row_bitmap(struct part_row_data *r_ptr)
+{
+	uint32_t j;
+
+	if (r_ptr->row_bitmap)
+		bit_nclear(r_ptr->row_bitmap, 0, bit_size(r_ptr->row_bitmap)-1);
+	for (j = 0; j < r_ptr->num_jobs; j++) {
+		add_job_to_cores(r_ptr->job_list[j], &(r_ptr->row_bitmap),
+				 cr_node_num_cores);
+	}
+}
+
 /* allocate resources to the given job
  * - add 'struct job_resources' resources to 'struct part_res_record'
  * - add job's memory requirements to 'struct node_res_record'
@@ -908,6 +1005,7 @@ static int _add_job_to_res(struct job_record *job_ptr, int action)
 			      "could not find row for job");
 			/* just add the job to the last row for now */
 			_add_job_to_row(job, &(p_ptr->row[p_ptr->num_rows-1]));
+			p_ptr->rows_overlap = true;
 		}
 		/* update the node state */
 		for (i = 0; i < select_node_cnt; i++) {
@@ -1039,6 +1137,16 @@ static int _rm_job_from_res(struct part_res_record *part_record_ptr,
 				}
 				p_ptr->row[i].job_list[j] = NULL;
 				p_ptr->row[i].num_jobs -= 1;
+				/* the job's cores belong to no other job in
+				 * this row unless it was forced into a row
+				 * that it did not fit */
+				if (!p_ptr->rows_overlap) {
+					remove_job_from_cores(job,
+						&(p_ptr->row[i].row_bitmap),
+						cr_node_num_cores);
+					if (p_ptr->num_rows > 1)
+						p_ptr->rebuild_rows = true;
+				}
 				/* found job - we're done */
 				n = 1;
 				i = p_ptr->num_rows;
@@ -1047,8 +1155,11 @@ static int _rm_job_from_res(struct part_res_record *part_record_ptr,
 		}
 
 		if (n) {
-			/* job was found and removed, so refresh the bitmaps */
-			_build_row_bitmaps(p_ptr);
+			/* job was found and removed. Bitmaps of rows which
+			 * may overlap must be rebuilt now, others are
+			 * repacked when next used. */
+			if (p_ptr->rows_overlap)
+				_build_row_bitmaps(p_ptr);
 
 			/* Adjust the node_state of all nodes affected by
 			 * the removal of this job. If all cores are now
@@ -1172,9 +1283,10 @@ static int _rm_job_from_one_node(struct job_record *job_ptr,
 			       job_ptr->job_id, p_ptr->part_ptr->name, i);
 			/* found job - we're done, don't actually remove */
 			n = 1;
-			i = p_ptr->num_rows;
 			break;
 		}
+		if (n)
+			break;
 	}
 	if (n == 0) {
 		error("cons_res: could not find job %u in partition %s",
@@ -1183,8 +1295,15 @@ static int _rm_job_from_one_node(struct job_record *job_ptr,
 	}
 
 
-	/* job was found and removed from core-bitmap, so refresh CR bitmaps */
-	_build_row_bitmaps(p_ptr);
+	/* job was found and removed from core-bitmap, so refresh CR bitmaps.
+	 * Only the job's own row changed unless rows may overlap. */
+	if (p_ptr->rows_overlap) {
+		_build_row_bitmaps(p_ptr);
+	} else {
+		_rebuild_row_bitmap(&(p_ptr->row[i]));
+		if (p_ptr->num_rows > 1)
+			p_ptr->rebuild_rows = true;
+	}
 
 	/* Adjust the node_state of the node removed from this job.
 	 * If all cores are now available, set node_state = NODE_CR_AVAILABLE */
@@ -1328,6 +1447,7 @@ static int _run_now(struct job_record *job_ptr, bitstr_t *bitmap,
 				/* Remove preemptable job now */
 				_rm_job_from_res(future_part, future_usage,
 						 tmp_job_ptr, 0);
+				_compact_part_rows(future_part);
 				bit_or(bitmap, orig_map);
 				rc = cr_job_test(job_ptr, bitmap, min_nodes,
 						 max_nodes, req_nodes,
@@ -1461,6 +1581,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 	list_iterator_destroy(job_iterator);
 
 	/* Test with all preemptable jobs gone */
+	_compact_part_rows(future_part);
 	if (preemptee_candidates) {
 		bit_or(bitmap, orig_map);
 		rc = cr_job_test(job_ptr, bitmap, min_nodes, max_nodes,
@@ -1488,6 +1609,7 @@ static int _will_run_test(struct job_record *job_ptr, bitstr_t *bitmap,
 			       tmp_job_ptr->job_id, ovrlap);
 			_rm_job_from_res(future_part, future_usage,
 					 tmp_job_ptr, 0);
+			_compact_part_rows(future_part);
 			rc = cr_job_test(job_ptr, bitmap, min_nodes,
 					 max_nodes, req_nodes,
 					 SELECT_MODE_WILL_RUN, cr_type,
@@ -1649,6 +1771,8 @@ extern int fini(void)
 	select_part_record = NULL;
 	xfree(cr_node_num_cores);
 	xfree(cr_node_cores_offset);
+	xfree(cr_switch_leaf_offset);
+	xfree(cr_switch_leaf_inx);
 
 	if (cr_type)
 		verbose("%s shutting down ...", plugin_name);
@@ -1717,6 +1841,7 @@ extern int select_p_node_init(struct node_record *node_ptr, int node_cnt)
 	select_state_initializing = true;
 	select_fast_schedule = slurm_get_fast_schedule();
 	_init_global_core_data(node_ptr, node_cnt);
+	_init_switch_leaf_data();
 
 	_destroy_node_data(select_node_usage, select_node_record);
 	select_node_cnt  = node_cnt;
@@ -1818,6 +1943,9 @@ extern int select_p_job_test(struct job_record *job_ptr, bitstr_t * bitmap,
 		job_ptr->details->mc_ptr = _create_default_mc();
 	job_node_req = _get_job_node_req(job_ptr);
 
+	/* repack rows left sparse by jobs which have ended */
+	_compact_part_rows(select_part_record);
+
 	if (select_debug_flags & DEBUG_FLAG_CPU_BIND) {
 		info("cons_res: select_p_job_test: job %u node_req %u mode %d",
 		     job_ptr->job_id, job_node_req, mode);
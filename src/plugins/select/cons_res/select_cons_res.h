@@ -97,6 +97,10 @@ struct part_res_record {
 	uint16_t num_rows;		/* Number of row_bitmaps */
 	struct part_record *part_ptr;   /* controller part record pointer */
 	struct part_row_data *row;	/* array of rows containing jobs */
+	bool rebuild_rows;		/* jobs removed, rows may be repacked */
+	bool rows_overlap;		/* a row holds jobs that do not fit
+					 * together, so a job's cores can not
+					 * simply be cleared on removal */
 };
 
 /* per-node resource data */
@@ -126,6 +130,13 @@ extern struct part_res_record *select_part_record;
 extern struct node_res_record *select_node_record;
 extern struct node_use_record *select_node_usage;
 
+/* Leaf switches below each switch in switch_record_table: those of switch
+ * j are cr_switch_leaf_inx[cr_switch_leaf_offset[j]] up to, but not
+ * including, cr_switch_leaf_inx[cr_switch_leaf_offset[j+1]]. NULL if the
+ * topology is not a tree of disjoint leaf switches. */
+extern uint32_t *cr_switch_leaf_offset;
+extern int *cr_switch_leaf_inx;
+
 extern void cr_sort_part_rows(struct part_res_record *p_ptr);
 extern uint32_t cr_get_coremap_offset(uint32_t node_index);
 
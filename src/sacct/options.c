@@ -48,6 +48,8 @@ void _help_fields_msg(void);
 void _help_msg(void);
 void _usage(void);
 void _init_params();
+void _process_jobs(List job_list);
+int _list_chunk(List job_list, void *arg);
 
 int selected_state[STATE_COUNT];
 List selected_parts = NULL;
@@ -528,11 +530,6 @@ void _init_params()
 
 int get_data(void)
 {
-	slurmdb_job_rec_t *job = NULL;
-	slurmdb_step_rec_t *step = NULL;
-
-	ListIterator itr = NULL;
-	ListIterator itr_step = NULL;
 	slurmdb_job_cond_t *job_cond = params.job_cond;
 
 	if(params.opt_completion) {
@@ -548,7 +545,21 @@ int get_data(void)
 	if(!jobs)
 		return SLURM_ERROR;
 
-	itr = list_iterator_create(jobs);
+	_process_jobs(jobs);
+
+	return SLURM_SUCCESS;
+}
+
+/* Fill in the job totals from its steps */
+void _process_jobs(List job_list)
+{
+	slurmdb_job_rec_t *job = NULL;
+	slurmdb_step_rec_t *step = NULL;
+
+	ListIterator itr = NULL;
+	ListIterator itr_step = NULL;
+
+	itr = list_iterator_create(job_list);
 	while((job = list_next(itr))) {
 		if(job->user) {
 			struct	passwd *pw = NULL;
@@ -582,8 +593,6 @@ int get_data(void)
 		list_iterator_destroy(itr_step);
 	}
 	list_iterator_destroy(itr);
-
-	return SLURM_SUCCESS;
 }
 
 void parse_command_line(int argc, char **argv)
@@ -1454,6 +1463,32 @@ void do_list(void)
 	list_iterator_destroy(itr);
 }
 
+int _list_chunk(List job_list, void *arg)
+{
+	jobs = job_list;
+	_process_jobs(jobs);
+	do_list();
+	jobs = NULL;
+
+	return SLURM_SUCCESS;
+}
+
+/* do_list_chunks() -- Get the data and list it a chunk at a time
+ *
+ * In:	Nothing explicit.
+ * Out:	SLURM_SUCCESS or an error code.
+ *
+ * The jobs are printed as they come from the storage instead of
+ * after all of them have been gathered, so we only ever hold a
+ * chunk of them in memory.
+ */
+int do_list_chunks(void)
+{
+	return jobacct_storage_g_get_jobs_cond_chunks(
+		acct_db_conn, getuid(), params.job_cond,
+		JOBS_CHUNK_SIZE, _list_chunk, NULL);
+}
+
 /* do_list_completion() -- List the assembled data
  *
  * In:	Nothing explicit.
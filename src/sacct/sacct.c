@@ -149,12 +149,12 @@ int main(int argc, char **argv)
 		break;
 	case SACCT_LIST:
 		print_fields_header(print_fields_list);
-		if(get_data() == SLURM_ERROR)
-			exit(errno);
-		if(params.opt_completion)
+		if(params.opt_completion) {
+			if(get_data() == SLURM_ERROR)
+				exit(errno);
 			do_list_completion();
-		else
-			do_list();
+		} else if(do_list_chunks() != SLURM_SUCCESS)
+			exit(errno);
 		break;
 	case SACCT_HELP:
 		do_help();
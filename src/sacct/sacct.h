@@ -76,6 +76,9 @@
 #define STATE_COUNT 10
 
 #define MAX_PRINTFIELDS 100
+
+/* Most jobs held at once when listing them */
+#define JOBS_CHUNK_SIZE 1000
 #define FORMAT_STRING_SIZE 34
 
 #define SECONDS_IN_MINUTE 60
@@ -190,6 +193,7 @@ void do_dump(void);
 void do_dump_completion(void);
 void do_help(void);
 void do_list(void);
+int do_list_chunks(void);
 void do_list_completion(void);
 void sacct_init();
 void sacct_fini();
@@ -50,10 +50,13 @@
  *  be possible to execute the agent as an pthread, process, or even a daemon
  *  on some other computer.
  *
- *  The main agent thread creates a separate thread for each node to be
- *  communicated with up to AGENT_THREAD_COUNT. A special watchdog thread
- *  sends SIGLARM to any threads that have been active (in DSH_ACTIVE state)
- *  for more than COMMAND_TIMEOUT seconds.
+ *  The main agent thread creates up to AGENT_THREAD_COUNT worker threads.
+ *  Each worker repeatedly takes the next node (or group of nodes for
+ *  messages forwarded through the slurmd tree) to be communicated with
+ *  until none remain, so no more than AGENT_THREAD_COUNT threads are
+ *  created per agent regardless of node count. A special watchdog thread
+ *  sends SIGUSR1 to any threads that have been active (in DSH_ACTIVE state)
+ *  on one request for more than COMMAND_TIMEOUT seconds.
  *  The agent responds to slurmctld via a function call or an RPC as required.
  *  For example, informing slurmctld that some node is not responding.
  *
@@ -117,8 +120,8 @@ typedef struct thd_complete {
 } thd_complete_t;
 
 typedef struct thd {
-	pthread_t thread;		/* thread ID */
-	pthread_attr_t attr;		/* thread attributes */
+	pthread_t thread;		/* ID of worker thread issuing
+					 * this request */
 	state_t state;			/* thread state */
 	time_t start_time;		/* start time */
 	time_t end_time;		/* end time or delta time
@@ -134,6 +137,7 @@ typedef struct agent_info {
 	pthread_cond_t thread_cond;	/* agent specific condition */
 	uint32_t thread_count;		/* number of threads records */
 	uint32_t threads_active;	/* currently active threads */
+	uint32_t thread_next;		/* next thread record to issue */
 	uint16_t retry;			/* if set, keep trying */
 	thd_t *thread_struct;		/* thread structures */
 	bool get_reply;			/* flag if reply expected */
@@ -147,6 +151,8 @@ typedef struct task_info {
 	pthread_cond_t *thread_cond_ptr;/* pointer to agent specific
 					 * condition */
 	uint32_t *threads_active_ptr;	/* currently active thread ptr */
+	uint32_t *thread_next_ptr;	/* next thread record to issue ptr */
+	uint32_t thread_count;		/* number of thread records */
 	thd_t *thread_struct_ptr;	/* thread structures ptr */
 	bool get_reply;			/* flag if reply expected */
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
@@ -170,12 +176,13 @@ static int  _batch_launch_defer(queued_request_t *queued_req_ptr);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
 static void _list_delete_retry(void *retry_entry);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
-static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx);
+static task_info_t *_make_task_data(agent_info_t *agent_info_ptr);
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr);
 static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 		int no_resp_cnt, int retry_cnt);
 static void _purge_agent_args(agent_arg_t *agent_arg_ptr);
 static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
+static void _rpc_one_group(task_info_t *task_ptr, thd_t *thread_ptr);
 static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			  int count, int *spot);
 static void _slurmctld_free_batch_job_launch_msg(batch_job_launch_msg_t * msg);
@@ -212,12 +219,11 @@ static bool wiki2_sched_test = false;
  */
 void *agent(void *args)
 {
-	int i, delay, rc, retries = 0;
-	pthread_attr_t attr_wdog;
-	pthread_t thread_wdog;
+	int i, delay, retries = 0, worker_cnt;
+	pthread_attr_t attr_wdog, attr_worker;
+	pthread_t thread_wdog, thread_worker;
 	agent_arg_t *agent_arg_ptr = args;
 	agent_info_t *agent_info_ptr = NULL;
-	thd_t *thread_ptr;
 	task_info_t *task_specific_ptr;
 	time_t begin_time;
 
@@ -254,7 +260,6 @@ void *agent(void *args)
 
 	/* initialize the agent data structures */
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
-	thread_ptr = agent_info_ptr->thread_struct;
 
 	/* start the watchdog thread */
 	slurm_attr_init(&attr_wdog);
@@ -273,47 +278,43 @@ void *agent(void *args)
 	fatal("AGENT_THREAD_COUNT value is invalid");
 #endif
 	debug2("got %d threads to send out",agent_info_ptr->thread_count);
-	/* start all the other threads (up to AGENT_THREAD_COUNT active) */
-	for (i = 0; i < agent_info_ptr->thread_count; i++) {
-
-		/* wait until "room" for another thread */
-		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-		while (agent_info_ptr->threads_active >=
-		       AGENT_THREAD_COUNT) {
-			pthread_cond_wait(&agent_info_ptr->thread_cond,
-					  &agent_info_ptr->thread_mutex);
-		}
-
+	/* start the worker threads (up to AGENT_THREAD_COUNT), each of
+	 * which issues requests until none remain */
+	worker_cnt = MIN(agent_info_ptr->thread_count, AGENT_THREAD_COUNT);
+	slurm_attr_init(&attr_worker);
+	if (pthread_attr_setdetachstate(&attr_worker,
+					PTHREAD_CREATE_DETACHED))
+		error("pthread_attr_setdetachstate error %m");
+	retries = 0;
+	for (i = 0; i < worker_cnt; i++) {
 		/* create thread specific data, NOTE: freed from
 		 *      _thread_per_group_rpc() */
-		task_specific_ptr = _make_task_data(agent_info_ptr, i);
+		task_specific_ptr = _make_task_data(agent_info_ptr);
 
-		slurm_attr_init(&thread_ptr[i].attr);
-		if (pthread_attr_setdetachstate(&thread_ptr[i].attr,
-						PTHREAD_CREATE_DETACHED))
-			error("pthread_attr_setdetachstate error %m");
-		while ((rc = pthread_create(&thread_ptr[i].thread,
-					    &thread_ptr[i].attr,
-					    _thread_per_group_rpc,
-					    (void *) task_specific_ptr))) {
-			error("pthread_create error %m");
-			if (agent_info_ptr->threads_active)
-				pthread_cond_wait(&agent_info_ptr->
-						  thread_cond,
-						  &agent_info_ptr->
-						  thread_mutex);
-			else {
-				slurm_mutex_unlock(&agent_info_ptr->
-						     thread_mutex);
-				usleep(10000);	/* sleep and retry */
-				slurm_mutex_lock(&agent_info_ptr->
-						   thread_mutex);
-			}
-		}
-		slurm_attr_destroy(&thread_ptr[i].attr);
+		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
 		agent_info_ptr->threads_active++;
 		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+		if (pthread_create(&thread_worker, &attr_worker,
+				   _thread_per_group_rpc,
+				   (void *) task_specific_ptr) == 0)
+			continue;
+
+		error("pthread_create error %m");
+		xfree(task_specific_ptr);
+		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+		agent_info_ptr->threads_active--;
+		if (agent_info_ptr->threads_active) {
+			/* the running workers will issue all requests */
+			slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+			break;
+		}
+		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+		if (++retries > MAX_RETRIES)
+			fatal("Can't create pthread");
+		usleep(10000);	/* sleep and retry */
+		i--;
 	}
+	slurm_attr_destroy(&attr_worker);
 
 	/* wait for termination of remaining threads */
 	pthread_join(thread_wdog, NULL);
@@ -458,7 +459,7 @@ static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr)
 	return agent_info_ptr;
 }
 
-static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
+static task_info_t *_make_task_data(agent_info_t *agent_info_ptr)
 {
 	task_info_t *task_info_ptr;
 	task_info_ptr = xmalloc(sizeof(task_info_t));
@@ -466,7 +467,9 @@ static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
 	task_info_ptr->thread_mutex_ptr  = &agent_info_ptr->thread_mutex;
 	task_info_ptr->thread_cond_ptr   = &agent_info_ptr->thread_cond;
 	task_info_ptr->threads_active_ptr= &agent_info_ptr->threads_active;
-	task_info_ptr->thread_struct_ptr = &agent_info_ptr->thread_struct[inx];
+	task_info_ptr->thread_next_ptr   = &agent_info_ptr->thread_next;
+	task_info_ptr->thread_count      = agent_info_ptr->thread_count;
+	task_info_ptr->thread_struct_ptr = agent_info_ptr->thread_struct;
 	task_info_ptr->get_reply         = agent_info_ptr->get_reply;
 	task_info_ptr->msg_type          = agent_info_ptr->msg_type;
 	task_info_ptr->msg_args_ptr      = *agent_info_ptr->msg_args_pptr;
@@ -787,15 +790,14 @@ static int _wif_status(void)
 }
 
 /*
- * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
- *                         sending message out to one and forwarding it to
- *                         others if necessary.
+ * _thread_per_group_rpc - worker thread to issue RPCs for groups of nodes,
+ *                         sending each message out to one node and
+ *                         forwarding it to others if necessary. Takes the
+ *                         agent's next unissued group until none remain.
  * IN/OUT args - pointer to task_info_t, xfree'd on completion
  */
 static void *_thread_per_group_rpc(void *args)
 {
-	int rc = SLURM_SUCCESS;
-	slurm_msg_t msg;
 	task_info_t *task_ptr = (task_info_t *) args;
 	/* we cache some pointers from task_info_t because we need
 	 * to xfree args before being finished with their use. xfree
@@ -805,7 +807,52 @@ static void *_thread_per_group_rpc(void *args)
 	pthread_mutex_t *thread_mutex_ptr   = task_ptr->thread_mutex_ptr;
 	pthread_cond_t  *thread_cond_ptr    = task_ptr->thread_cond_ptr;
 	uint32_t        *threads_active_ptr = task_ptr->threads_active_ptr;
-	thd_t           *thread_ptr         = task_ptr->thread_struct_ptr;
+	thd_t           *thread_ptr;
+	int sig_array[2] = {SIGUSR1, 0};
+
+	xassert(args != NULL);
+	xsignal(SIGUSR1, _sig_handler);
+	xsignal_unblock(sig_array);
+
+	while (1) {
+		slurm_mutex_lock(thread_mutex_ptr);
+		if (*task_ptr->thread_next_ptr >= task_ptr->thread_count) {
+			slurm_mutex_unlock(thread_mutex_ptr);
+			break;
+		}
+		thread_ptr = &task_ptr->thread_struct_ptr
+			[(*task_ptr->thread_next_ptr)++];
+		thread_ptr->thread = pthread_self();
+		thread_ptr->start_time = time(NULL);
+		thread_ptr->state = DSH_ACTIVE;
+		thread_ptr->end_time = thread_ptr->start_time +
+				       COMMAND_TIMEOUT;
+		slurm_mutex_unlock(thread_mutex_ptr);
+
+		_rpc_one_group(task_ptr, thread_ptr);
+	}
+
+	xfree(args);
+
+	slurm_mutex_lock(thread_mutex_ptr);
+	/* Signal completion so the agent can finish */
+	(*threads_active_ptr)--;
+	pthread_cond_signal(thread_cond_ptr);
+	slurm_mutex_unlock(thread_mutex_ptr);
+	return (void *) NULL;
+}
+
+/*
+ * _rpc_one_group - issue an RPC for one group of nodes and record the
+ *                  results in its thread record
+ * IN task_ptr - pointer to the worker's task_info_t
+ * IN/OUT thread_ptr - thread record for the group, already DSH_ACTIVE
+ */
+static void _rpc_one_group(task_info_t *task_ptr, thd_t *thread_ptr)
+{
+	int rc = SLURM_SUCCESS;
+	slurm_msg_t msg;
+	pthread_mutex_t *thread_mutex_ptr = task_ptr->thread_mutex_ptr;
 	state_t thread_state = DSH_NO_RESP;
 	slurm_msg_type_t msg_type = task_ptr->msg_type;
 	bool is_kill_msg, srun_agent;
@@ -813,16 +860,12 @@ static void *_thread_per_group_rpc(void *args)
 	ListIterator itr;
 	ret_data_info_t *ret_data_info = NULL;
 	int found = 0;
-	int sig_array[2] = {SIGUSR1, 0};
 
 #if AGENT_IS_THREAD
 	/* Locks: Write job, write node */
 	slurmctld_lock_t job_write_lock = {
 		NO_LOCK, WRITE_LOCK, WRITE_LOCK, NO_LOCK };
 #endif
-	xassert(args != NULL);
-	xsignal(SIGUSR1, _sig_handler);
-	xsignal_unblock(sig_array);
 	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
 			(msg_type == REQUEST_TERMINATE_JOB) );
 	srun_agent = (	(msg_type == SRUN_PING)			||
@@ -834,13 +877,6 @@ static void *_thread_per_group_rpc(void *args)
 			(msg_type == RESPONSE_RESOURCE_ALLOCATION) ||
 			(msg_type == SRUN_NODE_FAIL) );
 
-	thread_ptr->start_time = time(NULL);
-
-	slurm_mutex_lock(thread_mutex_ptr);
-	thread_ptr->state = DSH_ACTIVE;
-	thread_ptr->end_time = thread_ptr->start_time + COMMAND_TIMEOUT;
-	slurm_mutex_unlock(thread_mutex_ptr);
-
 	/* send request message */
 	slurm_msg_t_init(&msg);
 	msg.msg_type = msg_type;
@@ -1006,20 +1042,14 @@ static void *_thread_per_group_rpc(void *args)
 	list_iterator_destroy(itr);
 
 cleanup:
-	xfree(args);
-
-	/* handled at end of thread just in case resend is needed */
+	/* handled at end of request just in case resend is needed */
 	destroy_forward(&msg.forward);
 	slurm_mutex_lock(thread_mutex_ptr);
 	thread_ptr->ret_list = ret_list;
 	thread_ptr->state = thread_state;
 	thread_ptr->end_time = (time_t) difftime(time(NULL),
 						 thread_ptr->start_time);
-	/* Signal completion so another thread can replace us */
-	(*threads_active_ptr)--;
-	pthread_cond_signal(thread_cond_ptr);
 	slurm_mutex_unlock(thread_mutex_ptr);
-	return (void *) NULL;
 }
 
 /*
@@ -58,6 +58,10 @@
 #include <sys/resource.h>
 #include <sys/stat.h>
 
+#ifdef HAVE_SYS_EPOLL_H
+#  include <sys/epoll.h>
+#endif
+
 #include <slurm/slurm_errno.h>
 
 #include "src/common/assoc_mgr.h"
@@ -97,6 +101,7 @@
 #include "src/slurmctld/proc_req.h"
 #include "src/slurmctld/read_config.h"
 #include "src/slurmctld/reservation.h"
+#include "src/slurmctld/rpc_queue.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/slurmctld/sched_plugin.h"
 #include "src/slurmctld/srun_comm.h"
@@ -166,11 +171,11 @@ static int	daemonize = DEFAULT_DAEMONIZE;
 static int	debug_level = 0;
 static char	*debug_logfile = NULL;
 static bool     dump_core = false;
+static uint32_t max_rpc_conns = MAX_RPC_CONNS;
 static uint32_t max_server_threads = MAX_SERVER_THREADS;
 static int	new_nice = 0;
 static char	node_name[MAX_SLURM_NAME];
 static int	recover   = DEFAULT_RECOVER;
-static pthread_cond_t server_thread_cond = PTHREAD_COND_INITIALIZER;
 static pid_t	slurmctld_pid;
 static char    *slurm_conf_filename;
 static int      primary = 1 ;
@@ -200,7 +205,6 @@ static void         _remove_qos(slurmdb_qos_rec_t *rec);
 static void         _update_assoc(slurmdb_association_rec_t *rec);
 static void         _update_qos(slurmdb_qos_rec_t *rec);
 inline static int   _report_locks_set(void);
-static void *       _service_connection(void *arg);
 static int          _shutdown_backup_controller(int wait_time);
 static void *       _slurmctld_background(void *no_data);
 static void *       _slurmctld_rpc_mgr(void *no_data);
@@ -210,11 +214,40 @@ inline static void  _update_cred_key(void);
 static void         _update_nice(void);
 inline static void  _usage(char *prog_name);
 static bool         _valid_controller(void);
-static bool         _wait_for_server_thread(void);
 
-typedef struct connection_arg {
-	int newsockfd;
-} connection_arg_t;
+#ifdef HAVE_SYS_EPOLL_H
+/* Maximum events processed per epoll_wait() call */
+#define RPC_EPOLL_EVENTS 128
+
+/* An accepted RPC connection whose message is still being read,
+ * or one of the listening sockets */
+typedef struct rpc_conn {
+	slurm_fd_t	fd;
+	bool		listen;		/* listening socket */
+	time_t		accept_time;
+	char		len_buf[sizeof(uint32_t)]; /* message length prefix */
+	uint32_t	len_read;	/* bytes of len_buf read */
+	char *		msg_buf;
+	uint32_t	msg_len;
+	uint32_t	msg_read;	/* bytes of msg_buf read */
+	struct rpc_conn *prev;
+	struct rpc_conn *next;
+} rpc_conn_t;
+
+static void         _rpc_conn_accept(int epfd, slurm_fd_t sockfd);
+static void         _rpc_conn_close(rpc_conn_t *conn_ptr);
+static void         _rpc_conn_queue(int epfd, rpc_conn_t *conn_ptr);
+static void         _rpc_conn_read(int epfd, rpc_conn_t *conn_ptr);
+static void         _rpc_conn_timeout(void);
+static void         _rpc_conn_unlink(rpc_conn_t *conn_ptr);
+static void         _rpc_mgr_epoll(slurm_fd_t *sockfd, int nports);
+
+static rpc_conn_t  *rpc_conn_list = NULL;  /* connections being read */
+static int          rpc_conn_cnt = 0;
+#else
+static void         _rpc_mgr_select(slurm_fd_t *sockfd, int nports);
+#endif
+static bool         _rpc_conn_avail(int reading_cnt);
 
 /* main - slurmctld main function, start various threads and process RPCs */
 int main(int argc, char *argv[])
@@ -790,7 +823,7 @@ static void *_slurmctld_signal_hand(void *no_data)
 {
 	int sig;
 	int i, rc;
-	int sig_array[] = {SIGINT, SIGTERM, SIGHUP, SIGABRT, 0};
+	int sig_array[] = {SIGINT, SIGTERM, SIGHUP, SIGABRT, SIGUSR2, 0};
 	sigset_t set;
 
 	(void) pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
@@ -822,6 +855,11 @@ static void *_slurmctld_signal_hand(void *no_data)
 			slurmctld_shutdown();
 			dump_core = true;
 			return NULL;
+		case SIGUSR2:
+			info("Statistics signal (SIGUSR2) received");
+			rpc_queue_log_stats();
+			log_lock_stats();
+			break;
 		default:
 			error("Invalid signal (%d) received", sig);
 		}
@@ -848,21 +886,15 @@ static void _sig_handler(int signal)
 {
 }
 
-/* _slurmctld_rpc_mgr - Read incoming RPCs and create pthread for each */
+/* _slurmctld_rpc_mgr - Read incoming RPCs and queue them for processing
+ * by a fixed pool of threads (see rpc_queue.c) */
 static void *_slurmctld_rpc_mgr(void *no_data)
 {
-	slurm_fd_t newsockfd;
-	slurm_fd_t maxsockfd;
 	slurm_fd_t *sockfd;	/* our set of socket file descriptors */
-	slurm_addr_t cli_addr, srv_addr;
+	slurm_addr_t srv_addr;
 	uint16_t port;
 	char ip[32];
-	pthread_t thread_id_rpc_req;
-	pthread_attr_t thread_attr_rpc_req;
-	int no_thread;
-	int fd_next = 0, i, nports;
-	fd_set rfds;
-	connection_arg_t *conn_arg = NULL;
+	int i, nports;
 	/* Locks: Read config */
 	slurmctld_lock_t config_read_lock = {
 		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
@@ -873,12 +905,6 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	(void) pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 	debug3("_slurmctld_rpc_mgr pid = %u", getpid());
 
-	/* threads to process individual RPC's are detached */
-	slurm_attr_init(&thread_attr_rpc_req);
-	if (pthread_attr_setdetachstate
-	    (&thread_attr_rpc_req, PTHREAD_CREATE_DETACHED))
-		fatal("pthread_attr_setdetachstate %m");
-
 	/* set node_addr to bind to (NULL means any) */
 	if (slurmctld_conf.backup_controller && slurmctld_conf.backup_addr &&
 	    (strcmp(node_name, slurmctld_conf.backup_controller) == 0) &&
@@ -895,7 +921,6 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	/* initialize ports for RPCs */
 	lock_slurmctld(config_read_lock);
 	nports = slurmctld_conf.slurmctld_port_count;
-	maxsockfd = slurmctld_conf.slurmctld_port + nports;
 	sockfd = xmalloc(sizeof(slurm_fd_t) * nports);
 	for (i=0; i<nports; i++) {
 		sockfd[i] = slurm_init_msg_engine_addrname_port(
@@ -909,6 +934,10 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	}
 	unlock_slurmctld(config_read_lock);
 
+	/* Start worker threads before unblocking SIGUSR1 so that
+	 * they inherit a signal mask with it blocked */
+	rpc_queue_init(MIN(RPC_THREAD_COUNT, max_server_threads));
+
 	/* Prepare to catch SIGUSR1 to interrupt accept().
 	 * This signal is generated by the slurmctld signal
 	 * handler thread upon receipt of SIGABRT, SIGINT,
@@ -920,8 +949,306 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
-	while (_wait_for_server_thread()) {
+#ifdef HAVE_SYS_EPOLL_H
+	_rpc_mgr_epoll(sockfd, nports);
+#else
+	_rpc_mgr_select(sockfd, nports);
+#endif
+
+	debug3("_slurmctld_rpc_mgr shutting down");
+	for (i=0; i<nports; i++)
+		(void) slurm_shutdown_msg_engine(sockfd[i]);
+	xfree(sockfd);
+	/* Release our own count first, REQUEST_CONTROL waits for only its
+	 * own thread to remain before replying */
+	_free_server_thread();
+	rpc_queue_fini();
+	pthread_exit((void *) 0);
+	return NULL;
+}
+
+/* Return true if another RPC connection can be accepted
+ * IN reading_cnt - count of connections with messages still being read */
+static bool _rpc_conn_avail(int reading_cnt)
+{
+	static time_t last_print_time = 0;
+	time_t now;
+
+	/* server_thread_count includes this thread plus all connections
+	 * queued or being processed. Read without locking, it is only
+	 * used as a throttle. */
+	if ((slurmctld_config.server_thread_count + reading_cnt) <
+	    max_rpc_conns)
+		return true;
+
+	/* Just a delay and not an error. This can happen when the epilog
+	 * completes on a bunch of nodes at the same time, which can
+	 * easily happen for highly parallel jobs. */
+	now = time(NULL);
+	if (difftime(now, last_print_time) > 2) {
+		verbose("RPC connection count over limit (%d), waiting",
+			slurmctld_config.server_thread_count + reading_cnt);
+		last_print_time = now;
+	}
+	return false;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Accept connections and read their messages using non-blocking I/O.
+ * Only complete messages are queued for processing, so a slow client
+ * never ties up a worker thread.
+ */
+static void _rpc_mgr_epoll(slurm_fd_t *sockfd, int nports)
+{
+	struct epoll_event ev, *events;
+	rpc_conn_t *listen_conn, *conn_ptr;
+	bool listening = false;
+	int epfd, i, n;
+	time_t now, last_timeout_test = time(NULL);
+
+	if ((epfd = epoll_create(nports + RPC_EPOLL_EVENTS)) < 0)
+		fatal("epoll_create: %m");
+	fd_set_close_on_exec(epfd);
+
+	listen_conn = xmalloc(sizeof(rpc_conn_t) * nports);
+	for (i=0; i<nports; i++) {
+		listen_conn[i].fd = sockfd[i];
+		listen_conn[i].listen = true;
+		fd_set_nonblocking(sockfd[i]);
+	}
+	events = xmalloc(sizeof(struct epoll_event) * RPC_EPOLL_EVENTS);
+
+	while (slurmctld_config.shutdown_time == 0) {
+		/* Stop polling the listening sockets while at the
+		 * connection limit, new clients wait in the listen queue */
+		if (listening != _rpc_conn_avail(rpc_conn_cnt)) {
+			listening = !listening;
+			for (i=0; i<nports; i++) {
+				memset(&ev, 0, sizeof(ev));
+				ev.events = EPOLLIN;
+				ev.data.ptr = &listen_conn[i];
+				if (epoll_ctl(epfd, listening ?
+					      EPOLL_CTL_ADD : EPOLL_CTL_DEL,
+					      sockfd[i], &ev) < 0)
+					error("epoll_ctl(%d): %m", sockfd[i]);
+			}
+		}
+
+		n = epoll_wait(epfd, events, RPC_EPOLL_EVENTS,
+			       listening ? 1000 : 100);
+		if (n < 0) {
+			if (errno != EINTR)
+				error("epoll_wait: %m");
+			continue;
+		}
+		for (i=0; i<n; i++) {
+			conn_ptr = (rpc_conn_t *) events[i].data.ptr;
+			if (conn_ptr->listen)
+				_rpc_conn_accept(epfd, conn_ptr->fd);
+			else
+				_rpc_conn_read(epfd, conn_ptr);
+		}
+
+		now = time(NULL);
+		if (now != last_timeout_test) {
+			last_timeout_test = now;
+			_rpc_conn_timeout();
+		}
+	}
+
+	while (rpc_conn_list)
+		_rpc_conn_close(rpc_conn_list);
+	(void) close(epfd);
+	xfree(events);
+	xfree(listen_conn);
+}
+
+/* Accept pending connections on a listening socket and start
+ * reading their messages */
+static void _rpc_conn_accept(int epfd, slurm_fd_t sockfd)
+{
+	struct epoll_event ev;
+	slurm_addr_t cli_addr;
+	slurm_fd_t newsockfd;
+	rpc_conn_t *conn_ptr;
+
+	while (_rpc_conn_avail(rpc_conn_cnt)) {
+		if ((newsockfd = slurm_accept_msg_conn(sockfd, &cli_addr)) ==
+		    SLURM_SOCKET_ERROR) {
+			if ((errno != EAGAIN) && (errno != EWOULDBLOCK) &&
+			    (errno != EINTR))
+				error("slurm_accept_msg_conn: %m");
+			return;
+		}
+		fd_set_nonblocking(newsockfd);
+
+		conn_ptr = xmalloc(sizeof(rpc_conn_t));
+		conn_ptr->fd = newsockfd;
+		conn_ptr->accept_time = time(NULL);
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn_ptr;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, newsockfd, &ev) < 0) {
+			error("epoll_ctl(%d): %m", newsockfd);
+			slurm_close_accepted_conn(newsockfd);
+			xfree(conn_ptr);
+			continue;
+		}
+		conn_ptr->next = rpc_conn_list;
+		if (rpc_conn_list)
+			rpc_conn_list->prev = conn_ptr;
+		rpc_conn_list = conn_ptr;
+		rpc_conn_cnt++;
+	}
+}
+
+/* Unlink a connection from rpc_conn_list and free it. The connection's
+ * file descriptor and message buffer are not touched. */
+static void _rpc_conn_unlink(rpc_conn_t *conn_ptr)
+{
+	if (conn_ptr->prev)
+		conn_ptr->prev->next = conn_ptr->next;
+	else
+		rpc_conn_list = conn_ptr->next;
+	if (conn_ptr->next)
+		conn_ptr->next->prev = conn_ptr->prev;
+	rpc_conn_cnt--;
+	xfree(conn_ptr);
+}
+
+/* Close a connection whose message could not be read */
+static void _rpc_conn_close(rpc_conn_t *conn_ptr)
+{
+	/* close() also removes the descriptor from the epoll set */
+	if (slurm_close_accepted_conn(conn_ptr->fd) < 0)
+		error("close(%d): %m", conn_ptr->fd);
+	xfree(conn_ptr->msg_buf);
+	_rpc_conn_unlink(conn_ptr);
+}
+
+/* Hand a completely read message off to the worker threads */
+static void _rpc_conn_queue(int epfd, rpc_conn_t *conn_ptr)
+{
+	slurm_fd_t fd = conn_ptr->fd;
+	uint16_t version, flags, msg_type = 0;
+	Buf buffer;
+
+	(void) epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+	fd_set_blocking(fd);
+
+	/* The header leads with version, flags and message type. Peek at
+	 * the type for statistics, the worker unpacks the full message. */
+	buffer = create_buf(conn_ptr->msg_buf, conn_ptr->msg_len);
+	if ((unpack16(&version, buffer) != SLURM_SUCCESS) ||
+	    (unpack16(&flags, buffer)   != SLURM_SUCCESS) ||
+	    (unpack16(&msg_type, buffer) != SLURM_SUCCESS))
+		msg_type = 0;
+	set_buf_offset(buffer, 0);
+
+	conn_ptr->msg_buf = NULL;	/* now owned by buffer */
+	_rpc_conn_unlink(conn_ptr);
+	rpc_queue_add(fd, buffer, msg_type);
+}
+
+/* Read whatever data is available for a connection. The message is
+ * preceded by its length as a 32-bit integer in network byte order. */
+static void _rpc_conn_read(int epfd, rpc_conn_t *conn_ptr)
+{
+	ssize_t len;
+	uint32_t msg_len;
+
+	while (1) {
+		if (conn_ptr->len_read < sizeof(conn_ptr->len_buf)) {
+			len = read(conn_ptr->fd,
+				   conn_ptr->len_buf + conn_ptr->len_read,
+				   sizeof(conn_ptr->len_buf) -
+				   conn_ptr->len_read);
+		} else {
+			len = read(conn_ptr->fd,
+				   conn_ptr->msg_buf + conn_ptr->msg_read,
+				   conn_ptr->msg_len - conn_ptr->msg_read);
+		}
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return;
+			error("slurm_receive_msg: read(%d): %m", conn_ptr->fd);
+			_rpc_conn_close(conn_ptr);
+			return;
+		}
+		if (len == 0) {
+			error("slurm_receive_msg: Zero Bytes were transmitted "
+			      "or received");
+			_rpc_conn_close(conn_ptr);
+			return;
+		}
+
+		if (conn_ptr->len_read < sizeof(conn_ptr->len_buf)) {
+			conn_ptr->len_read += len;
+			if (conn_ptr->len_read < sizeof(conn_ptr->len_buf))
+				continue;
+			memcpy(&msg_len, conn_ptr->len_buf, sizeof(msg_len));
+			msg_len = ntohl(msg_len);
+			if (msg_len > MAX_MSG_SIZE) {
+				error("slurm_receive_msg: %s",
+				      slurm_strerror(
+					      SLURM_PROTOCOL_INSANE_MSG_LENGTH));
+				_rpc_conn_close(conn_ptr);
+				return;
+			}
+			conn_ptr->msg_len = msg_len;
+			conn_ptr->msg_buf = xmalloc(msg_len);
+		} else
+			conn_ptr->msg_read += len;
+
+		if (conn_ptr->msg_read == conn_ptr->msg_len) {
+			_rpc_conn_queue(epfd, conn_ptr);
+			return;
+		}
+	}
+}
+
+/* Close connections whose message has not arrived within MessageTimeout */
+static void _rpc_conn_timeout(void)
+{
+	rpc_conn_t *conn_ptr, *next_ptr;
+	time_t now;
+	int msg_timeout;
+
+	if (rpc_conn_list == NULL)
+		return;
+
+	now = time(NULL);
+	msg_timeout = slurm_get_msg_timeout();
+	for (conn_ptr = rpc_conn_list; conn_ptr; conn_ptr = next_ptr) {
+		next_ptr = conn_ptr->next;
+		if (difftime(now, conn_ptr->accept_time) <= msg_timeout)
+			continue;
+		error("slurm_receive_msg: %s",
+		      slurm_strerror(SLURM_PROTOCOL_SOCKET_IMPL_TIMEOUT));
+		_rpc_conn_close(conn_ptr);
+	}
+}
+
+#else
+
+/* Accept connections and have the worker threads read and process
+ * their messages */
+static void _rpc_mgr_select(slurm_fd_t *sockfd, int nports)
+{
+	slurm_fd_t newsockfd;
+	slurm_addr_t cli_addr;
+	int fd_next = 0, i;
+	fd_set rfds;
+
+	while (slurmctld_config.shutdown_time == 0) {
 		int max_fd = -1;
+		if (!_rpc_conn_avail(0)) {
+			usleep(10000);
+			continue;
+		}
 		FD_ZERO(&rfds);
 		for (i=0; i<nports; i++) {
 			FD_SET(sockfd[i], &rfds);
@@ -930,7 +1257,6 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 		if (select(max_fd+1, &rfds, NULL, NULL, NULL) == -1) {
 			if (errno != EINTR)
 				error("slurm_accept_msg_conn select: %m");
-			_free_server_thread();
 			continue;
 		}
 		/* find one to process */
@@ -951,126 +1277,12 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 		    SLURM_SOCKET_ERROR) {
 			if (errno != EINTR)
 				error("slurm_accept_msg_conn: %m");
-			_free_server_thread();
 			continue;
 		}
-		conn_arg = xmalloc(sizeof(connection_arg_t));
-		conn_arg->newsockfd = newsockfd;
-		if (slurmctld_config.shutdown_time)
-			no_thread = 1;
-		else if (pthread_create(&thread_id_rpc_req,
-					&thread_attr_rpc_req,
-					_service_connection,
-					(void *) conn_arg)) {
-			error("pthread_create: %m");
-			no_thread = 1;
-		} else
-			no_thread = 0;
-
-		if (no_thread) {
-			_service_connection((void *) conn_arg);
-		}
-	}
-
-	debug3("_slurmctld_rpc_mgr shutting down");
-	slurm_attr_destroy(&thread_attr_rpc_req);
-	for (i=0; i<nports; i++)
-		(void) slurm_shutdown_msg_engine(sockfd[i]);
-	xfree(sockfd);
-	_free_server_thread();
-	pthread_exit((void *) 0);
-	return NULL;
-}
-
-/*
- * _service_connection - service the RPC
- * IN/OUT arg - really just the connection's file descriptor, freed
- *	upon completion
- * RET - NULL
- */
-static void *_service_connection(void *arg)
-{
-	connection_arg_t *conn = (connection_arg_t *) arg;
-	void *return_code = NULL;
-	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
-
-	slurm_msg_t_init(msg);
-
-	if(slurm_receive_msg(conn->newsockfd, msg, 0) != 0) {
-		error("slurm_receive_msg: %m");
-		/* close should only be called when the socket implementation
-		 * is being used the following call will be a no-op in a
-		 * message/mongo implementation */
-		/* close the new socket */
-		slurm_close_accepted_conn(conn->newsockfd);
-		goto cleanup;
-	}
-
-	/* set msg connection fd to accepted fd. This allows
-	 *  possibility for slurmd_req () to close accepted connection
-	 */
-	if(errno != SLURM_SUCCESS) {
-		if (errno == SLURM_PROTOCOL_VERSION_ERROR) {
-			slurm_send_rc_msg(msg, SLURM_PROTOCOL_VERSION_ERROR);
-		} else
-			info("_service_connection/slurm_receive_msg %m");
-	} else {
-		/* process the request */
-		slurmctld_req(msg);
-	}
-	if ((conn->newsockfd >= 0)
-	    && slurm_close_accepted_conn(conn->newsockfd) < 0)
-		error ("close(%d): %m",  conn->newsockfd);
-
-cleanup:
-	slurm_free_msg(msg);
-	xfree(arg);
-	_free_server_thread();
-	return return_code;
-}
-
-/* Increment slurmctld_config.server_thread_count and don't return
- * until its value is no larger than MAX_SERVER_THREADS,
- * RET true unless shutdown in progress */
-static bool _wait_for_server_thread(void)
-{
-	bool print_it = true;
-	bool rc = true;
-
-	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
-	while (1) {
-		if (slurmctld_config.shutdown_time) {
-			rc = false;
-			break;
-		}
-		if (slurmctld_config.server_thread_count < max_server_threads) {
-			slurmctld_config.server_thread_count++;
-			break;
-		} else {
-			/* wait for state change and retry,
-			 * just a delay and not an error.
-			 * This can happen when the epilog completes
-			 * on a bunch of nodes at the same time, which
-			 * can easily happen for highly parallel jobs. */
-			if (print_it) {
-				static time_t last_print_time = 0;
-				time_t now = time(NULL);
-				if (difftime(now, last_print_time) > 2) {
-					verbose("server_thread_count over "
-						"limit (%d), waiting",
-						slurmctld_config.
-						server_thread_count);
-					last_print_time = now;
-				}
-				print_it = false;
-			}
-			pthread_cond_wait(&server_thread_cond,
-					  &slurmctld_config.thread_count_lock);
-		}
+		rpc_queue_add(newsockfd, NULL, 0);
 	}
-	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
-	return rc;
 }
+#endif
 
 static void _free_server_thread(void)
 {
@@ -1079,7 +1291,6 @@ static void _free_server_thread(void)
 		slurmctld_config.server_thread_count--;
 	else
 		error("slurmctld_config.server_thread_count underflow");
-	pthread_cond_broadcast(&server_thread_cond);
 	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
 }
 
@@ -2100,11 +2311,21 @@ static void _test_thread_limit(void)
 	struct rlimit rlim[1];
 	if (getrlimit(RLIMIT_NOFILE, rlim) < 0)
 		error("Unable to get file count limit");
-	else if ((rlim->rlim_cur != RLIM_INFINITY) &&
-		 (max_server_threads > rlim->rlim_cur)) {
-		max_server_threads = rlim->rlim_cur;
-		info("Reducing max_server_thread to %u due to file count limit "
-		     "of %u", max_server_threads, max_server_threads);
+	else if (rlim->rlim_cur != RLIM_INFINITY) {
+		if (max_server_threads > rlim->rlim_cur) {
+			max_server_threads = rlim->rlim_cur;
+			info("Reducing max_server_thread to %u due to file "
+			     "count limit of %u", max_server_threads,
+			     max_server_threads);
+		}
+		/* Leave half of the descriptors for agents, state files
+		 * and plugins */
+		if (max_rpc_conns > (rlim->rlim_cur / 2)) {
+			max_rpc_conns = rlim->rlim_cur / 2;
+			info("Reducing max_rpc_conns to %u due to file count "
+			     "limit of %u", max_rpc_conns,
+			     (uint32_t) rlim->rlim_cur);
+		}
 	}
 }
 #endif
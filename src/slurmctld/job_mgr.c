@@ -111,20 +111,54 @@
 List   job_list = NULL;		/* job_record list */
 time_t last_job_update;		/* time of last update to job records */
 
+/* Location and checksum of one job record in a job state save buffer */
+typedef struct job_state_rec {
+	uint32_t job_id;
+	uint32_t offset;		/* record offset in buffer */
+	uint32_t size;			/* record size, zero if job deleted */
+	uint32_t seq;			/* order in which records were read */
+	uint64_t hash;			/* checksum of packed record */
+} job_state_rec_t;
+
+/* Contents of the job state journal, see _load_job_journal() */
+typedef struct job_journal {
+	Buf buffer;			/* journal file contents */
+	uint32_t index_cnt;		/* count of index entries */
+	job_state_rec_t *index;		/* job_id and offset of each record
+					 * in the job_state snapshot */
+	uint32_t rec_cnt;		/* count of rec entries */
+	job_state_rec_t *rec;		/* latest journal entry of each job,
+					 * sorted by job_id */
+	uint32_t job_id_sequence;	/* last job_id_sequence saved */
+} job_journal_t;
+
 /* Local variables */
 static uint32_t maximum_prio = TOP_PRIORITY;
 static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
+static bool     journal_valid = false;	/* last job state save succeeded */
+static uint32_t journal_size = 0;	/* bytes in job state journal */
+static job_state_rec_t *saved_rec = NULL; /* jobs in last job state save,
+					 * sorted by job_id */
+static int      saved_rec_cnt = 0;	/* count of saved_rec entries */
 static struct   job_record **job_hash = NULL;
 static bool     wiki_sched = false;
 static bool     wiki2_sched = false;
 static bool     wiki_sched_test = false;
 
+/* Protects the pending job summary in each partition record (pend_cnt and
+ * pend_max_prio), which is written with only a partition read lock */
+static pthread_mutex_t top_prio_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Rebuild the summary on the next test, set with the job write lock */
+static bool     top_prio_stale = true;
+
 /* Local functions */
 static void _add_job_hash(struct job_record *job_ptr);
+static int  _append_job_journal(Buf block);
 static int  _checkpoint_job_record (struct job_record *job_ptr,
 				    char *image_dir);
+static int  _cmp_batch_dir(const void *x, const void *y);
 static int  _copy_job_desc_to_file(job_desc_msg_t * job_desc,
 				   uint32_t job_id);
 static int  _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
@@ -134,7 +168,6 @@ static int  _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
 static job_desc_msg_t * _copy_job_record_to_job_desc(
 				struct job_record *job_ptr);
 static char *_copy_nodelist_no_dup(char *node_list);
-static void _del_batch_list_rec(void *x);
 static void _delete_job_desc_files(uint32_t job_id);
 static slurmdb_qos_rec_t *_determine_and_validate_qos(
 				slurmdb_association_rec_t *assoc_ptr,
@@ -142,14 +175,20 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 static void _dump_job_details(struct job_details *detail_ptr,
 			      Buf buffer);
 static void _dump_job_state(struct job_record *dump_job_ptr, Buf buffer);
-static int  _find_batch_dir(void *x, void *key);
-static void _get_batch_job_dir_ids(List batch_dirs);
+static int  _dump_job_state_file(bool snapshot);
+static void _free_job_journal(job_journal_t *journal);
+static void _get_batch_job_dir_ids(uint32_t **batch_dirs, int *batch_dir_cnt);
+static uint64_t _job_state_hash(char *data, uint32_t size);
+static int  _job_state_rec_cmp(const void *r1, const void *r2);
+static int  _job_state_rec_find(const void *key, const void *r);
 static void _job_timed_out(struct job_record *job_ptr);
 static int  _job_create(job_desc_msg_t * job_specs, int allocate, int will_run,
 			struct job_record **job_rec_ptr, uid_t submit_uid);
 static void _list_delete_job(void *job_entry);
 static int  _list_find_job_id(void *job_entry, void *key);
 static int  _list_find_job_old(void *job_entry, void *key);
+static int  _load_job_journal(char *snap_data, uint32_t snap_size,
+			      time_t snap_time, job_journal_t *journal);
 static int  _load_job_details(struct job_record *job_ptr, Buf buffer,
 			      uint16_t protocol_version);
 static int  _load_job_state(Buf buffer,	uint16_t protocol_version);
@@ -157,6 +196,8 @@ static void _notify_srun_missing_step(struct job_record *job_ptr, int node_inx,
 				      time_t now, time_t node_boot_time);
 static int  _open_job_state_file(char **state_file);
 static void _pack_job_for_ckpt (struct job_record *job_ptr, Buf buffer);
+static Buf  _pack_job_journal_block(Buf buffer, job_state_rec_t *rec,
+				    int rec_cnt, time_t now);
 static void _pack_default_job_details(struct job_record *job_ptr,
 				      Buf buffer,
 				      uint16_t protocol_version);
@@ -170,7 +211,9 @@ static void _read_data_array_from_file(char *file_name, char ***data,
  				       struct job_record *job_ptr);
 static void _read_data_from_file(char *file_name, char **data);
 static char *_read_job_ckpt_file(char *ckpt_file, int *size_ptr);
-static void _remove_defunct_batch_dirs(List batch_dirs);
+static void _remove_defunct_batch_dirs(uint32_t *batch_dirs,
+				       int batch_dir_cnt, bitstr_t *keep_dirs);
+static void _resize_job_hash(int new_size);
 static int  _reset_detail_bitmaps(struct job_record *job_ptr);
 static void _reset_step_bitmaps(struct job_record *job_ptr);
 static int  _resume_job_nodes(struct job_record *job_ptr, bool clear_prio);
@@ -180,11 +223,19 @@ static void _signal_batch_job(struct job_record *job_ptr, uint16_t signal);
 static void _signal_job(struct job_record *job_ptr, int signal);
 static void _suspend_job(struct job_record *job_ptr, uint16_t op);
 static int  _suspend_job_nodes(struct job_record *job_ptr, bool clear_prio);
+static void _top_prio_build(void);
 static bool _top_priority(struct job_record *job_ptr);
+static bool _top_priority_resv(struct job_record *job_ptr);
+static void _top_prio_add(struct job_record *job_ptr);
 static int  _validate_job_create_req(job_desc_msg_t * job_desc);
 static int  _validate_job_desc(job_desc_msg_t * job_desc_msg, int allocate,
 			       uid_t submit_uid);
-static void _validate_job_files(List batch_dirs);
+static void _validate_job_files(uint32_t *batch_dirs, int batch_dir_cnt,
+				bitstr_t *keep_dirs);
+static int  _write_job_journal_header(Buf snapshot, time_t snapshot_time,
+				      job_state_rec_t *rec, int rec_cnt);
+static int  _write_state_data(int fd, char *data, int nwrite,
+			      char *file_name);
 static int  _write_data_to_file(char *file_name, char *data);
 static int  _write_data_array_to_file(char *file_name, char **data,
 				      uint32_t size);
@@ -365,15 +416,230 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
 
 
 /*
- * dump_all_job_state - save the state of all jobs to file for checkpoint
- *	Changes here should be reflected in load_last_job_id() and
- *	load_all_job_state().
+ * _job_state_hash - compute a 64-bit FNV-1a checksum of packed state data
+ */
+static uint64_t _job_state_hash(char *data, uint32_t size)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	uint32_t i;
+
+	for (i = 0; i < size; i++) {
+		hash ^= (unsigned char) data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+/* qsort/bsearch comparison of job_state_rec_t by job_id, then seq */
+static int _job_state_rec_cmp(const void *r1, const void *r2)
+{
+	const job_state_rec_t *rec1 = (const job_state_rec_t *) r1;
+	const job_state_rec_t *rec2 = (const job_state_rec_t *) r2;
+
+	if (rec1->job_id < rec2->job_id)
+		return -1;
+	if (rec1->job_id > rec2->job_id)
+		return 1;
+	if (rec1->seq < rec2->seq)
+		return -1;
+	if (rec1->seq > rec2->seq)
+		return 1;
+	return 0;
+}
+
+/* bsearch comparison of a job_id against a job_state_rec_t */
+static int _job_state_rec_find(const void *key, const void *r)
+{
+	uint32_t job_id = *(const uint32_t *) key;
+	const job_state_rec_t *rec = (const job_state_rec_t *) r;
+
+	if (job_id < rec->job_id)
+		return -1;
+	if (job_id > rec->job_id)
+		return 1;
+	return 0;
+}
+
+/* Write the full contents of a buffer to an open state file
  * RET 0 or error code */
-int dump_all_job_state(void)
+static int _write_state_data(int fd, char *data, int nwrite, char *file_name)
+{
+	int pos = 0, amount;
+
+	while (nwrite > 0) {
+		amount = write(fd, &data[pos], nwrite);
+		if (amount < 0) {
+			if (errno == EINTR)
+				continue;
+			error("Error writing file %s, %m", file_name);
+			return errno;
+		}
+		nwrite -= amount;
+		pos    += amount;
+	}
+	return 0;
+}
+
+/* Write a new job state journal holding only a header which ties it to the
+ * job_state snapshot just written, then move it into place
+ * RET 0 or error code */
+static int _write_job_journal_header(Buf snapshot, time_t snapshot_time,
+				     job_state_rec_t *rec, int rec_cnt)
+{
+	char *reg_file, *new_file;
+	int error_code = 0, log_fd, i;
+	Buf buffer = init_buf(BUF_SIZE + (rec_cnt * 8));
+
+	packstr(JOB_STATE_VERSION, buffer);
+	pack_time(snapshot_time, buffer);
+	pack32(get_buf_offset(snapshot), buffer);
+	pack64(_job_state_hash(get_buf_data(snapshot),
+			       get_buf_offset(snapshot)), buffer);
+	pack32(rec_cnt, buffer);
+	for (i = 0; i < rec_cnt; i++) {
+		pack32(rec[i].job_id, buffer);
+		pack32(rec[i].offset, buffer);
+	}
+
+	reg_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(reg_file, "/job_state.journal");
+	new_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(new_file, "/job_state.journal.new");
+	log_fd = creat(new_file, 0600);
+	if (log_fd < 0) {
+		error("Can't save state, create file %s error %m",
+		      new_file);
+		error_code = errno;
+	} else {
+		error_code = _write_state_data(log_fd, get_buf_data(buffer),
+					       get_buf_offset(buffer),
+					       new_file);
+		i = fsync_and_close(log_fd, "job journal");
+		if (i && !error_code)
+			error_code = i;
+	}
+	if (error_code)
+		(void) unlink(new_file);
+	else if (rename(new_file, reg_file)) {
+		error("Can't rename %s to %s: %m", new_file, reg_file);
+		error_code = errno;
+	} else
+		journal_size = get_buf_offset(buffer);
+	xfree(reg_file);
+	xfree(new_file);
+	free_buf(buffer);
+	return error_code;
+}
+
+/* Append one block of job record changes to the job state journal
+ * RET 0 or error code */
+static int _append_job_journal(Buf block)
+{
+	char *reg_file;
+	int error_code = 0, log_fd, rc;
+
+	reg_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(reg_file, "/job_state.journal");
+	log_fd = open(reg_file, O_WRONLY | O_APPEND);
+	if (log_fd < 0) {
+		error("Can't save state, open file %s error %m", reg_file);
+		error_code = errno;
+	} else {
+		error_code = _write_state_data(log_fd, get_buf_data(block),
+					       get_buf_offset(block),
+					       reg_file);
+		rc = fsync_and_close(log_fd, "job journal");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	if (error_code == 0)
+		journal_size += get_buf_offset(block);
+	xfree(reg_file);
+	return error_code;
+}
+
+/*
+ * _pack_job_journal_block - pack the records which differ from the last
+ *	saved state and the IDs of jobs no longer saved into a journal block
+ * IN buffer - packed job records
+ * IN rec - records in buffer, sorted by job_id
+ * IN rec_cnt - count of rec entries
+ * IN now - time of the save
+ * RET block to append to the journal, free with free_buf()
+ */
+static Buf _pack_job_journal_block(Buf buffer, job_state_rec_t *rec,
+				   int rec_cnt, time_t now)
+{
+	Buf block = init_buf(BUF_SIZE);
+	uint32_t cnt_offset, tmp_offset;
+	uint32_t update_cnt = 0, delete_cnt = 0;
+	int i, j;
+
+	/* write block header: size, time and job id */
+	pack32(0, block);
+	pack_time(now, block);
+	pack32(job_id_sequence, block);
+
+	/* write new and changed job records */
+	cnt_offset = get_buf_offset(block);
+	pack32(update_cnt, block);
+	for (i = 0, j = 0; i < rec_cnt; i++) {
+		while ((j < saved_rec_cnt) &&
+		       (saved_rec[j].job_id < rec[i].job_id))
+			j++;
+		if ((j < saved_rec_cnt) &&
+		    (saved_rec[j].job_id == rec[i].job_id) &&
+		    (saved_rec[j].hash == rec[i].hash))
+			continue;	/* unchanged */
+		pack32(rec[i].job_id, block);
+		packmem(get_buf_data(buffer) + rec[i].offset, rec[i].size,
+			block);
+		update_cnt++;
+	}
+	tmp_offset = get_buf_offset(block);
+	set_buf_offset(block, cnt_offset);
+	pack32(update_cnt, block);
+	set_buf_offset(block, tmp_offset);
+
+	/* write IDs of jobs no longer saved */
+	cnt_offset = get_buf_offset(block);
+	pack32(delete_cnt, block);
+	for (i = 0, j = 0; j < saved_rec_cnt; j++) {
+		while ((i < rec_cnt) && (rec[i].job_id < saved_rec[j].job_id))
+			i++;
+		if ((i < rec_cnt) && (rec[i].job_id == saved_rec[j].job_id))
+			continue;
+		pack32(saved_rec[j].job_id, block);
+		delete_cnt++;
+	}
+	tmp_offset = get_buf_offset(block);
+	set_buf_offset(block, cnt_offset);
+	pack32(delete_cnt, block);
+
+	/* put the real block size in the header */
+	set_buf_offset(block, 0);
+	pack32(tmp_offset - sizeof(uint32_t), block);
+	set_buf_offset(block, tmp_offset);
+
+	debug3("Job state journal block has %u updated and %u deleted jobs",
+	       update_cnt, delete_cnt);
+	if ((update_cnt == 0) && (delete_cnt == 0))
+		set_buf_offset(block, 0);	/* nothing to write */
+	return block;
+}
+
+/*
+ * _dump_job_state_file - save the state of all jobs for checkpoint, either
+ *	as a new job_state snapshot or as a block of changes appended to the
+ *	job state journal
+ * IN snapshot - if set, write a full snapshot
+ * RET 0 or error code
+ */
+static int _dump_job_state_file(bool snapshot)
 {
 	/* Save high-water mark to avoid buffer growth with copies */
 	static int high_buffer_size = (1024 * 1024);
-	int error_code = 0, log_fd;
+	int error_code = 0, log_fd, rec_cnt = 0, rec_alloc, i;
 	char *old_file, *new_file, *reg_file;
 	struct stat stat_buf;
 	/* Locks: Read config and job */
@@ -381,8 +647,10 @@ int dump_all_job_state(void)
 		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	Buf buffer = init_buf(high_buffer_size);
+	job_state_rec_t *rec;
+	Buf buffer = init_buf(high_buffer_size), block = NULL;
 	time_t min_age = 0, now = time(NULL);
+	uint32_t offset;
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -405,6 +673,8 @@ int dump_all_job_state(void)
 
 	/* write individual job records */
 	lock_slurmctld(job_read_lock);
+	rec_alloc = MAX(list_count(job_list), 1);
+	rec = xmalloc(sizeof(job_state_rec_t) * rec_alloc);
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
@@ -412,7 +682,16 @@ int dump_all_job_state(void)
 		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
 			continue;	/* job ready for purging, don't dump */
 
+		offset = get_buf_offset(buffer);
 		_dump_job_state(job_ptr, buffer);
+		if (rec_cnt >= rec_alloc) {
+			rec_alloc *= 2;
+			xrealloc(rec, sizeof(job_state_rec_t) * rec_alloc);
+		}
+		rec[rec_cnt].job_id = job_ptr->job_id;
+		rec[rec_cnt].offset = offset;
+		rec[rec_cnt].size   = get_buf_offset(buffer) - offset;
+		rec_cnt++;
 	}
 	list_iterator_destroy(job_iterator);
 
@@ -424,6 +703,37 @@ int dump_all_job_state(void)
 	new_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(new_file, "/job_state.new");
 	unlock_slurmctld(job_read_lock);
+	high_buffer_size = MAX(get_buf_offset(buffer), high_buffer_size);
+
+	for (i = 0; i < rec_cnt; i++) {
+		rec[i].hash = _job_state_hash(get_buf_data(buffer) +
+					      rec[i].offset, rec[i].size);
+		rec[i].seq = i;
+	}
+
+	/* Append the changed records to the journal unless it has grown to
+	 * half the snapshot size, then replace both */
+	if (!journal_valid)
+		snapshot = true;
+	if (!snapshot) {
+		job_state_rec_t *sorted;
+		sorted = xmalloc(sizeof(job_state_rec_t) * rec_alloc);
+		memcpy(sorted, rec, sizeof(job_state_rec_t) * rec_cnt);
+		qsort(sorted, rec_cnt, sizeof(job_state_rec_t),
+		      _job_state_rec_cmp);
+		block = _pack_job_journal_block(buffer, sorted, rec_cnt, now);
+		xfree(sorted);
+		if ((journal_size + get_buf_offset(block)) >
+		    (get_buf_offset(buffer) / 2))
+			snapshot = true;
+	}
+
+	lock_state_files();
+	if (!snapshot) {
+		if (get_buf_offset(block))
+			error_code = _append_job_journal(block);
+		goto fini;
+	}
 
 	if (stat(reg_file, &stat_buf) == 0) {
 		static time_t last_mtime = (time_t) 0;
@@ -440,27 +750,16 @@ int dump_all_job_state(void)
 		last_mtime = time(NULL);
 	}
 
-	lock_state_files();
 	log_fd = creat(new_file, 0600);
 	if (log_fd < 0) {
 		error("Can't save state, create file %s error %m",
 		      new_file);
 		error_code = errno;
 	} else {
-		int pos = 0, nwrite = get_buf_offset(buffer), amount, rc;
-		char *data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
-
+		int rc;
+		error_code = _write_state_data(log_fd, get_buf_data(buffer),
+					       get_buf_offset(buffer),
+					       new_file);
 		rc = fsync_and_close(log_fd, "job");
 		if (rc && !error_code)
 			error_code = rc;
@@ -477,17 +776,60 @@ int dump_all_job_state(void)
 			debug4("unable to create link for %s -> %s: %m",
 			       new_file, reg_file);
 		(void) unlink(new_file);
+		error_code = _write_job_journal_header(buffer, now,
+						       rec, rec_cnt);
 	}
+
+fini:	unlock_state_files();
 	xfree(old_file);
 	xfree(reg_file);
 	xfree(new_file);
-	unlock_state_files();
 
+	/* Remember what was saved for the next journal block. On failure
+	 * start over with a new snapshot. */
+	xfree(saved_rec);
+	saved_rec_cnt = 0;
+	journal_valid = (error_code == 0);
+	if (journal_valid) {
+		qsort(rec, rec_cnt, sizeof(job_state_rec_t),
+		      _job_state_rec_cmp);
+		saved_rec = rec;
+		saved_rec_cnt = rec_cnt;
+	} else
+		xfree(rec);
+
+	if (block)
+		free_buf(block);
 	free_buf(buffer);
-	END_TIMER2("dump_all_job_state");
+	if (snapshot) {
+		END_TIMER2("dump_all_job_state");
+	} else {
+		END_TIMER2("dump_job_state_changes");
+	}
 	return error_code;
 }
 
+/*
+ * dump_all_job_state - save the state of all jobs to file for checkpoint
+ *	and start a new job state journal.
+ *	Changes here should be reflected in load_last_job_id() and
+ *	load_all_job_state().
+ * RET 0 or error code */
+int dump_all_job_state(void)
+{
+	return _dump_job_state_file(true);
+}
+
+/*
+ * dump_job_state_changes - save the state of jobs which changed since the
+ *	last save by appending them to the job state journal. A new job_state
+ *	file is written instead once the journal reaches half its size.
+ * RET 0 or error code */
+extern int dump_job_state_changes(void)
+{
+	return _dump_job_state_file(false);
+}
+
 /* Open the job state save file, or backup if necessary.
  * state_file IN - the name of the state save file used
  * RET the file description to read from or error code
@@ -517,17 +859,190 @@ static int _open_job_state_file(char **state_file)
 	return state_fd;
 }
 
+/*
+ * _free_job_journal - free the contents of a job state journal
+ * IN journal - journal loaded by _load_job_journal() or zeroed, it is
+ *	zeroed again so may be freed more than once
+ */
+static void _free_job_journal(job_journal_t *journal)
+{
+	if (journal->buffer)
+		free_buf(journal->buffer);
+	xfree(journal->index);
+	xfree(journal->rec);
+	memset(journal, 0, sizeof(job_journal_t));
+}
+
+/*
+ * _load_job_journal - read the job state journal written after a job_state
+ *	snapshot, keeping the latest entry for each job
+ * IN snap_data - contents of the job_state file
+ * IN snap_size - size of the job_state file
+ * IN snap_time - time in the header of the job_state file
+ * OUT journal - journal contents, release with _free_job_journal()
+ * RET SLURM_SUCCESS if the journal belongs to the snapshot and can be
+ *	replayed, otherwise an error code
+ */
+static int _load_job_journal(char *snap_data, uint32_t snap_size,
+			     time_t snap_time, job_journal_t *journal)
+{
+	int data_allocated, data_read = 0, state_fd;
+	uint32_t data_size = 0, rec_alloc = 0, journal_size, block_size;
+	uint32_t block_end, cnt, job_id, size, i, j;
+	uint64_t journal_hash;
+	char *data = NULL, *state_file, *ver_str = NULL;
+	uint32_t ver_str_len;
+	time_t journal_time, block_time;
+	Buf buffer;
+
+	memset(journal, 0, sizeof(job_journal_t));
+
+	/* read the file */
+	state_file = slurm_get_state_save_location();
+	xstrcat(state_file, "/job_state.journal");
+	lock_state_files();
+	state_fd = open(state_file, O_RDONLY);
+	if (state_fd < 0) {
+		debug("No job state journal (%s) to recover", state_file);
+		xfree(state_file);
+		unlock_state_files();
+		return ENOENT;
+	}
+	data_allocated = BUF_SIZE;
+	data = xmalloc(data_allocated);
+	while (1) {
+		data_read = read(state_fd, &data[data_size], BUF_SIZE);
+		if (data_read < 0) {
+			if (errno == EINTR)
+				continue;
+			else {
+				error("Read error on %s: %m", state_file);
+				break;
+			}
+		} else if (data_read == 0)	/* eof */
+			break;
+		data_size      += data_read;
+		data_allocated += data_read;
+		xrealloc(data, data_allocated);
+	}
+	close(state_fd);
+	xfree(state_file);
+	unlock_state_files();
+
+	buffer = create_buf(data, data_size);
+	journal->buffer = buffer;
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	if ((!ver_str) || strcmp(ver_str, JOB_STATE_VERSION)) {
+		error("Ignoring job state journal, incompatible version");
+		xfree(ver_str);
+		_free_job_journal(journal);
+		return EFAULT;
+	}
+	xfree(ver_str);
+
+	safe_unpack_time(&journal_time, buffer);
+	safe_unpack32(&journal_size, buffer);
+	safe_unpack64(&journal_hash, buffer);
+	if ((journal_time != snap_time) || (journal_size != snap_size) ||
+	    (journal_hash != _job_state_hash(snap_data, snap_size))) {
+		error("Ignoring job state journal, it does not match the "
+		      "job_state file");
+		_free_job_journal(journal);
+		return EFAULT;
+	}
+
+	/* read the location of each job record in the snapshot */
+	safe_unpack32(&journal->index_cnt, buffer);
+	if (journal->index_cnt > (remaining_buf(buffer) / 8))
+		goto unpack_error;
+	journal->index = xmalloc(sizeof(job_state_rec_t) *
+				 MAX(journal->index_cnt, 1));
+	for (i = 0; i < journal->index_cnt; i++) {
+		safe_unpack32(&journal->index[i].job_id, buffer);
+		safe_unpack32(&journal->index[i].offset, buffer);
+		if (journal->index[i].offset >= snap_size)
+			goto unpack_error;
+	}
+
+	/* read the blocks of changes, a partial block at the end was left
+	 * by an interrupted save and is ignored */
+	while (remaining_buf(buffer) > 0) {
+		safe_unpack32(&block_size, buffer);
+		if (remaining_buf(buffer) < block_size) {
+			error("Job state journal ends with a partial block, "
+			      "%u bytes ignored", remaining_buf(buffer));
+			break;
+		}
+		block_end = get_buf_offset(buffer) + block_size;
+		safe_unpack_time(&block_time, buffer);
+		safe_unpack32(&journal->job_id_sequence, buffer);
+
+		for (j = 0; j < 2; j++) {	/* updates, then deletes */
+			safe_unpack32(&cnt, buffer);
+			if (cnt > (remaining_buf(buffer) / 4))
+				goto unpack_error;
+			if ((journal->rec_cnt + cnt) > rec_alloc) {
+				rec_alloc = MAX(rec_alloc * 2,
+						journal->rec_cnt + cnt);
+				xrealloc(journal->rec, sizeof(job_state_rec_t)
+					 * rec_alloc);
+			}
+			for (i = 0; i < cnt; i++) {
+				safe_unpack32(&job_id, buffer);
+				size = 0;
+				if (j == 0) {
+					safe_unpack32(&size, buffer);
+					if ((size == 0) ||
+					    (remaining_buf(buffer) < size))
+						goto unpack_error;
+				}
+				journal->rec[journal->rec_cnt].job_id = job_id;
+				journal->rec[journal->rec_cnt].offset =
+					get_buf_offset(buffer);
+				journal->rec[journal->rec_cnt].size = size;
+				journal->rec[journal->rec_cnt].seq =
+					journal->rec_cnt;
+				journal->rec_cnt++;
+				set_buf_offset(buffer,
+					       get_buf_offset(buffer) + size);
+			}
+		}
+		if (get_buf_offset(buffer) != block_end)
+			goto unpack_error;
+		debug3("Job state journal block from %ld", (long) block_time);
+	}
+
+	/* keep only the latest entry for each job */
+	qsort(journal->rec, journal->rec_cnt, sizeof(job_state_rec_t),
+	      _job_state_rec_cmp);
+	for (i = 0, j = 0; i < journal->rec_cnt; i++) {
+		if (((i + 1) < journal->rec_cnt) &&
+		    (journal->rec[i + 1].job_id == journal->rec[i].job_id))
+			continue;
+		journal->rec[j++] = journal->rec[i];
+	}
+	journal->rec_cnt = j;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("Invalid job state journal, ignoring it");
+	_free_job_journal(journal);
+	return SLURM_FAILURE;
+}
+
 /*
  * load_all_job_state - load the job state from file, recover from last
- *	checkpoint. Execute this after loading the configuration file data.
+ *	checkpoint and replay the job state journal written since then.
+ *	Execute this after loading the configuration file data.
  *	Changes here should be reflected in load_last_job_id().
  * RET 0 or error code
  */
 extern int load_all_job_state(void)
 {
 	int data_allocated, data_read = 0, error_code = SLURM_SUCCESS;
-	uint32_t data_size = 0;
+	uint32_t data_size = 0, i;
 	int state_fd, job_cnt = 0;
+	job_journal_t journal;
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
@@ -536,6 +1051,9 @@ extern int load_all_job_state(void)
 	uint32_t ver_str_len;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
 
+	/* unpack_error may be reached before the journal is loaded */
+	memset(&journal, 0, sizeof(job_journal_t));
+
 	/* read the file */
 	lock_state_files();
 	state_fd = _open_job_state_file(&state_file);
@@ -596,11 +1114,43 @@ extern int load_all_job_state(void)
 	safe_unpack32( &saved_job_id, buffer);
 	debug3("Job id in job_state header is %u", saved_job_id);
 
-	while (remaining_buf(buffer) > 0) {
-		error_code = _load_job_state(buffer, protocol_version);
-		if (error_code != SLURM_SUCCESS)
-			goto unpack_error;
-		job_cnt++;
+	if ((protocol_version == SLURM_PROTOCOL_VERSION) &&
+	    (_load_job_journal(data, data_size, buf_time, &journal) ==
+	     SLURM_SUCCESS)) {
+		/* Load snapshot records not replaced by the journal, then
+		 * the latest journal record of each remaining job */
+		for (i = 0; i < journal.index_cnt; i++) {
+			if (bsearch(&journal.index[i].job_id, journal.rec,
+				    journal.rec_cnt, sizeof(job_state_rec_t),
+				    _job_state_rec_find))
+				continue;
+			set_buf_offset(buffer, journal.index[i].offset);
+			error_code = _load_job_state(buffer, protocol_version);
+			if (error_code != SLURM_SUCCESS)
+				goto unpack_error;
+			job_cnt++;
+		}
+		for (i = 0; i < journal.rec_cnt; i++) {
+			if (journal.rec[i].size == 0)
+				continue;	/* job purged */
+			set_buf_offset(journal.buffer, journal.rec[i].offset);
+			error_code = _load_job_state(journal.buffer,
+						     protocol_version);
+			if (error_code != SLURM_SUCCESS)
+				goto unpack_error;
+			job_cnt++;
+		}
+		saved_job_id = MAX(saved_job_id, journal.job_id_sequence);
+		info("Replayed job state journal, %u jobs changed",
+		     journal.rec_cnt);
+		_free_job_journal(&journal);
+	} else {
+		while (remaining_buf(buffer) > 0) {
+			error_code = _load_job_state(buffer, protocol_version);
+			if (error_code != SLURM_SUCCESS)
+				goto unpack_error;
+			job_cnt++;
+		}
 	}
 
 	job_id_sequence = MAX(saved_job_id, job_id_sequence);
@@ -613,6 +1163,7 @@ extern int load_all_job_state(void)
 unpack_error:
 	error("Incomplete job data checkpoint file");
 	info("Recovered information about %d jobs", job_cnt);
+	_free_job_journal(&journal);
 	free_buf(buffer);
 	return SLURM_FAILURE;
 }
@@ -627,12 +1178,15 @@ extern int load_last_job_id( void )
 	int data_allocated, data_read = 0, error_code = SLURM_SUCCESS;
 	uint32_t data_size = 0;
 	int state_fd;
+	job_journal_t journal;
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
 	char *ver_str = NULL;
 	uint32_t ver_str_len;
 
+	memset(&journal, 0, sizeof(job_journal_t));
+
 	/* read the file */
 	state_file = slurm_get_state_save_location();
 	xstrcat(state_file, "/job_state");
@@ -689,6 +1243,13 @@ extern int load_last_job_id( void )
 
 	/* Ignore the state for individual jobs stored here */
 
+	if (_load_job_journal(data, data_size, buf_time, &journal) ==
+	    SLURM_SUCCESS) {
+		job_id_sequence = MAX(job_id_sequence,
+				      journal.job_id_sequence);
+		_free_job_journal(&journal);
+	}
+
 	free_buf(buffer);
 	return error_code;
 
@@ -2230,16 +2791,38 @@ extern void rehash_jobs(void)
 		hash_table_size = slurmctld_conf.max_job_cnt;
 		job_hash = (struct job_record **)
 			xmalloc(hash_table_size * sizeof(struct job_record *));
-	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
+	} else if (hash_table_size < slurmctld_conf.max_job_cnt) {
+		/* Keep no more than one job per hash table entry on average
+		 * as MaxJobCount grows */
+		_resize_job_hash(slurmctld_conf.max_job_cnt);
 	}
 }
 
+/*
+ * _resize_job_hash - move every job record into a new job hash table
+ * IN new_size - entry count of the new table
+ * global: job_hash, hash_table_size
+ */
+static void _resize_job_hash(int new_size)
+{
+	struct job_record **old_hash = job_hash;
+	struct job_record *job_ptr, *next_ptr;
+	int i, old_size = hash_table_size;
+
+	debug("resizing job hash table from %d to %d entries",
+	      old_size, new_size);
+	hash_table_size = new_size;
+	job_hash = (struct job_record **)
+		xmalloc(hash_table_size * sizeof(struct job_record *));
+	for (i = 0; i < old_size; i++) {
+		for (job_ptr = old_hash[i]; job_ptr; job_ptr = next_ptr) {
+			next_ptr = job_ptr->job_next;
+			_add_job_hash(job_ptr);
+		}
+	}
+	xfree(old_hash);
+}
+
 /*
  * job_allocate - create job_records for the supplied job specification and
  *	allocate nodes for it.
@@ -2390,6 +2973,8 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 			    (error_code == ESLURM_ACCOUNTING_POLICY)) {
 				error_code = SLURM_SUCCESS;
 			}
+			if (independent)
+				_top_prio_add(job_ptr);
 		}
 		return error_code;
 	}
@@ -2416,6 +3001,8 @@ extern int job_allocate(job_desc_msg_t * job_specs, int immediate,
 		debug2("sched: JobId=%u allocated resources: NodeList=%s",
 		       job_ptr->job_id, job_ptr->nodes);
 		rebuild_job_part_list(job_ptr);
+		if (independent)
+			_top_prio_add(job_ptr);	/* if left pending */
 	}
 
 	return SLURM_SUCCESS;
@@ -3422,9 +4009,6 @@ static int _job_create(job_desc_msg_t * job_desc, int allocate, int will_run,
 				xmalloc(sizeof(priority_factors_object_t));
 
 		if (!job_ptr->prio_factors->priority_fs) {
-			if (assoc_ptr->usage->usage_efctv
-			    == (long double)NO_VAL)
-				priority_g_set_assoc_usage(assoc_ptr);
 			job_ptr->prio_factors->priority_fs =
 				priority_g_calc_fs_factor(
 					assoc_ptr->usage->usage_efctv,
@@ -4318,6 +4902,11 @@ void job_time_limit(void)
 		    (list_count(job_ptr->step_list) > 0))
 			check_job_step_time_limit(job_ptr, now);
 
+		/* Without accounting there are no QOS or association
+		 * limits to test, so don't take the assoc_mgr locks */
+		if (!job_ptr->qos_ptr && !job_ptr->assoc_ptr)
+			goto limits_tested;
+
 		assoc_mgr_lock(&locks);
 		qos = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
 		assoc =	(slurmdb_association_rec_t *)job_ptr->assoc_ptr;
@@ -4433,6 +5022,7 @@ void job_time_limit(void)
 	job_failed:
 		assoc_mgr_unlock(&locks);
 
+	limits_tested:
 		if(job_ptr->state_reason == FAIL_TIMEOUT) {
 			last_job_update = now;
 			_job_timed_out(job_ptr);
@@ -4632,6 +5222,8 @@ static void _list_delete_job(void *job_entry)
 		fatal("job hash error");
 	*job_pptr = job_ptr->job_next;
 
+	notify_job_dependents(job_ptr);
+	xfree(job_ptr->dependent_ids);
 	delete_job_details(job_ptr);
 	xfree(job_ptr->account);
 	xfree(job_ptr->alloc_node);
@@ -4745,9 +5337,11 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 {
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
+	struct part_record **hidden_part;
 	uint32_t jobs_packed = 0, tmp_offset;
 	Buf buffer;
 	time_t min_age = 0, now = time(NULL);
+	bool private_data;
 
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
@@ -4763,18 +5357,19 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 		min_age = now  - slurmctld_conf.min_job_age;
 
 	/* write individual job records */
-	part_filter_set(uid);
+	hidden_part = part_filter_hidden(uid);
+	private_data = (slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
+		       !validate_operator(uid);
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 
 		if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
 		    (job_ptr->part_ptr) &&
-		    (job_ptr->part_ptr->flags & PART_FLAG_HIDDEN))
+		    part_is_hidden(job_ptr->part_ptr, hidden_part))
 			continue;
 
-		if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
-		    (job_ptr->user_id != uid) && !validate_operator(uid) &&
+		if (private_data && (job_ptr->user_id != uid) &&
 		    !assoc_mgr_is_user_acct_coord(acct_db_conn, uid,
 						  job_ptr->account))
 			continue;
@@ -4786,7 +5381,7 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 		pack_job(job_ptr, show_flags, buffer, protocol_version);
 		jobs_packed++;
 	}
-	part_filter_clear();
+	xfree(hidden_part);
 	list_iterator_destroy(job_iterator);
 
 	/* put the real record count in the message body header */
@@ -5581,15 +6176,143 @@ void reset_job_priority(void)
 		last_job_update = time(NULL);
 }
 
+/*
+ * _top_prio_build - record in each partition the count and highest priority
+ *	of pending jobs which could start now and have no reservation
+ * global: job_list, part_list
+ * NOTE: Call with top_prio_lock set
+ */
+static void _top_prio_build(void)
+{
+	ListIterator iter;
+	struct job_record *job_ptr;
+	struct part_record *part_ptr;
+
+	iter = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(iter))) {
+		part_ptr->pend_cnt = 0;
+		part_ptr->pend_max_prio = 0;
+	}
+	list_iterator_destroy(iter);
+
+	iter = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(iter))) {
+		if (!IS_JOB_PENDING(job_ptr) || IS_JOB_COMPLETING(job_ptr) ||
+		    job_ptr->resv_name || (job_ptr->part_ptr == NULL))
+			continue;
+		if (!job_independent(job_ptr, 0))
+			continue;
+		part_ptr = job_ptr->part_ptr;
+		part_ptr->pend_cnt++;
+		part_ptr->pend_max_prio = MAX(part_ptr->pend_max_prio,
+					      job_ptr->priority);
+	}
+	list_iterator_destroy(iter);
+}
+
+/* Have the next _top_priority() rebuild the pending job summary. Call when
+ * a job starts or ends, or a pending job's priority or eligibility changes,
+ * which the summary can not otherwise tell from other changes in the same
+ * second. Call with the job write lock set. This does not take
+ * top_prio_lock since it is also reached from job_independent() while the
+ * summary is built. */
+extern void job_top_prio_invalidate(void)
+{
+	top_prio_stale = true;
+}
+
+/* Add a job which job_allocate() leaves pending and eligible to the pending
+ * job summary, so later tests in the same second compare against it too */
+static void _top_prio_add(struct job_record *job_ptr)
+{
+	struct part_record *part_ptr = job_ptr->part_ptr;
+
+	if (!IS_JOB_PENDING(job_ptr) || job_ptr->resv_name ||
+	    (part_ptr == NULL))
+		return;
+	slurm_mutex_lock(&top_prio_lock);
+	if (!top_prio_stale) {
+		part_ptr->pend_cnt++;
+		part_ptr->pend_max_prio = MAX(part_ptr->pend_max_prio,
+					      job_ptr->priority);
+	}
+	slurm_mutex_unlock(&top_prio_lock);
+}
+
+/*
+ * _top_priority_resv - determine if any other job using a reservation has a
+ *	higher priority than the specified job, which also uses a reservation
+ * IN job_ptr - pointer to selected job
+ * RET true if selected job has highest priority
+ */
+static bool _top_priority_resv(struct job_record *job_ptr)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr2;
+	bool top = true;	/* assume top priority until found otherwise */
+
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr2 = (struct job_record *) list_next(job_iterator))) {
+		if (job_ptr2 == job_ptr)
+			continue;
+		if (!IS_JOB_PENDING(job_ptr2))
+			continue;
+		if (IS_JOB_COMPLETING(job_ptr2)) {
+			/* Job is hung in pending & completing state,
+			 * indicative of job requeue */
+			continue;
+		}
+		if (!job_ptr2->resv_name)
+			continue;	/* different reservation */
+		if (!job_independent(job_ptr2, 0))
+			continue;
+		if (!strcmp(job_ptr2->resv_name, job_ptr->resv_name)) {
+			/* same reservation */
+			if (job_ptr2->priority <= job_ptr->priority)
+				continue;
+			top = false;
+			break;
+		}
+		if (job_ptr2->part_ptr == job_ptr->part_ptr) {
+			/* same partition */
+			if (job_ptr2->priority <= job_ptr->priority)
+				continue;
+			top = false;
+			break;
+		}
+		if (bit_overlap(job_ptr->part_ptr->node_bitmap,
+				job_ptr2->part_ptr->node_bitmap) == 0)
+			continue;   /* no node overlap in partitions */
+		if ((job_ptr2->part_ptr->priority >
+		     job_ptr ->part_ptr->priority) ||
+		    ((job_ptr2->part_ptr->priority ==
+		      job_ptr ->part_ptr->priority) &&
+		     (job_ptr2->priority >  job_ptr->priority))) {
+			top = false;
+			break;
+		}
+	}
+	list_iterator_destroy(job_iterator);
+
+	return top;
+}
+
 /*
  * _top_priority - determine if any other job has a higher priority than the
  *	specified job
  * IN job_ptr - pointer to selected job
  * RET true if selected job has highest priority
+ * NOTE: For jobs without a reservation, pending jobs are summarized by
+ *	partition at most once per second, when job or partition records
+ *	change in a later second, or after job_top_prio_invalidate(). Jobs
+ *	which job_allocate() leaves pending are added by _top_prio_add().
  */
 static bool _top_priority(struct job_record *job_ptr)
 {
+	static time_t build_time = 0, build_job_update = 0;
+	static time_t build_part_update = 0;
 	struct job_details *detail_ptr = job_ptr->details;
+	struct part_record *job_part_ptr = job_ptr->part_ptr;
 	bool top;
 
 #ifdef HAVE_BG
@@ -5613,57 +6336,54 @@ static bool _top_priority(struct job_record *job_ptr)
 
 	if (job_ptr->priority == 0)	/* user held */
 		top = false;
+	else if (job_ptr->resv_name)
+		top = _top_priority_resv(job_ptr);
+	else if (job_part_ptr == NULL)
+		top = true;
 	else {
-		ListIterator job_iterator;
-		struct job_record *job_ptr2;
+		ListIterator part_iterator;
+		struct part_record *part_ptr;
+		time_t now = time(NULL);
+
+		slurm_mutex_lock(&top_prio_lock);
+		if (top_prio_stale || (build_time != now) ||
+		    (build_job_update != last_job_update) ||
+		    (build_part_update != last_part_update)) {
+			/* Clear first, jobs completed while building can
+			 * release others already looked at */
+			top_prio_stale = false;
+			_top_prio_build();
+			build_time = now;
+			build_job_update = last_job_update;
+			build_part_update = last_part_update;
+		}
 
 		top = true;	/* assume top priority until found otherwise */
-		job_iterator = list_iterator_create(job_list);
-		while ((job_ptr2 = (struct job_record *)
-					list_next(job_iterator))) {
-			if (job_ptr2 == job_ptr)
-				continue;
-			if (!IS_JOB_PENDING(job_ptr2))
-				continue;
-			if (IS_JOB_COMPLETING(job_ptr2)) {
-				/* Job is hung in pending & completing state,
-				 * indicative of job requeue */
-				continue;
-			}
-			if (!job_independent(job_ptr2, 0))
+		part_iterator = list_iterator_create(part_list);
+		while ((part_ptr = (struct part_record *)
+					list_next(part_iterator))) {
+			if (part_ptr->pend_cnt == 0)
 				continue;
-			if ((job_ptr2->resv_name && (!job_ptr->resv_name)) ||
-			    ((!job_ptr2->resv_name) && job_ptr->resv_name))
-				continue;	/* different reservation */
-			if (job_ptr2->resv_name && job_ptr->resv_name &&
-			    (!strcmp(job_ptr2->resv_name,
-				     job_ptr->resv_name))) {
-				/* same reservation */
-				if (job_ptr2->priority <= job_ptr->priority)
-					continue;
-				top = false;
-				break;
-			}
-			if (job_ptr2->part_ptr == job_ptr->part_ptr) {
+			if (part_ptr == job_part_ptr) {
 				/* same partition */
-				if (job_ptr2->priority <= job_ptr->priority)
+				if (part_ptr->pend_max_prio <=
+				    job_ptr->priority)
 					continue;
 				top = false;
 				break;
 			}
-			if (bit_overlap(job_ptr->part_ptr->node_bitmap,
-					job_ptr2->part_ptr->node_bitmap) == 0)
+			if (bit_overlap(job_part_ptr->node_bitmap,
+					part_ptr->node_bitmap) == 0)
 				continue;   /* no node overlap in partitions */
-			if ((job_ptr2->part_ptr->priority >
-			     job_ptr ->part_ptr->priority) ||
-			    ((job_ptr2->part_ptr->priority ==
-			      job_ptr ->part_ptr->priority) &&
-			     (job_ptr2->priority >  job_ptr->priority))) {
+			if ((part_ptr->priority > job_part_ptr->priority) ||
+			    ((part_ptr->priority == job_part_ptr->priority) &&
+			     (part_ptr->pend_max_prio > job_ptr->priority))) {
 				top = false;
 				break;
 			}
 		}
-		list_iterator_destroy(job_iterator);
+		list_iterator_destroy(part_iterator);
+		slurm_mutex_unlock(&top_prio_lock);
 	}
 
 	if ((!top) && detail_ptr) {	/* not top prio */
@@ -7000,6 +7720,7 @@ int update_job(job_desc_msg_t * job_specs, uid_t uid)
 #endif
 
 fini:
+	job_top_prio_invalidate();
 	if (update_accounting) {
 		info("updating accounting");
 		if (job_ptr->details && job_ptr->details->begin_time) {
@@ -7400,27 +8121,32 @@ job_alloc_info(uint32_t uid, uint32_t job_id, struct job_record **job_pptr)
  */
 int sync_job_files(void)
 {
-	List batch_dirs;
-
-	batch_dirs = list_create(_del_batch_list_rec);
-	_get_batch_job_dir_ids(batch_dirs);
-	_validate_job_files(batch_dirs);
-	_remove_defunct_batch_dirs(batch_dirs);
-	list_destroy(batch_dirs);
+	uint32_t *batch_dirs = NULL;
+	int batch_dir_cnt = 0;
+	bitstr_t *keep_dirs;
+
+	_get_batch_job_dir_ids(&batch_dirs, &batch_dir_cnt);
+	keep_dirs = bit_alloc(MAX(batch_dir_cnt, 1));
+	_validate_job_files(batch_dirs, batch_dir_cnt, keep_dirs);
+	_remove_defunct_batch_dirs(batch_dirs, batch_dir_cnt, keep_dirs);
+	FREE_NULL_BITMAP(keep_dirs);
+	xfree(batch_dirs);
 	return SLURM_SUCCESS;
 }
 
-/* Append to the batch_dirs list the job_id's associated with
- *	every batch job directory in existence
+/* Build a sorted array of the job_id's associated with every batch job
+ *	directory in existence
+ * OUT batch_dirs - array of job_id's, xfree when no longer needed
+ * OUT batch_dir_cnt - count of batch_dirs entries
  * NOTE: READ lock_slurmctld config before entry
  */
-static void _get_batch_job_dir_ids(List batch_dirs)
+static void _get_batch_job_dir_ids(uint32_t **batch_dirs, int *batch_dir_cnt)
 {
 	DIR *f_dir;
 	struct dirent *dir_ent;
 	long long_job_id;
-	uint32_t *job_id_ptr;
 	char *endptr;
+	int dir_alloc = 0;
 
 	xassert(slurmctld_conf.state_save_location);
 	f_dir = opendir(slurmctld_conf.state_save_location);
@@ -7437,23 +8163,29 @@ static void _get_batch_job_dir_ids(List batch_dirs)
 		if ((long_job_id == 0) || (endptr[0] != '\0'))
 			continue;
 		debug3("found batch directory for job_id %ld", long_job_id);
-		job_id_ptr = xmalloc(sizeof(uint32_t));
-		*job_id_ptr = long_job_id;
-		list_append (batch_dirs, job_id_ptr);
+		if (*batch_dir_cnt >= dir_alloc) {
+			dir_alloc = MAX(1024, dir_alloc * 2);
+			xrealloc(*batch_dirs, sizeof(uint32_t) * dir_alloc);
+		}
+		(*batch_dirs)[(*batch_dir_cnt)++] = long_job_id;
 	}
 
 	closedir(f_dir);
+	if (*batch_dir_cnt)
+		qsort(*batch_dirs, *batch_dir_cnt, sizeof(uint32_t),
+		      _cmp_batch_dir);
 }
 
 /* All pending batch jobs must have a batch_dir entry,
  *	otherwise we flag it as FAILED and don't schedule
  * If the batch_dir entry exists for a PENDING or RUNNING batch job,
- *	remove it the list (of directories to be deleted) */
-static void _validate_job_files(List batch_dirs)
+ *	set its bit in keep_dirs (all others are deleted) */
+static void _validate_job_files(uint32_t *batch_dirs, int batch_dir_cnt,
+				bitstr_t *keep_dirs)
 {
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
-	int del_cnt;
+	uint32_t *dir_ptr;
 
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
@@ -7462,9 +8194,15 @@ static void _validate_job_files(List batch_dirs)
 		if (IS_JOB_FINISHED(job_ptr))
 			continue;
 		/* Want to keep this job's files */
-		del_cnt = list_delete_all(batch_dirs, _find_batch_dir,
-					  &(job_ptr->job_id));
-		if ((del_cnt == 0) && IS_JOB_PENDING(job_ptr)) {
+		dir_ptr = NULL;
+		if (batch_dir_cnt) {
+			dir_ptr = bsearch(&job_ptr->job_id, batch_dirs,
+					  batch_dir_cnt, sizeof(uint32_t),
+					  _cmp_batch_dir);
+		}
+		if (dir_ptr)
+			bit_set(keep_dirs, dir_ptr - batch_dirs);
+		else if (IS_JOB_PENDING(job_ptr)) {
 			error("Script for job %u lost, state set to FAILED",
 			      job_ptr->job_id);
 			job_ptr->job_state = JOB_FAILED;
@@ -7478,33 +8216,33 @@ static void _validate_job_files(List batch_dirs)
 	list_iterator_destroy(job_iterator);
 }
 
-/* List matching function, see common/list.h */
-static int _find_batch_dir(void *x, void *key)
-{
-	uint32_t *key1 = x;
-	uint32_t *key2 = key;
-	return (int)(*key1 == *key2);
-}
-/* List entry deletion function, see common/list.h */
-static void _del_batch_list_rec(void *x)
+/* qsort/bsearch comparison of batch directory job_id's */
+static int _cmp_batch_dir(const void *x, const void *y)
 {
-	xfree(x);
+	uint32_t id1 = *(const uint32_t *) x;
+	uint32_t id2 = *(const uint32_t *) y;
+
+	if (id1 < id2)
+		return -1;
+	if (id1 > id2)
+		return 1;
+	return 0;
 }
 
-/* Remove all batch_dir entries in the list
+/* Remove all batch_dir entries in the array not set in keep_dirs
  * NOTE: READ lock_slurmctld config before entry */
-static void _remove_defunct_batch_dirs(List batch_dirs)
+static void _remove_defunct_batch_dirs(uint32_t *batch_dirs,
+				       int batch_dir_cnt, bitstr_t *keep_dirs)
 {
-	ListIterator batch_dir_inx;
-	uint32_t *job_id_ptr;
+	int i;
 
-	batch_dir_inx = list_iterator_create(batch_dirs);
-	while ((job_id_ptr = list_next(batch_dir_inx))) {
+	for (i = 0; i < batch_dir_cnt; i++) {
+		if (bit_test(keep_dirs, i))
+			continue;
 		info("Purging files for defunct batch job %u",
-		     *job_id_ptr);
-		_delete_job_desc_files(*job_id_ptr);
+		     batch_dirs[i]);
+		_delete_job_desc_files(batch_dirs[i]);
 	}
-	list_iterator_destroy(batch_dir_inx);
 }
 
 /*
@@ -7681,6 +8419,8 @@ extern void job_completion_logger(struct job_record  *job_ptr, bool requeue)
 	xassert(job_ptr);
 
 	acct_policy_remove_job_submit(job_ptr);
+	notify_job_dependents(job_ptr);
+	job_top_prio_invalidate();
 
 	if (!IS_JOB_RESIZING(job_ptr)) {
 		/* Remove configuring state just to make sure it isn't there
@@ -74,6 +74,7 @@
 #define MAX_RETRIES 10
 
 static char **	_build_env(struct job_record *job_ptr);
+static void	_add_dependent(struct job_record *job_ptr, uint32_t job_id);
 static void	_depend_list_del(void *dep_ptr);
 static void	_feature_list_delete(void *x);
 static void	_job_queue_append(List job_queue, struct job_record *job_ptr,
@@ -81,7 +82,8 @@ static void	_job_queue_append(List job_queue, struct job_record *job_ptr,
 static void	_job_queue_rec_del(void *x);
 static void *	_run_epilog(void *arg);
 static void *	_run_prolog(void *arg);
-static bool	_scan_depend(List dependency_list, uint32_t job_id);
+static bool	_scan_depend(List dependency_list, uint32_t job_id,
+			     uint32_t scan_seq);
 static int	_valid_feature_list(uint32_t job_id, List feature_list);
 static int	_valid_node_feature(char *feature);
 
@@ -504,10 +506,8 @@ extern int schedule(uint32_t job_limit)
 				 * or on nodes in this partition */
 				failed_parts[failed_part_cnt++] =
 						job_ptr->part_ptr;
-				bit_not(job_ptr->part_ptr->node_bitmap);
-				bit_and(avail_node_bitmap,
-					job_ptr->part_ptr->node_bitmap);
-				bit_not(job_ptr->part_ptr->node_bitmap);
+				bit_and_not(avail_node_bitmap,
+					    job_ptr->part_ptr->node_bitmap);
 			}
 		} else if (error_code == ESLURM_RESERVATION_NOT_USABLE) {
 			if (job_ptr->resv_ptr &&
@@ -519,10 +519,8 @@ extern int schedule(uint32_t job_limit)
 				       job_reason_string(job_ptr->
 							 state_reason),
 				       job_ptr->priority);
-				bit_not(job_ptr->resv_ptr->node_bitmap);
-				bit_and(avail_node_bitmap,
-					job_ptr->resv_ptr->node_bitmap);
-				bit_not(job_ptr->resv_ptr->node_bitmap);
+				bit_and_not(avail_node_bitmap,
+					    job_ptr->resv_ptr->node_bitmap);
 			} else {
 				/* The job has no reservation but requires
 				 * nodes that are currently in some reservation
@@ -764,6 +762,39 @@ static void _depend_list_del(void *dep_ptr)
 	xfree(dep_ptr);
 }
 
+/* Record that job_id depends upon job_ptr (a reverse dependency edge) */
+static void _add_dependent(struct job_record *job_ptr, uint32_t job_id)
+{
+	int i;
+
+	for (i = 0; i < job_ptr->dependent_cnt; i++) {
+		if (job_ptr->dependent_ids[i] == job_id)
+			return;		/* already recorded */
+	}
+	if ((job_ptr->dependent_cnt % 16) == 0) {
+		xrealloc(job_ptr->dependent_ids, sizeof(uint32_t) *
+			 (job_ptr->dependent_cnt + 16));
+	}
+	job_ptr->dependent_ids[job_ptr->dependent_cnt++] = job_id;
+}
+
+/*
+ * Clear the saved dependency test result of every job which depends upon
+ * job_ptr. Call when job_ptr starts, completes or is purged, a job's saved
+ * result is not retested otherwise.
+ */
+extern void notify_job_dependents(struct job_record *job_ptr)
+{
+	struct job_record *dep_job_ptr;
+	int i;
+
+	for (i = 0; i < job_ptr->dependent_cnt; i++) {
+		dep_job_ptr = find_job_record(job_ptr->dependent_ids[i]);
+		if (dep_job_ptr && dep_job_ptr->details)
+			dep_job_ptr->details->depend_wait = (time_t) 0;
+	}
+}
+
 /* Print a job's dependency information based upon job_ptr->depend_list */
 extern void print_job_dependency(struct job_record *job_ptr)
 {
@@ -809,7 +840,7 @@ extern int test_job_dependency(struct job_record *job_ptr)
 {
 	ListIterator depend_iter, job_iterator;
 	struct depend_spec *dep_ptr;
-	bool failure = false, depends = false;
+	bool failure = false, depends = false, singleton = false;
  	List job_queue = NULL;
  	int now;
  	struct job_record *qjob_ptr;
@@ -818,12 +849,18 @@ extern int test_job_dependency(struct job_record *job_ptr)
 	    (job_ptr->details->depend_list == NULL))
 		return 0;
 
+	/* None of the jobs we depend upon have changed state since the
+	 * dependencies were last found unsatisfied */
+	if (job_ptr->details->depend_wait)
+		return 1;
+
 	depend_iter = list_iterator_create(job_ptr->details->depend_list);
 	if (!depend_iter)
 		fatal("list_iterator_create memory allocation failure");
 	while ((dep_ptr = list_next(depend_iter))) {
  		if ((dep_ptr->depend_type == SLURM_DEPEND_SINGLETON) &&
  		    job_ptr->name) {
+			singleton = true;
  			/* get user jobs with the same user and name */
  			job_queue = _build_user_job_list(job_ptr->user_id,
 							 job_ptr->name);
@@ -887,6 +924,13 @@ extern int test_job_dependency(struct job_record *job_ptr)
 	}
 	list_iterator_destroy(depend_iter);
 
+	/* Singleton dependencies are not tracked by notify_job_dependents(),
+	 * so those must always be retested */
+	if (depends && !failure && !singleton)
+		job_ptr->details->depend_wait = time(NULL);
+	else
+		job_ptr->details->depend_wait = (time_t) 0;
+
 	if (failure)
 		return 2;
 	if (depends)
@@ -909,6 +953,7 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 	uint32_t job_id = 0;
 	char *tok = new_depend, *sep_ptr, *sep_ptr2;
 	List new_depend_list = NULL;
+	ListIterator depend_iter;
 	struct depend_spec *dep_ptr;
 	struct job_record *dep_job_ptr;
 	char dep_buf[32];
@@ -1024,9 +1069,14 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 			break;
 	}
 
-	if (rc == SLURM_SUCCESS) {
-		/* test for circular dependencies (e.g. A -> B -> A) */
-		if (_scan_depend(new_depend_list, job_ptr->job_id))
+	/* Test for circular dependencies (e.g. A -> B -> A). A cycle can
+	 * only be closed through a job which others already depend upon,
+	 * so newly submitted jobs need no scan. */
+	if ((rc == SLURM_SUCCESS) && job_ptr->dependent_cnt) {
+		static uint32_t scan_seq = 0;
+		if (++scan_seq == 0)
+			scan_seq = 1;
+		if (_scan_depend(new_depend_list, job_ptr->job_id, scan_seq))
 			rc = ESLURM_CIRCULAR_DEPENDENCY;
 	}
 
@@ -1036,6 +1086,17 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 		if (job_ptr->details->depend_list)
 			list_destroy(job_ptr->details->depend_list);
 		job_ptr->details->depend_list = new_depend_list;
+		job_ptr->details->depend_wait = (time_t) 0;
+		depend_iter = list_iterator_create(new_depend_list);
+		if (depend_iter == NULL)
+			fatal("list_iterator_create malloc failure");
+		while ((dep_ptr = (struct depend_spec *)
+				  list_next(depend_iter))) {
+			if (dep_ptr->job_ptr)
+				_add_dependent(dep_ptr->job_ptr,
+					       job_ptr->job_id);
+		}
+		list_iterator_destroy(depend_iter);
 #if _DEBUG
 		print_job_dependency(job_ptr);
 #endif
@@ -1046,8 +1107,10 @@ extern int update_job_dependency(struct job_record *job_ptr, char *new_depend)
 }
 
 /* Return TRUE if job_id is found in dependency_list.
- * Execute recursively for each dependent job */
-static bool _scan_depend(List dependency_list, uint32_t job_id)
+ * Execute recursively for each dependent job, visiting each job at most
+ * once per scan_seq */
+static bool _scan_depend(List dependency_list, uint32_t job_id,
+			 uint32_t scan_seq)
 {
 	bool rc = false;
 	ListIterator iter;
@@ -1064,10 +1127,13 @@ static bool _scan_depend(List dependency_list, uint32_t job_id)
 			continue;
 		if (dep_ptr->job_id == job_id)
 			rc = true;
+		else if (dep_ptr->job_ptr->depend_scan == scan_seq)
+			continue;	/* already scanned */
 		else if (dep_ptr->job_ptr->details &&
 			 dep_ptr->job_ptr->details->depend_list) {
+			dep_ptr->job_ptr->depend_scan = scan_seq;
 			rc = _scan_depend(dep_ptr->job_ptr->details->
-					  depend_list, job_id);
+					  depend_list, job_id, scan_seq);
 			if (rc) {
 				info("circular dependency: job %u is dependent "
 				     "upon job %u", dep_ptr->job_id, job_id);
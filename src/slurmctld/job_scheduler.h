@@ -105,6 +105,12 @@ extern void launch_job(struct job_record *job_ptr);
 extern int make_batch_job_cred(batch_job_launch_msg_t *launch_msg_ptr,
 			       struct job_record *job_ptr);
 
+/*
+ * Clear the saved dependency test result of every job which depends upon
+ * job_ptr. Call when job_ptr starts, completes or is purged.
+ */
+extern void notify_job_dependents(struct job_record *job_ptr);
+
 /* Print a job's dependency information based upon job_ptr->depend_list */
 extern void print_job_dependency(struct job_record *job_ptr);
 
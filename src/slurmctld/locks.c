@@ -46,19 +46,46 @@
 #endif
 
 #include <errno.h>
+#include <inttypes.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
-static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
+/* Each data type has its own mutex and separate conditions for waiting
+ * readers and writers, so an unlock only wakes threads which could make
+ * progress on that data type rather than every waiting thread */
+typedef struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t  read_cond;
+	pthread_cond_t  write_cond;
+} lock_sync_t;
+
+#define LOCK_SYNC_INITIALIZER { PTHREAD_MUTEX_INITIALIZER, \
+				PTHREAD_COND_INITIALIZER,  \
+				PTHREAD_COND_INITIALIZER }
+
+/* Contention statistics for one lock level of one data type */
+typedef struct {
+	uint32_t lock_cnt;	/* locks granted */
+	uint32_t wait_cnt;	/* locks which had to wait */
+	uint64_t wait_usec;	/* total time spent waiting */
+	uint64_t wait_max;
+} lock_stats_t;
+
+static lock_sync_t lock_sync[ENTITY_COUNT] = {
+	LOCK_SYNC_INITIALIZER, LOCK_SYNC_INITIALIZER,
+	LOCK_SYNC_INITIALIZER, LOCK_SYNC_INITIALIZER };
+static lock_stats_t read_stats[ENTITY_COUNT];
+static lock_stats_t write_stats[ENTITY_COUNT];
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static slurmctld_lock_flags_t slurmctld_locks;
 static int kill_thread = 0;
 
+static void _record_wait(lock_stats_t *stats, struct timeval *start_time);
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock);
 static void _wr_rdunlock(lock_datatype_t datatype);
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock);
@@ -185,45 +212,78 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
 		_wr_wrunlock(CONFIG_LOCK);
 }
 
+/* Add the time since start_time to a lock's wait statistics.
+ * Call with the data type's mutex set. */
+static void _record_wait(lock_stats_t *stats, struct timeval *start_time)
+{
+	struct timeval end_time;
+	long wait_usec;
+
+	gettimeofday(&end_time, NULL);
+	wait_usec = diff_tv(start_time, &end_time);
+	stats->wait_cnt++;
+	stats->wait_usec += wait_usec;
+	if (wait_usec > stats->wait_max)
+		stats->wait_max = wait_usec;
+}
+
 /* _wr_rdlock - Issue a read lock on the specified data type */
 static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 {
-	bool success = true;
+	lock_sync_t *sync = &lock_sync[datatype];
+	struct timeval start_time;
+	bool success = true, waited = false;
 
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&sync->mutex);
 	while (1) {
 		if ((slurmctld_locks.entity[write_wait_lock(datatype)] == 0) &&
 		    (slurmctld_locks.entity[write_lock(datatype)] == 0)) {
 			slurmctld_locks.entity[read_lock(datatype)]++;
+			read_stats[datatype].lock_cnt++;
+			if (waited)
+				_record_wait(&read_stats[datatype],
+					     &start_time);
 			break;
 		} else if (!wait_lock) {
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			pthread_cond_wait(&locks_cond, &locks_mutex);
+			if (!waited) {
+				gettimeofday(&start_time, NULL);
+				waited = true;
+			}
+			pthread_cond_wait(&sync->read_cond, &sync->mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&sync->mutex);
 	return success;
 }
 
 /* _wr_rdunlock - Issue a read unlock on the specified data type */
 static void _wr_rdunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
+	lock_sync_t *sync = &lock_sync[datatype];
+
+	slurm_mutex_lock(&sync->mutex);
 	slurmctld_locks.entity[read_lock(datatype)]--;
-	pthread_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	/* Readers never wait for other readers, so only a writer
+	 * can be waiting on the last reader */
+	if ((slurmctld_locks.entity[read_lock(datatype)] == 0) &&
+	    slurmctld_locks.entity[write_wait_lock(datatype)])
+		pthread_cond_signal(&sync->write_cond);
+	slurm_mutex_unlock(&sync->mutex);
 }
 
 /* _wr_wrlock - Issue a write lock on the specified data type */
 static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 {
-	bool success = true;
+	lock_sync_t *sync = &lock_sync[datatype];
+	struct timeval start_time;
+	bool success = true, waited = false;
 
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&sync->mutex);
 	slurmctld_locks.entity[write_wait_lock(datatype)]++;
 
 	while (1) {
@@ -231,44 +291,103 @@ static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 		    (slurmctld_locks.entity[write_lock(datatype)] == 0)) {
 			slurmctld_locks.entity[write_lock(datatype)]++;
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
+			write_stats[datatype].lock_cnt++;
+			if (waited)
+				_record_wait(&write_stats[datatype],
+					     &start_time);
 			break;
 		} else if (!wait_lock) {
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
+			/* Readers may have been held off by our wait */
+			if ((slurmctld_locks.entity[write_wait_lock(datatype)]
+			     == 0) &&
+			    (slurmctld_locks.entity[write_lock(datatype)] == 0))
+				pthread_cond_broadcast(&sync->read_cond);
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			pthread_cond_wait(&locks_cond, &locks_mutex);
+			if (!waited) {
+				gettimeofday(&start_time, NULL);
+				waited = true;
+			}
+			pthread_cond_wait(&sync->write_cond, &sync->mutex);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&sync->mutex);
 	return success;
 }
 
 /* _wr_wrunlock - Issue a write unlock on the specified data type */
 static void _wr_wrunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
+	lock_sync_t *sync = &lock_sync[datatype];
+
+	slurm_mutex_lock(&sync->mutex);
 	slurmctld_locks.entity[write_lock(datatype)]--;
-	pthread_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	/* Writers have priority, readers proceed once none are waiting */
+	if (slurmctld_locks.entity[write_wait_lock(datatype)])
+		pthread_cond_signal(&sync->write_cond);
+	else
+		pthread_cond_broadcast(&sync->read_cond);
+	slurm_mutex_unlock(&sync->mutex);
 }
 
 /* get_lock_values - Get the current value of all locks
  * OUT lock_flags - a copy of the current lock values */
 void get_lock_values(slurmctld_lock_flags_t * lock_flags)
 {
+	int i;
+
 	xassert(lock_flags);
+	for (i = 0; i < ENTITY_COUNT; i++)
+		slurm_mutex_lock(&lock_sync[i].mutex);
 	memcpy((void *) lock_flags, (void *) &slurmctld_locks,
 	       sizeof(slurmctld_locks));
+	for (i = (ENTITY_COUNT - 1); i >= 0; i--)
+		slurm_mutex_unlock(&lock_sync[i].mutex);
 }
 
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads(void)
 {
+	int i;
+
 	kill_thread = 1;
-	pthread_cond_broadcast(&locks_cond);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&lock_sync[i].mutex);
+		pthread_cond_broadcast(&lock_sync[i].read_cond);
+		pthread_cond_broadcast(&lock_sync[i].write_cond);
+		slurm_mutex_unlock(&lock_sync[i].mutex);
+	}
+}
+
+/* log_lock_stats - Log lock contention statistics for each data type */
+extern void log_lock_stats(void)
+{
+	static char *entity_name[ENTITY_COUNT] = {
+		"config", "job", "node", "partition" };
+	lock_stats_t rd, wr;
+	int i;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&lock_sync[i].mutex);
+		rd = read_stats[i];
+		wr = write_stats[i];
+		slurm_mutex_unlock(&lock_sync[i].mutex);
+
+		info("Lock %s: read=%u read_waits=%u read_wait_ave=%"PRIu64
+		     " read_wait_max=%"PRIu64" write=%u write_waits=%u "
+		     "write_wait_ave=%"PRIu64" write_wait_max=%"PRIu64
+		     " (usec)", entity_name[i],
+		     rd.lock_cnt, rd.wait_cnt,
+		     rd.wait_cnt ? (rd.wait_usec / rd.wait_cnt) : 0,
+		     rd.wait_max,
+		     wr.lock_cnt, wr.wait_cnt,
+		     wr.wait_cnt ? (wr.wait_usec / wr.wait_cnt) : 0,
+		     wr.wait_max);
+	}
 }
 
 /* un/lock semaphore used for saving state of slurmctld */
@@ -75,6 +75,12 @@
  * number of writers waiting semaphore to become 0, meaning that there are no
  * writers waiting to lock the resource.
  *
+ * Each data type has its own mutex with separate conditions for waiting
+ * readers and writers. Releasing a lock wakes only those threads which can
+ * now obtain it: the next waiting writer if any, otherwise all waiting
+ * readers. Contention statistics are kept for each data type and can be
+ * logged with log_lock_stats().
+ *
  * use init_locks() to initialize the locks then
  * lock_slurmctld() and unlock_slurmctld() to get the ordering so as to
  * prevent deadlock. The arguments indicate the lock type required for
@@ -136,6 +142,9 @@ extern void init_locks ( void );
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads ( void );
 
+/* log_lock_stats - Log lock contention statistics for each data type */
+extern void log_lock_stats(void);
+
 /* lock_slurmctld - Issue the required lock requests in a well defined order */
 extern void lock_slurmctld (slurmctld_lock_t lock_levels);
 
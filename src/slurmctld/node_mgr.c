@@ -96,10 +96,11 @@ static void 	_dump_node_state (struct node_record *dump_node_ptr,
 static void 	_make_node_down(struct node_record *node_ptr,
 				time_t event_time);
 static void	_node_did_resp(struct node_record *node_ptr);
-static bool	_node_is_hidden(struct node_record *node_ptr);
+static bool	_node_is_hidden(struct node_record *node_ptr,
+				struct part_record **hidden_part);
 static int	_open_node_state_file(char **state_file);
-static void 	_pack_node (struct node_record *dump_node_ptr, Buf buffer,
-			    uint16_t protocol_version);
+static void 	_pack_node (struct node_record *dump_node_ptr, bool hidden,
+			    Buf buffer, uint16_t protocol_version);
 static void	_sync_bitmaps(struct node_record *node_ptr, int job_count);
 static void	_update_config_ptr(bitstr_t *bitmap,
 				struct config_record *config_ptr);
@@ -538,13 +539,14 @@ int list_compare_config (void *config_entry1, void *config_entry2)
 }
 
 
-static bool _node_is_hidden(struct node_record *node_ptr)
+static bool _node_is_hidden(struct node_record *node_ptr,
+			    struct part_record **hidden_part)
 {
 	int i;
 	bool shown = false;
 
 	for (i=0; i<node_ptr->part_cnt; i++) {
-		if (!(node_ptr->part_pptr[i]->flags & PART_FLAG_HIDDEN)) {
+		if (!part_is_hidden(node_ptr->part_pptr[i], hidden_part)) {
 			shown = true;
 			break;
 		}
@@ -577,6 +579,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 	Buf buffer;
 	time_t now = time(NULL);
 	struct node_record *node_ptr = node_record_table_ptr;
+	struct part_record **hidden_part;
 	bool hidden;
 
 	buffer_ptr[0] = NULL;
@@ -595,7 +598,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 		pack_time(now, buffer);
 
 		/* write node records */
-		part_filter_set(uid);
+		hidden_part = part_filter_hidden(uid);
 		for (inx = 0; inx < node_record_count; inx++, node_ptr++) {
 			xassert (node_ptr->magic == NODE_MAGIC);
 			xassert (node_ptr->config_ptr->magic ==
@@ -607,7 +610,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 			 * with it. */
 			hidden = false;
 			if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
-			    (_node_is_hidden(node_ptr)))
+			    (_node_is_hidden(node_ptr, hidden_part)))
 				hidden = true;
 			else if (IS_NODE_FUTURE(node_ptr))
 				hidden = true;
@@ -615,16 +618,10 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 				 (node_ptr->name[0] == '\0'))
 				hidden = true;
 
-			if (hidden) {
-				char *orig_name = node_ptr->name;
-				node_ptr->name = NULL;
-				_pack_node(node_ptr, buffer, protocol_version);
-				node_ptr->name = orig_name;
-			} else
-				_pack_node(node_ptr, buffer, protocol_version);
+			_pack_node(node_ptr, hidden, buffer, protocol_version);
 			nodes_packed++;
 		}
-		part_filter_clear();
+		xfree(hidden_part);
 	} else {
 		error("pack_all_node: Unsupported slurm version %u",
 		      protocol_version);
@@ -644,17 +641,21 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
  * _pack_node - dump all configuration information about a specific node in
  *	machine independent form (for network transmission)
  * IN dump_node_ptr - pointer to node for which information is requested
+ * IN hidden - pack the node with a name of NULL
  * IN/OUT buffer - buffer where data is placed, pointers automatically updated
  * IN protocol_version - slurm protocol version of client
  * NOTE: if you make any changes here be sure to make the corresponding
  *	changes to load_node_config in api/node_info.c
  * NOTE: READ lock_slurmctld config before entry
  */
-static void _pack_node (struct node_record *dump_node_ptr, Buf buffer,
-			uint16_t protocol_version)
+static void _pack_node (struct node_record *dump_node_ptr, bool hidden,
+			Buf buffer, uint16_t protocol_version)
 {
+	/* A hidden node is packed with a name of NULL */
+	char *node_name = hidden ? NULL : dump_node_ptr->name;
+
 	if(protocol_version >= SLURM_2_2_PROTOCOL_VERSION) {
-		packstr (dump_node_ptr->name, buffer);
+		packstr (node_name, buffer);
 		pack16  (dump_node_ptr->node_state, buffer);
 		if (slurmctld_conf.fast_schedule) {
 			/* Only data from config_record used for scheduling */
@@ -692,7 +693,7 @@ static void _pack_node (struct node_record *dump_node_ptr, Buf buffer,
 		packstr(dump_node_ptr->os, buffer);
 		packstr(dump_node_ptr->reason, buffer);
 	} else if(protocol_version >= SLURM_2_1_PROTOCOL_VERSION) {
-		packstr (dump_node_ptr->name, buffer);
+		packstr (node_name, buffer);
 		pack16  (dump_node_ptr->node_state, buffer);
 		if (slurmctld_conf.fast_schedule) {
 			/* Only data from config_record used for scheduling */
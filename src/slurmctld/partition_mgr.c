@@ -820,40 +820,40 @@ int list_find_part(void *part_entry, void *key)
 	return 0;
 }
 
-/* part_filter_set - Set the partition's hidden flag based upon a user's
- * group access. This must be followed by a call to part_filter_clear() */
-extern void part_filter_set(uid_t uid)
+/* part_filter_hidden - Build a NULL terminated array of the partitions
+ * which are hidden from a user, either flagged Hidden or not accessible
+ * to the user's groups. The partition records are not modified, so only a
+ * partition read lock is required. Free the array using xfree(). */
+extern struct part_record **part_filter_hidden(uid_t uid)
 {
-	struct part_record *part_ptr;
+	struct part_record *part_ptr, **hidden_part;
 	ListIterator part_iterator;
+	int i = 0;
 
+	hidden_part = xmalloc(sizeof(struct part_record *) *
+			      (list_count(part_list) + 1));
 	part_iterator = list_iterator_create(part_list);
 	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
-		if (part_ptr->flags & PART_FLAG_HIDDEN)
-			continue;
-		if (validate_group (part_ptr, uid) == 0) {
-			part_ptr->flags |= PART_FLAG_HIDDEN;
-			part_ptr->flags |= PART_FLAG_HIDDEN_CLR;
-		}
+		if ((part_ptr->flags & PART_FLAG_HIDDEN) ||
+		    (validate_group (part_ptr, uid) == 0))
+			hidden_part[i++] = part_ptr;
 	}
 	list_iterator_destroy(part_iterator);
+	return hidden_part;
 }
 
-/* part_filter_clear - Clear the partition's hidden flag based upon a user's
- * group access. This must follow a call to part_filter_set() */
-extern void part_filter_clear(void)
+/* part_is_hidden - Test if a partition is in an array built by
+ * part_filter_hidden() */
+extern bool part_is_hidden(struct part_record *part_ptr,
+			   struct part_record **hidden_part)
 {
-	struct part_record *part_ptr;
-	ListIterator part_iterator;
+	int i;
 
-	part_iterator = list_iterator_create(part_list);
-	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
-		if (part_ptr->flags & PART_FLAG_HIDDEN_CLR) {
-			part_ptr->flags &= (~PART_FLAG_HIDDEN);
-			part_ptr->flags &= (~PART_FLAG_HIDDEN_CLR);
-		}
+	for (i = 0; hidden_part[i]; i++) {
+		if (hidden_part[i] == part_ptr)
+			return true;
 	}
-	list_iterator_destroy(part_iterator);
+	return false;
 }
 
 /*
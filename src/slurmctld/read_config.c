@@ -95,6 +95,7 @@ static int  _build_bitmaps(void);
 static void _build_bitmaps_pre_select(void);
 static void _gres_reconfig(bool reconfig);
 static int  _init_all_slurm_conf(void);
+static void _phase_time(struct timeval *phase_tv, char *phase, bool reconfig);
 static int  _preserve_select_type_param(slurm_ctl_conf_t * ctl_conf_ptr,
 					uint16_t old_select_type_p);
 static int  _preserve_plugins(slurm_ctl_conf_t * ctl_conf_ptr,
@@ -610,6 +611,23 @@ static void _sync_part_prio(void)
 	}
 }
 
+/* Log the time spent in one phase of read_slurm_conf() and restart the
+ * phase timer. Phases are logged at info level on startup, when they
+ * include state recovery, and at debug level on reconfiguration. */
+static void _phase_time(struct timeval *phase_tv, char *phase, bool reconfig)
+{
+	struct timeval now;
+	long delta;
+
+	gettimeofday(&now, NULL);
+	delta = diff_tv(phase_tv, &now);
+	if (reconfig)
+		debug("read_slurm_conf: %s took %ld usec", phase, delta);
+	else
+		info("read_slurm_conf: %s took %ld usec", phase, delta);
+	*phase_tv = now;
+}
+
 /*
  * read_slurm_conf - load the slurm configuration from the configured file.
  * read_slurm_conf can be called more than once if so desired.
@@ -628,6 +646,7 @@ static void _sync_part_prio(void)
 int read_slurm_conf(int recover, bool reconfig)
 {
 	DEF_TIMERS;
+	struct timeval phase_tv;
 	int error_code, i, rc, load_job_ret = SLURM_SUCCESS;
 	int old_node_record_count = 0;
 	struct node_record *old_node_table_ptr = NULL, *node_ptr;
@@ -647,6 +666,7 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	/* initialization */
 	START_TIMER;
+	phase_tv = tv1;
 
 	if (reconfig) {
 		/* in order to re-use job state information,
@@ -712,6 +732,7 @@ int read_slurm_conf(int recover, bool reconfig)
 	rehash_node();
 	rehash_jobs();
 	set_slurmd_addr();
+	_phase_time(&phase_tv, "node and partition configuration", reconfig);
 
 	if (reconfig) {		/* Preserve state from memory */
 		if (old_node_table_ptr) {
@@ -743,6 +764,7 @@ int read_slurm_conf(int recover, bool reconfig)
 		(void) load_all_part_state();
 		load_job_ret = load_all_job_state();
 	}
+	_phase_time(&phase_tv, "state recovery", reconfig);
 
 	_sync_part_prio();
 	_build_bitmaps_pre_select();
@@ -757,9 +779,11 @@ int read_slurm_conf(int recover, bool reconfig)
 	xfree(state_save_dir);
 	_gres_reconfig(reconfig);
 	reset_job_bitmaps();		/* must follow select_g_job_init() */
+	_phase_time(&phase_tv, "node selection and job bitmaps", reconfig);
 
 	(void) _sync_nodes_to_jobs();
 	(void) sync_job_files();
+	_phase_time(&phase_tv, "job node and file sync", reconfig);
 	_purge_old_node_state(old_node_table_ptr, old_node_record_count);
 	_purge_old_part_state(old_part_list, old_def_part_name);
 
@@ -781,6 +805,7 @@ int read_slurm_conf(int recover, bool reconfig)
 #endif
 	(void) _sync_nodes_to_comp_job();/* must follow select_g_node_init() */
 	load_part_uid_allow_list(1);
+	_phase_time(&phase_tv, "bitmaps, features and dependencies", reconfig);
 
 	if (reconfig) {
 		load_all_resv_state(0);
@@ -792,6 +817,8 @@ int read_slurm_conf(int recover, bool reconfig)
 		}
 	}
 
+	_phase_time(&phase_tv, "reservation and trigger recovery", reconfig);
+
 	/* sort config_list by weight for scheduling */
 	list_sort(config_list, &list_compare_config);
 
@@ -1505,6 +1532,15 @@ static int _restore_job_dependencies(void)
 
 	assoc_mgr_clear_used_info();
 	job_iterator = list_iterator_create(job_list);
+
+	/* The jobs which depend upon each job are recorded again below as
+	 * each job's dependencies are rebuilt */
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		xfree(job_ptr->dependent_ids);
+		job_ptr->dependent_cnt = 0;
+	}
+	list_iterator_reset(job_iterator);
+
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		(void) build_feature_list(job_ptr);
 
@@ -2312,10 +2312,8 @@ static int  _resize_resv(slurmctld_resv_t *resv_ptr, uint32_t node_cnt)
 				FREE_NULL_BITMAP(tmp2_bitmap);
 				delta_node_cnt = 0;	/* ALL DONE */
 			} else if (i) {
-				bit_not(idle_node_bitmap);
-				bit_and(resv_ptr->node_bitmap,
-					idle_node_bitmap);
-				bit_not(idle_node_bitmap);
+				bit_and_not(resv_ptr->node_bitmap,
+					    idle_node_bitmap);
 				resv_ptr->node_cnt = bit_set_count(
 						resv_ptr->node_bitmap);
 				delta_node_cnt = resv_ptr->node_cnt -
@@ -2391,9 +2389,7 @@ static int  _select_nodes(resv_desc_msg_t *resv_desc_ptr,
 			    (resv_ptr->start_time >= resv_desc_ptr->end_time) ||
 			    (resv_ptr->end_time   <= resv_desc_ptr->start_time))
 				continue;
-			bit_not(resv_ptr->node_bitmap);
-			bit_and(node_bitmap, resv_ptr->node_bitmap);
-			bit_not(resv_ptr->node_bitmap);
+			bit_and_not(node_bitmap, resv_ptr->node_bitmap);
 		}
 		list_iterator_destroy(iter);
 	}
@@ -2520,9 +2516,7 @@ static bitstr_t *_pick_idle_nodes(bitstr_t *avail_nodes,
 		if (!IS_JOB_RUNNING(job_ptr) ||
 		    (job_ptr->end_time < resv_desc_ptr->start_time))
 			continue;
-		bit_not(job_ptr->node_bitmap);
-		bit_and(avail_nodes, job_ptr->node_bitmap);
-		bit_not(job_ptr->node_bitmap);
+		bit_and_not(avail_nodes, job_ptr->node_bitmap);
 	}
 	list_iterator_destroy(job_iterator);
 
@@ -2551,9 +2545,7 @@ static bitstr_t *_pick_idle_nodes2(bitstr_t *avail_nodes,
 		tmp_bitmap = bit_copy(avail_nodes);
 		if (tmp_bitmap == NULL)
 			fatal("malloc failure");
-		bit_not(job_ptr->node_bitmap);
-		bit_and(avail_nodes, job_ptr->node_bitmap);
-		bit_not(job_ptr->node_bitmap);
+		bit_and_not(avail_nodes, job_ptr->node_bitmap);
 		if (bit_set_count(avail_nodes) < resv_desc_ptr->node_cnt) {
 			/* Removed too many nodes, put them back */
 			bit_or(avail_nodes, tmp_bitmap);
@@ -2865,9 +2857,7 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 			    (res2_ptr->start_time >= job_end_time) ||
 			    (res2_ptr->end_time   <= job_start_time))
 				continue;
-			bit_not(res2_ptr->node_bitmap);
-			bit_and(*node_bitmap, res2_ptr->node_bitmap);
-			bit_not(res2_ptr->node_bitmap);
+			bit_and_not(*node_bitmap, res2_ptr->node_bitmap);
 			overlap_resv = true;
 		}
 		list_iterator_destroy(iter);
@@ -2915,9 +2905,7 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 				    (lic_resv_time > resv_ptr->end_time))
 					lic_resv_time = resv_ptr->end_time;
 			}
-			bit_not(resv_ptr->node_bitmap);
-			bit_and(*node_bitmap, resv_ptr->node_bitmap);
-			bit_not(resv_ptr->node_bitmap);
+			bit_and_not(*node_bitmap, resv_ptr->node_bitmap);
 		}
 		list_iterator_destroy(iter);
 
@@ -0,0 +1,406 @@
+/*****************************************************************************\
+ *  rpc_queue.c - queue of received RPCs and the threads that process them
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#ifdef WITH_PTHREADS
+#  include <pthread.h>
+#endif
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/xmalloc.h"
+
+#include "src/slurmctld/proc_req.h"
+#include "src/slurmctld/rpc_queue.h"
+#include "src/slurmctld/slurmctld.h"
+
+typedef struct rpc_queue_rec {
+	slurm_fd_t	fd;
+	Buf		buffer;
+	uint16_t	msg_type;	/* as queued, zero if unknown */
+	int		rpc_class;
+	struct timeval	queue_time;
+} rpc_queue_rec_t;
+
+typedef struct rpc_stats {
+	uint16_t	msg_type;
+	uint32_t	queued;		/* currently waiting for a thread */
+	uint32_t	queued_max;
+	uint32_t	count;		/* RPCs processed */
+	uint64_t	wait_usec;	/* total time queued */
+	uint64_t	wait_max;
+	uint64_t	run_usec;	/* total processing time */
+	uint64_t	run_max;
+} rpc_stats_t;
+
+/* RPCs are queued by class and the workers take them from each class in
+ * turn. A class which already has its share of the threads busy
+ * (rpc_thread_cnt / RPC_CLASS_CNT) is passed over while a class below its
+ * share has RPCs waiting, so a storm of one kind (e.g. squeue) can not
+ * hold every thread and the slurmd messages that free resources and the
+ * job submissions still get through. With no other work waiting any class
+ * may use every thread.
+ * Within a class RPCs go first in, first out. */
+enum {
+	RPC_CLASS_SLURMD,	/* from slurmd/slurmstepd, and pings */
+	RPC_CLASS_QUERY,	/* read only information requests */
+	RPC_CLASS_OTHER,	/* job submission, updates, unknown type */
+	RPC_CLASS_CNT
+};
+
+static char *rpc_class_name[RPC_CLASS_CNT] = { "slurmd", "query", "other" };
+
+static List		rpc_queue[RPC_CLASS_CNT];
+static int		rpc_queue_next = 0;	/* class to serve next */
+static int		rpc_class_busy[RPC_CLASS_CNT]; /* threads serving */
+static pthread_mutex_t	rpc_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	rpc_queue_cond = PTHREAD_COND_INITIALIZER;
+static bool		rpc_queue_shutdown = false;
+static pthread_t *	rpc_thread_id = NULL;
+static int		rpc_thread_cnt = 0;
+
+/* Statistics are few entries (one per RPC type seen), so a simple
+ * array searched linearly is fine */
+static pthread_mutex_t	rpc_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static rpc_stats_t *	rpc_stats = NULL;
+static int		rpc_stats_cnt = 0;
+static int		rpc_stats_size = 0;
+
+static rpc_queue_rec_t *_dequeue(void);
+static int   _rpc_class(uint16_t msg_type);
+static void *_rpc_worker(void *no_data);
+static void  _service_rpc(rpc_queue_rec_t *rpc_ptr);
+static rpc_stats_t *_stats_find(uint16_t msg_type);
+
+/* Return the statistics record for the given RPC type, create one as
+ * needed. Call with rpc_stats_lock set. */
+static rpc_stats_t *_stats_find(uint16_t msg_type)
+{
+	int i;
+
+	for (i = 0; i < rpc_stats_cnt; i++) {
+		if (rpc_stats[i].msg_type == msg_type)
+			return &rpc_stats[i];
+	}
+	if (rpc_stats_cnt >= rpc_stats_size) {
+		rpc_stats_size += 32;
+		xrealloc(rpc_stats, sizeof(rpc_stats_t) * rpc_stats_size);
+	}
+	memset(&rpc_stats[rpc_stats_cnt], 0, sizeof(rpc_stats_t));
+	rpc_stats[rpc_stats_cnt].msg_type = msg_type;
+	return &rpc_stats[rpc_stats_cnt++];
+}
+
+/* Return the queue class of an RPC type */
+static int _rpc_class(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case MESSAGE_EPILOG_COMPLETE:
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+	case REQUEST_STEP_COMPLETE:
+	case REQUEST_CHECKPOINT_COMP:
+	case REQUEST_CHECKPOINT_TASK_COMP:
+	case REQUEST_PING:
+	case ACCOUNTING_UPDATE_MSG:
+	case ACCOUNTING_FIRST_REG:
+		return RPC_CLASS_SLURMD;
+	case REQUEST_BUILD_INFO:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_SINGLE:
+	case REQUEST_SHARE_INFO:
+	case REQUEST_PRIORITY_FACTORS:
+	case REQUEST_JOB_END_TIME:
+	case REQUEST_NODE_INFO:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_JOB_ALLOCATION_INFO:
+	case REQUEST_JOB_ALLOCATION_INFO_LITE:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_BLOCK_INFO:
+	case REQUEST_TRIGGER_GET:
+	case REQUEST_TOPO_INFO:
+		return RPC_CLASS_QUERY;
+	default:
+		return RPC_CLASS_OTHER;
+	}
+}
+
+/* Take the next RPC, serving the classes in turn and skipping empty ones.
+ * Classes at their share of busy threads are skipped in the first pass,
+ * the second pass takes from any class so no thread idles while RPCs wait.
+ * Call with rpc_queue_lock set. RET NULL if all are empty */
+static rpc_queue_rec_t *_dequeue(void)
+{
+	rpc_queue_rec_t *rpc_ptr;
+	int i, inx, pass;
+	int share = MAX(rpc_thread_cnt / RPC_CLASS_CNT, 1);
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < RPC_CLASS_CNT; i++) {
+			inx = (rpc_queue_next + i) % RPC_CLASS_CNT;
+			if ((pass == 0) && (rpc_class_busy[inx] >= share))
+				continue;
+			if ((rpc_ptr = list_dequeue(rpc_queue[inx]))) {
+				rpc_queue_next = (inx + 1) % RPC_CLASS_CNT;
+				rpc_class_busy[inx]++;
+				return rpc_ptr;
+			}
+		}
+	}
+	return NULL;
+}
+
+static void _free_server_count(void)
+{
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	if (slurmctld_config.server_thread_count > 0)
+		slurmctld_config.server_thread_count--;
+	else
+		error("slurmctld_config.server_thread_count underflow");
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+}
+
+/* Start thread_cnt threads to process queued RPCs */
+extern void rpc_queue_init(int thread_cnt)
+{
+	pthread_attr_t thread_attr;
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_lock);
+	for (i = 0; i < RPC_CLASS_CNT; i++) {
+		if (rpc_queue[i] == NULL)
+			rpc_queue[i] = list_create(NULL);
+	}
+	rpc_queue_shutdown = false;
+	rpc_thread_cnt = MAX(thread_cnt, 1);
+	rpc_thread_id = xmalloc(sizeof(pthread_t) * rpc_thread_cnt);
+	slurm_mutex_unlock(&rpc_queue_lock);
+
+	for (i = 0; i < rpc_thread_cnt; i++) {
+		slurm_attr_init(&thread_attr);
+		while (pthread_create(&rpc_thread_id[i], &thread_attr,
+				      _rpc_worker, NULL)) {
+			error("pthread_create: %m");
+			sleep(1);
+		}
+		slurm_attr_destroy(&thread_attr);
+	}
+	debug2("rpc_queue: started %d threads", rpc_thread_cnt);
+}
+
+/* Process any RPCs still queued, then terminate the worker threads */
+extern void rpc_queue_fini(void)
+{
+	int i;
+
+	slurm_mutex_lock(&rpc_queue_lock);
+	rpc_queue_shutdown = true;
+	pthread_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_lock);
+
+	for (i = 0; i < rpc_thread_cnt; i++)
+		pthread_join(rpc_thread_id[i], NULL);
+
+	slurm_mutex_lock(&rpc_queue_lock);
+	xfree(rpc_thread_id);
+	rpc_thread_cnt = 0;
+	for (i = 0; i < RPC_CLASS_CNT; i++) {
+		if (rpc_queue[i]) {
+			list_destroy(rpc_queue[i]);
+			rpc_queue[i] = NULL;
+		}
+	}
+	slurm_mutex_unlock(&rpc_queue_lock);
+}
+
+/*
+ * Queue a connection for processing by a worker thread. The connection
+ * is counted in slurmctld_config.server_thread_count until it is closed.
+ * IN fd - accepted connection, closed once the RPC has been processed
+ * IN buffer - complete message read from fd, or NULL to have the worker
+ *	read the message itself
+ * IN msg_type - message type from the header of buffer, zero if unknown
+ */
+extern void rpc_queue_add(slurm_fd_t fd, Buf buffer, uint16_t msg_type)
+{
+	rpc_queue_rec_t *rpc_ptr;
+	rpc_stats_t *stats_ptr;
+
+	rpc_ptr = xmalloc(sizeof(rpc_queue_rec_t));
+	rpc_ptr->fd = fd;
+	rpc_ptr->buffer = buffer;
+	rpc_ptr->msg_type = msg_type;
+	rpc_ptr->rpc_class = _rpc_class(msg_type);
+	gettimeofday(&rpc_ptr->queue_time, NULL);
+
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	slurmctld_config.server_thread_count++;
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+	slurm_mutex_lock(&rpc_stats_lock);
+	stats_ptr = _stats_find(msg_type);
+	stats_ptr->queued++;
+	stats_ptr->queued_max = MAX(stats_ptr->queued, stats_ptr->queued_max);
+	slurm_mutex_unlock(&rpc_stats_lock);
+
+	slurm_mutex_lock(&rpc_queue_lock);
+	list_enqueue(rpc_queue[rpc_ptr->rpc_class], rpc_ptr);
+	pthread_cond_signal(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_lock);
+}
+
+static void *_rpc_worker(void *no_data)
+{
+	rpc_queue_rec_t *rpc_ptr;
+	int rpc_class;
+
+	while (1) {
+		slurm_mutex_lock(&rpc_queue_lock);
+		while (((rpc_ptr = _dequeue()) == NULL) &&
+		       !rpc_queue_shutdown) {
+			pthread_cond_wait(&rpc_queue_cond, &rpc_queue_lock);
+		}
+		slurm_mutex_unlock(&rpc_queue_lock);
+		if (rpc_ptr == NULL)	/* shutdown and queue is empty */
+			break;
+		rpc_class = rpc_ptr->rpc_class;
+		_service_rpc(rpc_ptr);	/* frees rpc_ptr */
+		slurm_mutex_lock(&rpc_queue_lock);
+		rpc_class_busy[rpc_class]--;
+		slurm_mutex_unlock(&rpc_queue_lock);
+	}
+	return NULL;
+}
+
+/* Unpack and process one queued RPC, then close its connection */
+static void _service_rpc(rpc_queue_rec_t *rpc_ptr)
+{
+	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
+	rpc_stats_t *stats_ptr;
+	struct timeval start_time, end_time;
+	long wait_usec, run_usec;
+	int rc;
+
+	gettimeofday(&start_time, NULL);
+	wait_usec = diff_tv(&rpc_ptr->queue_time, &start_time);
+
+	slurm_msg_t_init(msg);
+	if (rpc_ptr->buffer)
+		rc = slurm_unpack_received_msg(msg, rpc_ptr->fd,
+					       rpc_ptr->buffer);
+	else
+		rc = slurm_receive_msg(rpc_ptr->fd, msg, 0);
+
+	if (rc != 0)
+		error("slurm_receive_msg: %m");
+	else
+		slurmctld_req(msg);
+	if ((rpc_ptr->fd >= 0) &&
+	    (slurm_close_accepted_conn(rpc_ptr->fd) < 0))
+		error("close(%d): %m", rpc_ptr->fd);
+
+	gettimeofday(&end_time, NULL);
+	run_usec = diff_tv(&start_time, &end_time);
+
+	slurm_mutex_lock(&rpc_stats_lock);
+	stats_ptr = _stats_find(rpc_ptr->msg_type);
+	if (stats_ptr->queued)
+		stats_ptr->queued--;
+	if (rc == 0)
+		stats_ptr = _stats_find(msg->msg_type);
+	stats_ptr->count++;
+	stats_ptr->wait_usec += wait_usec;
+	stats_ptr->wait_max = MAX(stats_ptr->wait_max, wait_usec);
+	stats_ptr->run_usec += run_usec;
+	stats_ptr->run_max = MAX(stats_ptr->run_max, run_usec);
+	slurm_mutex_unlock(&rpc_stats_lock);
+
+	slurm_free_msg(msg);
+	xfree(rpc_ptr);
+	_free_server_count();
+}
+
+/* Log queue depth, queue latency and processing time by RPC type */
+extern void rpc_queue_log_stats(void)
+{
+	rpc_stats_t *stats_ptr;
+	int i, queue_len[RPC_CLASS_CNT], busy[RPC_CLASS_CNT];
+
+	slurm_mutex_lock(&rpc_queue_lock);
+	for (i = 0; i < RPC_CLASS_CNT; i++) {
+		queue_len[i] = rpc_queue[i] ? list_count(rpc_queue[i]) : 0;
+		busy[i] = rpc_class_busy[i];
+	}
+	slurm_mutex_unlock(&rpc_queue_lock);
+	info("RPC queue: %s=%d/%d %s=%d/%d %s=%d/%d (queued/busy) threads=%d",
+	     rpc_class_name[RPC_CLASS_SLURMD], queue_len[RPC_CLASS_SLURMD],
+	     busy[RPC_CLASS_SLURMD],
+	     rpc_class_name[RPC_CLASS_QUERY], queue_len[RPC_CLASS_QUERY],
+	     busy[RPC_CLASS_QUERY],
+	     rpc_class_name[RPC_CLASS_OTHER], queue_len[RPC_CLASS_OTHER],
+	     busy[RPC_CLASS_OTHER], rpc_thread_cnt);
+
+	slurm_mutex_lock(&rpc_stats_lock);
+	for (i = 0; i < rpc_stats_cnt; i++) {
+		stats_ptr = &rpc_stats[i];
+		if ((stats_ptr->count == 0) && (stats_ptr->queued == 0))
+			continue;
+		info("RPC type=%u count=%u queued=%u queued_max=%u "
+		     "ave_wait=%"PRIu64" max_wait=%"PRIu64" "
+		     "ave_run=%"PRIu64" max_run=%"PRIu64" (usec)",
+		     stats_ptr->msg_type, stats_ptr->count,
+		     stats_ptr->queued, stats_ptr->queued_max,
+		     stats_ptr->count ?
+		     (stats_ptr->wait_usec / stats_ptr->count) : 0,
+		     stats_ptr->wait_max,
+		     stats_ptr->count ?
+		     (stats_ptr->run_usec / stats_ptr->count) : 0,
+		     stats_ptr->run_max);
+	}
+	slurm_mutex_unlock(&rpc_stats_lock);
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************\
+ *  rpc_queue.h - queue of received RPCs and the threads that process them
+ *****************************************************************************
+ *  Copyright (C) 2011 Lawrence Livermore National Security.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  CODE-OCEC-09-009. All rights reserved.
+ *
+ *  This file is part of SLURM, a resource management program.
+ *  For details, see <https://computing.llnl.gov/linux/slurm/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  SLURM is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  SLURM is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with SLURM; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_RPC_QUEUE_H
+#define _HAVE_RPC_QUEUE_H
+
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_api.h"
+
+/* Start thread_cnt threads to process queued RPCs */
+extern void rpc_queue_init(int thread_cnt);
+
+/* Process any RPCs still queued, then terminate the worker threads */
+extern void rpc_queue_fini(void);
+
+/*
+ * Queue a connection for processing by a worker thread. The connection
+ * is counted in slurmctld_config.server_thread_count until it is closed.
+ * IN fd - accepted connection, closed once the RPC has been processed
+ * IN buffer - complete message read from fd, or NULL to have the worker
+ *	read the message itself
+ * IN msg_type - message type from the header of buffer, zero if unknown
+ */
+extern void rpc_queue_add(slurm_fd_t fd, Buf buffer, uint16_t msg_type);
+
+/* Log queue depth, queue latency and processing time by RPC type */
+extern void rpc_queue_log_stats(void);
+
+#endif	/* !_HAVE_RPC_QUEUE_H */
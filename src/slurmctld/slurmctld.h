@@ -92,6 +92,19 @@
 #define MAX_SERVER_THREADS 256
 #endif
 
+/* Number of threads which process RPCs once their message has been read.
+ * Connections are read by the RPC manager thread and queued for these
+ * workers, so this bounds concurrent RPC processing, not connections. */
+#ifndef RPC_THREAD_COUNT
+#define RPC_THREAD_COUNT 64
+#endif
+
+/* Maximum number of RPC connections being read, queued or processed at
+ * one time. Further connections wait in the listen queue. */
+#ifndef MAX_RPC_CONNS
+#define MAX_RPC_CONNS 2048
+#endif
+
 /* Perform full slurmctld's state every PERIODIC_CHECKPOINT seconds */
 #ifndef PERIODIC_CHECKPOINT
 #define	PERIODIC_CHECKPOINT	300
@@ -235,6 +248,11 @@ struct part_record {
 	char *nodes;		/* comma delimited list names of nodes */
 	double   norm_priority;	/* normalized scheduling priority for
 				 * jobs (DON'T PACK) */
+	uint32_t pend_cnt;	/* count of pending jobs able to start now
+				 * and without a reservation, maintained
+				 * by _top_priority() in job_mgr.c under
+				 * its top_prio_lock */
+	uint32_t pend_max_prio;	/* highest priority of those jobs */
 	uint16_t preempt_mode;	/* See PREEMPT_MODE_* in slurm/slurm.h */
 	uint16_t priority;	/* scheduling priority for jobs */
 	uint16_t state_up;	/* See PARTITION_* states in slurm.h */
@@ -323,6 +341,9 @@ struct job_details {
 	uint16_t cpus_per_task;		/* number of processors required for
 					 * each task */
 	List depend_list;		/* list of job_ptr:state pairs */
+	time_t depend_wait;		/* time dependencies last found
+					 * unsatisfied, cleared when a job
+					 * in depend_list changes state */
 	char *dependency;		/* wait for other jobs */
 	uint16_t env_cnt;		/* size of env_sup (see below) */
 	char **env_sup;			/* supplemental environment variables
@@ -409,6 +430,10 @@ struct job_record {
                                          * 1 if cr is enabled */
 	uint32_t db_index;              /* used only for database
 					 * plugins */
+	uint32_t depend_scan;		/* circular dependency scan sequence */
+	uint32_t dependent_cnt;		/* count of dependent_ids */
+	uint32_t *dependent_ids;	/* jobs which depend upon this job,
+					 * may include stale job IDs */
 	uint32_t derived_ec;		/* highest exit code of all job steps */
 	struct job_details *details;	/* job details */
 	uint16_t direct_set_prio;	/* Priority set directly if
@@ -694,6 +719,11 @@ extern int drain_nodes ( char *nodes, char *reason, uint32_t reason_uid );
  * RET 0 or error code */
 extern int dump_all_job_state ( void );
 
+/* dump_job_state_changes - append the state of jobs changed since the last
+ *	save to the job state journal, or save all jobs once it grows large
+ * RET 0 or error code */
+extern int dump_job_state_changes ( void );
+
 /* dump_all_node_state - save the state of all nodes to file */
 extern int dump_all_node_state ( void );
 
@@ -884,6 +914,10 @@ extern int job_checkpoint(checkpoint_msg_t *ckpt_ptr, uid_t uid,
 /* log the completion of the specified job */
 extern void job_completion_logger(struct job_record  *job_ptr, bool requeue);
 
+/* Have the next job submission rebuild its summary of pending job
+ * priorities, see job_mgr.c */
+extern void job_top_prio_invalidate(void);
+
 /*
  * job_epilog_complete - Note the completion of the epilog script for a
  *	given job
@@ -1370,13 +1404,16 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 			uint32_t job_id, uint16_t show_flags, uid_t uid,
 			uint16_t protocol_version);
 
-/* part_filter_clear - Clear the partition's hidden flag based upon a user's
- * group access. This must follow a call to part_filter_set() */
-extern void part_filter_clear(void);
+/* part_filter_hidden - Build a NULL terminated array of the partitions
+ * which are hidden from a user, either flagged Hidden or not accessible
+ * to the user's groups. The partition records are not modified, so only a
+ * partition read lock is required. Free the array using xfree(). */
+extern struct part_record **part_filter_hidden(uid_t uid);
 
-/* part_filter_set - Set the partition's hidden flag based upon a user's
- * group access. This must be followed by a call to part_filter_clear() */
-extern void part_filter_set(uid_t uid);
+/* part_is_hidden - Test if a partition is in an array built by
+ * part_filter_hidden() */
+extern bool part_is_hidden(struct part_record *part_ptr,
+			   struct part_record **hidden_part);
 
 /* part_fini - free all memory associated with partition records */
 extern void part_fini (void);
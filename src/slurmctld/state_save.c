@@ -155,7 +155,7 @@ extern void *slurmctld_state_save(void *no_data)
 {
 	time_t last_save = 0, now;
 	double save_delay;
-	bool run_save;
+	bool run_save, shutdown;
 	int save_count;
 
 	while (1) {
@@ -186,16 +186,20 @@ extern void *slurmctld_state_save(void *no_data)
 			}
 		}
 
-		/* save job info if necessary */
+		/* save job info if necessary, write a full job state
+		 * file rather than a journal block on shutdown */
 		run_save = false;
 		/* slurm_mutex_lock(&state_save_lock); done above */
 		if (save_jobs) {
 			run_save = true;
 			save_jobs = 0;
 		}
+		shutdown = !run_save_thread;
 		slurm_mutex_unlock(&state_save_lock);
-		if (run_save)
+		if (run_save && shutdown)
 			(void)dump_all_job_state();
+		else if (run_save)
+			(void)dump_job_state_changes();
 
 		/* save node info if necessary */
 		run_save = false;
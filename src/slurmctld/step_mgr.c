@@ -1966,13 +1966,14 @@ extern int pack_ctld_job_step_info_response_msg(
 	uint32_t steps_packed = 0, tmp_offset;
 	struct step_record *step_ptr;
 	struct job_record *job_ptr;
+	struct part_record **hidden_part;
 	time_t now = time(NULL);
 	int valid_job = 0;
 
 	pack_time(now, buffer);
 	pack32(steps_packed, buffer);	/* steps_packed placeholder */
 
-	part_filter_set(uid);
+	hidden_part = part_filter_hidden(uid);
 
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = list_next(job_iterator))) {
@@ -1981,7 +1982,7 @@ extern int pack_ctld_job_step_info_response_msg(
 
 		if (((show_flags & SHOW_ALL) == 0)
 		    && (job_ptr->part_ptr)
-		    && (job_ptr->part_ptr->flags & PART_FLAG_HIDDEN))
+		    && part_is_hidden(job_ptr->part_ptr, hidden_part))
 			continue;
 
 		if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
@@ -2008,7 +2009,7 @@ extern int pack_ctld_job_step_info_response_msg(
 	if (list_count(job_list) && !valid_job && !steps_packed)
 		error_code = ESLURM_INVALID_JOB_ID;
 
-	part_filter_clear();
+	xfree(hidden_part);
 
 	/* put the real record count in the message body header */
 	tmp_offset = get_buf_offset(buffer);
@@ -49,6 +49,21 @@
 #include "src/slurmdbd/proc_req.h"
 #include "src/slurmctld/slurmctld.h"
 
+/* Most jobs sent in one DBD_GOT_JOBS_CHUNK message */
+#define JOBS_CHUNK_SIZE 1000
+
+/* Records of a DBD_SEND_MULT_MSG, some held to be stored together */
+typedef struct {
+	Buf *req_buf;			/* each record of the message */
+	Buf *ret_buf;			/* response to each record */
+	List job_start_list;		/* dbd_job_start_msg_t held */
+	int *job_start_inx;		/* their records */
+	List step_start_list;		/* dbd_step_start_msg_t held */
+	int *step_start_inx;		/* their records */
+	List step_comp_list;		/* dbd_step_comp_msg_t held */
+	int *step_comp_inx;		/* their records */
+} mult_msg_t;
+
 /* Local functions */
 static int   _add_accounts(slurmdbd_conn_t *slurmdbd_conn,
 			   Buf in_buffer, Buf *out_buffer, uint32_t *uid);
@@ -86,6 +101,9 @@ static int   _get_jobs(slurmdbd_conn_t *slurmdbd_conn,
 		       Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
+static int   _get_jobs_chunks(slurmdbd_conn_t *slurmdbd_conn,
+			      Buf in_buffer, Buf *out_buffer, uint32_t *uid);
+static int   _send_jobs_chunk(List job_list, void *arg);
 static int   _get_probs(slurmdbd_conn_t *slurmdbd_conn,
 			Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _get_qos(slurmdbd_conn_t *slurmdbd_conn,
@@ -128,12 +146,25 @@ static int   _modify_wckeys(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _modify_reservation(slurmdbd_conn_t *slurmdbd_conn,
 				 Buf in_buffer, Buf *out_buffer, uint32_t *uid);
+static int   _mult_job_start_flush(slurmdbd_conn_t *slurmdbd_conn,
+				   mult_msg_t *mult, int *fail_inx);
+static int   _mult_step_add(slurmdbd_conn_t *slurmdbd_conn, mult_msg_t *mult,
+			    int inx, uint16_t msg_type, void *step_msg,
+			    uint32_t *uid, int *fail_inx);
+static int   _mult_step_flush(slurmdbd_conn_t *slurmdbd_conn,
+			      mult_msg_t *mult, uint32_t *uid, int *fail_inx);
+static int   _mult_step_store(slurmdbd_conn_t *slurmdbd_conn,
+			      mult_msg_t *mult, List step_list, int *inx,
+			      uint16_t msg_type, uint32_t *uid,
+			      int *fail_inx);
 static int   _node_state(slurmdbd_conn_t *slurmdbd_conn,
 			 Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static char *_node_state_string(uint16_t node_state);
 static void  _process_job_start(slurmdbd_conn_t *slurmdbd_conn,
 				dbd_job_start_msg_t *job_start_msg,
 				dbd_id_rc_msg_t *id_rc_msg);
+static void  _process_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
+				     List job_start_list, List id_rc_list);
 static int   _register_ctld(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _remove_accounts(slurmdbd_conn_t *slurmdbd_conn,
@@ -161,10 +192,27 @@ static int   _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer,
 			    uint32_t *uid);
+static void  _setup_job_start(dbd_job_start_msg_t *job_start_msg,
+			      struct job_record *job,
+			      struct job_details *details);
+static void  _setup_step_complete(dbd_step_comp_msg_t *step_comp_msg,
+				  struct step_record *step,
+				  struct job_record *job,
+				  struct job_details *details);
+static void  _setup_step_start(dbd_step_start_msg_t *step_start_msg,
+			       struct step_record *step,
+			       struct job_record *job,
+			       struct job_details *details,
+			       slurm_step_layout_t *layout);
 static int   _step_complete(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid);
 static int   _step_start(slurmdbd_conn_t *slurmdbd_conn,
 			 Buf in_buffer, Buf *out_buffer, uint32_t *uid);
+static uint16_t _unpack_mult_msg_type(Buf req_buf);
+static dbd_job_start_msg_t *_unpack_mult_job_start(
+	slurmdbd_conn_t *slurmdbd_conn, Buf req_buf);
+static void *_unpack_mult_step(slurmdbd_conn_t *slurmdbd_conn,
+			       Buf req_buf, uint16_t msg_type);
 
 /* Process an incoming RPC
  * slurmdbd_conn IN/OUT - in will that the newsockfd set before
@@ -275,6 +323,10 @@ proc_req(slurmdbd_conn_t *slurmdbd_conn,
 			rc = _get_jobs_cond(slurmdbd_conn,
 					    in_buffer, out_buffer, uid);
 			break;
+		case DBD_GET_JOBS_CHUNKS:
+			rc = _get_jobs_chunks(slurmdbd_conn,
+					      in_buffer, out_buffer, uid);
+			break;
 		case DBD_GET_PROBS:
 			rc = _get_probs(slurmdbd_conn,
 					in_buffer, out_buffer, uid);
@@ -1333,6 +1385,64 @@ static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn,
 	return rc;
 }
 
+/* Send the jobs to the client as soon as we have them instead of
+ * building the whole list first.  The last message is the DBD_RC
+ * in out_buffer. */
+static int _get_jobs_chunks(slurmdbd_conn_t *slurmdbd_conn,
+			    Buf in_buffer, Buf *out_buffer, uint32_t *uid)
+{
+	dbd_cond_msg_t *cond_msg = NULL;
+	char *comment = NULL;
+	int rc = SLURM_SUCCESS;
+
+	debug2("DBD_GET_JOBS_CHUNKS: called");
+	if (slurmdbd_unpack_cond_msg(&cond_msg, slurmdbd_conn->rpc_version,
+				     DBD_GET_JOBS_CHUNKS, in_buffer) !=
+	    SLURM_SUCCESS) {
+		comment = "Failed to unpack DBD_GET_JOBS_CHUNKS message";
+		error("CONN:%u %s", slurmdbd_conn->newsockfd, comment);
+		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+					      SLURM_ERROR, comment,
+					      DBD_GET_JOBS_CHUNKS);
+		return SLURM_ERROR;
+	}
+
+	rc = jobacct_storage_g_get_jobs_cond_chunks(
+		slurmdbd_conn->db_conn, *uid, cond_msg->cond,
+		JOBS_CHUNK_SIZE, _send_jobs_chunk, slurmdbd_conn);
+	if (rc != SLURM_SUCCESS)
+		comment = slurm_strerror(rc);
+
+	*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+				      rc, comment, DBD_GET_JOBS_CHUNKS);
+
+	slurmdbd_free_cond_msg(cond_msg, DBD_GET_JOBS_CHUNKS);
+
+	return rc;
+}
+
+static int _send_jobs_chunk(List job_list, void *arg)
+{
+	slurmdbd_conn_t *slurmdbd_conn = (slurmdbd_conn_t *) arg;
+	dbd_list_msg_t list_msg;
+	Buf buffer;
+
+	list_msg.my_list = job_list;
+	buffer = init_buf(1024);
+	pack16((uint16_t) DBD_GOT_JOBS_CHUNK, buffer);
+	slurmdbd_pack_list_msg(&list_msg, slurmdbd_conn->rpc_version,
+			       DBD_GOT_JOBS_CHUNK, buffer);
+
+	if (send_dbd_resp(slurmdbd_conn->newsockfd, buffer)
+	    != SLURM_SUCCESS) {
+		error("CONN:%u Problem sending jobs",
+		      slurmdbd_conn->newsockfd);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
 static int _get_probs(slurmdbd_conn_t *slurmdbd_conn,
 		      Buf in_buffer, Buf *out_buffer, uint32_t *uid)
 {
@@ -2633,53 +2743,12 @@ static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn,
 			       dbd_job_start_msg_t *job_start_msg,
 			       dbd_id_rc_msg_t *id_rc_msg)
 {
-	struct job_record job, *job_ptr;
+	struct job_record job;
 	struct job_details details;
 
-	memset(&job, 0, sizeof(struct job_record));
-	memset(&details, 0, sizeof(struct job_details));
 	memset(id_rc_msg, 0, sizeof(dbd_id_rc_msg_t));
 
-	job.total_cpus = job_start_msg->alloc_cpus;
-	job.total_nodes = job_start_msg->alloc_nodes;
-	job.account = _replace_double_quotes(job_start_msg->account);
-	job.assoc_id = job_start_msg->assoc_id;
-	job.comment = job_start_msg->block_id;
-	job.db_index = job_start_msg->db_index;
-	details.begin_time = job_start_msg->eligible_time;
-	job.user_id = job_start_msg->uid;
-	job.group_id = job_start_msg->gid;
-	job.job_id = job_start_msg->job_id;
-	job.job_state = job_start_msg->job_state;
-	job.name = _replace_double_quotes(job_start_msg->name);
-	job.nodes = job_start_msg->nodes;
-	job.network = job_start_msg->node_inx;
-	job.partition = job_start_msg->partition;
-	details.min_cpus = job_start_msg->req_cpus;
-	job.qos_id = job_start_msg->qos_id;
-	job.resv_id = job_start_msg->resv_id;
-	job.priority = job_start_msg->priority;
-	job.start_time = job_start_msg->start_time;
-	job.time_limit = job_start_msg->timelimit;
-	job.wckey = _replace_double_quotes(job_start_msg->wckey);
-	details.submit_time = job_start_msg->submit_time;
-
-	job.details = &details;
-	job_ptr = &job;
-
-	if (job.job_state & JOB_RESIZING) {
-		job.resize_time = job_start_msg->eligible_time;
-		debug2("DBD_JOB_START: RESIZE CALL ID:%u NAME:%s INX:%u",
-		       job_start_msg->job_id, job_start_msg->name,
-		       job.db_index);
-	} else if (job.start_time && !IS_JOB_PENDING(job_ptr)) {
-		debug2("DBD_JOB_START: START CALL ID:%u NAME:%s INX:%u",
-		       job_start_msg->job_id, job_start_msg->name,
-		       job.db_index);
-	} else {
-		debug2("DBD_JOB_START: ELIGIBLE CALL ID:%u NAME:%s",
-		       job_start_msg->job_id, job_start_msg->name);
-	}
+	_setup_job_start(job_start_msg, &job, &details);
 	id_rc_msg->return_code = jobacct_storage_g_job_start(
 		slurmdbd_conn->db_conn, &job);
 	id_rc_msg->job_id = job.job_id;
@@ -2690,6 +2759,61 @@ static void _process_job_start(slurmdbd_conn_t *slurmdbd_conn,
 		xfree(job.wckey);
 }
 
+/* Store the jobs of a list of dbd_job_start_msg_t at once and append a
+ * dbd_id_rc_msg_t for each of them to id_rc_list */
+static void _process_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
+				    List job_start_list, List id_rc_list)
+{
+	struct job_record *job;
+	struct job_details *details;
+	dbd_job_start_msg_t *job_start_msg;
+	dbd_id_rc_msg_t *id_rc_msg;
+	List job_list;
+	ListIterator itr;
+	int i, rc, cnt = list_count(job_start_list);
+
+	if (!cnt)
+		return;
+
+	job = xmalloc(sizeof(struct job_record) * cnt);
+	details = xmalloc(sizeof(struct job_details) * cnt);
+	job_list = list_create(NULL);
+
+	i = 0;
+	itr = list_iterator_create(job_start_list);
+	while ((job_start_msg = list_next(itr))) {
+		_setup_job_start(job_start_msg, &job[i], &details[i]);
+		list_append(job_list, &job[i]);
+		i++;
+	}
+	rc = jobacct_storage_g_job_start_mult(slurmdbd_conn->db_conn,
+					      job_list);
+	list_destroy(job_list);
+
+	i = 0;
+	list_iterator_reset(itr);
+	while ((job_start_msg = list_next(itr))) {
+		id_rc_msg = xmalloc(sizeof(dbd_id_rc_msg_t));
+		/* rc is for all the jobs, those with a db_index made it */
+		if (job[i].db_index)
+			id_rc_msg->return_code = SLURM_SUCCESS;
+		else
+			id_rc_msg->return_code = rc;
+		id_rc_msg->job_id = job[i].job_id;
+		id_rc_msg->id = job[i].db_index;
+		list_append(id_rc_list, id_rc_msg);
+
+		/* just incase job.wckey was set because we didn't send one */
+		if (!job_start_msg->wckey)
+			xfree(job[i].wckey);
+		i++;
+	}
+	list_iterator_destroy(itr);
+
+	xfree(job);
+	xfree(details);
+}
+
 static int   _register_ctld(slurmdbd_conn_t *slurmdbd_conn,
 			    Buf in_buffer, Buf *out_buffer, uint32_t *uid)
 {
@@ -3354,9 +3478,6 @@ static int   _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 	dbd_list_msg_t *get_msg = NULL;
 	dbd_list_msg_t list_msg;
 	char *comment = NULL;
-	ListIterator itr = NULL;
-	dbd_job_start_msg_t *job_start_msg;
-	dbd_id_rc_msg_t *id_rc_msg;
 
 	if (*uid != slurmdbd_conf->slurm_user_id) {
 		comment = "DBD_SEND_MULT_JOB_START message from invalid uid";
@@ -3380,14 +3501,8 @@ static int   _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 
 	list_msg.my_list = list_create(slurmdbd_free_id_rc_msg);
 
-	itr = list_iterator_create(get_msg->my_list);
-	while ((job_start_msg = list_next(itr))) {
-	        id_rc_msg = xmalloc(sizeof(dbd_id_rc_msg_t));
-		list_append(list_msg.my_list, id_rc_msg);
-
-		_process_job_start(slurmdbd_conn, job_start_msg, id_rc_msg);
-	}
-	list_iterator_destroy(itr);
+	_process_mult_job_start(slurmdbd_conn, get_msg->my_list,
+				list_msg.my_list);
 
 	slurmdbd_free_list_msg(get_msg);
 
@@ -3410,7 +3525,11 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 	char *comment = NULL;
 	ListIterator itr = NULL;
 	Buf req_buf = NULL, ret_buf = NULL;
-	int rc = SLURM_SUCCESS;
+	dbd_job_start_msg_t *job_start_msg;
+	mult_msg_t mult;
+	uint16_t msg_type;
+	void *step_msg;
+	int i, cnt, fail_inx, rc = SLURM_SUCCESS;
 
 	if (*uid != slurmdbd_conf->slurm_user_id) {
 		comment = "DBD_SEND_MULT_MSG message from invalid uid";
@@ -3432,19 +3551,102 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 		return SLURM_ERROR;
 	}
 
-	list_msg.my_list = list_create(slurmdbd_free_buffer);
-
+	cnt = list_count(get_msg->my_list);
+	memset(&mult, 0, sizeof(mult_msg_t));
+	mult.req_buf = xmalloc(sizeof(Buf) * cnt);
+	mult.ret_buf = xmalloc(sizeof(Buf) * cnt);
+	mult.job_start_list = list_create(slurmdbd_free_job_start_msg);
+	mult.job_start_inx = xmalloc(sizeof(int) * cnt);
+	mult.step_start_list = list_create(
+		(ListDelF) slurmdbd_free_step_start_msg);
+	mult.step_start_inx = xmalloc(sizeof(int) * cnt);
+	mult.step_comp_list = list_create(
+		(ListDelF) slurmdbd_free_step_complete_msg);
+	mult.step_comp_inx = xmalloc(sizeof(int) * cnt);
+
+	/* Job starts are stored together until any other record but a
+	 * step comes.  Steps wait until a record other than a job start
+	 * or completion, since only those leave the step records alone. */
+	fail_inx = cnt;
+	i = 0;
 	itr = list_iterator_create(get_msg->my_list);
 	while ((req_buf = list_next(itr))) {
+		mult.req_buf[i] = req_buf;
+		msg_type = _unpack_mult_msg_type(req_buf);
+		if ((msg_type == DBD_STEP_START) ||
+		    (msg_type == DBD_STEP_COMPLETE)) {
+			if ((step_msg = _unpack_mult_step(slurmdbd_conn,
+							  req_buf,
+							  msg_type))) {
+				if (_mult_step_add(slurmdbd_conn, &mult, i,
+						   msg_type, step_msg, uid,
+						   &fail_inx)
+				    != SLURM_SUCCESS) {
+					rc = SLURM_ERROR;
+					break;
+				}
+				i++;
+				continue;
+			}
+		} else if ((job_start_msg =
+			    _unpack_mult_job_start(slurmdbd_conn, req_buf))) {
+			/* a resized job moves its steps to a new record */
+			if ((job_start_msg->job_state & JOB_RESIZING) &&
+			    (_mult_step_flush(slurmdbd_conn, &mult, uid,
+					      &fail_inx) != SLURM_SUCCESS)) {
+				slurmdbd_free_job_start_msg(job_start_msg);
+				rc = SLURM_ERROR;
+				break;
+			}
+			mult.job_start_inx[list_count(mult.job_start_list)] = i;
+			list_append(mult.job_start_list, job_start_msg);
+			i++;
+			continue;
+		}
+		if ((_mult_job_start_flush(slurmdbd_conn, &mult, &fail_inx)
+		     != SLURM_SUCCESS) ||
+		    ((msg_type != DBD_JOB_COMPLETE) &&
+		     (_mult_step_flush(slurmdbd_conn, &mult, uid, &fail_inx)
+		      != SLURM_SUCCESS))) {
+			rc = SLURM_ERROR;
+			break;
+		}
+
 		ret_buf = NULL;
 		rc = proc_req(slurmdbd_conn, get_buf_data(req_buf),
 			      size_buf(req_buf), 0, &ret_buf, uid);
-		if (ret_buf)
-			list_append(list_msg.my_list, ret_buf);
-		if (rc != SLURM_SUCCESS)
+		mult.ret_buf[i] = ret_buf;
+		if (rc != SLURM_SUCCESS) {
+			fail_inx = i;
 			break;
+		}
+		i++;
 	}
 	list_iterator_destroy(itr);
+	/* Store what was held before the record which failed */
+	if ((_mult_job_start_flush(slurmdbd_conn, &mult, &fail_inx)
+	     != SLURM_SUCCESS) ||
+	    (_mult_step_flush(slurmdbd_conn, &mult, uid, &fail_inx)
+	     != SLURM_SUCCESS))
+		rc = SLURM_ERROR;
+
+	list_msg.my_list = list_create(slurmdbd_free_buffer);
+	for (i = 0; (i < cnt) && mult.ret_buf[i]; i++) {
+		list_append(list_msg.my_list, mult.ret_buf[i]);
+		mult.ret_buf[i] = NULL;
+	}
+	for ( ; i < cnt; i++) {
+		if (mult.ret_buf[i])
+			free_buf(mult.ret_buf[i]);
+	}
+	list_destroy(mult.job_start_list);
+	list_destroy(mult.step_start_list);
+	list_destroy(mult.step_comp_list);
+	xfree(mult.req_buf);
+	xfree(mult.ret_buf);
+	xfree(mult.job_start_inx);
+	xfree(mult.step_start_inx);
+	xfree(mult.step_comp_inx);
 
 	slurmdbd_free_list_msg(get_msg);
 
@@ -3455,7 +3657,316 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 	if (list_msg.my_list)
 		list_destroy(list_msg.my_list);
 
-	return SLURM_SUCCESS;
+	/* The records after a failed one are in the reply as not done,
+	 * rpc_mgr closes the connection to drop any batches the
+	 * slurmctld sent after this one. */
+	return rc;
+}
+
+/* Store the job starts held from a DBD_SEND_MULT_MSG and set the DBD_ID_RC
+ * response of each of them
+ * fail_inx IN/OUT - the first record which failed
+ * RET SLURM_SUCCESS or SLURM_ERROR if any of them failed */
+static int _mult_job_start_flush(slurmdbd_conn_t *slurmdbd_conn,
+				 mult_msg_t *mult, int *fail_inx)
+{
+	List id_rc_list;
+	dbd_id_rc_msg_t *id_rc_msg;
+	Buf ret_buf;
+	int i = 0, rc = SLURM_SUCCESS;
+
+	if (!list_count(mult->job_start_list))
+		return rc;
+
+	id_rc_list = list_create(slurmdbd_free_id_rc_msg);
+	_process_mult_job_start(slurmdbd_conn, mult->job_start_list,
+				id_rc_list);
+	while ((id_rc_msg = list_dequeue(id_rc_list))) {
+		ret_buf = init_buf(1024);
+		pack16((uint16_t) DBD_ID_RC, ret_buf);
+		slurmdbd_pack_id_rc_msg(id_rc_msg,
+					slurmdbd_conn->rpc_version, ret_buf);
+		mult->ret_buf[mult->job_start_inx[i]] = ret_buf;
+		if ((id_rc_msg->return_code != SLURM_SUCCESS) &&
+		    (rc == SLURM_SUCCESS)) {
+			rc = SLURM_ERROR;
+			*fail_inx = MIN(*fail_inx, mult->job_start_inx[i]);
+		}
+		slurmdbd_free_id_rc_msg(id_rc_msg);
+		i++;
+	}
+	list_destroy(id_rc_list);
+	list_flush(mult->job_start_list);
+
+	return rc;
+}
+
+/* Hold a step start or completion of a DBD_SEND_MULT_MSG.  A step started
+ * again after its completion is held has the held steps stored first, so
+ * it ends up running.
+ * RET SLURM_SUCCESS or SLURM_ERROR if storing the held steps failed */
+static int _mult_step_add(slurmdbd_conn_t *slurmdbd_conn, mult_msg_t *mult,
+			  int inx, uint16_t msg_type, void *step_msg,
+			  uint32_t *uid, int *fail_inx)
+{
+	dbd_step_start_msg_t *step_start_msg = step_msg;
+	dbd_step_comp_msg_t *step_comp_msg;
+	ListIterator itr;
+	int rc = SLURM_SUCCESS;
+
+	if (msg_type == DBD_STEP_COMPLETE) {
+		mult->step_comp_inx[list_count(mult->step_comp_list)] = inx;
+		list_append(mult->step_comp_list, step_msg);
+		return rc;
+	}
+
+	itr = list_iterator_create(mult->step_comp_list);
+	while ((step_comp_msg = list_next(itr))) {
+		if ((step_comp_msg->job_id == step_start_msg->job_id) &&
+		    (step_comp_msg->step_id == step_start_msg->step_id) &&
+		    (step_comp_msg->job_submit_time ==
+		     step_start_msg->job_submit_time))
+			break;
+	}
+	list_iterator_destroy(itr);
+	if (step_comp_msg)
+		rc = _mult_step_flush(slurmdbd_conn, mult, uid, fail_inx);
+	if (rc != SLURM_SUCCESS) {
+		slurmdbd_free_step_start_msg(step_start_msg);
+		return rc;
+	}
+
+	mult->step_start_inx[list_count(mult->step_start_list)] = inx;
+	list_append(mult->step_start_list, step_msg);
+	return rc;
+}
+
+/* Store the steps of step_list together, or if that fails each one with
+ * proc_req() to get its own response
+ * RET SLURM_SUCCESS or SLURM_ERROR if any of them failed */
+static int _mult_step_store(slurmdbd_conn_t *slurmdbd_conn, mult_msg_t *mult,
+			    List step_list, int *inx, uint16_t msg_type,
+			    uint32_t *uid, int *fail_inx)
+{
+	struct step_record *step;
+	struct job_record *job;
+	struct job_details *details;
+	slurm_step_layout_t *layout = NULL;
+	List store_list;
+	ListIterator itr;
+	void *step_msg;
+	Buf req_buf, ret_buf;
+	int i, cnt = 0, rc;
+
+	/* nothing after a record which failed is stored */
+	while ((cnt < list_count(step_list)) && (inx[cnt] < *fail_inx))
+		cnt++;
+	if (!cnt)
+		return SLURM_SUCCESS;
+
+	step = xmalloc(sizeof(struct step_record) * cnt);
+	job = xmalloc(sizeof(struct job_record) * cnt);
+	details = xmalloc(sizeof(struct job_details) * cnt);
+	if (msg_type == DBD_STEP_START)
+		layout = xmalloc(sizeof(slurm_step_layout_t) * cnt);
+	store_list = list_create(NULL);
+
+	itr = list_iterator_create(step_list);
+	for (i = 0; i < cnt; i++) {
+		step_msg = list_next(itr);
+		if (msg_type == DBD_STEP_START)
+			_setup_step_start(step_msg, &step[i], &job[i],
+					  &details[i], &layout[i]);
+		else
+			_setup_step_complete(step_msg, &step[i], &job[i],
+					     &details[i]);
+		list_append(store_list, &step[i]);
+	}
+	list_iterator_destroy(itr);
+
+	if (msg_type == DBD_STEP_START)
+		rc = jobacct_storage_g_step_start_mult(slurmdbd_conn->db_conn,
+						       store_list);
+	else
+		rc = jobacct_storage_g_step_complete_mult(
+			slurmdbd_conn->db_conn, store_list);
+	list_destroy(store_list);
+
+	if (rc == SLURM_SUCCESS) {
+		for (i = 0; i < cnt; i++)
+			mult->ret_buf[inx[i]] = make_dbd_rc_msg(
+				slurmdbd_conn->rpc_version, SLURM_SUCCESS,
+				NULL, msg_type);
+	} else {
+		rc = SLURM_SUCCESS;
+		for (i = 0; (rc == SLURM_SUCCESS) && (i < cnt); i++) {
+			debug("Storing step record %d of %d by itself",
+			      i + 1, cnt);
+			req_buf = mult->req_buf[inx[i]];
+			ret_buf = NULL;
+			rc = proc_req(slurmdbd_conn, get_buf_data(req_buf),
+				      size_buf(req_buf), 0, &ret_buf, uid);
+			mult->ret_buf[inx[i]] = ret_buf;
+			if (rc != SLURM_SUCCESS)
+				*fail_inx = MIN(*fail_inx, inx[i]);
+		}
+	}
+
+	for (i = 0; i < cnt; i++) {
+		/* just incase this gets set we need to clear it */
+		xfree(job[i].wckey);
+	}
+	xfree(layout);
+	xfree(details);
+	xfree(job);
+	xfree(step);
+
+	return rc;
+}
+
+/* Store the step starts and then the step completions held from a
+ * DBD_SEND_MULT_MSG, after the job starts held since they may be of the
+ * same jobs
+ * fail_inx IN/OUT - the first record which failed
+ * RET SLURM_SUCCESS or SLURM_ERROR if any of them failed */
+static int _mult_step_flush(slurmdbd_conn_t *slurmdbd_conn, mult_msg_t *mult,
+			    uint32_t *uid, int *fail_inx)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (!list_count(mult->step_start_list) &&
+	    !list_count(mult->step_comp_list))
+		return rc;
+
+	if (_mult_job_start_flush(slurmdbd_conn, mult, fail_inx)
+	    != SLURM_SUCCESS)
+		rc = SLURM_ERROR;
+	if (_mult_step_store(slurmdbd_conn, mult, mult->step_start_list,
+			     mult->step_start_inx, DBD_STEP_START, uid,
+			     fail_inx) != SLURM_SUCCESS)
+		rc = SLURM_ERROR;
+	if (_mult_step_store(slurmdbd_conn, mult, mult->step_comp_list,
+			     mult->step_comp_inx, DBD_STEP_COMPLETE, uid,
+			     fail_inx) != SLURM_SUCCESS)
+		rc = SLURM_ERROR;
+	list_flush(mult->step_start_list);
+	list_flush(mult->step_comp_list);
+
+	return rc;
+}
+
+static void _setup_job_start(dbd_job_start_msg_t *job_start_msg,
+			     struct job_record *job,
+			     struct job_details *details)
+{
+	memset(job, 0, sizeof(struct job_record));
+	memset(details, 0, sizeof(struct job_details));
+
+	job->total_cpus = job_start_msg->alloc_cpus;
+	job->total_nodes = job_start_msg->alloc_nodes;
+	job->account = _replace_double_quotes(job_start_msg->account);
+	job->assoc_id = job_start_msg->assoc_id;
+	job->comment = job_start_msg->block_id;
+	job->db_index = job_start_msg->db_index;
+	details->begin_time = job_start_msg->eligible_time;
+	job->user_id = job_start_msg->uid;
+	job->group_id = job_start_msg->gid;
+	job->job_id = job_start_msg->job_id;
+	job->job_state = job_start_msg->job_state;
+	job->name = _replace_double_quotes(job_start_msg->name);
+	job->nodes = job_start_msg->nodes;
+	job->network = job_start_msg->node_inx;
+	job->partition = job_start_msg->partition;
+	details->min_cpus = job_start_msg->req_cpus;
+	job->qos_id = job_start_msg->qos_id;
+	job->resv_id = job_start_msg->resv_id;
+	job->priority = job_start_msg->priority;
+	job->start_time = job_start_msg->start_time;
+	job->time_limit = job_start_msg->timelimit;
+	job->wckey = _replace_double_quotes(job_start_msg->wckey);
+	details->submit_time = job_start_msg->submit_time;
+
+	job->details = details;
+
+	if (job->job_state & JOB_RESIZING) {
+		job->resize_time = job_start_msg->eligible_time;
+		debug2("DBD_JOB_START: RESIZE CALL ID:%u NAME:%s INX:%u",
+		       job_start_msg->job_id, job_start_msg->name,
+		       job->db_index);
+	} else if (job->start_time && !IS_JOB_PENDING(job)) {
+		debug2("DBD_JOB_START: START CALL ID:%u NAME:%s INX:%u",
+		       job_start_msg->job_id, job_start_msg->name,
+		       job->db_index);
+	} else {
+		debug2("DBD_JOB_START: ELIGIBLE CALL ID:%u NAME:%s",
+		       job_start_msg->job_id, job_start_msg->name);
+	}
+}
+
+static void _setup_step_complete(dbd_step_comp_msg_t *step_comp_msg,
+				 struct step_record *step,
+				 struct job_record *job,
+				 struct job_details *details)
+{
+	debug2("DBD_STEP_COMPLETE: ID:%u.%u SUBMIT:%lu",
+	       step_comp_msg->job_id, step_comp_msg->step_id,
+	       (unsigned long) step_comp_msg->job_submit_time);
+
+	memset(step, 0, sizeof(struct step_record));
+	memset(job, 0, sizeof(struct job_record));
+	memset(details, 0, sizeof(struct job_details));
+
+	job->assoc_id = step_comp_msg->assoc_id;
+	job->db_index = step_comp_msg->db_index;
+	job->end_time = step_comp_msg->end_time;
+	step->exit_code = step_comp_msg->exit_code;
+	step->jobacct = step_comp_msg->jobacct;
+	job->job_id = step_comp_msg->job_id;
+	step->requid = step_comp_msg->req_uid;
+	job->start_time = step_comp_msg->start_time;
+	details->submit_time = step_comp_msg->job_submit_time;
+	step->step_id = step_comp_msg->step_id;
+	step->cpu_count = step_comp_msg->total_cpus;
+	details->num_tasks = step_comp_msg->total_tasks;
+
+	job->details = details;
+	step->job_ptr = job;
+}
+
+static void _setup_step_start(dbd_step_start_msg_t *step_start_msg,
+			      struct step_record *step,
+			      struct job_record *job,
+			      struct job_details *details,
+			      slurm_step_layout_t *layout)
+{
+	debug2("DBD_STEP_START: ID:%u.%u NAME:%s SUBMIT:%lu",
+	       step_start_msg->job_id, step_start_msg->step_id,
+	       step_start_msg->name,
+	       (unsigned long) step_start_msg->job_submit_time);
+
+	memset(step, 0, sizeof(struct step_record));
+	memset(job, 0, sizeof(struct job_record));
+	memset(details, 0, sizeof(struct job_details));
+	memset(layout, 0, sizeof(slurm_step_layout_t));
+
+	job->assoc_id = step_start_msg->assoc_id;
+	job->db_index = step_start_msg->db_index;
+	job->job_id = step_start_msg->job_id;
+	step->name = step_start_msg->name;
+	job->nodes = step_start_msg->nodes;
+	step->network = step_start_msg->node_inx;
+	step->start_time = step_start_msg->start_time;
+	details->submit_time = step_start_msg->job_submit_time;
+	step->step_id = step_start_msg->step_id;
+	step->cpu_count = step_start_msg->total_cpus;
+	details->num_tasks = step_start_msg->total_tasks;
+
+	layout->node_cnt = step_start_msg->node_cnt;
+	layout->task_dist = step_start_msg->task_dist;
+
+	job->details = details;
+	step->job_ptr = job;
+	step->step_layout = layout;
 }
 
 static int  _step_complete(slurmdbd_conn_t *slurmdbd_conn,
@@ -3484,30 +3995,7 @@ static int  _step_complete(slurmdbd_conn_t *slurmdbd_conn,
 		goto end_it;
 	}
 
-	debug2("DBD_STEP_COMPLETE: ID:%u.%u SUBMIT:%lu",
-	       step_comp_msg->job_id, step_comp_msg->step_id,
-	       (unsigned long) step_comp_msg->job_submit_time);
-
-	memset(&step, 0, sizeof(struct step_record));
-	memset(&job, 0, sizeof(struct job_record));
-	memset(&details, 0, sizeof(struct job_details));
-
-	job.assoc_id = step_comp_msg->assoc_id;
-	job.db_index = step_comp_msg->db_index;
-	job.end_time = step_comp_msg->end_time;
-	step.exit_code = step_comp_msg->exit_code;
-	step.jobacct = step_comp_msg->jobacct;
-	job.job_id = step_comp_msg->job_id;
-	step.requid = step_comp_msg->req_uid;
-	job.start_time = step_comp_msg->start_time;
-	details.submit_time = step_comp_msg->job_submit_time;
-	step.step_id = step_comp_msg->step_id;
-	step.cpu_count = step_comp_msg->total_cpus;
-	details.num_tasks = step_comp_msg->total_tasks;
-
-	job.details = &details;
-	step.job_ptr = &job;
-
+	_setup_step_complete(step_comp_msg, &step, &job, &details);
 	rc = jobacct_storage_g_step_complete(slurmdbd_conn->db_conn, &step);
 
 	if (rc && errno == 740) /* meaning data is already there */
@@ -3547,35 +4035,7 @@ static int  _step_start(slurmdbd_conn_t *slurmdbd_conn,
 		goto end_it;
 	}
 
-	debug2("DBD_STEP_START: ID:%u.%u NAME:%s SUBMIT:%lu",
-	       step_start_msg->job_id, step_start_msg->step_id,
-	       step_start_msg->name,
-	       (unsigned long) step_start_msg->job_submit_time);
-
-	memset(&step, 0, sizeof(struct step_record));
-	memset(&job, 0, sizeof(struct job_record));
-	memset(&details, 0, sizeof(struct job_details));
-	memset(&layout, 0, sizeof(slurm_step_layout_t));
-
-	job.assoc_id = step_start_msg->assoc_id;
-	job.db_index = step_start_msg->db_index;
-	job.job_id = step_start_msg->job_id;
-	step.name = step_start_msg->name;
-	job.nodes = step_start_msg->nodes;
-	step.network = step_start_msg->node_inx;
-	step.start_time = step_start_msg->start_time;
-	details.submit_time = step_start_msg->job_submit_time;
-	step.step_id = step_start_msg->step_id;
-	step.cpu_count = step_start_msg->total_cpus;
-	details.num_tasks = step_start_msg->total_tasks;
-
-	layout.node_cnt = step_start_msg->node_cnt;
-	layout.task_dist = step_start_msg->task_dist;
-
-	job.details = &details;
-	step.job_ptr = &job;
-	step.step_layout = &layout;
-
+	_setup_step_start(step_start_msg, &step, &job, &details, &layout);
 	rc = jobacct_storage_g_step_start(slurmdbd_conn->db_conn, &step);
 
 	if (rc && errno == 740) /* meaning data is already there */
@@ -3590,3 +4050,65 @@ end_it:
 	return rc;
 }
 
+/* RET the type of the message in req_buf, 0 if it can not be read */
+static uint16_t _unpack_mult_msg_type(Buf req_buf)
+{
+	uint16_t msg_type;
+	Buf in_buffer;
+
+	in_buffer = create_buf(get_buf_data(req_buf), size_buf(req_buf));
+	if (unpack16(&msg_type, in_buffer) != SLURM_SUCCESS)
+		msg_type = 0;
+	xfer_buf_data(in_buffer);	/* req_buf still owns the data */
+
+	return msg_type;
+}
+
+/* RET the message in req_buf if it is a DBD_JOB_START, NULL if it is
+ *	anything else or can not be unpacked so proc_req() handles it */
+static dbd_job_start_msg_t *_unpack_mult_job_start(
+	slurmdbd_conn_t *slurmdbd_conn, Buf req_buf)
+{
+	dbd_job_start_msg_t *job_start_msg = NULL;
+	uint16_t msg_type;
+	Buf in_buffer;
+
+	in_buffer = create_buf(get_buf_data(req_buf), size_buf(req_buf));
+	if ((unpack16(&msg_type, in_buffer) != SLURM_SUCCESS)
+	    || (msg_type != DBD_JOB_START)
+	    || (slurmdbd_unpack_job_start_msg((void **)&job_start_msg,
+					      slurmdbd_conn->rpc_version,
+					      in_buffer) != SLURM_SUCCESS))
+		job_start_msg = NULL;
+	xfer_buf_data(in_buffer);	/* req_buf still owns the data */
+
+	return job_start_msg;
+}
+
+/* RET the DBD_STEP_START or DBD_STEP_COMPLETE message in req_buf, NULL if
+ *	it can not be unpacked so proc_req() handles it */
+static void *_unpack_mult_step(slurmdbd_conn_t *slurmdbd_conn,
+			       Buf req_buf, uint16_t msg_type)
+{
+	void *step_msg = NULL;
+	uint16_t type;
+	Buf in_buffer;
+	int rc;
+
+	in_buffer = create_buf(get_buf_data(req_buf), size_buf(req_buf));
+	if (unpack16(&type, in_buffer) != SLURM_SUCCESS)
+		rc = SLURM_ERROR;
+	else if (msg_type == DBD_STEP_START)
+		rc = slurmdbd_unpack_step_start_msg(
+			(dbd_step_start_msg_t **)&step_msg,
+			slurmdbd_conn->rpc_version, in_buffer);
+	else
+		rc = slurmdbd_unpack_step_complete_msg(
+			(dbd_step_comp_msg_t **)&step_msg,
+			slurmdbd_conn->rpc_version, in_buffer);
+	if (rc != SLURM_SUCCESS)
+		step_msg = NULL;
+	xfer_buf_data(in_buffer);	/* req_buf still owns the data */
+
+	return step_msg;
+}
@@ -43,10 +43,13 @@
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <signal.h>
+#include <string.h>
 #include <sys/poll.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #include "src/common/fd.h"
+#include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/slurm_protocol_api.h"
@@ -59,7 +62,11 @@
 #include "src/slurmdbd/rpc_mgr.h"
 #include "src/slurmdbd/slurmdbd.h"
 
-#define MAX_THREAD_COUNT 100
+#define MAX_CONN_COUNT		100	/* Open connections, each has its
+					 * own database connection */
+#define RPC_WORKER_COUNT	16	/* Threads processing RPCs */
+#define QUERY_WORKER_COUNT	4	/* Threads processing job and usage
+					 * queries */
 
 /*
  *  Maximum message size. Messages larger than this value (in bytes)
@@ -67,51 +74,84 @@
  */
 #define MAX_MSG_SIZE     (16*1024*1024)
 
+/* State of a connection. Connections waiting for a message are polled by
+ * the rpc_mgr thread, which reads messages as they arrive and queues the
+ * connection for an RPC thread once one is complete.  The connection is
+ * not polled again until its RPC is done, so each client's RPCs are
+ * processed and replied to in order. */
+typedef struct {
+	slurmdbd_conn_t *conn;
+	bool first;		/* no message processed yet */
+	uint32_t uid;		/* user ID who initiated the RPCs */
+	uint32_t nw_size;	/* size of next message, network order */
+	ssize_t size_read;	/* bytes of nw_size read */
+	char *msg;		/* message, NULL until its size is read */
+	uint32_t msg_size;
+	ssize_t msg_read;	/* bytes of msg read */
+} rpc_conn_t;
+
+/* Connections with a message to process (or to be closed if msg is NULL)
+ * and the threads working on them */
+typedef struct {
+	List conn_list;
+	pthread_cond_t cond;
+	int thread_count;
+} rpc_queue_t;
+
 /* Local functions */
-static bool   _fd_readable(slurm_fd_t fd);
-static void   _free_server_thread(pthread_t my_tid);
-static int    _send_resp(slurm_fd_t fd, Buf buffer);
-static void * _service_connection(void *arg);
+static void   _conn_close(rpc_conn_t *rpc_conn);
+static void   _conn_done(rpc_conn_t *rpc_conn);
+static int    _conn_read(rpc_conn_t *rpc_conn);
+static void   _conn_queue(rpc_conn_t *rpc_conn);
+static bool   _is_query(char *msg);
+static int    _process_msg(rpc_conn_t *rpc_conn);
+static void * _rpc_thread(void *arg);
 static void   _sig_handler(int signal);
+static void   _start_threads(void);
+static void   _stop_threads(void);
 static int    _tot_wait (struct timeval *start_time);
-static int    _wait_for_server_thread(void);
-static void   _wait_for_thread_fini(void);
+static void   _wake_rpc_mgr(void);
 
 /* Local variables */
-static pthread_t       master_thread_id = 0, slave_thread_id[MAX_THREAD_COUNT];
-static int             thread_count = 0;
-static pthread_mutex_t thread_count_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  thread_count_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t       master_thread_id = 0;
+static pthread_t       thread_id[RPC_WORKER_COUNT + QUERY_WORKER_COUNT];
+static pthread_mutex_t rpc_lock = PTHREAD_MUTEX_INITIALIZER;
+static rpc_queue_t     rpc_queue   = { NULL, PTHREAD_COND_INITIALIZER,
+				       RPC_WORKER_COUNT };
+static rpc_queue_t     query_queue = { NULL, PTHREAD_COND_INITIALIZER,
+				       QUERY_WORKER_COUNT };
+static List            done_list = NULL;	/* RPCs processed */
+static int             conn_count = 0;
+static int             wake_fd[2] = { -1, -1 };
 
 
 /* Process incoming RPCs. Meant to execute as a pthread */
 extern void *rpc_mgr(void *no_data)
 {
-	pthread_attr_t thread_attr_rpc_req;
 	slurm_fd_t sockfd, newsockfd;
-	int i, retry_cnt, sigarray[] = {SIGUSR1, 0};
+	int i, j, nfds, rc, sigarray[] = {SIGUSR1, 0};
+	int idle_count = 0;
+	bool accepting;
+	char c;
 	slurm_addr_t cli_addr;
 	slurmdbd_conn_t *conn_arg = NULL;
+	rpc_conn_t *rpc_conn;
+	rpc_conn_t **idle_conn;
+	struct pollfd *pfds;
 
-	slurm_mutex_lock(&thread_count_lock);
+	slurm_mutex_lock(&rpc_lock);
 	master_thread_id = pthread_self();
-	slurm_mutex_unlock(&thread_count_lock);
+	slurm_mutex_unlock(&rpc_lock);
 
 	(void) pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
 	(void) pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 
-	/* threads to process individual RPC's are detached */
-	slurm_attr_init(&thread_attr_rpc_req);
-	if (pthread_attr_setdetachstate
-	    (&thread_attr_rpc_req, PTHREAD_CREATE_DETACHED))
-		fatal("pthread_attr_setdetachstate %m");
-
 	/* initialize port for RPCs */
 	if ((sockfd = slurm_init_msg_engine_port(get_dbd_port()))
 	    == SLURM_SOCKET_ERROR)
 		fatal("slurm_init_msg_engine_port error %m");
 
-	/* Prepare to catch SIGUSR1 to interrupt accept().
+	/* Prepare to catch SIGUSR1 to interrupt poll().
 	 * This signal is generated by the slurmdbd signal
 	 * handler thread upon receipt of SIGABRT, SIGINT,
 	 * or SIGTERM. That thread does all processing of
@@ -119,10 +159,65 @@ extern void *rpc_mgr(void *no_data)
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sigarray);
 
+	if (pipe(wake_fd) < 0)
+		fatal("pipe: %m");
+	fd_set_nonblocking(wake_fd[0]);
+	fd_set_nonblocking(wake_fd[1]);
+	fd_set_close_on_exec(wake_fd[0]);
+	fd_set_close_on_exec(wake_fd[1]);
+
+	_start_threads();
+
+	idle_conn = xmalloc(sizeof(rpc_conn_t *) * MAX_CONN_COUNT);
+	pfds = xmalloc(sizeof(struct pollfd) * (MAX_CONN_COUNT + 2));
+
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
-	while ((i = _wait_for_server_thread()) >= 0) {
+	while (!shutdown_time) {
+		/* Poll the connections whose RPC is done again */
+		slurm_mutex_lock(&rpc_lock);
+		while ((rpc_conn = list_dequeue(done_list)))
+			idle_conn[idle_count++] = rpc_conn;
+		accepting = (conn_count < MAX_CONN_COUNT);
+		slurm_mutex_unlock(&rpc_lock);
+
+		pfds[0].fd = wake_fd[0];
+		pfds[0].events = POLLIN;
+		pfds[1].fd = accepting ? sockfd : -1;
+		pfds[1].events = POLLIN;
+		for (i = 0; i < idle_count; i++) {
+			pfds[i + 2].fd = idle_conn[i]->conn->newsockfd;
+			pfds[i + 2].events = POLLIN;
+		}
+		nfds = idle_count + 2;
+
+		if ((rc = poll(pfds, nfds, -1)) < 0) {
+			if ((errno != EINTR) && (errno != EAGAIN))
+				error("poll: %m");
+			continue;
+		}
+
+		if (pfds[0].revents) {
+			while (read(wake_fd[0], &c, 1) > 0)
+				;
+		}
+
+		/* Read what arrived, the connections with a complete
+		 * message (or an error) are handed to the RPC threads */
+		for (i = 0, j = 0; i < idle_count; i++) {
+			rpc_conn = idle_conn[i];
+			if (pfds[i + 2].revents &&
+			    (_conn_read(rpc_conn) != 0)) {
+				_conn_queue(rpc_conn);
+				continue;
+			}
+			idle_conn[j++] = rpc_conn;
+		}
+		idle_count = j;
+
+		if ((pfds[1].revents & POLLIN) == 0)
+			continue;
 		/*
 		 * accept needed for stream implementation is a no-op in
 		 * message implementation that just passes sockfd to newsockfd
@@ -130,38 +225,55 @@ extern void *rpc_mgr(void *no_data)
 		if ((newsockfd = slurm_accept_msg_conn(sockfd,
 						       &cli_addr)) ==
 		    SLURM_SOCKET_ERROR) {
-			_free_server_thread((pthread_t) 0);
 			if (errno != EINTR)
 				error("slurm_accept_msg_conn: %m");
 			continue;
 		}
 		fd_set_nonblocking(newsockfd);
+		fd_set_close_on_exec(newsockfd);
 
 		conn_arg = xmalloc(sizeof(slurmdbd_conn_t));
 		conn_arg->newsockfd = newsockfd;
 		slurm_get_ip_str(&cli_addr, &conn_arg->orig_port,
 				 conn_arg->ip, sizeof(conn_arg->ip));
-		retry_cnt = 0;
-		while (pthread_create(&slave_thread_id[i],
-				      &thread_attr_rpc_req,
-				      _service_connection,
-				      (void *) conn_arg)) {
-			if (retry_cnt > 0) {
-				error("pthread_create failure, "
-				      "aborting RPC: %m");
-				close(newsockfd);
-				break;
-			}
-			error("pthread_create failure: %m");
-			retry_cnt++;
-			usleep(1000);	/* retry in 1 msec */
-		}
+		debug2("Opened connection %d from %s",
+		       conn_arg->newsockfd, conn_arg->ip);
+
+		rpc_conn = xmalloc(sizeof(rpc_conn_t));
+		rpc_conn->conn = conn_arg;
+		rpc_conn->first = true;
+		rpc_conn->uid = NO_VAL;
+		idle_conn[idle_count++] = rpc_conn;
+
+		slurm_mutex_lock(&rpc_lock);
+		conn_count++;
+		slurm_mutex_unlock(&rpc_lock);
 	}
 
 	debug3("rpc_mgr shutting down");
-	slurm_attr_destroy(&thread_attr_rpc_req);
 	(void) slurm_shutdown_msg_engine(sockfd);
-	_wait_for_thread_fini();
+	_stop_threads();
+
+	for (i = 0; i < idle_count; i++)
+		_conn_close(idle_conn[i]);
+	while ((rpc_conn = list_dequeue(done_list)))
+		_conn_close(rpc_conn);
+	xfree(idle_conn);
+	xfree(pfds);
+
+	slurm_mutex_lock(&rpc_lock);
+	list_destroy(done_list);
+	done_list = NULL;
+	list_destroy(rpc_queue.conn_list);
+	rpc_queue.conn_list = NULL;
+	list_destroy(query_queue.conn_list);
+	query_queue.conn_list = NULL;
+	(void) close(wake_fd[0]);
+	(void) close(wake_fd[1]);
+	wake_fd[0] = wake_fd[1] = -1;
+	master_thread_id = 0;
+	slurm_mutex_unlock(&rpc_lock);
+
 	pthread_exit((void *) 0);
 	return NULL;
 }
@@ -171,91 +283,217 @@ extern void rpc_mgr_wake(void)
 {
 	int i;
 
-	slurm_mutex_lock(&thread_count_lock);
+	slurm_mutex_lock(&rpc_lock);
+	_wake_rpc_mgr();
 	if (master_thread_id)
 		pthread_kill(master_thread_id, SIGUSR1);
-	for (i=0; i<MAX_THREAD_COUNT; i++) {
-		if (slave_thread_id[i])
-			pthread_kill(slave_thread_id[i], SIGUSR1);
+	pthread_cond_broadcast(&rpc_queue.cond);
+	pthread_cond_broadcast(&query_queue.cond);
+	for (i=0; i<(RPC_WORKER_COUNT + QUERY_WORKER_COUNT); i++) {
+		if (thread_id[i])
+			pthread_kill(thread_id[i], SIGUSR1);
 	}
-	slurm_mutex_unlock(&thread_count_lock);
+	slurm_mutex_unlock(&rpc_lock);
 }
 
-static void * _service_connection(void *arg)
+/* Read what is available of the next message on a connection without
+ * blocking.
+ * RET 1 once the message is complete, 0 if more is needed, or
+ *	-1 if the connection was closed or failed */
+static int _conn_read(rpc_conn_t *rpc_conn)
 {
-	slurmdbd_conn_t *conn = (slurmdbd_conn_t *) arg;
-	uint32_t nw_size = 0, msg_size = 0, uid = NO_VAL;
-	char *msg = NULL;
-	ssize_t msg_read = 0, offset = 0;
-	bool fini = false, first = true;
-	Buf buffer = NULL;
-	int rc = SLURM_SUCCESS;
-
-	debug2("Opened connection %d from %s", conn->newsockfd, conn->ip);
-
-	while (!fini) {
-		if (!_fd_readable(conn->newsockfd))
-			break;		/* problem with this socket */
-		msg_read = read(conn->newsockfd, &nw_size, sizeof(nw_size));
-		if (msg_read == 0)	/* EOF */
-			break;
-		if (msg_read != sizeof(nw_size)) {
-			error("Could not read msg_size from "
-			      "connection %d(%s) uid(%d)",
-			      conn->newsockfd, conn->ip, uid);
-			break;
+	slurmdbd_conn_t *conn = rpc_conn->conn;
+	ssize_t msg_read;
+
+	if (rpc_conn->size_read < sizeof(rpc_conn->nw_size)) {
+		msg_read = read(conn->newsockfd,
+				((char *) &rpc_conn->nw_size) +
+				rpc_conn->size_read,
+				sizeof(rpc_conn->nw_size) -
+				rpc_conn->size_read);
+		if (msg_read == 0) {	/* EOF */
+			if (rpc_conn->size_read)
+				error("Could not read msg_size from "
+				      "connection %d(%s) uid(%d)",
+				      conn->newsockfd, conn->ip,
+				      rpc_conn->uid);
+			return -1;
 		}
-		msg_size = ntohl(nw_size);
-		if ((msg_size < 2) || (msg_size > MAX_MSG_SIZE)) {
-			error("Invalid msg_size (%u) from "
-			      "connection %d(%s) uid(%d)",
-			      msg_size, conn->newsockfd, conn->ip, uid);
-			break;
+		if (msg_read < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				return 0;
+			error("read(%d): %m", conn->newsockfd);
+			return -1;
 		}
+		rpc_conn->size_read += msg_read;
+		if (rpc_conn->size_read < sizeof(rpc_conn->nw_size))
+			return 0;
 
-		msg = xmalloc(msg_size);
-		offset = 0;
-		while (msg_size > offset) {
-			if (!_fd_readable(conn->newsockfd))
-				break;		/* problem with this socket */
-			msg_read = read(conn->newsockfd, (msg + offset),
-					(msg_size - offset));
-			if (msg_read <= 0) {
-				error("read(%d): %m", conn->newsockfd);
-				break;
-			}
-			offset += msg_read;
-		}
-		if (msg_size == offset) {
-			rc = proc_req(
-				conn, msg, msg_size, first, &buffer, &uid);
-			first = false;
-			if (rc != SLURM_SUCCESS && rc != ACCOUNTING_FIRST_REG) {
-				error("Processing last message from "
-				      "connection %d(%s) uid(%d)",
-				      conn->newsockfd, conn->ip, uid);
-				if (rc == ESLURM_ACCESS_DENIED
-				    || rc == SLURM_PROTOCOL_VERSION_ERROR)
-					fini = true;
-			}
-		} else {
-			buffer = make_dbd_rc_msg(conn->rpc_version,
-						 SLURM_ERROR, "Bad offset", 0);
-			fini = true;
+		rpc_conn->msg_size = ntohl(rpc_conn->nw_size);
+		if ((rpc_conn->msg_size < 2) ||
+		    (rpc_conn->msg_size > MAX_MSG_SIZE)) {
+			error("Invalid msg_size (%u) from "
+			      "connection %d(%s) uid(%d)",
+			      rpc_conn->msg_size, conn->newsockfd, conn->ip,
+			      rpc_conn->uid);
+			return -1;
 		}
+		rpc_conn->msg = xmalloc(rpc_conn->msg_size);
+		rpc_conn->msg_read = 0;
+	}
 
-		rc = _send_resp(conn->newsockfd, buffer);
-		xfree(msg);
+	msg_read = read(conn->newsockfd, rpc_conn->msg + rpc_conn->msg_read,
+			rpc_conn->msg_size - rpc_conn->msg_read);
+	if (msg_read < 0) {
+		if ((errno == EINTR) || (errno == EAGAIN))
+			return 0;
+		error("read(%d): %m", conn->newsockfd);
+		return -1;
+	} else if (msg_read == 0) {
+		error("read(%d): only read %zd of %u bytes", conn->newsockfd,
+		      rpc_conn->msg_read, rpc_conn->msg_size);
+		return -1;
 	}
+	rpc_conn->msg_read += msg_read;
+	if (rpc_conn->msg_read < rpc_conn->msg_size)
+		return 0;
+	return 1;
+}
+
+/* Hand a connection with a complete message to the RPC threads, or to be
+ * closed if it has no message.  Job and usage queries can run long, so
+ * they get threads of their own to not hold up other RPCs, in particular
+ * those of the slurmctld. */
+static void _conn_queue(rpc_conn_t *rpc_conn)
+{
+	rpc_queue_t *queue = &rpc_queue;
+
+	if (rpc_conn->msg && (rpc_conn->msg_read < rpc_conn->msg_size))
+		xfree(rpc_conn->msg);
+	if (rpc_conn->msg && _is_query(rpc_conn->msg))
+		queue = &query_queue;
+
+	slurm_mutex_lock(&rpc_lock);
+	if (list_enqueue(queue->conn_list, rpc_conn) == NULL)
+		fatal("list_enqueue: memory allocation failure");
+	pthread_cond_signal(&queue->cond);
+	slurm_mutex_unlock(&rpc_lock);
+}
+
+/* Give a connection back to the rpc_mgr to wait for its next message */
+static void _conn_done(rpc_conn_t *rpc_conn)
+{
+	xfree(rpc_conn->msg);
+	rpc_conn->msg_size = 0;
+	rpc_conn->msg_read = 0;
+	rpc_conn->size_read = 0;
+
+	slurm_mutex_lock(&rpc_lock);
+	if (list_enqueue(done_list, rpc_conn) == NULL)
+		fatal("list_enqueue: memory allocation failure");
+	_wake_rpc_mgr();
+	slurm_mutex_unlock(&rpc_lock);
+}
+
+static void _conn_close(rpc_conn_t *rpc_conn)
+{
+	slurmdbd_conn_t *conn = rpc_conn->conn;
 
 	acct_storage_g_close_connection(&conn->db_conn);
 	if (slurm_close_accepted_conn(conn->newsockfd) < 0)
 		error("close(%d): %m(%s)",  conn->newsockfd, conn->ip);
 	else
-		debug2("Closed connection %d uid(%d)", conn->newsockfd, uid);
+		debug2("Closed connection %d uid(%d)", conn->newsockfd,
+		       rpc_conn->uid);
 	xfree(conn->cluster_name);
 	xfree(conn);
-	_free_server_thread(pthread_self());
+	xfree(rpc_conn->msg);
+	xfree(rpc_conn);
+
+	slurm_mutex_lock(&rpc_lock);
+	if (conn_count > 0)
+		conn_count--;
+	else
+		error("conn_count underflow");
+	/* may be able to accept connections again */
+	_wake_rpc_mgr();
+	slurm_mutex_unlock(&rpc_lock);
+}
+
+static bool _is_query(char *msg)
+{
+	uint16_t msg_type;
+
+	memcpy(&msg_type, msg, sizeof(msg_type));
+	switch (ntohs(msg_type)) {
+	case DBD_GET_ASSOC_USAGE:
+	case DBD_GET_CLUSTER_USAGE:
+	case DBD_GET_JOBS:
+	case DBD_GET_JOBS_COND:
+	case DBD_GET_JOBS_CHUNKS:
+	case DBD_GET_WCKEY_USAGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Process the message read on a connection and send the response
+ * RET SLURM_SUCCESS or SLURM_ERROR if the connection should be closed */
+static int _process_msg(rpc_conn_t *rpc_conn)
+{
+	slurmdbd_conn_t *conn = rpc_conn->conn;
+	Buf buffer = NULL;
+	bool fini = false;
+	uint16_t msg_type;
+	int rc;
+
+	rc = proc_req(conn, rpc_conn->msg, rpc_conn->msg_size,
+		      rpc_conn->first, &buffer, &rpc_conn->uid);
+	rpc_conn->first = false;
+	if (rc != SLURM_SUCCESS && rc != ACCOUNTING_FIRST_REG) {
+		error("Processing last message from "
+		      "connection %d(%s) uid(%d)",
+		      conn->newsockfd, conn->ip, rpc_conn->uid);
+		if (rc == ESLURM_ACCESS_DENIED
+		    || rc == SLURM_PROTOCOL_VERSION_ERROR)
+			fini = true;
+
+		/* The slurmctld may have sent more batches behind one
+		 * which failed.  Close the connection without reading
+		 * them so they are sent again after the failed one. */
+		memcpy(&msg_type, rpc_conn->msg, sizeof(msg_type));
+		if ((ntohs(msg_type) == DBD_SEND_MULT_MSG) &&
+		    (conn->rpc_version >= SLURMDBD_PIPELINE_VERSION))
+			fini = true;
+	}
+
+	rc = send_dbd_resp(conn->newsockfd, buffer);
+	if (fini)
+		return SLURM_ERROR;
+	return rc;
+}
+
+static void * _rpc_thread(void *arg)
+{
+	rpc_queue_t *queue = (rpc_queue_t *) arg;
+	rpc_conn_t *rpc_conn;
+
+	while (1) {
+		slurm_mutex_lock(&rpc_lock);
+		while (!(rpc_conn = list_dequeue(queue->conn_list)) &&
+		       !shutdown_time)
+			pthread_cond_wait(&queue->cond, &rpc_lock);
+		slurm_mutex_unlock(&rpc_lock);
+		if (!rpc_conn)
+			break;
+
+		if (rpc_conn->msg && !shutdown_time &&
+		    (_process_msg(rpc_conn) == SLURM_SUCCESS))
+			_conn_done(rpc_conn);
+		else
+			_conn_close(rpc_conn);
+	}
 	return NULL;
 }
 
@@ -276,7 +514,9 @@ extern Buf make_dbd_rc_msg(uint16_t rpc_version,
 	return buffer;
 }
 
-static int _send_resp(slurm_fd_t fd, Buf buffer)
+/* Write a response to the connection and free the buffer
+ * RET SLURM_SUCCESS or SLURM_ERROR if it could not be written */
+extern int send_dbd_resp(slurm_fd_t fd, Buf buffer)
 {
 	uint32_t msg_size, nw_size;
 	ssize_t msg_wrote;
@@ -323,46 +563,6 @@ static int _tot_wait (struct timeval *start_time)
 	return msec_delay;
 }
 
-/* Wait until a file is readable, return false if can not be read */
-static bool _fd_readable(slurm_fd_t fd)
-{
-	struct pollfd ufds;
-	int rc;
-
-	ufds.fd     = fd;
-	ufds.events = POLLIN;
-	while (1) {
-		rc = poll(&ufds, 1, -1);
-		if (shutdown_time)
-			return false;
-		if (rc == -1) {
-			if ((errno == EINTR) || (errno == EAGAIN))
-				continue;
-			error("poll: %m");
-			return false;
-		}
-		if ((ufds.revents & POLLHUP) &&
-		    ((ufds.revents & POLLIN) == 0)) {
-			debug3("Read connection %d closed", fd);
-			return false;
-		}
-		if (ufds.revents & POLLNVAL) {
-			error("Connection %d is invalid", fd);
-			return false;
-		}
-		if (ufds.revents & POLLERR) {
-			error("Connection %d experienced an error", fd);
-			return false;
-		}
-		if ((ufds.revents & POLLIN) == 0) {
-			error("Connection %d events %d", fd, ufds.revents);
-			return false;
-		}
-		break;
-	}
-	return true;
-}
-
 /* Wait until a file is writeable,
  * RET false if can not be written to within 5 seconds */
 extern bool fd_writeable(slurm_fd_t fd)
@@ -397,9 +597,11 @@ extern bool fd_writeable(slurm_fd_t fd)
 		 * If not then exit out and notify the sender.  This
  		 * is here since a write doesn't always tell you the
 		 * socket is gone, but getting 0 back from a
-		 * nonblocking read means just that.
+		 * nonblocking read means just that.  Only peek, the
+		 * client may already have sent its next message.
 		 */
-		if (ufds.revents & POLLHUP || (recv(fd, &temp, 1, 0) == 0)) {
+		if (ufds.revents & POLLHUP ||
+		    (recv(fd, &temp, 1, MSG_PEEK) == 0)) {
 			debug3("Write connection %d closed", fd);
 			return false;
 		}
@@ -420,125 +622,68 @@ extern bool fd_writeable(slurm_fd_t fd)
 	return true;
 }
 
-/* Increment thread_count and don't return until its value is no larger
- *	than MAX_THREAD_COUNT,
- * RET index of free index in slave_pthread_id or -1 to exit */
-static int _wait_for_server_thread(void)
+/* Start the threads processing RPCs */
+static void _start_threads(void)
 {
-	bool print_it = true;
-	int i, rc = -1;
-
-	slurm_mutex_lock(&thread_count_lock);
-	while (1) {
-		if (shutdown_time)
-			break;
-
-		if (thread_count < MAX_THREAD_COUNT) {
-			thread_count++;
-			for (i=0; i<MAX_THREAD_COUNT; i++) {
-				if (slave_thread_id[i])
-					continue;
-				rc = i;
-				break;
-			}
-			if (rc == -1) {
-				/* thread_count and slave_thread_id
-				 * out of sync */
-				fatal("No free slave_thread_id");
-			}
-			break;
-		} else {
-			/* wait for state change and retry,
-			 * just a delay and not an error.
-			 * This can happen when the epilog completes
-			 * on a bunch of nodes at the same time, which
-			 * can easily happen for highly parallel jobs. */
-			if (print_it) {
-				static time_t last_print_time = 0;
-				time_t now = time(NULL);
-				if (difftime(now, last_print_time) > 2) {
-					verbose("thread_count over "
-						"limit (%d), waiting",
-						thread_count);
-					last_print_time = now;
-				}
-				print_it = false;
-			}
-			pthread_cond_wait(&thread_count_cond,
-			                  &thread_count_lock);
+	pthread_attr_t thread_attr;
+	rpc_queue_t *queue;
+	int i, retry_cnt;
+
+	slurm_mutex_lock(&rpc_lock);
+	rpc_queue.conn_list = list_create(NULL);
+	query_queue.conn_list = list_create(NULL);
+	done_list = list_create(NULL);
+	conn_count = 0;
+	slurm_mutex_unlock(&rpc_lock);
+
+	slurm_attr_init(&thread_attr);
+	for (i=0; i<(RPC_WORKER_COUNT + QUERY_WORKER_COUNT); i++) {
+		if (i < rpc_queue.thread_count)
+			queue = &rpc_queue;
+		else
+			queue = &query_queue;
+		retry_cnt = 0;
+		while (pthread_create(&thread_id[i], &thread_attr,
+				      _rpc_thread, (void *) queue)) {
+			if (retry_cnt++ > 5)
+				fatal("pthread_create error %m");
+			error("pthread_create failure: %m");
+			usleep(1000);	/* retry in 1 msec */
 		}
 	}
-	slurm_mutex_unlock(&thread_count_lock);
-	return rc;
+	slurm_attr_destroy(&thread_attr);
 }
 
-/* my_tid IN - Thread ID of spawned thread, 0 if no thread spawned */
-static void _free_server_thread(pthread_t my_tid)
+/* Wait for the threads processing RPCs to finish the RPC they are working
+ * on and close the connections left queued */
+static void _stop_threads(void)
 {
 	int i;
 
-	slurm_mutex_lock(&thread_count_lock);
-	if (thread_count > 0)
-		thread_count--;
-	else
-		error("thread_count underflow");
+	slurm_mutex_lock(&rpc_lock);
+	pthread_cond_broadcast(&rpc_queue.cond);
+	pthread_cond_broadcast(&query_queue.cond);
+	slurm_mutex_unlock(&rpc_lock);
 
-	if (my_tid) {
-		for (i=0; i<MAX_THREAD_COUNT; i++) {
-			if (slave_thread_id[i] != my_tid)
-				continue;
-			slave_thread_id[i] = (pthread_t) 0;
-			break;
-		}
-		if (i >= MAX_THREAD_COUNT)
-			error("Could not find slave_thread_id");
+	for (i=0; i<(RPC_WORKER_COUNT + QUERY_WORKER_COUNT); i++) {
+		if (thread_id[i] == 0)
+			continue;
+		pthread_join(thread_id[i], NULL);
+		slurm_mutex_lock(&rpc_lock);
+		thread_id[i] = (pthread_t) 0;
+		slurm_mutex_unlock(&rpc_lock);
 	}
-
-	pthread_cond_broadcast(&thread_count_cond);
-	slurm_mutex_unlock(&thread_count_lock);
 }
 
-/* Wait for all RPC handler threads to exit.
- * After one second, start sending SIGKILL to the threads. */
-static void _wait_for_thread_fini(void)
+/* Wake the rpc_mgr from poll()
+ * NOTE: rpc_lock must be locked */
+static void _wake_rpc_mgr(void)
 {
-	int i, j;
-
-	if (thread_count == 0)
-		return;
-	usleep(500000);	/* Give the threads 500 msec to clean up */
+	char c = 0;
 
-	/* Interupt any hung I/O */
-	slurm_mutex_lock(&thread_count_lock);
-	for (j=0; j<MAX_THREAD_COUNT; j++) {
-		if (slave_thread_id[j] == 0)
-			continue;
-		pthread_kill(slave_thread_id[j], SIGUSR1);
-	}
-	slurm_mutex_unlock(&thread_count_lock);
-	usleep(100000);	/* Give the threads 100 msec to clean up */
-
-	for (i=0; ; i++) {
-		if (thread_count == 0)
-			return;
-
-		slurm_mutex_lock(&thread_count_lock);
-		for (j=0; j<MAX_THREAD_COUNT; j++) {
-			if (slave_thread_id[j] == 0)
-				continue;
-			info("rpc_mgr sending SIGKILL to thread %lu",
-			     (unsigned long) slave_thread_id[j]);
-			if (pthread_kill(slave_thread_id[j], SIGKILL)) {
-				slave_thread_id[j] = 0;
-				if (thread_count > 0)
-					thread_count--;
-				else
-					error("thread_count underflow");
-			}
-		}
-		slurm_mutex_unlock(&thread_count_lock);
-		sleep(1);
-	}
+	if ((wake_fd[1] >= 0) && (write(wake_fd[1], &c, 1) < 0) &&
+	    (errno != EAGAIN))
+		error("rpc_mgr wake write: %m");
 }
 
 static void _sig_handler(int signal)
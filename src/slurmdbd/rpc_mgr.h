@@ -49,6 +49,10 @@ extern bool fd_writeable(slurm_fd_t fd);
 extern Buf make_dbd_rc_msg(uint16_t rpc_version,
 			   int rc, char *comment, uint16_t sent_type);
 
+/* Write the message in buffer to the connection, buffer is freed
+ * RET SLURM_SUCCESS or SLURM_ERROR if it could not be written */
+extern int send_dbd_resp(slurm_fd_t fd, Buf buffer);
+
 /* Process incoming RPCs. Meant to execute as a pthread */
 extern void *rpc_mgr(void *no_data);
 
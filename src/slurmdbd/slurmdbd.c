@@ -225,8 +225,14 @@ int main(int argc, char *argv[])
 		}
 
 		/* this is only ran if not backup */
-		if (rollup_handler_thread)
+		if (rollup_handler_thread) {
 			pthread_join(rollup_handler_thread, NULL);
+			/* The thread ID may be reused by an RPC thread,
+			 * do not let _rollup_handler_cancel() cancel it */
+			slurm_mutex_lock(&rollup_lock);
+			rollup_handler_thread = 0;
+			slurm_mutex_unlock(&rollup_lock);
+		}
 		if (rpc_handler_thread)
 			pthread_join(rpc_handler_thread, NULL);
 
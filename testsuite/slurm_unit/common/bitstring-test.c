@@ -196,6 +196,81 @@ main(int argc, char *argv[])
 		TEST(bit_equal(bs, bs2), "bitstring");
 	}
 
+	note("Testing word operations against bit by bit results");
+	{
+		int sizes[] = { 1, 31, 32, 33, 63, 64, 65, 1000, 10007, 0 };
+		int i, n, bit, cnt, ovl, first, last, first_clr, sub;
+		int ok = 1;
+		bitstr_t *bs1, *bs2;
+
+		srand(1);
+		for (i = 0; sizes[i]; i++) {
+			n = sizes[i];
+			bs1 = bit_alloc(n);
+			bs2 = bit_alloc(n);
+			for (bit = 0; bit < n; bit++) {
+				if (rand() % 3)
+					bit_set(bs1, bit);
+				if (rand() % 2)
+					bit_set(bs2, bit);
+			}
+			/* leaves bits past the end set */
+			bit_not(bs1);
+
+			cnt = ovl = 0;
+			first = last = first_clr = -1;
+			sub = 1;
+			for (bit = 0; bit < n; bit++) {
+				if (bit_test(bs1, bit)) {
+					cnt++;
+					if (first == -1)
+						first = bit;
+					last = bit;
+					if (bit_test(bs2, bit))
+						ovl++;
+					else
+						sub = 0;
+				} else if (first_clr == -1)
+					first_clr = bit;
+			}
+			if ((bit_set_count(bs1) != cnt) ||
+			    (bit_overlap(bs1, bs2) != ovl) ||
+			    (bit_ffs(bs1) != first) ||
+			    (bit_fls(bs1) != last) ||
+			    (bit_ffc(bs1) != first_clr) ||
+			    (bit_super_set(bs1, bs2) != sub))
+				ok = 0;
+
+			bit_and_not(bs2, bs1);
+			for (bit = 0; bit < n; bit++) {
+				if (bit_test(bs1, bit) && bit_test(bs2, bit))
+					ok = 0;
+			}
+			bit_free(bs1);
+			bit_free(bs2);
+		}
+		TEST(ok, "word operations");
+
+		bs1 = bit_alloc(1000);
+		bit_nset(bs1, 0, 999);
+		TEST(bit_ffc(bs1) == -1, "ffc full");
+		bit_clear(bs1, 500);
+		TEST(bit_ffc(bs1) == 500, "ffc");
+		bit_nclear(bs1, 0, 499);
+		TEST(bit_nffs(bs1, 499) == 501, "nffs at end");
+		TEST(bit_nffc(bs1, 501) == 0, "nffc whole words");
+		bit_nclear(bs1, 900, 999);
+		TEST(bit_nffc(bs1, 100) == 0, "nffc");
+		TEST(bit_nffc(bs1, 600) == -1, "nffc");
+		TEST(bit_noc(bs1, 100, 950) == 0, "noc seed too large");
+		TEST(bit_noc(bs1, 100, 850) == 900, "noc after seed");
+		TEST(bit_noc(bs1, 50, 450) == 450, "noc at seed");
+		TEST(bit_noc(bs1, 100, 450) == 900, "noc after seed");
+		TEST(bit_noc(bs1, 200, 450) == 0, "noc before seed");
+		TEST(bit_noc(bs1, 200, 250) == 250, "noc at seed");
+		bit_free(bs1);
+	}
+
 	totals();
 	return failed;
 }
@@ -0,0 +1,100 @@
+/* Test of src/common/hostlist.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/hostlist.h>
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+int
+main(int argc, char *argv[])
+{
+	note("Testing hostlist lookups");
+	{
+		hostlist_t hl = hostlist_create("n[1-5,7],foo,m[01-03]");
+		char buf[256];
+
+		TEST(hostlist_count(hl) == 10, "count");
+		TEST(hostlist_find(hl, "n1") == 0, "find first");
+		TEST(hostlist_find(hl, "n7") == 5, "find in second range");
+		TEST(hostlist_find(hl, "foo") == 6, "find host without suffix");
+		TEST(hostlist_find(hl, "m02") == 8, "find padded host");
+		TEST(hostlist_find(hl, "n6") == -1, "find missing host");
+		TEST(hostlist_find(hl, "n01") == -1, "find wrong width");
+		TEST(hostlist_find(hl, "m2") == -1, "find unpadded host");
+		TEST(hostlist_find(hl, "fo") == -1, "find prefix only");
+
+		TEST(hostlist_delete_host(hl, "n3") == 1, "delete host");
+		TEST(hostlist_delete_host(hl, "n3") == 0, "delete host again");
+		TEST(hostlist_count(hl) == 9, "count after delete");
+		TEST(hostlist_find(hl, "n4") == 2, "find after delete");
+		hostlist_ranged_string(hl, sizeof(buf), buf);
+		TEST(!strcmp(buf, "n[1-2,4-5,7],foo,m[01-03]"),
+		     "ranged string after delete");
+		hostlist_destroy(hl);
+	}
+	note("Testing hostlist_uniq");
+	{
+		hostlist_t hl = hostlist_create("n[3,1,2,2,5],n[4-6],bar,bar");
+		char buf[256];
+
+		hostlist_uniq(hl);
+		TEST(hostlist_count(hl) == 7, "uniq count");
+		hostlist_ranged_string(hl, sizeof(buf), buf);
+		TEST(!strcmp(buf, "bar,n[1-6]"), "uniq ranged string");
+		hostlist_destroy(hl);
+	}
+	note("Testing range parsing errors");
+	{
+		TEST(hostlist_create("n[5-3]") == NULL, "reversed range");
+		TEST(hostlist_create("n[1-2,a]") == NULL, "bad range");
+	}
+	note("Testing hostsets");
+	{
+		hostset_t set = hostset_create("n[10,1-5],m5,n[7-8],foo");
+
+		TEST(hostset_count(set) == 10, "set count");
+		TEST(hostset_within(set, "n[2-4],m5,foo"), "within");
+		TEST(!hostset_within(set, "n[5-7]"), "not within");
+		TEST(hostset_intersects(set, "x1,n8"), "intersects");
+		TEST(!hostset_intersects(set, "n[6,9,11],m4,fo"),
+		     "does not intersect");
+		TEST(hostset_insert(set, "n[6,9,11-12]") == 4, "insert");
+		TEST(hostset_insert(set, "n[1-3],m5") == 0,
+		     "insert duplicates");
+		TEST(hostset_count(set) == 14, "count after insert");
+		TEST(hostset_within(set, "n[1-12]"), "within after insert");
+		TEST(hostset_find(set, "n1") == 2, "find in set");
+		TEST(hostset_delete(set, "n[6-7]") == 2, "delete from set");
+		TEST(!hostset_intersects(set, "n[6-7]"), "deleted from set");
+		TEST(hostset_within(set, "n[5,8]"), "neighbours kept");
+		hostset_destroy(set);
+	}
+	note("Testing hostsets with zero padded and unpadded ranges");
+	{
+		hostset_t set = hostset_create("n[1-100],n002,n030");
+
+		TEST(hostset_within(set, "n100") == 1, "within unpadded range");
+		TEST(hostset_within(set, "n030") == 1, "within padded host");
+		TEST(hostset_within(set, "n101") == 0, "not within");
+		hostset_destroy(set);
+
+		set = hostset_create("n[1-100]");
+		TEST(hostset_insert(set, "n002") == 1, "insert padded host");
+		TEST(hostset_within(set, "n[2,100]"), "within after insert");
+		TEST(hostset_within(set, "n002"), "padded host within");
+		hostset_destroy(set);
+	}
+
+	totals();
+	return failed;
+}